@@ -28,11 +28,12 @@
 
 #include "cli/cmd_report.hpp"
 
-#include <algorithm>
 #include <cstddef>
 #include <cstdlib>
+#include <istream>
 #include <map>
 #include <ostream>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -73,66 +74,14 @@ using utils::optional;
 namespace {
 
 
-/// Generates a plain-text report intended to be printed to the console.
-class report_console_hooks : public drivers::scan_results::base_hooks {
+/// Generates the details of a plain-text report to be printed to the console.
+///
+/// The execution context and the test cases are printed as they are read from
+/// the results file, so nothing is held in memory between results.
+class report_details_hooks : public drivers::scan_results::base_hooks {
     /// Stream to which to write the report.
     std::ostream& _output;
 
-    /// Whether to include details in the report or not.
-    const bool _verbose;
-
-    /// Collection of result types to include in the report.
-    const cli::result_types& _results_filters;
-
-    /// Path to the results file being read.
-    const fs::path& _results_file;
-
-    /// The start time of the first test.
-    optional< utils::datetime::timestamp > _start_time;
-
-    /// The end time of the last test.
-    optional< utils::datetime::timestamp > _end_time;
-
-    /// The total run time of the tests.  Note that we cannot subtract _end_time
-    /// from _start_time to compute this due to parallel execution.
-    utils::datetime::delta _runtime;
-
-    /// Representation of a single result.
-    struct result_data {
-        /// The relative path to the test program.
-        utils::fs::path binary_path;
-
-        /// The name of the test case.
-        std::string test_case_name;
-
-        /// The result of the test case.
-        model::test_result result;
-
-        /// The duration of the test case execution.
-        utils::datetime::delta duration;
-
-        /// Constructs a new results data.
-        ///
-        /// \param binary_path_ The relative path to the test program.
-        /// \param test_case_name_ The name of the test case.
-        /// \param result_ The result of the test case.
-        /// \param duration_ The duration of the test case execution.
-        result_data(const utils::fs::path& binary_path_,
-                    const std::string& test_case_name_,
-                    const model::test_result& result_,
-                    const utils::datetime::delta& duration_) :
-            binary_path(binary_path_), test_case_name(test_case_name_),
-            result(result_), duration(duration_)
-        {
-        }
-    };
-
-    /// Results received, broken down by their type.
-    ///
-    /// Note that this may not include all results, as keeping the whole list in
-    /// memory may be too much.
-    std::map< model::test_result_type, std::vector< result_data > > _results;
-
     /// Pretty-prints the value of an environment variable.
     ///
     /// \param indent Prefix for the lines to print.  Continuation lines
@@ -176,6 +125,22 @@ class report_console_hooks : public drivers::scan_results::base_hooks {
         }
     }
 
+    /// Prints an output of a test case, unless it is empty.
+    ///
+    /// The contents are copied piece by piece so that large outputs are not
+    /// loaded into memory.
+    ///
+    /// \param title Name of the output, printed before its contents.
+    /// \param input The contents of the output.
+    void
+    print_output(const char* title, std::istream& input)
+    {
+        if (input.peek() == std::istream::traits_type::eof())
+            return;
+        _output << "\n" << title << ":\n";
+        utils::copy_stream(input, _output);
+    }
+
     /// Dumps a detailed view of the test case.
     ///
     /// \param result_iter Results iterator pointing at the test case to be
@@ -183,8 +148,7 @@ class report_console_hooks : public drivers::scan_results::base_hooks {
     void
     print_test_case_and_result(const store::results_iterator& result_iter)
     {
-        const model::test_case& test_case =
-            result_iter.test_program()->find(result_iter.test_case_name());
+        const model::test_case test_case = result_iter.test_case();
         const model::properties_map props =
             test_case.get_metadata().to_properties();
 
@@ -212,61 +176,77 @@ class report_console_hooks : public drivers::scan_results::base_hooks {
             }
         }
 
-        const std::string stdout_contents = result_iter.stdout_contents();
-        if (!stdout_contents.empty()) {
-            _output << "\n"
-                    << "Standard output:\n"
-                    << stdout_contents;
-        }
-
-        const std::string stderr_contents = result_iter.stderr_contents();
-        if (!stderr_contents.empty()) {
-            _output << "\n"
-                    << "Standard error:\n"
-                    << stderr_contents;
-        }
+        print_output("Standard output", *result_iter.stdout_stream());
+        print_output("Standard error", *result_iter.stderr_stream());
     }
 
-    /// Counts how many results of a given type have been received.
+public:
+    /// Constructor for the hooks.
     ///
-    /// \param type Test result type to count results for.
+    /// \param [out] output_ Stream to which to write the report.
+    explicit report_details_hooks(std::ostream& output_) :
+        _output(output_)
+    {
+    }
+
+    /// Callback executed when the context is loaded.
     ///
-    /// \return The number of test results with \p type.
-    std::size_t
-    count_results(const model::test_result_type type)
+    /// \param context The context loaded from the database.
+    void
+    got_context(const model::context& context)
     {
-        const std::map< model::test_result_type,
-                        std::vector< result_data > >::const_iterator iter =
-            _results.find(type);
-        if (iter == _results.end())
-            return 0;
-        else
-            return (*iter).second.size();
+        print_context(context);
     }
 
-    /// Prints a set of results.
+    /// Callback executed when a test results is found.
     ///
-    /// \param type Test result type to print results for.
-    /// \param title Title used when printing results.
+    /// \param iter Container for the test result's data.
     void
-    print_results(const model::test_result_type type,
-                  const char* title)
+    got_result(store::results_iterator& iter)
     {
-        const std::map< model::test_result_type,
-                        std::vector< result_data > >::const_iterator iter2 =
-            _results.find(type);
-        if (iter2 == _results.end())
-            return;
-        const std::vector< result_data >& all = (*iter2).second;
-
-        _output << F("===> %s\n") % title;
-        for (std::vector< result_data >::const_iterator iter = all.begin();
-             iter != all.end(); iter++) {
-            _output << F("%s:%s  ->  %s  [%s]\n") % (*iter).binary_path %
-                (*iter).test_case_name %
-                cli::format_result((*iter).result) %
-                cli::format_delta((*iter).duration);
-        }
+        print_test_case_and_result(iter);
+    }
+};
+
+
+/// Generates a plain-text report intended to be printed to the console.
+///
+/// The results must be received grouped by their type in the order in which
+/// the user requested them so that the listing of each type can be printed as
+/// the results come.  This keeps the memory usage of the report constant
+/// regardless of the number of results.
+class report_console_hooks : public drivers::scan_results::base_hooks {
+    /// Stream to which to write the report.
+    std::ostream& _output;
+
+    /// Whether to include details in the report or not.
+    const bool _verbose;
+
+    /// Path to the results file being read.
+    const fs::path& _results_file;
+
+    /// Titles of the listings of each result type.
+    std::map< model::test_result_type, const char* > _titles;
+
+    /// Type of the last result printed, if any.
+    optional< model::test_result_type > _last_type;
+
+    /// Counts how many results of a given type exist.
+    ///
+    /// \param totals The aggregated data of all results.
+    /// \param type Test result type to count results for.
+    ///
+    /// \return The number of test results with \p type.
+    static std::size_t
+    count_results(const store::results_totals_map& totals,
+                  const model::test_result_type type)
+    {
+        const store::results_totals_map::const_iterator iter =
+            totals.find(type);
+        if (iter == totals.end())
+            return 0;
+        else
+            return (*iter).second.count;
     }
 
 public:
@@ -274,28 +254,24 @@ public:
     ///
     /// \param [out] output_ Stream to which to write the report.
     /// \param verbose_ Whether to include details in the output or not.
-    /// \param results_filters_ The result types to include in the report.
-    ///     Cannot be empty.
     /// \param results_file_ Path to the results file being read.
     report_console_hooks(std::ostream& output_, const bool verbose_,
-                         const cli::result_types& results_filters_,
                          const fs::path& results_file_) :
         _output(output_),
         _verbose(verbose_),
-        _results_filters(results_filters_),
         _results_file(results_file_)
     {
-        PRE(!results_filters_.empty());
+        _titles[model::test_result_broken] = "Broken tests";
+        _titles[model::test_result_expected_failure] = "Expected failures";
+        _titles[model::test_result_failed] = "Failed tests";
+        _titles[model::test_result_passed] = "Passed tests";
+        _titles[model::test_result_skipped] = "Skipped tests";
     }
 
     /// Callback executed when the context is loaded.
-    ///
-    /// \param context The context loaded from the database.
     void
-    got_context(const model::context& context)
+    got_context(const model::context& /* context */)
     {
-        if (_verbose)
-            print_context(context);
     }
 
     /// Callback executed when a test results is found.
@@ -304,72 +280,72 @@ public:
     void
     got_result(store::results_iterator& iter)
     {
-        if (!_start_time || _start_time.get() > iter.start_time())
-            _start_time = iter.start_time();
-        if (!_end_time || _end_time.get() < iter.end_time())
-            _end_time = iter.end_time();
-
-        const datetime::delta duration = iter.end_time() - iter.start_time();
-
-        _runtime += duration;
         const model::test_result result = iter.result();
-        _results[result.type()].push_back(
-            result_data(iter.test_program()->relative_path(),
-                        iter.test_case_name(), iter.result(), duration));
-
-        if (_verbose) {
-            // TODO(jmmv): _results_filters is a list and is small enough for
-            // std::find to not be an expensive operation here (probably).  But
-            // we should be using a std::set instead.
-            if (std::find(_results_filters.begin(), _results_filters.end(),
-                          iter.result().type()) != _results_filters.end()) {
-                print_test_case_and_result(iter);
-            }
+
+        if (!_last_type || _last_type.get() != result.type()) {
+            const std::map< model::test_result_type, const char* >::
+                const_iterator match = _titles.find(result.type());
+            INV_MSG(match != _titles.end(), "Conditional does not match user "
+                    "input validation in parse_types()");
+            _output << F("===> %s\n") % (*match).second;
+            _last_type = result.type();
         }
+
+        _output << F("%s:%s  ->  %s  [%s]\n") %
+            iter.test_program()->relative_path() % iter.test_case_name() %
+            cli::format_result(result) %
+            cli::format_delta(iter.end_time() - iter.start_time());
     }
 
     /// Prints the tests summary.
+    ///
+    /// \param r The result of the driver execution.
     void
-    end(const drivers::scan_results::result& /* r */)
+    end(const drivers::scan_results::result& r)
     {
-        typedef std::map< model::test_result_type, const char* > types_map;
-
-        types_map titles;
-        titles[model::test_result_broken] = "Broken tests";
-        titles[model::test_result_expected_failure] = "Expected failures";
-        titles[model::test_result_failed] = "Failed tests";
-        titles[model::test_result_passed] = "Passed tests";
-        titles[model::test_result_skipped] = "Skipped tests";
-
-        for (cli::result_types::const_iterator iter = _results_filters.begin();
-             iter != _results_filters.end(); ++iter) {
-            const types_map::const_iterator match = titles.find(*iter);
-            INV_MSG(match != titles.end(), "Conditional does not match user "
-                    "input validation in parse_types()");
-            print_results((*match).first, (*match).second);
-        }
-
-        const std::size_t broken = count_results(model::test_result_broken);
-        const std::size_t failed = count_results(model::test_result_failed);
-        const std::size_t passed = count_results(model::test_result_passed);
-        const std::size_t skipped = count_results(model::test_result_skipped);
+        const std::size_t broken = count_results(r.totals,
+                                                 model::test_result_broken);
+        const std::size_t failed = count_results(r.totals,
+                                                 model::test_result_failed);
+        const std::size_t passed = count_results(r.totals,
+                                                 model::test_result_passed);
+        const std::size_t skipped = count_results(r.totals,
+                                                  model::test_result_skipped);
         const std::size_t xfail = count_results(
-            model::test_result_expected_failure);
+            r.totals, model::test_result_expected_failure);
         const std::size_t total = broken + failed + passed + skipped + xfail;
 
+        // The total run time is the sum of the durations of the tests; we
+        // cannot subtract the start time from the end time to compute it due
+        // to parallel execution.
+        optional< datetime::timestamp > start_time;
+        optional< datetime::timestamp > end_time;
+        datetime::delta runtime;
+        for (store::results_totals_map::const_iterator iter = r.totals.begin();
+             iter != r.totals.end(); ++iter) {
+            const store::results_totals& totals = (*iter).second;
+            if (!start_time || start_time.get() > totals.start_time)
+                start_time = totals.start_time;
+            if (!end_time || end_time.get() < totals.end_time)
+                end_time = totals.end_time;
+            runtime += totals.runtime;
+        }
+
         _output << "===> Summary\n";
         _output << F("Results read from %s\n") % _results_file;
+        if (!r.completed)
+            _output << "Results are incomplete: the test run was interrupted\n";
         _output << F("Test cases: %s total, %s skipped, %s expected failures, "
                      "%s broken, %s failed\n") %
             total % skipped % xfail % broken % failed;
-        if (_verbose && _start_time) {
-            INV(_end_time);
+        if (_verbose && start_time) {
+            INV(end_time);
             _output << F("Start time: %s\n") %
-                    _start_time.get().to_iso8601_in_utc();
+                    start_time.get().to_iso8601_in_utc();
             _output << F("End time:   %s\n") %
-                    _end_time.get().to_iso8601_in_utc();
+                    end_time.get().to_iso8601_in_utc();
         }
-        _output << F("Total time: %s\n") % cli::format_delta(_runtime);
+        _output << F("Total time: %s\n") % cli::format_delta(runtime);
     }
 };
 
@@ -410,11 +386,26 @@ cmd_report::run(cmdline::ui* ui,
     const fs::path results_file = layout::find_results(
         results_file_open(cmdline));
 
+    const std::set< engine::test_filter > filters = parse_filters(
+        cmdline.arguments());
     const result_types types = get_result_types(cmdline);
-    report_console_hooks hooks(*output.get(), cmdline.has_option("verbose"),
-                               types, results_file);
+    const bool verbose = cmdline.has_option("verbose");
+
+    // The details of the test cases come first, in the order in which they
+    // are stored, and the listings grouped by type come after them.  Doing
+    // two passes over the results file lets us print both without holding the
+    // results in memory.
+    if (verbose) {
+        report_details_hooks details_hooks(*output.get());
+        drivers::scan_results::drive(
+            results_file, filters,
+            std::set< model::test_result_type >(types.begin(), types.end()),
+            details_hooks);
+    }
+
+    report_console_hooks hooks(*output.get(), verbose, results_file);
     const drivers::scan_results::result result = drivers::scan_results::drive(
-        results_file, parse_filters(cmdline.arguments()), hooks);
+        results_file, filters, types, hooks);
 
     return report_unused_filters(result.unused_filters, ui) ?
         EXIT_FAILURE : EXIT_SUCCESS;
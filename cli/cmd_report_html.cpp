@@ -28,14 +28,24 @@
 
 #include "cli/cmd_report_html.hpp"
 
-#include <algorithm>
 #include <cerrno>
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <sstream>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 #include "cli/common.ipp"
 #include "drivers/scan_results.hpp"
+#include "engine/config.hpp"
 #include "engine/filters.hpp"
 #include "model/context.hpp"
 #include "model/metadata.hpp"
@@ -44,6 +54,7 @@
 #include "model/test_result.hpp"
 #include "store/layout.hpp"
 #include "store/read_transaction.hpp"
+#include "utils/cmdline/exceptions.hpp"
 #include "utils/cmdline/options.hpp"
 #include "utils/cmdline/parser.ipp"
 #include "utils/cmdline/ui.hpp"
@@ -53,7 +64,13 @@
 #include "utils/fs/exceptions.hpp"
 #include "utils/fs/operations.hpp"
 #include "utils/fs/path.hpp"
+#include "utils/logging/macros.hpp"
+#include "utils/noncopyable.hpp"
 #include "utils/optional.ipp"
+#include "utils/sanity.hpp"
+#include "utils/signals/misc.hpp"
+#include "utils/stream.hpp"
+#include "utils/text/exceptions.hpp"
 #include "utils/text/templates.hpp"
 
 namespace cmdline = utils::cmdline;
@@ -61,6 +78,7 @@ namespace config = utils::config;
 namespace datetime = utils::datetime;
 namespace fs = utils::fs;
 namespace layout = store::layout;
+namespace signals = utils::signals;
 namespace text = utils::text;
 
 using utils::optional;
@@ -69,6 +87,18 @@ using utils::optional;
 namespace {
 
 
+/// Maximum size of an output of a test case to hand over to another thread.
+///
+/// The pages of the test cases with larger outputs are written by the thread
+/// that reads the results so that the outputs can be streamed from the
+/// database instead of being loaded into memory.
+static const std::size_t max_queued_output = 1024 * 1024;
+
+
+/// Number of test cases listed in each page of the paginated listings.
+static const std::size_t test_cases_per_page = 1000;
+
+
 /// Creates the report's top directory and fails if it exists.
 ///
 /// \param directory The directory to create.
@@ -141,6 +171,398 @@ add_map(text::templates_def& templates, const config::properties_map& props,
 }
 
 
+/// Copies an output of a test case into its HTML file.
+///
+/// \param input The output of the test case.
+/// \param output The stream to which to write the output.
+static void
+copy_output(std::istream* input, std::ostream& output)
+{
+    utils::copy_stream(*input, output);
+}
+
+
+/// Writes the HTML file of a test result.
+///
+/// The outputs of the test case are defined as the stdout and stderr callback
+/// variables of the templates, if not empty, so that they are copied into the
+/// file piece by piece instead of being loaded into memory.
+///
+/// \param page_template The compiled template of the page.
+/// \param templates The templates to use.
+/// \param output_path The path to the file to create.
+/// \param stdout_stream The standard output of the test case.
+/// \param stderr_stream The standard error of the test case.
+///
+/// \throw text::error If there is any problem applying the templates.
+static void
+write_result_page(const text::compiled_template& page_template,
+                  text::templates_def templates,
+                  const fs::path& output_path,
+                  std::istream& stdout_stream,
+                  std::istream& stderr_stream)
+{
+    if (stdout_stream.peek() != std::istream::traits_type::eof())
+        templates.add_callback("stdout", std::bind(copy_output, &stdout_stream,
+                                                   std::placeholders::_1));
+    if (stderr_stream.peek() != std::istream::traits_type::eof())
+        templates.add_callback("stderr", std::bind(copy_output, &stderr_stream,
+                                                   std::placeholders::_1));
+
+    std::ofstream output(output_path.c_str());
+    if (!output)
+        throw text::error(F("Failed to open %s for write") % output_path);
+    page_template.render(templates, output);
+}
+
+
+/// Reads an output of a test case into memory if it is small enough.
+///
+/// \param input The stream to read from.
+/// \param [out] contents The contents read from the stream.
+///
+/// \return True if the whole stream was read; false if it is larger than
+/// max_queued_output, in which case the stream has been partially consumed.
+static bool
+read_small_output(std::istream& input, std::string& contents)
+{
+    char buffer[64 * 1024];
+    while (input.good()) {
+        input.read(buffer, sizeof(buffer));
+        contents.append(buffer, input.gcount());
+        if (contents.length() > max_queued_output)
+            return false;
+    }
+    return true;
+}
+
+
+/// HTML file of a test result waiting to be written.
+struct result_page {
+    /// The templates to apply to the page.
+    text::templates_def templates;
+
+    /// The path to the file to create.
+    fs::path output_path;
+
+    /// The standard output of the test case.
+    std::string stdout_contents;
+
+    /// The standard error of the test case.
+    std::string stderr_contents;
+
+    /// Constructor.
+    ///
+    /// \param templates_ The templates to apply to the page.
+    /// \param output_path_ The path to the file to create.
+    result_page(const text::templates_def& templates_,
+                const fs::path& output_path_) :
+        templates(templates_), output_path(output_path_)
+    {
+    }
+};
+
+
+/// Pool of threads that write the HTML files of the test results.
+///
+/// The files are independent of each other, so they can be written in any
+/// order and the result is the same as writing them one after the other.
+/// The number of queued pages is bounded so that the memory used does not
+/// grow with the number of results.
+class result_pages_writer : utils::noncopyable {
+    /// The compiled template of the pages.
+    const text::compiled_template _template;
+
+    /// Maximum number of pages waiting to be written.
+    const std::size_t _max_pending;
+
+    /// Protects all the mutable fields below.
+    std::mutex _mutex;
+
+    /// Signals the workers that there are pages to write or that they must
+    /// terminate.
+    std::condition_variable _work_available;
+
+    /// Signals the producer that there is room for more pages in the queue.
+    std::condition_variable _space_available;
+
+    /// Pages pending to be written.
+    std::deque< result_page > _pending;
+
+    /// Whether the workers have been asked to terminate.
+    bool _stopping;
+
+    /// First error found while writing a page; empty if none.
+    std::string _error;
+
+    /// Background threads writing the pages.
+    std::vector< std::thread > _workers;
+
+    /// Body of the background threads.
+    void
+    worker(void)
+    {
+        std::unique_lock< std::mutex > lock(_mutex);
+        for (;;) {
+            while (_pending.empty() && !_stopping)
+                _work_available.wait(lock);
+            if (_pending.empty())
+                return;
+
+            const result_page page = _pending.front();
+            _pending.pop_front();
+            _space_available.notify_one();
+            lock.unlock();
+
+            std::string error;
+            try {
+                std::istringstream stdout_stream(page.stdout_contents);
+                std::istringstream stderr_stream(page.stderr_contents);
+                write_result_page(_template, page.templates, page.output_path,
+                                  stdout_stream, stderr_stream);
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+
+            lock.lock();
+            if (!error.empty() && _error.empty()) {
+                _error = error;
+                _pending.clear();
+                _space_available.notify_all();
+            }
+        }
+    }
+
+    /// Stops and waits for all the background threads.
+    ///
+    /// The threads write all the pages still in the queue before terminating.
+    void
+    join(void)
+    {
+        {
+            std::lock_guard< std::mutex > lock(_mutex);
+            _stopping = true;
+        }
+        _work_available.notify_all();
+        for (std::vector< std::thread >::iterator iter = _workers.begin();
+             iter != _workers.end(); ++iter)
+            (*iter).join();
+        _workers.clear();
+    }
+
+public:
+    /// Constructor.
+    ///
+    /// \param template_ The compiled template of the pages.
+    /// \param nworkers Number of background threads to start.
+    result_pages_writer(const text::compiled_template& template_,
+                        const std::size_t nworkers) :
+        _template(template_), _max_pending(2 * nworkers), _stopping(false)
+    {
+        PRE(nworkers > 0);
+
+        try {
+            for (std::size_t i = 0; i < nworkers; ++i)
+                _workers.push_back(signals::start_masked_thread(
+                    std::bind(&result_pages_writer::worker, this)));
+        } catch (...) {
+            join();
+            throw;
+        }
+    }
+
+    /// Destructor.
+    ///
+    /// Pages not yet written by the time this is called are discarded; use
+    /// finish() to wait for them.
+    ~result_pages_writer(void)
+    {
+        {
+            std::lock_guard< std::mutex > lock(_mutex);
+            _pending.clear();
+        }
+        join();
+    }
+
+    /// Queues a page to be written.
+    ///
+    /// This blocks while the queue is full.
+    ///
+    /// \param page The page to write.
+    ///
+    /// \throw std::runtime_error If writing any previous page failed.
+    void
+    write(const result_page& page)
+    {
+        std::unique_lock< std::mutex > lock(_mutex);
+        while (_pending.size() >= _max_pending && _error.empty())
+            _space_available.wait(lock);
+        if (!_error.empty())
+            throw std::runtime_error(_error);
+        _pending.push_back(page);
+        _work_available.notify_one();
+    }
+
+    /// Waits for all the queued pages to be written.
+    ///
+    /// \throw std::runtime_error If writing any page failed.
+    void
+    finish(void)
+    {
+        join();
+        if (!_error.empty())
+            throw std::runtime_error(_error);
+    }
+};
+
+
+/// Paginated listing of the test cases with a particular result.
+///
+/// Only the test cases of the page being filled are kept in memory, so the
+/// memory used does not grow with the number of test cases.
+class test_list_writer : utils::noncopyable {
+    /// User interface object where to report progress.
+    cmdline::ui* _ui;
+
+    /// The directory in which to create the pages.
+    const fs::path _directory;
+
+    /// Compiled template for the pages.
+    const text::compiled_template _template;
+
+    /// Prefix of the names of the pages.
+    const std::string _name;
+
+    /// Title of the pages.
+    const std::string _title;
+
+    /// Identifiers of the test cases of the page being filled.
+    std::vector< std::string > _test_cases;
+
+    /// Names of the HTML files of the test cases of the page being filled.
+    std::vector< std::string > _test_cases_files;
+
+    /// Number of pages written so far.
+    std::size_t _pages;
+
+    /// Number of test cases added so far.
+    std::size_t _total;
+
+    /// Computes the name of a page.
+    ///
+    /// \param number The number of the page, starting at 1.
+    ///
+    /// \return A basename for the page.
+    std::string
+    page_name(const std::size_t number) const
+    {
+        return F("%s_%s.html") % _name % number;
+    }
+
+    /// Writes the page being filled.
+    ///
+    /// \param has_next Whether there are more test cases after this page.
+    ///
+    /// \throw fs::error If the directory for the pages cannot be created.
+    /// \throw text::error If there is any problem applying the templates.
+    void
+    write_page(const bool has_next)
+    {
+        PRE(!_test_cases.empty());
+
+        if (_pages == 0 && !fs::exists(_directory))
+            fs::mkdir(_directory, 0755);
+        ++_pages;
+
+        text::templates_def templates;
+        templates.add_variable("css", "../report.css");
+        templates.add_variable("title", _title);
+        templates.add_variable("page", F("%s") % _pages);
+        templates.add_variable("first_index",
+                               F("%s") % (_total - _test_cases.size() + 1));
+        templates.add_variable("last_index", F("%s") % _total);
+        templates.add_vector("test_cases");
+        templates.add_vector("test_cases_file");
+        for (std::vector< std::string >::size_type i = 0;
+             i < _test_cases.size(); ++i) {
+            templates.add_to_vector("test_cases", _test_cases[i]);
+            templates.add_to_vector("test_cases_file", _test_cases_files[i]);
+        }
+        if (_pages > 1)
+            templates.add_variable("previous_page", page_name(_pages - 1));
+        if (has_next)
+            templates.add_variable("next_page", page_name(_pages + 1));
+
+        const fs::path output_path(_directory / page_name(_pages));
+        _ui->out(F("Generating %s") % output_path);
+        std::ofstream output(output_path.c_str());
+        if (!output)
+            throw text::error(F("Failed to open %s for write") % output_path);
+        _template.render(templates, output);
+
+        _test_cases.clear();
+        _test_cases_files.clear();
+    }
+
+public:
+    /// Constructor.
+    ///
+    /// \param ui_ User interface object where to report progress.
+    /// \param directory_ The directory in which to create the pages.  It is
+    ///     created on demand.
+    /// \param template_ Compiled template for the pages.
+    /// \param name_ Prefix of the names of the pages.
+    /// \param title_ Title of the pages.
+    test_list_writer(cmdline::ui* ui_, const fs::path& directory_,
+                     const text::compiled_template& template_,
+                     const std::string& name_, const std::string& title_) :
+        _ui(ui_), _directory(directory_), _template(template_), _name(name_),
+        _title(title_), _pages(0), _total(0)
+    {
+    }
+
+    /// Adds a test case to the listing.
+    ///
+    /// \param test_case The identifier of the test case.
+    /// \param test_case_file The name of the HTML file of the test case.
+    ///
+    /// \throw fs::error If the directory for the pages cannot be created.
+    /// \throw text::error If there is any problem applying the templates.
+    void
+    add(const std::string& test_case, const std::string& test_case_file)
+    {
+        if (_test_cases.size() == test_cases_per_page)
+            write_page(true);
+        _test_cases.push_back(test_case);
+        _test_cases_files.push_back(test_case_file);
+        ++_total;
+    }
+
+    /// Writes the last page of the listing.
+    ///
+    /// \throw fs::error If the directory for the pages cannot be created.
+    /// \throw text::error If there is any problem applying the templates.
+    void
+    finish(void)
+    {
+        if (!_test_cases.empty())
+            write_page(false);
+    }
+
+    /// Gets the path to the first page relative to the output directory.
+    ///
+    /// \return The path to the first page, or none if the listing is empty.
+    optional< std::string >
+    first_page(void) const
+    {
+        if (_total == 0)
+            return utils::none;
+        return utils::make_optional(
+            (fs::path(_directory.leaf_name()) / page_name(1)).str());
+    }
+};
+
+
 /// Generates an HTML report.
 class html_hooks : public drivers::scan_results::base_hooks {
     /// User interface object where to report progress.
@@ -149,9 +571,6 @@ class html_hooks : public drivers::scan_results::base_hooks {
     /// The top directory in which to create the HTML files.
     fs::path _directory;
 
-    /// Collection of result types to include in the report.
-    const cli::result_types& _results_filters;
-
     /// The start time of the first test.
     optional< utils::datetime::timestamp > _start_time;
 
@@ -165,7 +584,30 @@ class html_hooks : public drivers::scan_results::base_hooks {
     /// Templates accumulator to generate the index.html file.
     text::templates_def _summary_templates;
 
+    /// Compiled template for the pages of the individual test results.
+    ///
+    /// This is loaded once because it is rendered for every test case.
+    const text::compiled_template _result_template;
+
+    /// Threads to write the pages of the test results; NULL to write them
+    /// synchronously.
+    std::auto_ptr< result_pages_writer > _writer;
+
+    /// Compiled template for the paginated listings of test cases.
+    const text::compiled_template _list_template;
+
+    /// Listing of the test cases that failed as expected.
+    test_list_writer _xfail_list;
+
+    /// Listing of the test cases that were skipped.
+    test_list_writer _skipped_list;
+
+    /// Listing of the test cases that passed.
+    test_list_writer _passed_list;
+
     /// Mapping of result types to the amount of tests with such result.
+    ///
+    /// This covers all results, not only those included in the report.
     std::map< model::test_result_type, std::size_t > _types_count;
 
     /// Generates a common set of templates for all of our files.
@@ -181,22 +623,25 @@ class html_hooks : public drivers::scan_results::base_hooks {
 
     /// Adds a test case result to the summary.
     ///
+    /// The broken and failed test cases are listed in the index.html file
+    /// itself.  All others are listed in paginated listings so that the index
+    /// stays small regardless of the number of results.
+    ///
     /// \param test_program The test program with the test case to be added.
     /// \param test_case_name Name of the test case.
     /// \param result The result of the test case.
-    /// \param has_detail If true, the result of the test case has not been
-    ///     filtered and therefore there exists a separate file for the test
-    ///     with all of its information.
+    ///
+    /// \throw fs::error If the directory for the listings cannot be created.
+    /// \throw text::error If there is any problem applying the templates.
     void
     add_to_summary(const model::test_program& test_program,
                    const std::string& test_case_name,
-                   const model::test_result& result,
-                   const bool has_detail)
+                   const model::test_result& result)
     {
-        ++_types_count[result.type()];
-
-        if (!has_detail)
-            return;
+        const std::string test_case = cli::format_test_case_id(
+            test_program, test_case_name);
+        const std::string test_case_file = test_case_filename(
+            test_program, test_case_name);
 
         std::string test_cases_vector;
         std::string test_cases_file_vector;
@@ -207,9 +652,8 @@ class html_hooks : public drivers::scan_results::base_hooks {
             break;
 
         case model::test_result_expected_failure:
-            test_cases_vector = "xfail_test_cases";
-            test_cases_file_vector = "xfail_test_cases_file";
-            break;
+            _xfail_list.add(test_case, test_case_file);
+            return;
 
         case model::test_result_failed:
             test_cases_vector = "failed_test_cases";
@@ -217,24 +661,36 @@ class html_hooks : public drivers::scan_results::base_hooks {
             break;
 
         case model::test_result_passed:
-            test_cases_vector = "passed_test_cases";
-            test_cases_file_vector = "passed_test_cases_file";
-            break;
+            _passed_list.add(test_case, test_case_file);
+            return;
 
         case model::test_result_skipped:
-            test_cases_vector = "skipped_test_cases";
-            test_cases_file_vector = "skipped_test_cases_file";
-            break;
+            _skipped_list.add(test_case, test_case_file);
+            return;
         }
         INV(!test_cases_vector.empty());
         INV(!test_cases_file_vector.empty());
 
-        _summary_templates.add_to_vector(
-            test_cases_vector,
-            cli::format_test_case_id(test_program, test_case_name));
-        _summary_templates.add_to_vector(
-            test_cases_file_vector,
-            test_case_filename(test_program, test_case_name));
+        _summary_templates.add_to_vector(test_cases_vector, test_case);
+        _summary_templates.add_to_vector(test_cases_file_vector,
+                                         test_case_file);
+    }
+
+    /// Terminates a paginated listing and links it from the summary.
+    ///
+    /// \param list The listing to terminate.
+    /// \param variable The name of the variable in the summary templates that
+    ///     holds the path to the first page of the listing.
+    ///
+    /// \throw fs::error If the directory for the listings cannot be created.
+    /// \throw text::error If there is any problem applying the templates.
+    void
+    finish_list(test_list_writer& list, const std::string& variable)
+    {
+        list.finish();
+        const optional< std::string > first_page = list.first_page();
+        if (first_page)
+            _summary_templates.add_variable(variable, first_page.get());
     }
 
     /// Instantiate a template to generate an HTML file in the output directory.
@@ -251,21 +707,32 @@ class html_hooks : public drivers::scan_results::base_hooks {
              const std::string& template_name,
              const std::string& output_name) const
     {
-        const fs::path miscdir(utils::getenv_with_default(
-             "KYUA_MISCDIR", KYUA_MISCDIR));
-        const fs::path template_file = miscdir / template_name;
+        const fs::path template_file = template_path(template_name);
         const fs::path output_path(_directory / output_name);
 
         _ui->out(F("Generating %s") % output_path);
         text::instantiate(templates, template_file, output_path);
     }
 
+    /// Locates a template in the installed directory.
+    ///
+    /// \param template_name The name of the template.
+    ///
+    /// \return The path to the template.
+    static fs::path
+    template_path(const std::string& template_name)
+    {
+        const fs::path miscdir(utils::getenv_with_default(
+             "KYUA_MISCDIR", KYUA_MISCDIR));
+        return miscdir / template_name;
+    }
+
     /// Gets the number of tests with a given result type.
     ///
     /// \param type The type to be queried.
     ///
-    /// \return The number of tests of the given type, or 0 if none have yet
-    /// been registered by add_to_summary().
+    /// \return The number of tests of the given type, or 0 if there are none or
+    /// if the driver has not finished yet.
     std::size_t
     get_count(const model::test_result_type type) const
     {
@@ -282,28 +749,35 @@ public:
     ///
     /// \param ui_ User interface object where to report progress.
     /// \param directory_ The directory in which to create the HTML files.
-    /// \param results_filters_ The result types to include in the report.
-    ///     Cannot be empty.
+    /// \param jobs Number of threads to write the pages of the test results.
+    ///     If 1, the pages are written by the caller.
+    ///
+    /// \throw text::error If the templates cannot be loaded.
     html_hooks(cmdline::ui* ui_, const fs::path& directory_,
-               const cli::result_types& results_filters_) :
+               const std::size_t jobs) :
         _ui(ui_),
         _directory(directory_),
-        _results_filters(results_filters_),
-        _summary_templates(common_templates())
+        _summary_templates(common_templates()),
+        _result_template(text::compiled_template::compile(
+            template_path("test_result.html"))),
+        _list_template(text::compiled_template::compile(
+            template_path("test_list.html"))),
+        _xfail_list(ui_, directory_ / "lists", _list_template, "xfail",
+                    "Expected failures"),
+        _skipped_list(ui_, directory_ / "lists", _list_template, "skipped",
+                      "Skipped test cases"),
+        _passed_list(ui_, directory_ / "lists", _list_template, "passed",
+                     "Passed test cases")
     {
-        PRE(!results_filters_.empty());
+        PRE(jobs > 0);
+        if (jobs > 1)
+            _writer.reset(new result_pages_writer(_result_template, jobs));
 
         // Keep in sync with add_to_summary().
         _summary_templates.add_vector("broken_test_cases");
         _summary_templates.add_vector("broken_test_cases_file");
-        _summary_templates.add_vector("xfail_test_cases");
-        _summary_templates.add_vector("xfail_test_cases_file");
         _summary_templates.add_vector("failed_test_cases");
         _summary_templates.add_vector("failed_test_cases_file");
-        _summary_templates.add_vector("passed_test_cases");
-        _summary_templates.add_vector("passed_test_cases_file");
-        _summary_templates.add_vector("skipped_test_cases");
-        _summary_templates.add_vector("skipped_test_cases_file");
     }
 
     /// Callback executed when the context is loaded.
@@ -328,13 +802,7 @@ public:
         const std::string& test_case_name = iter.test_case_name();
         const model::test_result result = iter.result();
 
-        if (std::find(_results_filters.begin(), _results_filters.end(),
-                      result.type()) == _results_filters.end()) {
-            add_to_summary(*test_program, test_case_name, result, false);
-            return;
-        }
-
-        add_to_summary(*test_program, test_case_name, result, true);
+        add_to_summary(*test_program, test_case_name, result);
 
         if (!_start_time || _start_time.get() > iter.start_time())
             _start_time = iter.start_time();
@@ -358,32 +826,62 @@ public:
                                iter.end_time().to_iso8601_in_utc());
         templates.add_variable("duration", cli::format_delta(duration));
 
-        const model::test_case& test_case = test_program->find(test_case_name);
+        const model::test_case test_case = iter.test_case();
         add_map(templates, test_case.get_metadata().to_properties(),
                 "metadata_var", "metadata_value");
 
-        {
-            const std::string stdout_text = iter.stdout_contents();
-            if (!stdout_text.empty())
-                templates.add_variable("stdout", stdout_text);
-        }
-        {
-            const std::string stderr_text = iter.stderr_contents();
-            if (!stderr_text.empty())
-                templates.add_variable("stderr", stderr_text);
+        std::auto_ptr< std::istream > stdout_stream = iter.stdout_stream();
+        std::auto_ptr< std::istream > stderr_stream = iter.stderr_stream();
+
+        const fs::path output_path(
+            _directory / test_case_filename(*test_program, test_case_name));
+        _ui->out(F("Generating %s") % output_path);
+
+        if (_writer.get() != NULL) {
+            result_page page(templates, output_path);
+            if (read_small_output(*stdout_stream, page.stdout_contents) &&
+                read_small_output(*stderr_stream, page.stderr_contents)) {
+                _writer->write(page);
+                return;
+            }
+            stdout_stream = iter.stdout_stream();
+            stderr_stream = iter.stderr_stream();
         }
+        write_result_page(_result_template, templates, output_path,
+                          *stdout_stream, *stderr_stream);
+    }
 
-        generate(templates, "test_result.html",
-                 test_case_filename(*test_program, test_case_name));
+    /// Callback executed after all results have been received.
+    ///
+    /// \param r The result of the driver execution.
+    void
+    end(const drivers::scan_results::result& r)
+    {
+        for (store::results_totals_map::const_iterator iter = r.totals.begin();
+             iter != r.totals.end(); ++iter) {
+            _types_count[(*iter).first] = (*iter).second.count;
+        }
     }
 
     /// Writes the index.html file in the output directory.
     ///
     /// This should only be called once all the processing has been done;
     /// i.e. when the scan_results driver returns.
+    ///
+    /// \throw std::runtime_error If any of the pages of the test results
+    ///     could not be written.
+    /// \throw fs::error If the directory for the listings cannot be created.
+    /// \throw text::error If there is any problem applying the templates.
     void
     write_summary(void)
     {
+        if (_writer.get() != NULL)
+            _writer->finish();
+
+        finish_list(_xfail_list, "xfail_test_cases_page");
+        finish_list(_skipped_list, "skipped_test_cases_page");
+        finish_list(_passed_list, "passed_test_cases_page");
+
         const std::size_t n_passed = get_count(model::test_result_passed);
         const std::size_t n_failed = get_count(model::test_result_failed);
         const std::size_t n_skipped = get_count(model::test_result_skipped);
@@ -441,6 +939,9 @@ cli::cmd_report_html::cmd_report_html(void) : cli_command(
     add_option(cmdline::list_option(
         "results-filter", "Comma-separated list of result types to include in "
         "the report", "types", "skipped,xfail,broken,failed"));
+    add_option(cmdline::int_option(
+        "jobs", "Number of threads that write the pages of the test cases; "
+        "0 to use one per online CPU", "num", "0"));
 }
 
 
@@ -458,16 +959,23 @@ cli::cmd_report_html::run(cmdline::ui* ui,
 {
     const result_types types = get_result_types(cmdline);
 
+    const int jobs = cmdline.get_option< cmdline::int_option >("jobs");
+    if (jobs < 0)
+        throw cmdline::usage_error(F("Invalid number of jobs '%s'; must be a "
+                                     "non-negative number") % jobs);
+
     const fs::path results_file = layout::find_results(
         results_file_open(cmdline));
 
     const fs::path directory =
         cmdline.get_option< cmdline::path_option >("output");
     create_top_directory(directory, cmdline.has_option("force"));
-    html_hooks hooks(ui, directory, types);
-    drivers::scan_results::drive(results_file,
-                                 std::set< engine::test_filter >(),
-                                 hooks);
+    html_hooks hooks(ui, directory, jobs == 0 ?
+                     engine::online_cpus() : static_cast< std::size_t >(jobs));
+    drivers::scan_results::drive(
+        results_file, std::set< engine::test_filter >(),
+        std::set< model::test_result_type >(types.begin(), types.end()),
+        hooks);
     hooks.write_summary();
 
     return EXIT_SUCCESS;
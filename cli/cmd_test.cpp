@@ -32,9 +32,12 @@
 
 #include "cli/common.ipp"
 #include "drivers/run_tests.hpp"
+#include "engine/config.hpp"
 #include "model/test_program.hpp"
 #include "model/test_result.hpp"
+#include "store/exceptions.hpp"
 #include "store/layout.hpp"
+#include "utils/cmdline/exceptions.hpp"
 #include "utils/cmdline/options.hpp"
 #include "utils/cmdline/parser.ipp"
 #include "utils/cmdline/ui.hpp"
@@ -42,6 +45,7 @@
 #include "utils/datetime.hpp"
 #include "utils/format/macros.hpp"
 #include "utils/fs/path.hpp"
+#include "utils/optional.ipp"
 
 namespace cmdline = utils::cmdline;
 namespace config = utils::config;
@@ -50,6 +54,7 @@ namespace fs = utils::fs;
 namespace layout = store::layout;
 
 using cli::cmd_test;
+using utils::optional;
 
 
 namespace {
@@ -124,6 +129,29 @@ public:
 };
 
 
+/// Loads the durations of the test cases in the previous run of a test suite.
+///
+/// \param ui Object to interact with the I/O of the program.
+/// \param root Path to the root of the test suite.
+///
+/// \return The durations of the test cases, which is empty if there are no
+/// previous results for the test suite.
+static drivers::run_tests::durations_map
+load_previous_durations(cmdline::ui* ui, const fs::path& root)
+{
+    try {
+        const fs::path results_file = layout::find_results(
+            layout::test_suite_for_path(root));
+        return drivers::run_tests::load_durations(results_file);
+    } catch (const store::error& e) {
+        cmdline::print_warning(ui, F("Cannot load the durations of previous "
+                                     "tests; running them in default order: "
+                                     "%s") % e.what());
+        return drivers::run_tests::durations_map();
+    }
+}
+
+
 }  // anonymous namespace
 
 
@@ -134,6 +162,12 @@ cmd_test::cmd_test(void) : cli_command(
     add_option(build_root_option);
     add_option(kyuafile_option);
     add_option(results_file_create_option);
+    add_option(cmdline::bool_option(
+        "longest-first", "Run the test cases that took the longest in the "
+        "previous run of the test suite first"));
+    add_option(cmdline::int_option(
+        "default-duration", "Estimated duration of test cases that did not run "
+        "before; only used with --longest-first", "seconds", "0"));
 }
 
 
@@ -148,16 +182,31 @@ int
 cmd_test::run(cmdline::ui* ui, const cmdline::parsed_cmdline& cmdline,
               const config::tree& user_config)
 {
+    const int default_duration = cmdline.get_option< cmdline::int_option >(
+        "default-duration");
+    if (default_duration < 0)
+        throw cmdline::usage_error(F("Invalid duration '%s'; must be a "
+                                     "non-negative number of seconds") %
+                                   default_duration);
+
+    // The previous durations must be loaded before the new results file is
+    // created, as it would otherwise become the latest one.
+    optional< drivers::run_tests::durations_map > durations;
+    if (cmdline.has_option("longest-first"))
+        durations = load_previous_durations(
+            ui, kyuafile_path(cmdline).branch_path());
+
     const layout::results_id_file_pair results = layout::new_db(
         results_file_create(cmdline), kyuafile_path(cmdline).branch_path());
 
-    const bool parallel = (user_config.lookup< config::positive_int_node >(
-                               "parallelism") > 1);
+    const bool parallel = (user_config.lookup< engine::parallelism_node >(
+                               "parallelism") != 1);
 
     print_hooks hooks(ui, parallel);
     const drivers::run_tests::result result = drivers::run_tests::drive(
         kyuafile_path(cmdline), build_root_path(cmdline), results.second,
-        parse_filters(cmdline.arguments()), user_config, hooks);
+        parse_filters(cmdline.arguments()), user_config, durations,
+        datetime::delta(default_duration, 0), hooks);
 
     int exit_code;
     if (hooks.good_count > 0 || hooks.bad_count > 0) {
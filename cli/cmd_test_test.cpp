@@ -57,7 +57,24 @@ ATF_TEST_CASE_BODY(invalid_filter)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(invalid_default_duration);
+ATF_TEST_CASE_BODY(invalid_default_duration)
+{
+    cmdline::args_vector args;
+    args.push_back("test");
+    args.push_back("--default-duration=-5");
+
+    cli::cmd_test cmd;
+    cmdline::ui_mock ui;
+    ATF_REQUIRE_THROW_RE(cmdline::usage_error, "Invalid duration '-5'",
+                         cmd.main(&ui, args, engine::default_config()));
+    ATF_REQUIRE(ui.out_log().empty());
+    ATF_REQUIRE(ui.err_log().empty());
+}
+
+
 ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, invalid_filter);
+    ATF_ADD_TEST_CASE(tcs, invalid_default_duration);
 }
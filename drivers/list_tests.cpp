@@ -28,12 +28,17 @@
 
 #include "drivers/list_tests.hpp"
 
+#include <cstddef>
+
+#include "engine/config.hpp"
 #include "engine/exceptions.hpp"
 #include "engine/filters.hpp"
 #include "engine/kyuafile.hpp"
 #include "engine/scanner.hpp"
 #include "engine/scheduler.hpp"
 #include "model/test_program.hpp"
+#include "store/layout.hpp"
+#include "utils/config/tree.ipp"
 #include "utils/optional.ipp"
 
 namespace config = utils::config;
@@ -66,11 +71,17 @@ drivers::list_tests::drive(const fs::path& kyuafile_path,
                            base_hooks& hooks)
 {
     scheduler::scheduler_handle handle = scheduler::setup();
+    if (user_config.is_set("cache_test_lists") &&
+        user_config.lookup< config::bool_node >("cache_test_lists"))
+        handle.enable_list_cache(store::layout::query_list_cache_dir());
 
     const engine::kyuafile kyuafile = engine::kyuafile::load(
         kyuafile_path, build_root, user_config, handle);
 
-    engine::scanner scanner(kyuafile.test_programs(), filters);
+    const std::size_t slots = user_config.is_set("parallelism") ?
+        engine::resolve_parallelism(
+            user_config.lookup< engine::parallelism_node >("parallelism")) : 1;
+    engine::scanner scanner(kyuafile.test_programs(), filters, slots);
 
     while (!scanner.done()) {
         const optional< engine::scan_result > result = scanner.yield();
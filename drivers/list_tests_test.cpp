@@ -272,6 +272,42 @@ ATF_TEST_CASE_BODY(crash)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(default_config);
+ATF_TEST_CASE_BODY(default_config)
+{
+    utils::setenv("TESTS", "no_properties some_properties");
+    capture_hooks hooks;
+    create_helpers(this, fs::path("root"), fs::path("root"));
+    drivers::list_tests::drive(fs::path("root/Kyuafile"), none,
+                               std::set< engine::test_filter >(),
+                               engine::default_config(), hooks);
+
+    std::set< std::string > exp_test_cases;
+    exp_test_cases.insert("dir/program:no_properties");
+    exp_test_cases.insert("dir/program:some_properties");
+    ATF_REQUIRE(exp_test_cases == hooks.test_cases);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(auto_parallelism);
+ATF_TEST_CASE_BODY(auto_parallelism)
+{
+    utils::setenv("TESTS", "no_properties some_properties");
+    capture_hooks hooks;
+    create_helpers(this, fs::path("root"), fs::path("root"));
+    config::tree user_config = engine::default_config();
+    user_config.set_string("parallelism", "auto");
+    drivers::list_tests::drive(fs::path("root/Kyuafile"), none,
+                               std::set< engine::test_filter >(),
+                               user_config, hooks);
+
+    std::set< std::string > exp_test_cases;
+    exp_test_cases.insert("dir/program:no_properties");
+    exp_test_cases.insert("dir/program:some_properties");
+    ATF_REQUIRE(exp_test_cases == hooks.test_cases);
+}
+
+
 ATF_INIT_TEST_CASES(tcs)
 {
     scheduler::register_interface(
@@ -284,4 +320,6 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, build_root);
     ATF_ADD_TEST_CASE(tcs, config_in_head);
     ATF_ADD_TEST_CASE(tcs, crash);
+    ATF_ADD_TEST_CASE(tcs, default_config);
+    ATF_ADD_TEST_CASE(tcs, auto_parallelism);
 }
@@ -29,6 +29,8 @@
 #include "drivers/report_junit.hpp"
 
 #include <algorithm>
+#include <istream>
+#include <memory>
 
 #include "model/context.hpp"
 #include "model/metadata.hpp"
@@ -47,6 +49,48 @@ namespace datetime = utils::datetime;
 namespace text = utils::text;
 
 
+namespace {
+
+
+/// Copies the contents of a stream into the report, escaped for XML.
+///
+/// The contents are escaped in pieces so that large outputs are not loaded into
+/// memory.  Escaping works on individual bytes, so splitting the contents does
+/// not change the result.
+///
+/// \param input The stream to copy.
+/// \param output The stream in which to write the escaped contents.
+static void
+copy_escaped(std::istream& input, std::ostream& output)
+{
+    char buffer[16384];
+    while (input.good()) {
+        input.read(buffer, sizeof(buffer));
+        if (input.good() || input.eof()) {
+            text::escape_xml(buffer, input.gcount(), output);
+        }
+    }
+}
+
+
+/// Writes the details of a result that has no status node of its own.
+///
+/// \param title The title of the details, underlined.
+/// \param reason The reason of the result.
+/// \param output The stream in which to write the escaped details.
+static void
+write_result_details(const char* title, const std::string& reason,
+                     std::ostream& output)
+{
+    text::escape_xml(title, output);
+    text::escape_xml(reason, output);
+    output << "\n\n";
+}
+
+
+}  // anonymous namespace
+
+
 /// Converts a test program name into a class-like name.
 ///
 /// \param test_program Test program from which to extract the name.
@@ -163,13 +207,16 @@ drivers::report_junit_hooks::got_context(const model::context& context)
     _output << "<testsuite>\n";
 
     _output << "<properties>\n";
-    _output << F("<property name=\"cwd\" value=\"%s\"/>\n")
-        % text::escape_xml(context.cwd().str());
+    _output << "<property name=\"cwd\" value=\"";
+    text::escape_xml(context.cwd().str(), _output);
+    _output << "\"/>\n";
     for (model::properties_map::const_iterator iter =
              context.env().begin(); iter != context.env().end(); ++iter) {
-        _output << F("<property name=\"env.%s\" value=\"%s\"/>\n")
-            % text::escape_xml((*iter).first)
-            % text::escape_xml((*iter).second);
+        _output << "<property name=\"env.";
+        text::escape_xml((*iter).first, _output);
+        _output << "\" value=\"";
+        text::escape_xml((*iter).second, _output);
+        _output << "\"/>\n";
     }
     _output << "</properties>\n";
 }
@@ -183,25 +230,27 @@ drivers::report_junit_hooks::got_result(store::results_iterator& iter)
 {
     const model::test_result result = iter.result();
 
-    _output << F("<testcase classname=\"%s\" name=\"%s\" time=\"%s\">\n")
-        % text::escape_xml(junit_classname(*iter.test_program()))
-        % text::escape_xml(iter.test_case_name())
-        % junit_duration(iter.end_time() - iter.start_time());
+    _output << "<testcase classname=\"";
+    text::escape_xml(junit_classname(*iter.test_program()), _output);
+    _output << "\" name=\"";
+    text::escape_xml(iter.test_case_name(), _output);
+    _output << "\" time=\"" << junit_duration(iter.end_time() -
+                                               iter.start_time()) << "\">\n";
 
-    std::string stderr_contents;
+    // Title of the details of the result to prepend to stderr, if any.
+    const char* details_title = NULL;
 
     switch (result.type()) {
     case model::test_result_failed:
-        _output << F("<failure message=\"%s\"/>\n")
-            % text::escape_xml(result.reason());
+        _output << "<failure message=\"";
+        text::escape_xml(result.reason(), _output);
+        _output << "\"/>\n";
         break;
 
     case model::test_result_expected_failure:
-        stderr_contents += ("Expected failure result details\n"
-                            "-------------------------------\n"
-                            "\n"
-                            + result.reason() + "\n"
-                            "\n");
+        details_title = ("Expected failure result details\n"
+                         "-------------------------------\n"
+                         "\n");
         break;
 
     case model::test_result_passed:
@@ -210,41 +259,46 @@ drivers::report_junit_hooks::got_result(store::results_iterator& iter)
 
     case model::test_result_skipped:
         _output << "<skipped/>\n";
-        stderr_contents += ("Skipped result details\n"
-                            "----------------------\n"
-                            "\n"
-                            + result.reason() + "\n"
-                            "\n");
+        details_title = ("Skipped result details\n"
+                         "----------------------\n"
+                         "\n");
         break;
 
     default:
-        _output << F("<error message=\"%s\"/>\n")
-            % text::escape_xml(result.reason());
+        _output << "<error message=\"";
+        text::escape_xml(result.reason(), _output);
+        _output << "\"/>\n";
     }
 
-    const std::string stdout_contents = iter.stdout_contents();
-    if (!stdout_contents.empty()) {
-        _output << F("<system-out>%s</system-out>\n")
-            % text::escape_xml(stdout_contents);
+    {
+        const std::auto_ptr< std::istream > stdout_stream =
+            iter.stdout_stream();
+        if (stdout_stream->peek() != std::istream::traits_type::eof()) {
+            _output << "<system-out>";
+            copy_escaped(*stdout_stream, _output);
+            _output << "</system-out>\n";
+        }
     }
 
+    _output << "<system-err>";
+    if (details_title != NULL)
+        write_result_details(details_title, result.reason(), _output);
     {
-        const model::test_case& test_case = iter.test_program()->find(
-            iter.test_case_name());
-        stderr_contents += junit_metadata(test_case.get_metadata());
+        const model::test_case test_case = iter.test_case();
+        text::escape_xml(junit_metadata(test_case.get_metadata()), _output);
     }
-    stderr_contents += junit_timing(iter.start_time(), iter.end_time());
+    text::escape_xml(junit_timing(iter.start_time(), iter.end_time()), _output);
+    text::escape_xml(junit_stderr_header, _output);
     {
-        stderr_contents += junit_stderr_header;
-        const std::string real_stderr_contents = iter.stderr_contents();
-        if (real_stderr_contents.empty()) {
-            stderr_contents += "<EMPTY>\n";
+        const std::auto_ptr< std::istream > stderr_stream =
+            iter.stderr_stream();
+        if (stderr_stream->peek() == std::istream::traits_type::eof()) {
+            text::escape_xml("<EMPTY>\n", _output);
         } else {
-            stderr_contents += real_stderr_contents;
+            copy_escaped(*stderr_stream, _output);
         }
     }
-    _output << "<system-err>" << text::escape_xml(stderr_contents)
-            << "</system-err>\n";
+    _output << "</system-err>\n";
 
     _output << "</testcase>\n";
 }
@@ -63,8 +63,10 @@ static const char* const default_metadata =
     "allowed_architectures is empty\n"
     "allowed_platforms is empty\n"
     "description is empty\n"
+    "exclusive_group is empty\n"
     "has_cleanup = false\n"
     "is_exclusive = false\n"
+    "max_output_size = 0\n"
     "required_configs is empty\n"
     "required_disk_space = 0\n"
     "required_files is empty\n"
@@ -80,8 +82,10 @@ static const char* const overriden_metadata =
     "allowed_architectures is empty\n"
     "allowed_platforms is empty\n"
     "description = Textual description\n"
+    "exclusive_group is empty\n"
     "has_cleanup = false\n"
     "is_exclusive = false\n"
+    "max_output_size = 0\n"
     "required_configs is empty\n"
     "required_disk_space = 0\n"
     "required_files is empty\n"
@@ -199,8 +203,10 @@ ATF_TEST_CASE_BODY(junit_metadata__overrides)
         .add_allowed_architecture("arch1")
         .add_allowed_platform("platform1")
         .set_description("This is a test")
+        .set_exclusive_group("group1")
         .set_has_cleanup(true)
         .set_is_exclusive(true)
+        .set_max_output_size(units::bytes(789))
         .add_required_config("config1")
         .set_required_disk_space(units::bytes(456))
         .add_required_file(fs::path("file1"))
@@ -215,8 +221,10 @@ ATF_TEST_CASE_BODY(junit_metadata__overrides)
         + "allowed_architectures = arch1\n"
         + "allowed_platforms = platform1\n"
         + "description = This is a test\n"
+        + "exclusive_group = group1\n"
         + "has_cleanup = true\n"
         + "is_exclusive = true\n"
+        + "max_output_size = 789\n"
         + "required_configs = config1\n"
         + "required_disk_space = 456\n"
         + "required_files = file1\n"
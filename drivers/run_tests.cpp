@@ -28,7 +28,25 @@
 
 #include "drivers/run_tests.hpp"
 
+#if defined(HAVE_CONFIG_H)
+#   include "config.h"
+#endif
+
+extern "C" {
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include <stdlib.h>
+}
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "engine/config.hpp"
 #include "engine/filters.hpp"
@@ -40,17 +58,23 @@
 #include "model/test_case.hpp"
 #include "model/test_program.hpp"
 #include "model/test_result.hpp"
-#include "store/write_backend.hpp"
-#include "store/write_transaction.hpp"
+#include "store/async_writer.hpp"
+#include "store/layout.hpp"
+#include "store/read_backend.hpp"
+#include "store/read_transaction.hpp"
 #include "utils/config/tree.ipp"
 #include "utils/datetime.hpp"
 #include "utils/defs.hpp"
 #include "utils/format/macros.hpp"
+#include "utils/fs/exceptions.hpp"
+#include "utils/fs/operations.hpp"
 #include "utils/logging/macros.hpp"
+#include "utils/memory.hpp"
 #include "utils/noncopyable.hpp"
 #include "utils/optional.ipp"
 #include "utils/passwd.hpp"
 #include "utils/text/operations.ipp"
+#include "utils/units.hpp"
 
 namespace config = utils::config;
 namespace datetime = utils::datetime;
@@ -58,6 +82,7 @@ namespace fs = utils::fs;
 namespace passwd = utils::passwd;
 namespace scheduler = engine::scheduler;
 namespace text = utils::text;
+namespace units = utils::units;
 
 using utils::none;
 using utils::optional;
@@ -66,6 +91,24 @@ using utils::optional;
 namespace {
 
 
+/// Maximum number of writes to the store that can be pending at any time.
+///
+/// Once this is reached, the execution of tests blocks until the store catches
+/// up.
+static const std::size_t max_pending_writes = 1024;
+
+
+/// Maximum number of writes to the store that can remain uncommitted.
+///
+/// Together with commit_interval, this bounds the amount of results lost if
+/// kyua is abruptly terminated.  Each test case causes a handful of writes.
+static const std::size_t max_uncommitted_writes = 1000;
+
+
+/// Maximum time that stored results can remain uncommitted.
+static const datetime::delta commit_interval(5, 0);
+
+
 /// Map of test program identifiers (relative paths) to their identifiers in the
 /// database.  We need to keep this in memory because test programs can be
 /// returned by the scanner in any order, and we only want to put each test
@@ -81,6 +124,475 @@ typedef std::map< int, int64_t > pid_to_id_map;
 typedef pid_to_id_map::value_type pid_and_id_pair;
 
 
+/// Pair of the estimated duration of a test case and the test case itself.
+typedef std::pair< datetime::delta, engine::scan_result > estimated_test;
+
+
+/// Tracks the groups of mutually exclusive tests held by in-flight tests.
+///
+/// A test that belongs to a group that is held by another test must wait for
+/// that test to finish before it can start.
+class exclusive_groups : utils::noncopyable {
+    /// Mapping of in-flight PIDs to the groups they hold.
+    std::map< int, std::string > _holders;
+
+    /// Names of the groups held by in-flight tests.
+    std::set< std::string > _busy;
+
+    /// Tests waiting for a group to be released, keyed by group name.
+    std::map< std::string, std::deque< engine::scan_result > > _waiting;
+
+public:
+    /// Checks if a group is held by an in-flight test.
+    ///
+    /// \param group The name of the group to check.
+    ///
+    /// \return True if a test in the group is running; false otherwise.
+    bool
+    is_busy(const std::string& group) const
+    {
+        return _busy.find(group) != _busy.end();
+    }
+
+    /// Records that a test is waiting for a busy group.
+    ///
+    /// \param group The name of the group the test belongs to.
+    /// \param test The test waiting for the group.
+    void
+    defer(const std::string& group, const engine::scan_result& test)
+    {
+        PRE(is_busy(group));
+        _waiting[group].push_back(test);
+    }
+
+    /// Records that an in-flight test holds a group.
+    ///
+    /// \param group The name of the group held by the test.
+    /// \param pid The PID of the test holding the group.
+    void
+    acquire(const std::string& group, const int pid)
+    {
+        PRE(!is_busy(group));
+        _busy.insert(group);
+        _holders[pid] = group;
+    }
+
+    /// Releases the group held by a test, if any.
+    ///
+    /// \param pid The PID of the test that finished.
+    ///
+    /// \return The next test waiting for the released group, if any.  This
+    /// test has to be started before any other test in its group to respect
+    /// the order in which the tests were found.
+    optional< engine::scan_result >
+    release(const int pid)
+    {
+        const std::map< int, std::string >::iterator holder = _holders.find(
+            pid);
+        if (holder == _holders.end())
+            return none;
+        const std::string group = (*holder).second;
+        _holders.erase(holder);
+        _busy.erase(group);
+
+        const std::map< std::string, std::deque< engine::scan_result > >::
+            iterator waiting = _waiting.find(group);
+        if (waiting == _waiting.end())
+            return none;
+        const engine::scan_result next = (*waiting).second.front();
+        (*waiting).second.pop_front();
+        if ((*waiting).second.empty())
+            _waiting.erase(waiting);
+        return utils::make_optional(next);
+    }
+
+    /// Checks if there are tests waiting for any group.
+    ///
+    /// \return True if there are waiting tests; false otherwise.
+    bool
+    has_waiting(void) const
+    {
+        return !_waiting.empty();
+    }
+};
+
+
+/// Computes the disk space available to the tests.
+///
+/// \param work_directory The directory in which the tests run.
+///
+/// \return The free disk space in the given directory at the time of the
+/// call, or none if we cannot tell.
+static optional< units::bytes >
+disk_budget(const fs::path& work_directory)
+{
+    try {
+        return utils::make_optional(fs::free_disk_space(work_directory));
+    } catch (const fs::error& e) {
+        LW(F("Cannot query the free disk space in %s; not limiting the "
+             "concurrency of tests by disk usage: %s") % work_directory %
+           e.what());
+        return none;
+    }
+}
+
+
+/// Gets the metadata of a test case found by the scanner.
+///
+/// \param test The test case to query.
+///
+/// \return The metadata of the test case.
+static model::metadata
+metadata_of(const engine::scan_result& test)
+{
+    return test.first->find(test.second).get_metadata();
+}
+
+
+/// Tracks the memory and disk space claimed by the in-flight tests.
+///
+/// Tests declare the resources they need through their required_memory and
+/// required_disk_space metadata properties.  This class keeps the sum of the
+/// requirements of the running tests within the available budgets so that
+/// tests that need lots of resources are not co-scheduled with each other.
+///
+/// The disk budget is the free disk space of the work directory, which is
+/// sampled again whenever a test finishes so that space used by anything else
+/// is accounted for.  The space claimed by the in-flight tests is subtracted
+/// from the sample even if they have already used part of it, which errs on
+/// the side of running fewer tests.
+class resources_tracker : utils::noncopyable {
+    /// Resources claimed by a single test: memory and disk space.
+    typedef std::pair< uint64_t, uint64_t > claim_pair;
+
+    /// Amount of memory available to all in-flight tests; 0 if unlimited.
+    const uint64_t _memory_budget;
+
+    /// Directory whose free space limits the tests; none if unlimited.
+    optional< fs::path > _work_directory;
+
+    /// Amount of disk space available to all in-flight tests; 0 if unlimited.
+    uint64_t _disk_budget;
+
+    /// Amount of memory claimed by the in-flight tests.
+    uint64_t _memory_used;
+
+    /// Amount of disk space claimed by the in-flight tests.
+    uint64_t _disk_used;
+
+    /// Mapping of in-flight PIDs to the resources they claimed.
+    std::map< int, claim_pair > _claims;
+
+    /// Tests waiting for resources to be released, in the order they came.
+    std::deque< engine::scan_result > _waiting;
+
+    /// Whether resources were released since the waiting tests last failed to
+    /// fit.  Avoids rescanning the waiting tests while nothing has changed.
+    bool _released;
+
+    /// Checks if a claim fits in a budget given the current usage.
+    ///
+    /// \param budget The total budget; 0 if unlimited.
+    /// \param used The amount of the budget already in use.
+    /// \param amount The amount to claim.
+    ///
+    /// \return True if the claim fits; false otherwise.
+    static bool
+    fits_in(const uint64_t budget, const uint64_t used, const uint64_t amount)
+    {
+        return budget == 0 || amount == 0 || used + amount <= budget;
+    }
+
+    /// Samples the free disk space of the work directory.
+    void
+    sample_disk_budget(void)
+    {
+        if (!_work_directory)
+            return;
+        const optional< units::bytes > free_space = disk_budget(
+            _work_directory.get());
+        if (free_space) {
+            // A budget of 0 means unlimited, so keep a full disk at 1 byte.
+            _disk_budget = std::max(static_cast< uint64_t >(free_space.get()),
+                                    static_cast< uint64_t >(1));
+        } else {
+            _work_directory = none;
+            _disk_budget = 0;
+        }
+    }
+
+public:
+    /// Constructor.
+    ///
+    /// \param memory_budget Memory available to the tests; 0 if unlimited.
+    /// \param work_directory Directory in which the tests run, whose free
+    ///     space limits the disk space available to the tests.
+    resources_tracker(const units::bytes& memory_budget,
+                      const fs::path& work_directory) :
+        _memory_budget(memory_budget),
+        _work_directory(work_directory),
+        _disk_budget(0),
+        _memory_used(0), _disk_used(0),
+        _released(false)
+    {
+        sample_disk_budget();
+    }
+
+    /// Checks if a test can be started without exceeding the budgets.
+    ///
+    /// A test always fits if no other test is running, even if it claims more
+    /// than the budgets; otherwise it would never run.  Whether the test can
+    /// run at all on this machine is decided later by the test's requirements.
+    ///
+    /// \param md The metadata of the test to check.
+    ///
+    /// \return True if the test can be started now; false otherwise.
+    bool
+    fits(const model::metadata& md) const
+    {
+        if (_claims.empty())
+            return true;
+        return fits_in(_memory_budget, _memory_used, md.required_memory()) &&
+            fits_in(_disk_budget, _disk_used, md.required_disk_space());
+    }
+
+    /// Records that a test is waiting for resources to be released.
+    ///
+    /// \param test The test that does not fit.
+    void
+    defer(const engine::scan_result& test)
+    {
+        _waiting.push_back(test);
+    }
+
+    /// Takes the first waiting test that fits in the budgets, if any.
+    ///
+    /// \return The test to start, or none if no waiting test fits.
+    optional< engine::scan_result >
+    take_fitting(void)
+    {
+        if (!_released)
+            return none;
+        for (std::deque< engine::scan_result >::iterator iter =
+                 _waiting.begin(); iter != _waiting.end(); ++iter) {
+            if (fits(metadata_of(*iter))) {
+                const engine::scan_result test = *iter;
+                _waiting.erase(iter);
+                return utils::make_optional(test);
+            }
+        }
+        _released = false;
+        return none;
+    }
+
+    /// Checks if there are tests waiting for resources.
+    ///
+    /// \return True if there are waiting tests; false otherwise.
+    bool
+    has_waiting(void) const
+    {
+        return !_waiting.empty();
+    }
+
+    /// Records the resources claimed by an in-flight test.
+    ///
+    /// \param pid The PID of the test.
+    /// \param md The metadata of the test.
+    void
+    acquire(const int pid, const model::metadata& md)
+    {
+        const claim_pair claim(md.required_memory(),
+                               md.required_disk_space());
+        if (claim.first == 0 && claim.second == 0)
+            return;
+        PRE(_claims.find(pid) == _claims.end());
+        _claims[pid] = claim;
+        _memory_used += claim.first;
+        _disk_used += claim.second;
+    }
+
+    /// Returns the resources claimed by a test, if any.
+    ///
+    /// \param pid The PID of the test that finished.
+    void
+    release(const int pid)
+    {
+        const std::map< int, claim_pair >::iterator claim = _claims.find(pid);
+        if (claim == _claims.end())
+            return;
+        INV(_memory_used >= (*claim).second.first);
+        INV(_disk_used >= (*claim).second.second);
+        _memory_used -= (*claim).second.first;
+        _disk_used -= (*claim).second.second;
+        _claims.erase(claim);
+
+        sample_disk_budget();
+        _released = true;
+    }
+};
+
+
+/// Adjusts the number of execution slots to the load of the machine.
+///
+/// When the parallelism is set to 'auto', we start with as many slots as CPUs
+/// and periodically sample the CPU time consumed by the finished tests and the
+/// load average of the system.  Tests that mostly sleep or wait for I/O leave
+/// the CPUs idle, so we add slots; tests that saturate the CPUs slow each other
+/// down, so we remove slots.  With a fixed parallelism, this never changes the
+/// number of slots.
+class slots_controller : utils::noncopyable {
+    /// Minimum time between two adjustments of the number of slots.
+    static const int64_t sampling_interval_usecs = 1000000;
+
+    /// Number of online CPUs; 0 if the parallelism is fixed.
+    const std::size_t _cpus;
+
+    /// Maximum number of slots we can grow up to.
+    const std::size_t _max_slots;
+
+    /// Current number of slots.
+    std::size_t _slots;
+
+    /// Time of the last sample.
+    datetime::timestamp _last_sample;
+
+    /// CPU time consumed by the finished tests at the last sample.
+    datetime::delta _last_cpu_time;
+
+    /// Gets the CPU time consumed by all the children that have been awaited.
+    ///
+    /// \return The user and system time of the children.
+    static datetime::delta
+    children_cpu_time(void)
+    {
+        struct ::rusage usage;
+        if (::getrusage(RUSAGE_CHILDREN, &usage) == -1) {
+            LW("getrusage(RUSAGE_CHILDREN) failed; assuming no CPU usage");
+            return datetime::delta();
+        }
+        return datetime::delta(usage.ru_utime.tv_sec, usage.ru_utime.tv_usec) +
+            datetime::delta(usage.ru_stime.tv_sec, usage.ru_stime.tv_usec);
+    }
+
+    /// Gets the one-minute load average of the system.
+    ///
+    /// \return The load average, or none if it cannot be queried.
+    static optional< double >
+    load_average(void)
+    {
+#if defined(HAVE_GETLOADAVG)
+        double loadavg;
+        if (::getloadavg(&loadavg, 1) == 1)
+            return utils::make_optional(loadavg);
+#endif
+        return none;
+    }
+
+public:
+    /// Constructor.
+    ///
+    /// \param parallelism The configured parallelism, which may be
+    ///     engine::auto_parallelism.
+    explicit slots_controller(const int parallelism) :
+        _cpus(parallelism == engine::auto_parallelism ?
+              engine::online_cpus() : 0),
+        _max_slots(parallelism == engine::auto_parallelism ?
+                   _cpus * 4 : parallelism),
+        _slots(engine::resolve_parallelism(parallelism)),
+        _last_sample(datetime::timestamp::now()),
+        _last_cpu_time(children_cpu_time())
+    {
+        INV(_slots >= 1);
+    }
+
+    /// Gets the maximum number of slots that can ever be in use.
+    ///
+    /// \return A number of slots.
+    std::size_t
+    max_slots(void) const
+    {
+        return _max_slots;
+    }
+
+    /// Gets the number of slots to keep busy at this moment.
+    ///
+    /// \return A number of slots.
+    std::size_t
+    slots(void) const
+    {
+        return _slots;
+    }
+
+    /// Recomputes the number of slots after a test finishes.
+    ///
+    /// This is a no-op if the parallelism is fixed or if the last adjustment
+    /// was too recent to have collected meaningful measurements.
+    void
+    update(void)
+    {
+        if (_cpus == 0)
+            return;
+
+        const datetime::timestamp now = datetime::timestamp::now();
+        const int64_t elapsed = (now - _last_sample).to_microseconds();
+        if (elapsed < sampling_interval_usecs)
+            return;
+        const datetime::delta cpu_time = children_cpu_time();
+        // Number of CPUs kept busy by the tests that finished in the period.
+        const double busy_cpus = static_cast< double >(
+            cpu_time.to_microseconds() - _last_cpu_time.to_microseconds()) /
+            elapsed;
+        _last_sample = now;
+        _last_cpu_time = cpu_time;
+
+        const optional< double > load = load_average();
+        const std::size_t old_slots = _slots;
+        if (load && load.get() > _cpus * 1.25) {
+            if (_slots > 1)
+                --_slots;
+        } else if (busy_cpus < _cpus * 0.75 && (!load || load.get() < _cpus)) {
+            if (_slots < _max_slots)
+                ++_slots;
+        }
+        if (_slots != old_slots)
+            LD(F("Adjusted parallelism from %s to %s (busy CPUs %s, load %s)")
+               % old_slots % _slots % busy_cpus % load);
+    }
+};
+
+
+/// Computes the memory available to the tests.
+///
+/// \param user_config The end-user configuration properties.
+///
+/// \return The configured memory budget if any; otherwise, the amount of
+/// physical memory in the machine.  0 means unlimited.
+static units::bytes
+memory_budget(const config::tree& user_config)
+{
+    if (user_config.is_set("memory_budget"))
+        return user_config.lookup< config::bytes_node >("memory_budget");
+    else
+        return utils::physical_memory();
+}
+
+
+/// Computes the maximum size of the outputs to store for each test.
+///
+/// \param user_config The end-user configuration properties.
+///
+/// \return The configured maximum size, which applies to the tests that do not
+/// set their own.  0 means unlimited.
+static units::bytes
+max_output_size(const config::tree& user_config)
+{
+    if (user_config.is_set("max_output_size"))
+        return user_config.lookup< config::bytes_node >("max_output_size");
+    else
+        return units::bytes();
+}
+
+
 /// Puts a test program in the store and returns its identifier.
 ///
 /// This function is idempotent: we maintain a side cache of already-put test
@@ -90,19 +602,19 @@ typedef pid_to_id_map::value_type pid_and_id_pair;
 /// functionality and not have to do this ourselves here.
 ///
 /// \param test_program The test program being put.
-/// \param [in,out] tx Writable transaction on the store.
+/// \param [in,out] writer Writer of the store.
 /// \param [in,out] ids_cache Cache of already-put test programs.
 ///
 /// \return A test program identifier.
 static int64_t
 find_test_program_id(const model::test_program_ptr test_program,
-                     store::write_transaction& tx,
+                     store::async_writer& writer,
                      path_to_id_map& ids_cache)
 {
     const fs::path& key = test_program->relative_path();
     std::map< fs::path, int64_t >::const_iterator iter = ids_cache.find(key);
     if (iter == ids_cache.end()) {
-        const int64_t id = tx.put_test_program(*test_program);
+        const int64_t id = writer.put_test_program(test_program);
         ids_cache.insert(std::make_pair(key, id));
         return id;
     } else {
@@ -115,17 +627,41 @@ find_test_program_id(const model::test_program_ptr test_program,
 ///
 /// \param test_case_id Identifier of the test case in the database.
 /// \param result The result of the execution.
-/// \param [in,out] tx Writable transaction where to store the result data.
+/// \param max_output_size Maximum size of the outputs to store for tests that
+///     do not set their own; 0 means unlimited.
+/// \param [in,out] writer Writer of the store where to put the result data.
 static void
 put_test_result(const int64_t test_case_id,
                 const scheduler::test_result_handle& result,
-                store::write_transaction& tx)
+                const units::bytes& max_output_size,
+                store::async_writer& writer)
 {
-    tx.put_result(result.test_result(), test_case_id,
-                  result.start_time(), result.end_time());
-    tx.put_test_case_file("__STDOUT__", result.stdout_file(), test_case_id);
-    tx.put_test_case_file("__STDERR__", result.stderr_file(), test_case_id);
+    const model::metadata& md = result.test_program()->find(
+        result.test_case_name()).get_metadata();
+    const units::bytes& max_length =
+        md.max_output_size() > 0 ? md.max_output_size() : max_output_size;
+
+    writer.put_result(result.test_result(), test_case_id,
+                      result.start_time(), result.end_time());
 
+    // Outputs captured in memory go straight to the store; only those that
+    // were spilled to disk have to be read back from their files.
+    if (result.stdout_contents()) {
+        writer.put_test_case_contents("__STDOUT__",
+                                      result.stdout_contents().get(),
+                                      test_case_id, max_length);
+    } else {
+        writer.put_test_case_file("__STDOUT__", result.stdout_file(),
+                                  test_case_id, max_length);
+    }
+    if (result.stderr_contents()) {
+        writer.put_test_case_contents("__STDERR__",
+                                      result.stderr_contents().get(),
+                                      test_case_id, max_length);
+    } else {
+        writer.put_test_case_file("__STDERR__", result.stderr_file(),
+                                  test_case_id, max_length);
+    }
 }
 
 
@@ -154,7 +690,7 @@ safe_cleanup(scheduler::test_result_handle handle) throw()
 ///
 /// \param handle Scheduler handle.
 /// \param match Test program and test case to start.
-/// \param [in,out] tx Writable transaction to obtain test IDs.
+/// \param [in,out] writer Writer of the store to obtain test IDs.
 /// \param [in,out] ids_cache Cache of already-put test cases.
 /// \param user_config The end-user configuration properties.
 /// \param hooks The hooks for this execution.
@@ -164,7 +700,7 @@ safe_cleanup(scheduler::test_result_handle handle) throw()
 pid_and_id_pair
 start_test(scheduler::scheduler_handle& handle,
            const engine::scan_result& match,
-           store::write_transaction& tx,
+           store::async_writer& writer,
            path_to_id_map& ids_cache,
            const config::tree& user_config,
            drivers::run_tests::base_hooks& hooks)
@@ -175,9 +711,9 @@ start_test(scheduler::scheduler_handle& handle,
     hooks.got_test_case(*test_program, test_case_name);
 
     const int64_t test_program_id = find_test_program_id(
-        test_program, tx, ids_cache);
-    const int64_t test_case_id = tx.put_test_case(
-        *test_program, test_case_name, test_program_id);
+        test_program, writer, ids_cache);
+    const int64_t test_case_id = writer.put_test_case(
+        test_program->find(test_case_name), test_program_id);
 
     const scheduler::exec_handle exec_handle = handle.spawn_test(
         test_program, test_case_name, user_config);
@@ -189,21 +725,25 @@ start_test(scheduler::scheduler_handle& handle,
 ///
 /// \param [in,out] result_handle The completion handle of the test subprocess.
 /// \param test_case_id Identifier of the test case as returned by start_test().
-/// \param [in,out] tx Writable transaction to put the test results.
+/// \param max_output_size Maximum size of the outputs to store for tests that
+///     do not set their own; 0 means unlimited.
+/// \param [in,out] writer Writer of the store to put the test results.
 /// \param hooks The hooks for this execution.
 ///
 /// \post result_handle is cleaned up.  The caller cannot clean it up again.
 void
 finish_test(scheduler::result_handle_ptr result_handle,
             const int64_t test_case_id,
-            store::write_transaction& tx,
+            const units::bytes& max_output_size,
+            store::async_writer& writer,
             drivers::run_tests::base_hooks& hooks)
 {
     const scheduler::test_result_handle* test_result_handle =
         dynamic_cast< const scheduler::test_result_handle* >(
             result_handle.get());
 
-    put_test_result(test_case_id, *test_result_handle, tx);
+    put_test_result(test_case_id, *test_result_handle, max_output_size,
+                    writer);
 
     const model::test_result test_result = safe_cleanup(*test_result_handle);
     hooks.got_result(
@@ -231,6 +771,66 @@ format_pids(const pid_to_id_map& map)
 }
 
 
+/// Compares two test cases by their estimated durations.
+///
+/// \param a The first test case to compare.
+/// \param b The second test case to compare.
+///
+/// \return True if a is expected to take longer than b.
+static bool
+longer_than(const estimated_test& a, const estimated_test& b)
+{
+    return a.first > b.first;
+}
+
+
+/// Collects all test cases to run sorted by decreasing estimated duration.
+///
+/// Dispatching the longest tests first minimizes the chances of a few long
+/// tests that would otherwise come last extending the total run time while
+/// the other execution slots sit idle.
+///
+/// \param [in,out] scanner The scanner from which to get the test cases.  It
+///     is drained on return.
+/// \param durations Known durations of test cases.
+/// \param default_duration Estimated duration of any test case not in the
+///     durations map.
+///
+/// \return The sorted collection of test cases.  Test cases with equal
+/// estimates retain the order in which the scanner returned them.
+static std::deque< engine::scan_result >
+sort_longest_first(engine::scanner& scanner,
+                   const drivers::run_tests::durations_map& durations,
+                   const datetime::delta& default_duration)
+{
+    std::vector< estimated_test > tests;
+    for (optional< engine::scan_result > match = scanner.yield(); match;
+         match = scanner.yield()) {
+        const model::test_program_ptr test_program = match.get().first;
+        const std::string& test_case_name = match.get().second;
+
+        const drivers::run_tests::durations_map::const_iterator iter =
+            durations.find(std::make_pair(test_program->relative_path(),
+                                          test_case_name));
+        if (iter == durations.end()) {
+            tests.push_back(estimated_test(default_duration, match.get()));
+        } else {
+            tests.push_back(estimated_test((*iter).second, match.get()));
+        }
+    }
+    INV(scanner.done());
+
+    std::stable_sort(tests.begin(), tests.end(), longer_than);
+
+    std::deque< engine::scan_result > sorted_tests;
+    for (std::vector< estimated_test >::const_iterator iter = tests.begin();
+         iter != tests.end(); ++iter) {
+        sorted_tests.push_back((*iter).second);
+    }
+    return sorted_tests;
+}
+
+
 }  // anonymous namespace
 
 
@@ -240,6 +840,33 @@ drivers::run_tests::base_hooks::~base_hooks(void)
 }
 
 
+/// Loads the durations of the test cases recorded in a results file.
+///
+/// \param results_file Path to the results file to read.
+///
+/// \return The durations of all the test cases in the results file.
+///
+/// \throw store::error If the results file cannot be read.
+drivers::run_tests::durations_map
+drivers::run_tests::load_durations(const fs::path& results_file)
+{
+    durations_map durations;
+
+    store::read_backend db = store::read_backend::open_ro(results_file);
+    store::read_transaction tx = db.start_read();
+    for (store::results_iterator iter = tx.get_results(); iter; ++iter) {
+        durations[std::make_pair(iter.test_program()->relative_path(),
+                                 iter.test_case_name())] =
+            iter.end_time() - iter.start_time();
+    }
+    tx.finish();
+
+    LI(F("Loaded the durations of %s test cases from %s") % durations.size() %
+       results_file);
+    return durations;
+}
+
+
 /// Executes the operation.
 ///
 /// \param kyuafile_path The path to the Kyuafile to be loaded.
@@ -247,6 +874,11 @@ drivers::run_tests::base_hooks::~base_hooks(void)
 /// \param store_path The path to the store to be used.
 /// \param filters The test case filters as provided by the user.
 /// \param user_config The end-user configuration properties.
+/// \param durations If not none, known durations of the test cases, in which
+///     case the test cases are run in decreasing order of estimated duration.
+///     Otherwise, the test cases are run in the order in which they are found.
+/// \param default_duration Estimated duration of the test cases that are not
+///     in the durations map.
 /// \param hooks The hooks for this execution.
 ///
 /// \returns A structure with all results computed by this driver.
@@ -256,56 +888,113 @@ drivers::run_tests::drive(const fs::path& kyuafile_path,
                           const fs::path& store_path,
                           const std::set< engine::test_filter >& filters,
                           const config::tree& user_config,
+                          const optional< durations_map >& durations,
+                          const datetime::delta& default_duration,
                           base_hooks& hooks)
 {
     scheduler::scheduler_handle handle = scheduler::setup();
+    if (user_config.is_set("cache_test_lists") &&
+        user_config.lookup< config::bool_node >("cache_test_lists"))
+        handle.enable_list_cache(store::layout::query_list_cache_dir());
 
     const engine::kyuafile kyuafile = engine::kyuafile::load(
         kyuafile_path, build_root, user_config, handle);
-    store::write_backend db = store::write_backend::open_rw(store_path);
-    store::write_transaction tx = db.start_write();
+    // Results are written to the store in the background so that slow writes
+    // do not delay the spawning of tests.  The writer commits periodically so
+    // that the results recorded so far survive an interruption of the run.
+    store::async_writer writer(store_path, max_pending_writes,
+                               max_uncommitted_writes, commit_interval);
 
     {
         const model::context context = scheduler::current_context();
-        (void)tx.put_context(context);
+        writer.put_context(context);
+        writer.put_run_status(false);
     }
 
-    engine::scanner scanner(kyuafile.test_programs(), filters);
+    slots_controller slots(user_config.lookup< engine::parallelism_node >(
+        "parallelism"));
+
+    // Load the lists of test cases of as many test programs as we have slots
+    // in the background so that listing overlaps with the execution of tests.
+    engine::scanner scanner(kyuafile.test_programs(), filters, slots.slots());
+
+    // When ordering by duration, all test cases have to be known upfront.
+    // Test cases are then taken from this queue instead of from the scanner.
+    std::deque< engine::scan_result > sorted_tests;
+    if (durations)
+        sorted_tests = sort_longest_first(scanner, durations.get(),
+                                          default_duration);
 
     path_to_id_map ids_cache;
     pid_to_id_map in_flight;
     std::vector< engine::scan_result > exclusive_tests;
 
-    const std::size_t slots = user_config.lookup< config::positive_int_node >(
-        "parallelism");
-    INV(slots >= 1);
+    // Tests in an exclusive group run concurrently with other tests but not
+    // with tests of the same group.  When a group is released, the next test
+    // waiting for it is queued here and takes precedence over any other test.
+    exclusive_groups groups;
+    std::deque< engine::scan_result > unblocked_tests;
+
+    // Tests whose combined resource requirements exceed what the machine can
+    // provide are not run concurrently.  A test that does not fit waits until
+    // enough in-flight tests finish, and other tests that fit run meanwhile.
+    resources_tracker resources(memory_budget(user_config),
+                                handle.root_work_directory());
+
+    const units::bytes default_max_output_size = max_output_size(user_config);
+
     do {
-        INV(in_flight.size() <= slots);
+        INV(in_flight.size() <= slots.max_slots());
 
         // Spawn as many jobs as needed to fill our execution slots.  We do this
         // first with the assumption that the spawning is faster than any single
         // job, so we want to keep as many jobs in the background as possible.
-        while (in_flight.size() < slots) {
-            optional< engine::scan_result > match = scanner.yield();
+        //
+        // The number of slots may shrink below the number of in-flight tests;
+        // in that case, we wait for tests to finish before spawning new ones.
+        while (in_flight.size() < slots.slots()) {
+            // Tests that waited for resources go first, as they were found
+            // before any other test that has not started yet.
+            optional< engine::scan_result > match = resources.take_fitting();
+            if (!match && !unblocked_tests.empty()) {
+                match = unblocked_tests.front();
+                unblocked_tests.pop_front();
+            } else if (!match && !sorted_tests.empty()) {
+                match = sorted_tests.front();
+                sorted_tests.pop_front();
+            } else if (!match) {
+                match = scanner.yield();
+            }
             if (!match)
                 break;
             const model::test_program_ptr test_program = match.get().first;
             const std::string& test_case_name = match.get().second;
 
-            const model::test_case& test_case = test_program->find(
-                test_case_name);
-            if (test_case.get_metadata().is_exclusive()) {
+            const model::metadata md = metadata_of(match.get());
+            const std::string& group = md.exclusive_group();
+            if (group.empty() && md.is_exclusive()) {
                 // Exclusive tests get processed later, separately.
                 exclusive_tests.push_back(match.get());
                 continue;
+            } else if (!group.empty() && groups.is_busy(group)) {
+                groups.defer(group, match.get());
+                continue;
+            } else if (!resources.fits(md)) {
+                LD(F("Delaying %s:%s until enough resources are released") %
+                   test_program->relative_path() % test_case_name);
+                resources.defer(match.get());
+                continue;
             }
 
             const pid_and_id_pair pid_id = start_test(
-                handle, match.get(), tx, ids_cache, user_config, hooks);
+                handle, match.get(), writer, ids_cache, user_config, hooks);
             INV_MSG(in_flight.find(pid_id.first) == in_flight.end(),
                     F("Spawned test has PID of still-tracked process %s") %
                     pid_id.first);
             in_flight.insert(pid_id);
+            if (!group.empty())
+                groups.acquire(group, pid_id.first);
+            resources.acquire(pid_id.first, md);
         }
 
         // If there are any used slots, consume any at random and return the
@@ -322,21 +1011,34 @@ drivers::run_tests::drive(const fs::path& kyuafile_path,
             const int64_t test_case_id = (*iter).second;
             in_flight.erase(iter);
 
-            finish_test(result_handle, test_case_id, tx, hooks);
+            resources.release(result_handle->original_pid());
+            const optional< engine::scan_result > unblocked = groups.release(
+                result_handle->original_pid());
+            if (unblocked)
+                unblocked_tests.push_back(unblocked.get());
+
+            finish_test(result_handle, test_case_id, default_max_output_size,
+                        writer, hooks);
+            slots.update();
         }
-    } while (!in_flight.empty() || !scanner.done());
+    } while (!in_flight.empty() || !unblocked_tests.empty() ||
+             resources.has_waiting() || !sorted_tests.empty() ||
+             !scanner.done());
+    INV(!groups.has_waiting());
 
     // Run any exclusive tests that we spotted earlier sequentially.
     for (std::vector< engine::scan_result >::const_iterator
              iter = exclusive_tests.begin(); iter != exclusive_tests.end();
              ++iter) {
         const pid_and_id_pair data = start_test(
-            handle, *iter, tx, ids_cache, user_config, hooks);
+            handle, *iter, writer, ids_cache, user_config, hooks);
         scheduler::result_handle_ptr result_handle = handle.wait_any();
-        finish_test(result_handle, data.second, tx, hooks);
+        finish_test(result_handle, data.second, default_max_output_size,
+                    writer, hooks);
     }
 
-    tx.commit();
+    writer.put_run_status(true);
+    writer.commit();
 
     handle.cleanup();
 
@@ -36,8 +36,10 @@
 #if !defined(DRIVERS_RUN_TESTS_HPP)
 #define DRIVERS_RUN_TESTS_HPP
 
+#include <map>
 #include <set>
 #include <string>
+#include <utility>
 
 #include "engine/filters.hpp"
 #include "model/test_program.hpp"
@@ -51,6 +53,14 @@ namespace drivers {
 namespace run_tests {
 
 
+/// Estimated durations of test cases.
+///
+/// The keys are pairs of the relative path of a test program and the name of
+/// one of its test cases.
+typedef std::map< std::pair< utils::fs::path, std::string >,
+                  utils::datetime::delta > durations_map;
+
+
 /// Abstract definition of the hooks for this driver.
 class base_hooks {
 public:
@@ -95,9 +105,13 @@ public:
 };
 
 
+durations_map load_durations(const utils::fs::path&);
+
 result drive(const utils::fs::path&, const utils::optional< utils::fs::path >,
              const utils::fs::path&, const std::set< engine::test_filter >&,
-             const utils::config::tree&, base_hooks&);
+             const utils::config::tree&,
+             const utils::optional< durations_map >&,
+             const utils::datetime::delta&, base_hooks&);
 
 
 }  // namespace run_tests
@@ -28,17 +28,83 @@
 
 #include "drivers/scan_results.hpp"
 
+#include <vector>
+
 #include "engine/filters.hpp"
 #include "model/context.hpp"
-#include "model/test_case.hpp"
-#include "model/test_program.hpp"
 #include "store/read_backend.hpp"
 #include "store/read_transaction.hpp"
 #include "utils/defs.hpp"
+#include "utils/sanity.hpp"
+#include "utils/fs/path.hpp"
 
 namespace fs = utils::fs;
 
 
+namespace {
+
+
+/// Executes the operation.
+///
+/// \param store_path The path to the database store.
+/// \param raw_filters The test case filters as provided by the user.
+/// \param types The types of the results to pass to the hooks.  If empty,
+///     all results that match the test case filters are passed.
+/// \param types_order The order in which to pass the results to the hooks by
+///     their type.  If empty, results are passed in test case order.
+/// \param hooks The hooks for this execution.
+///
+/// \returns A structure with all results computed by this driver.
+static drivers::scan_results::result
+scan(const fs::path& store_path,
+     const std::set< engine::test_filter >& raw_filters,
+     const std::set< model::test_result_type >& types,
+     const std::vector< model::test_result_type >& types_order,
+     drivers::scan_results::base_hooks& hooks)
+{
+    store::read_backend db = store::read_backend::open_ro(store_path);
+    store::read_transaction tx = db.start_read();
+
+    hooks.begin();
+
+    const model::context context = tx.get_context();
+    const bool completed = tx.get_completed();
+    hooks.got_context(context);
+
+    store::results_filter filter;
+    std::set< engine::test_filter > unused_filters;
+    for (std::set< engine::test_filter >::const_iterator
+             iter = raw_filters.begin(); iter != raw_filters.end(); ++iter) {
+        const std::pair< fs::path, std::string > test_case(
+            (*iter).test_program, (*iter).test_case);
+
+        store::results_filter single_filter;
+        single_filter.test_cases.insert(test_case);
+        if (!tx.has_results(single_filter))
+            unused_filters.insert(*iter);
+
+        filter.test_cases.insert(test_case);
+    }
+
+    const store::results_totals_map totals = tx.get_results_totals(filter);
+
+    filter.types = types;
+    filter.types_order = types_order;
+    store::results_iterator iter = tx.get_results(filter);
+    while (iter) {
+        hooks.got_result(iter);
+        ++iter;
+    }
+
+    drivers::scan_results::result r(unused_filters, completed, totals);
+    hooks.end(r);
+    return r;
+}
+
+
+}  // anonymous namespace
+
+
 /// Pure abstract destructor.
 drivers::scan_results::base_hooks::~base_hooks(void)
 {
@@ -71,37 +137,55 @@ drivers::scan_results::drive(const fs::path& store_path,
                              const std::set< engine::test_filter >& raw_filters,
                              base_hooks& hooks)
 {
-    engine::filters_state filters(raw_filters);
-
-    store::read_backend db = store::read_backend::open_ro(store_path);
-    store::read_transaction tx = db.start_read();
+    return drive(store_path, raw_filters,
+                 std::set< model::test_result_type >(), hooks);
+}
 
-    hooks.begin();
 
-    const model::context context = tx.get_context();
-    hooks.got_context(context);
+/// Executes the operation.
+///
+/// The filters are handed to the database so that only the matching results
+/// are read from it.
+///
+/// \param store_path The path to the database store.
+/// \param raw_filters The test case filters as provided by the user.
+/// \param types The types of the results to pass to the hooks.  If empty,
+///     all results that match the test case filters are passed.
+/// \param hooks The hooks for this execution.
+///
+/// \returns A structure with all results computed by this driver.
+drivers::scan_results::result
+drivers::scan_results::drive(const fs::path& store_path,
+                             const std::set< engine::test_filter >& raw_filters,
+                             const std::set< model::test_result_type >& types,
+                             base_hooks& hooks)
+{
+    return scan(store_path, raw_filters, types,
+                std::vector< model::test_result_type >(), hooks);
+}
 
-    store::results_iterator iter = tx.get_results();
-    while (iter) {
-        // TODO(jmmv): We should be filtering at the test case level for
-        // efficiency, but that means we would need to execute more than one
-        // query on the database and our current interfaces don't support that.
-        //
-        // Reuse engine::filters_state for the time being because it is simpler
-        // and we get tracking of unmatched filters "for free".
-        const model::test_program_ptr test_program = iter.test_program();
-        if (filters.match_test_program(test_program->relative_path())) {
-            const model::test_case& test_case = test_program->find(
-                iter.test_case_name());
-            if (filters.match_test_case(test_program->relative_path(),
-                                        test_case.name())) {
-                hooks.got_result(iter);
-            }
-        }
-        ++iter;
-    }
 
-    result r(filters.unused());
-    hooks.end(r);
-    return r;
+/// Executes the operation passing the results to the hooks grouped by type.
+///
+/// This allows the hooks to print a listing sectioned by result type as the
+/// results come, without having to hold them in memory until the end.
+///
+/// \param store_path The path to the database store.
+/// \param raw_filters The test case filters as provided by the user.
+/// \param types The types of the results to pass to the hooks, in the order
+///     in which to pass them.  Within each type, the results are passed in
+///     test case order.  Must not be empty.
+/// \param hooks The hooks for this execution.
+///
+/// \returns A structure with all results computed by this driver.
+drivers::scan_results::result
+drivers::scan_results::drive(const fs::path& store_path,
+                             const std::set< engine::test_filter >& raw_filters,
+                             const std::vector< model::test_result_type >& types,
+                             base_hooks& hooks)
+{
+    PRE(!types.empty());
+    return scan(store_path, raw_filters,
+                std::set< model::test_result_type >(types.begin(), types.end()),
+                types, hooks);
 }
@@ -42,10 +42,12 @@ extern "C" {
 }
 
 #include <set>
+#include <vector>
 
 #include "engine/filters.hpp"
 #include "model/context_fwd.hpp"
-#include "store/read_transaction_fwd.hpp"
+#include "model/test_result_fwd.hpp"
+#include "store/read_transaction.hpp"
 #include "utils/datetime_fwd.hpp"
 #include "utils/fs/path_fwd.hpp"
 
@@ -62,11 +64,28 @@ public:
     /// test filter does not match any test case, it is probably a typo.
     std::set< engine::test_filter > unused_filters;
 
+    /// Whether the test run that generated the results completed or not.
+    ///
+    /// If false, the run was interrupted and the results are partial.
+    bool completed;
+
+    /// Aggregated data of the results that match the test filters.
+    ///
+    /// These cover all result types, including those that were not requested
+    /// and thus not passed to the hooks.
+    store::results_totals_map totals;
+
     /// Initializer for the tuple's fields.
     ///
     /// \param unused_filters_ The filters that did not match any test case.
-    result(const std::set< engine::test_filter >& unused_filters_) :
-        unused_filters(unused_filters_)
+    /// \param completed_ Whether the test run completed or not.
+    /// \param totals_ Aggregated data of the results that match the filters.
+    result(const std::set< engine::test_filter >& unused_filters_,
+           const bool completed_,
+           const store::results_totals_map& totals_) :
+        unused_filters(unused_filters_),
+        completed(completed_),
+        totals(totals_)
     {
     }
 };
@@ -97,6 +116,10 @@ public:
 
 result drive(const utils::fs::path&, const std::set< engine::test_filter >&,
              base_hooks&);
+result drive(const utils::fs::path&, const std::set< engine::test_filter >&,
+             const std::set< model::test_result_type >&, base_hooks&);
+result drive(const utils::fs::path&, const std::set< engine::test_filter >&,
+             const std::vector< model::test_result_type >&, base_hooks&);
 
 
 }  // namespace scan_results
@@ -29,6 +29,7 @@
 #include "drivers/scan_results.hpp"
 
 #include <set>
+#include <vector>
 
 #include <atf-c++.hpp>
 
@@ -136,8 +137,10 @@ public:
 ///     Determines the number of test programs and the number of test cases
 ///     each has.  Can be used to determine from the caller which particular
 ///     results file has been loaded.
+/// \param completed Whether to mark the test run as completed or not.
 static void
-populate_results_file(const char* db_name, const int count)
+populate_results_file(const char* db_name, const int count,
+                      const bool completed)
 {
     store::write_backend backend = store::write_backend::open_rw(
         fs::path(db_name));
@@ -149,6 +152,7 @@ populate_results_file(const char* db_name, const int count)
         env[F("VAR%s") % i] = F("Value %s") % i;
     const model::context context(fs::path("/root"), env);
     tx.put_context(context);
+    tx.put_run_status(completed);
 
     for (int i = 0; i < count; i++) {
         model::test_program_builder test_program_builder(
@@ -183,12 +187,13 @@ populate_results_file(const char* db_name, const int count)
 ATF_TEST_CASE_WITHOUT_HEAD(ok__all);
 ATF_TEST_CASE_BODY(ok__all)
 {
-    populate_results_file("test.db", 2);
+    populate_results_file("test.db", 2, true);
 
     capture_hooks hooks;
     const drivers::scan_results::result result = drivers::scan_results::drive(
         fs::path("test.db"), std::set< engine::test_filter >(), hooks);
     ATF_REQUIRE(result.unused_filters.empty());
+    ATF_REQUIRE(result.completed);
     ATF_REQUIRE(hooks._begin_called);
     ATF_REQUIRE(hooks._end_result);
 
@@ -210,7 +215,7 @@ ATF_TEST_CASE_BODY(ok__all)
 ATF_TEST_CASE_WITHOUT_HEAD(ok__filters);
 ATF_TEST_CASE_BODY(ok__filters)
 {
-    populate_results_file("test.db", 3);
+    populate_results_file("test.db", 3, true);
 
     std::set< engine::test_filter > filters;
     filters.insert(engine::test_filter(fs::path("dir/prog_1"), ""));
@@ -235,6 +240,110 @@ ATF_TEST_CASE_BODY(ok__filters)
     results.insert("/root/dir/prog_1:case_2:skipped:Count 2:4:13");
     results.insert("/root/dir/prog_2:case_1:skipped:Count 1:4:13");
     ATF_REQUIRE_EQ(results, hooks._results);
+
+    ATF_REQUIRE_EQ(1, result.totals.size());
+    ATF_REQUIRE_EQ(4, result.totals.find(
+        model::test_result_skipped)->second.count);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(ok__types);
+ATF_TEST_CASE_BODY(ok__types)
+{
+    populate_results_file("test.db", 2, true);
+
+    std::set< engine::test_filter > filters;
+    filters.insert(engine::test_filter(fs::path("dir/prog_1"), ""));
+
+    {
+        std::set< model::test_result_type > types;
+        types.insert(model::test_result_passed);
+
+        capture_hooks hooks;
+        const drivers::scan_results::result result =
+            drivers::scan_results::drive(fs::path("test.db"), filters, types,
+                                         hooks);
+        ATF_REQUIRE(result.unused_filters.empty());
+        ATF_REQUIRE(hooks._results.empty());
+
+        ATF_REQUIRE_EQ(1, result.totals.size());
+        const store::results_totals& totals = result.totals.find(
+            model::test_result_skipped)->second;
+        ATF_REQUIRE_EQ(2, totals.count);
+        ATF_REQUIRE_EQ(datetime::delta(8, 23), totals.runtime);
+    }
+
+    {
+        std::set< model::test_result_type > types;
+        types.insert(model::test_result_passed);
+        types.insert(model::test_result_skipped);
+
+        capture_hooks hooks;
+        const drivers::scan_results::result result =
+            drivers::scan_results::drive(fs::path("test.db"), filters, types,
+                                         hooks);
+
+        std::set< std::string > results;
+        results.insert("/root/dir/prog_1:case_0:skipped:Count 0:4:11");
+        results.insert("/root/dir/prog_1:case_1:skipped:Count 1:4:12");
+        ATF_REQUIRE_EQ(results, hooks._results);
+    }
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(ok__types_order);
+ATF_TEST_CASE_BODY(ok__types_order)
+{
+    populate_results_file("test.db", 2, true);
+
+    std::set< engine::test_filter > filters;
+    filters.insert(engine::test_filter(fs::path("dir/prog_0"), ""));
+
+    {
+        std::vector< model::test_result_type > types;
+        types.push_back(model::test_result_passed);
+
+        capture_hooks hooks;
+        const drivers::scan_results::result result =
+            drivers::scan_results::drive(fs::path("test.db"), filters, types,
+                                         hooks);
+        ATF_REQUIRE(result.unused_filters.empty());
+        ATF_REQUIRE(hooks._results.empty());
+        ATF_REQUIRE_EQ(2, result.totals.find(
+            model::test_result_skipped)->second.count);
+    }
+
+    {
+        std::vector< model::test_result_type > types;
+        types.push_back(model::test_result_skipped);
+        types.push_back(model::test_result_passed);
+
+        capture_hooks hooks;
+        drivers::scan_results::drive(fs::path("test.db"), filters, types,
+                                     hooks);
+
+        std::set< std::string > results;
+        results.insert("/root/dir/prog_0:case_0:skipped:Count 0:4:10");
+        results.insert("/root/dir/prog_0:case_1:skipped:Count 1:4:11");
+        ATF_REQUIRE_EQ(results, hooks._results);
+    }
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(ok__incomplete);
+ATF_TEST_CASE_BODY(ok__incomplete)
+{
+    populate_results_file("test.db", 1, false);
+
+    capture_hooks hooks;
+    const drivers::scan_results::result result = drivers::scan_results::drive(
+        fs::path("test.db"), std::set< engine::test_filter >(), hooks);
+    ATF_REQUIRE(!result.completed);
+    ATF_REQUIRE(!hooks._end_result.get().completed);
+
+    std::set< std::string > results;
+    results.insert("/root/dir/prog_0:case_0:skipped:Count 0:4:10");
+    ATF_REQUIRE_EQ(results, hooks._results);
 }
 
 
@@ -254,5 +363,8 @@ ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, ok__all);
     ATF_ADD_TEST_CASE(tcs, ok__filters);
+    ATF_ADD_TEST_CASE(tcs, ok__types);
+    ATF_ADD_TEST_CASE(tcs, ok__types_order);
+    ATF_ADD_TEST_CASE(tcs, ok__incomplete);
     ATF_ADD_TEST_CASE(tcs, missing_db);
 }
@@ -240,3 +240,13 @@ engine::atf_interface::compute_result(
 {
     return calculate_atf_result(status, control_directory / result_name);
 }
+
+
+/// Checks whether compute_result() reads the output of the test case.
+///
+/// \return False: the result of ATF test cases does not depend on their output.
+bool
+engine::atf_interface::needs_output_files(void) const
+{
+    return false;
+}
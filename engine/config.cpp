@@ -32,13 +32,23 @@
 #   include "config.h"
 #endif
 
+extern "C" {
+#include <unistd.h>
+}
+
 #include <stdexcept>
 
+#include <lutok/state.ipp>
+
 #include "engine/exceptions.hpp"
 #include "utils/config/exceptions.hpp"
+#include "utils/config/nodes.ipp"
 #include "utils/config/parser.hpp"
 #include "utils/config/tree.ipp"
+#include "utils/format/macros.hpp"
+#include "utils/logging/macros.hpp"
 #include "utils/passwd.hpp"
+#include "utils/sanity.hpp"
 #include "utils/text/exceptions.hpp"
 #include "utils/text/operations.ipp"
 
@@ -59,7 +69,10 @@ static void
 init_tree(config::tree& tree)
 {
     tree.define< config::string_node >("architecture");
-    tree.define< config::positive_int_node >("parallelism");
+    tree.define< config::bool_node >("cache_test_lists");
+    tree.define< config::bytes_node >("max_output_size");
+    tree.define< config::bytes_node >("memory_budget");
+    tree.define< engine::parallelism_node >("parallelism");
     tree.define< config::string_node >("platform");
     tree.define< engine::user_node >("unprivileged_user");
     tree.define_dynamic("test_suites");
@@ -77,7 +90,7 @@ set_defaults(config::tree& tree)
     // TODO(jmmv): Automatically derive this from the number of CPUs in the
     // machine and forcibly set to a value greater than 1.  Still testing
     // the new parallel implementation as of 2015-02-27 though.
-    tree.set< config::positive_int_node >("parallelism", 1);
+    tree.set< engine::parallelism_node >("parallelism", 1);
     tree.set< config::string_node >("platform", KYUA_PLATFORM);
 }
 
@@ -121,9 +134,137 @@ public:
 };
 
 
+/// Parses the textual representation of a parallelism setting.
+///
+/// \param raw_value The value to parse: a positive integer or 'auto'.
+///
+/// \return The parsed value, which is auto_parallelism for 'auto'.
+///
+/// \throw value_error If the value is invalid.
+static int
+parse_parallelism(const std::string& raw_value)
+{
+    if (raw_value == "auto")
+        return engine::auto_parallelism;
+
+    int value;
+    try {
+        value = text::to_type< int >(raw_value);
+    } catch (const text::value_error& e) {
+        throw config::value_error("Must be a positive integer or 'auto'");
+    }
+    if (value <= 0)
+        throw config::value_error("Must be a positive integer or 'auto'");
+    return value;
+}
+
+
 }  // anonymous namespace
 
 
+/// Copies the node.
+///
+/// \return A dynamically-allocated node.
+config::detail::base_node*
+engine::parallelism_node::deep_copy(void) const
+{
+    std::auto_ptr< parallelism_node > new_node(new parallelism_node());
+    new_node->_value = _value;
+    return new_node.release();
+}
+
+
+/// Pushes the node's value onto the Lua stack.
+///
+/// \param state The Lua state onto which to push the value.
+void
+engine::parallelism_node::push_lua(lutok::state& state) const
+{
+    if (value() == auto_parallelism)
+        state.push_string("auto");
+    else
+        state.push_integer(value());
+}
+
+
+/// Sets the value of the node from an entry in the Lua stack.
+///
+/// \param state The Lua state from which to get the value.
+/// \param value_index The stack index in which the value resides.
+///
+/// \throw value_error If the value in state(value_index) cannot be
+///     processed by this node.
+void
+engine::parallelism_node::set_lua(lutok::state& state, const int value_index)
+{
+    // Numbers are also strings in Lua, so this handles both types.
+    if (!state.is_string(value_index))
+        throw config::value_error("Must be a positive integer or 'auto'");
+    config::typed_leaf_node< int >::set(
+        parse_parallelism(state.to_string(value_index)));
+}
+
+
+/// Sets the value of the node from a raw string representation.
+///
+/// \param raw_value The value to set the node to.
+///
+/// \throw value_error If the value is invalid.
+void
+engine::parallelism_node::set_string(const std::string& raw_value)
+{
+    config::typed_leaf_node< int >::set(parse_parallelism(raw_value));
+}
+
+
+/// Converts the contents of the node to a string.
+///
+/// \pre The node must have a value.
+///
+/// \return A string representation of the value held by the node.
+std::string
+engine::parallelism_node::to_string(void) const
+{
+    const int parallelism = config::typed_leaf_node< int >::value();
+    if (parallelism == auto_parallelism)
+        return "auto";
+    else
+        return F("%s") % parallelism;
+}
+
+
+/// Gets the number of online CPUs.
+///
+/// \return The number of online CPUs; 1 if it cannot be queried.
+std::size_t
+engine::online_cpus(void)
+{
+    const long cpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) {
+        LW("Cannot query the number of online CPUs; assuming 1");
+        return 1;
+    }
+    return static_cast< std::size_t >(cpus);
+}
+
+
+/// Computes the initial number of concurrent test cases.
+///
+/// \param parallelism The value of a parallelism_node.
+///
+/// \return The given parallelism, or the number of online CPUs if the
+/// parallelism is auto_parallelism.
+std::size_t
+engine::resolve_parallelism(const int parallelism)
+{
+    PRE(parallelism >= 0);
+    if (parallelism == auto_parallelism)
+        return online_cpus();
+    else
+        return static_cast< std::size_t >(parallelism);
+}
+
+
 /// Copies the node.
 ///
 /// \return A dynamically-allocated node.
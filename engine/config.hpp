@@ -34,6 +34,8 @@
 
 #include "engine/config_fwd.hpp"
 
+#include <cstddef>
+
 #include "utils/config/nodes.hpp"
 #include "utils/config/tree_fwd.hpp"
 #include "utils/fs/path_fwd.hpp"
@@ -42,6 +44,31 @@
 namespace engine {
 
 
+/// Tree node to hold the maximum number of concurrent test cases.
+///
+/// The node holds either a positive integer or the 'auto' keyword, which is
+/// represented internally as auto_parallelism.
+class parallelism_node : public utils::config::typed_leaf_node< int > {
+public:
+    virtual base_node* deep_copy(void) const;
+
+    void push_lua(lutok::state&) const;
+    void set_lua(lutok::state&, const int);
+
+    void set_string(const std::string&);
+    std::string to_string(void) const;
+};
+
+
+/// Value of a parallelism_node to let the number of concurrent tests adapt to
+/// the capacity and the load of the machine.
+const int auto_parallelism = 0;
+
+
+std::size_t online_cpus(void);
+std::size_t resolve_parallelism(const int);
+
+
 /// Tree node to hold a system user identifier.
 class user_node : public utils::config::typed_leaf_node< utils::passwd::user > {
 public:
@@ -42,10 +42,12 @@
 #include "utils/cmdline/parser.hpp"
 #include "utils/config/tree.ipp"
 #include "utils/passwd.hpp"
+#include "utils/units.hpp"
 
 namespace config = utils::config;
 namespace fs = utils::fs;
 namespace passwd = utils::passwd;
+namespace units = utils::units;
 
 using utils::none;
 using utils::optional;
@@ -78,9 +80,15 @@ validate_defaults(const config::tree& config)
         KYUA_ARCHITECTURE,
         config.lookup< config::string_node >("architecture"));
 
+    ATF_REQUIRE(!config.is_set("cache_test_lists"));
+
+    ATF_REQUIRE(!config.is_set("max_output_size"));
+
+    ATF_REQUIRE(!config.is_set("memory_budget"));
+
     ATF_REQUIRE_EQ(
         1,
-        config.lookup< config::positive_int_node >("parallelism"));
+        config.lookup< engine::parallelism_node >("parallelism"));
 
     ATF_REQUIRE_EQ(
         KYUA_PLATFORM,
@@ -103,17 +111,78 @@ ATF_TEST_CASE_BODY(config__defaults)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(config__set__cache_test_lists);
+ATF_TEST_CASE_BODY(config__set__cache_test_lists)
+{
+    config::tree user_config = engine::default_config();
+    user_config.set_string("cache_test_lists", "false");
+    ATF_REQUIRE(!user_config.lookup< config::bool_node >("cache_test_lists"));
+    ATF_REQUIRE_THROW_RE(
+        config::error, "cache_test_lists",
+        user_config.set_string("cache_test_lists", "foo"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(config__set__max_output_size);
+ATF_TEST_CASE_BODY(config__set__max_output_size)
+{
+    config::tree user_config = engine::default_config();
+    user_config.set_string("max_output_size", "10M");
+    ATF_REQUIRE_EQ(
+        units::bytes(10 * units::MB),
+        user_config.lookup< config::bytes_node >("max_output_size"));
+    ATF_REQUIRE_THROW_RE(
+        config::error, "max_output_size",
+        user_config.set_string("max_output_size", "foo"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(config__set__memory_budget);
+ATF_TEST_CASE_BODY(config__set__memory_budget)
+{
+    config::tree user_config = engine::default_config();
+    user_config.set_string("memory_budget", "2G");
+    ATF_REQUIRE_EQ(
+        units::bytes(2 * units::GB),
+        user_config.lookup< config::bytes_node >("memory_budget"));
+    ATF_REQUIRE_THROW_RE(
+        config::error, "memory_budget",
+        user_config.set_string("memory_budget", "foo"));
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(config__set__parallelism);
 ATF_TEST_CASE_BODY(config__set__parallelism)
 {
     config::tree user_config = engine::default_config();
     user_config.set_string("parallelism", "8");
+    ATF_REQUIRE_EQ(
+        8, user_config.lookup< engine::parallelism_node >("parallelism"));
+    user_config.set_string("parallelism", "auto");
+    ATF_REQUIRE_EQ(
+        engine::auto_parallelism,
+        user_config.lookup< engine::parallelism_node >("parallelism"));
+    ATF_REQUIRE_EQ("auto", user_config.lookup_string("parallelism"));
     ATF_REQUIRE_THROW_RE(
         config::error, "parallelism.*Must be a positive integer",
         user_config.set_string("parallelism", "0"));
     ATF_REQUIRE_THROW_RE(
         config::error, "parallelism.*Must be a positive integer",
         user_config.set_string("parallelism", "-1"));
+    ATF_REQUIRE_THROW_RE(
+        config::error, "parallelism.*Must be a positive integer",
+        user_config.set_string("parallelism", "foo"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(resolve_parallelism);
+ATF_TEST_CASE_BODY(resolve_parallelism)
+{
+    ATF_REQUIRE_EQ(1, engine::resolve_parallelism(1));
+    ATF_REQUIRE_EQ(16, engine::resolve_parallelism(16));
+    ATF_REQUIRE_EQ(engine::online_cpus(),
+                   engine::resolve_parallelism(engine::auto_parallelism));
+    ATF_REQUIRE(engine::online_cpus() >= 1);
 }
 
 
@@ -136,6 +205,7 @@ ATF_TEST_CASE_BODY(config__load__overrides)
         "config",
         "syntax(2)\n"
         "architecture = 'test-architecture'\n"
+        "memory_budget = '512m'\n"
         "parallelism = 16\n"
         "platform = 'test-platform'\n"
         "unprivileged_user = 'user2'\n"
@@ -145,6 +215,8 @@ ATF_TEST_CASE_BODY(config__load__overrides)
 
     ATF_REQUIRE_EQ("test-architecture",
                    user_config.lookup_string("architecture"));
+    ATF_REQUIRE_EQ(units::bytes(512 * units::MB),
+                   user_config.lookup< config::bytes_node >("memory_budget"));
     ATF_REQUIRE_EQ("16",
                    user_config.lookup_string("parallelism"));
     ATF_REQUIRE_EQ("test-platform",
@@ -194,7 +266,11 @@ ATF_TEST_CASE_BODY(config__load__missing_file)
 ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, config__defaults);
+    ATF_ADD_TEST_CASE(tcs, config__set__cache_test_lists);
+    ATF_ADD_TEST_CASE(tcs, config__set__max_output_size);
+    ATF_ADD_TEST_CASE(tcs, config__set__memory_budget);
     ATF_ADD_TEST_CASE(tcs, config__set__parallelism);
+    ATF_ADD_TEST_CASE(tcs, resolve_parallelism);
     ATF_ADD_TEST_CASE(tcs, config__load__defaults);
     ATF_ADD_TEST_CASE(tcs, config__load__overrides);
     ATF_ADD_TEST_CASE(tcs, config__load__lua_error);
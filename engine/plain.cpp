@@ -141,3 +141,14 @@ engine::plain_interface::compute_result(
             F("Received signal %s") % status.get().termsig());
     }
 }
+
+
+/// Checks whether compute_result() reads the output of the test case.
+///
+/// \return False: the result of plain test cases only depends on their exit
+/// status.
+bool
+engine::plain_interface::needs_output_files(void) const
+{
+    return false;
+}
@@ -58,6 +58,8 @@ public:
         const utils::fs::path&,
         const utils::fs::path&,
         const utils::fs::path&) const;
+
+    bool needs_output_files(void) const;
 };
 
 
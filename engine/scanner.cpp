@@ -28,16 +28,20 @@
 
 #include "engine/scanner.hpp"
 
+#include <cstddef>
 #include <deque>
 #include <string>
 
 #include "engine/filters.hpp"
+#include "engine/scheduler.hpp"
 #include "model/test_case.hpp"
 #include "model/test_program.hpp"
 #include "utils/noncopyable.hpp"
 #include "utils/optional.ipp"
 #include "utils/sanity.hpp"
 
+namespace scheduler = engine::scheduler;
+
 using utils::none;
 using utils::optional;
 
@@ -85,15 +89,70 @@ struct engine::scanner::impl : utils::noncopyable {
     /// pending_test_programs when such test program is active.
     optional< std::deque< std::string > > first_test_cases;
 
+    /// Maximum number of test programs to load ahead of time.
+    const std::size_t max_prefetch;
+
+    /// Position in pending_test_programs of the next candidate to prefetch.
+    std::size_t prefetch_cursor;
+
+    /// Test programs still pending whose loading has been started, in order.
+    std::deque< const model::test_program* > prefetched;
+
     /// Constructor.
     ///
     /// \param test_programs_ Collection of test programs to scan through.
     /// \param filters_ List of scan filters as provided by the user.
+    /// \param max_prefetch_ Maximum number of test programs to load ahead of
+    ///     time.
     impl(const model::test_programs_vector& test_programs_,
-         const std::set< engine::test_filter >& filters_) :
+         const std::set< engine::test_filter >& filters_,
+         const std::size_t max_prefetch_) :
         pending_test_programs(test_programs_.begin(), test_programs_.end()),
-        filters(filters_)
+        filters(filters_),
+        max_prefetch(max_prefetch_),
+        prefetch_cursor(0)
+    {
+    }
+
+    /// Starts loading the test cases of the upcoming test programs.
+    ///
+    /// Only test programs that load their test cases lazily from disk are
+    /// affected by this; any others are already loaded and are skipped.  The
+    /// active test program counts towards max_prefetch, so a value of 1 is
+    /// equivalent to not prefetching at all.  Every test program is only
+    /// considered once, no matter how many times this is called.
+    void
+    prefetch(void)
+    {
+        while (prefetched.size() < max_prefetch &&
+               prefetch_cursor < pending_test_programs.size()) {
+            const model::test_program_ptr& test_program =
+                pending_test_programs[prefetch_cursor];
+            ++prefetch_cursor;
+
+            const scheduler::lazy_test_program* lazy_test_program =
+                dynamic_cast< const scheduler::lazy_test_program* >(
+                    test_program.get());
+            if (lazy_test_program == NULL ||
+                !filters.match_test_program(test_program->relative_path()))
+                continue;
+
+            lazy_test_program->prefetch_test_cases();
+            prefetched.push_back(test_program.get());
+        }
+    }
+
+    /// Discards the first pending test program.
+    void
+    pop_test_program(void)
     {
+        PRE(!pending_test_programs.empty());
+        if (!prefetched.empty() &&
+            prefetched.front() == pending_test_programs.front().get())
+            prefetched.pop_front();
+        pending_test_programs.pop_front();
+        if (prefetch_cursor > 0)
+            --prefetch_cursor;
     }
 
     /// Positions the internal state to return the next element if any.
@@ -109,7 +168,7 @@ struct engine::scanner::impl : utils::noncopyable {
         for (;;) {
             if (first_test_cases) {
                 if (first_test_cases.get().empty()) {
-                    pending_test_programs.pop_front();
+                    pop_test_program();
                     first_test_cases = none;
                 }
             }
@@ -121,10 +180,11 @@ struct engine::scanner::impl : utils::noncopyable {
             if (!first_test_cases) {
                 if (!filters.match_test_program(
                         test_program->relative_path())) {
-                    pending_test_programs.pop_front();
+                    pop_test_program();
                     continue;
                 }
 
+                prefetch();
                 first_test_cases = utils::make_optional(
                     map_keys(test_program->test_cases()));
             }
@@ -140,7 +200,7 @@ struct engine::scanner::impl : utils::noncopyable {
                 }
                 return true;
             } else {
-                pending_test_programs.pop_front();
+                pop_test_program();
                 first_test_cases = none;
             }
         }
@@ -167,9 +227,13 @@ struct engine::scanner::impl : utils::noncopyable {
 ///
 /// \param test_programs Collection of test programs to scan through.
 /// \param filters List of scan filters as provided by the user.
+/// \param max_prefetch Maximum number of test programs for which to load the
+///     list of test cases concurrently.  Values of 0 and 1 cause the lists to
+///     be loaded one at a time, on demand.
 engine::scanner::scanner(const model::test_programs_vector& test_programs,
-                         const std::set< engine::test_filter >& filters) :
-    _pimpl(new impl(test_programs, filters))
+                         const std::set< engine::test_filter >& filters,
+                         const std::size_t max_prefetch) :
+    _pimpl(new impl(test_programs, filters, max_prefetch))
 {
 }
 
@@ -34,6 +34,7 @@
 
 #include "engine/scanner_fwd.hpp"
 
+#include <cstddef>
 #include <memory>
 #include <set>
 
@@ -52,6 +53,9 @@ namespace engine {
 ///
 /// The scanning algorithm guarantees that test programs are initialized
 /// dynamically, should they need to load their list of test cases from disk.
+/// Such loading can be pipelined: the scanner can start loading the lists of
+/// the upcoming test programs while the caller is still processing the test
+/// cases of the current one.
 ///
 /// The order of the extraction is not guaranteed.
 class scanner {
@@ -60,7 +64,8 @@ class scanner {
     std::shared_ptr< impl > _pimpl;
 
 public:
-    scanner(const model::test_programs_vector&, const std::set< test_filter >&);
+    scanner(const model::test_programs_vector&, const std::set< test_filter >&,
+            const std::size_t = 0);
     ~scanner(void);
 
     bool done(void);
@@ -32,11 +32,13 @@ extern "C" {
 #include <unistd.h>
 }
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <memory>
 #include <stdexcept>
+#include <vector>
 
 #include "engine/config.hpp"
 #include "engine/exceptions.hpp"
@@ -46,15 +48,16 @@ extern "C" {
 #include "model/test_case.hpp"
 #include "model/test_program.hpp"
 #include "model/test_result.hpp"
+#include "store/list_cache.hpp"
 #include "utils/config/tree.ipp"
 #include "utils/datetime.hpp"
 #include "utils/defs.hpp"
 #include "utils/env.hpp"
 #include "utils/format/macros.hpp"
-#include "utils/fs/directory.hpp"
 #include "utils/fs/exceptions.hpp"
 #include "utils/fs/operations.hpp"
 #include "utils/fs/path.hpp"
+#include "utils/fs/walker.hpp"
 #include "utils/logging/macros.hpp"
 #include "utils/noncopyable.hpp"
 #include "utils/optional.ipp"
@@ -113,6 +116,14 @@ static const int exit_skipped = 84;
 static const char* skipped_cookie = "skipped.txt";
 
 
+/// Maximum amount of each output of a test to keep in memory.
+///
+/// Larger outputs are spilled to the output files.  This matches the size
+/// above which the store copies files piece by piece instead of loading them
+/// into memory, so outputs that exceed it do not cost an extra copy.
+static const std::size_t max_captured_output_size = 1024 * 1024;
+
+
 /// Mapping of interface names to interface definitions.
 typedef std::map< std::string, std::shared_ptr< scheduler::interface > >
     interfaces_map;
@@ -138,14 +149,12 @@ append_files_listing(const fs::path& dir_path, const fs::path& output_file)
         throw engine::error(F("Failed to open output file %s for append")
                             % output_file);
     try {
-        std::set < std::string > names;
+        std::vector< std::string > names;
 
-        const fs::directory dir(dir_path);
-        for (fs::directory::const_iterator iter = dir.begin();
-             iter != dir.end(); ++iter) {
-            if (iter->name != "." && iter->name != "..")
-                names.insert(iter->name);
-        }
+        fs::walker walker(dir_path, false);
+        while (walker.next())
+            names.push_back(walker.name());
+        std::sort(names.begin(), names.end());
 
         if (!names.empty()) {
             output << "Files left in work directory after failure: "
@@ -492,6 +501,74 @@ public:
 };
 
 
+/// Builds the test cases list that represents a failed listing operation.
+///
+/// TODO(jmmv): This is a very ugly workaround for the fact that we cannot
+/// report failures at the test-program level.
+///
+/// \param reason The reason for the failure.
+///
+/// \return A test cases list with a single fake test case that, when run,
+/// reports the failure to load the list.
+static model::test_cases_map
+broken_test_cases_list(const std::string& reason)
+{
+    LW(F("Failed to load test cases list: %s") % reason);
+    model::test_cases_map fake_test_cases;
+    fake_test_cases.insert(model::test_cases_map::value_type(
+        "__test_cases_list__",
+        model::test_case(
+            "__test_cases_list__",
+            "Represents the correct processing of the test cases list",
+            model::test_result(model::test_result_broken, reason))));
+    return fake_test_cases;
+}
+
+
+/// Maintenance data held while a test program listing is being executed.
+///
+/// Listing operations are not tracked in exec_data_map because they are never
+/// exposed to the caller as result handles: their results are kept internally
+/// until list_tests() is called for the corresponding test program.
+struct list_exec_data {
+    /// The test program being listed.
+    const model::test_program* test_program;
+
+    /// Test program-specific execution interface.
+    std::shared_ptr< scheduler::interface > interface;
+
+    /// Configuration variables passed to the test program.
+    config::properties_map vars;
+
+    /// Handle of the listing subprocess.
+    executor::exec_handle exec_handle;
+
+    /// Constructor.
+    ///
+    /// \param test_program_ The test program being listed.
+    /// \param interface_ Test program-specific execution interface.
+    /// \param vars_ Configuration variables passed to the test program.
+    /// \param exec_handle_ Handle of the listing subprocess.
+    list_exec_data(const model::test_program* test_program_,
+                   const std::shared_ptr< scheduler::interface > interface_,
+                   const config::properties_map& vars_,
+                   const executor::exec_handle& exec_handle_) :
+        test_program(test_program_), interface(interface_), vars(vars_),
+        exec_handle(exec_handle_)
+    {
+    }
+};
+
+
+/// Mapping of PIDs of listing subprocesses to their maintenance data.
+typedef std::map< int, list_exec_data > list_exec_data_map;
+
+
+/// Mapping of test programs to their test case lists.
+typedef std::map< const model::test_program*, model::test_cases_map >
+    test_cases_lists_map;
+
+
 /// Obtains the right scheduler interface for a given test program.
 ///
 /// \param name The name of the interface of the test program.
@@ -523,6 +600,15 @@ scheduler::interface::exec_cleanup(
 }
 
 
+bool
+scheduler::interface::needs_output_files(void) const
+{
+    // Be conservative by default: interfaces that do not inspect the output of
+    // their test cases can opt out so that the output stays in memory.
+    return true;
+}
+
+
 /// Internal implementation of a lazy_test_program.
 struct engine::scheduler::lazy_test_program::impl : utils::noncopyable {
     /// Whether the test cases list has been yet loaded or not.
@@ -600,6 +686,20 @@ scheduler::lazy_test_program::test_cases(void) const
 }
 
 
+/// Starts loading the list of test cases in the background.
+///
+/// This is a hint to the scheduler: a later call to test_cases() will pick up
+/// the results of this operation if it has already completed, or wait for it
+/// otherwise.  Calling this more than once, or after the test cases have
+/// already been loaded, has no effect.
+void
+scheduler::lazy_test_program::prefetch_test_cases(void) const
+{
+    if (!_pimpl->_loaded)
+        _pimpl->_scheduler_handle.prefetch_tests(this, _pimpl->_user_config);
+}
+
+
 /// Internal implementation for the result_handle class.
 struct engine::scheduler::result_handle::bimpl : utils::noncopyable {
     /// Generic executor exit handle for this result handle.
@@ -706,24 +806,54 @@ scheduler::result_handle::work_directory(void) const
 
 /// Returns the path to the test's stdout file.
 ///
+/// If the output of the test was captured in memory, this writes it to disk
+/// first.  Callers that can consume the output from memory should check
+/// stdout_contents() before resorting to this.
+///
 /// \return The path to a file that exists until cleanup() is called.
 const fs::path&
 scheduler::result_handle::stdout_file(void) const
 {
+    _pbimpl->generic.write_output();
     return _pbimpl->generic.stdout_file();
 }
 
 
 /// Returns the path to the test's stderr file.
 ///
+/// If the output of the test was captured in memory, this writes it to disk
+/// first.  Callers that can consume the output from memory should check
+/// stderr_contents() before resorting to this.
+///
 /// \return The path to a file that exists until cleanup() is called.
 const fs::path&
 scheduler::result_handle::stderr_file(void) const
 {
+    _pbimpl->generic.write_output();
     return _pbimpl->generic.stderr_file();
 }
 
 
+/// Returns the test's stdout if it was captured in memory.
+///
+/// \return The output of the test, or none if it lives in stdout_file().
+const optional< std::string >&
+scheduler::result_handle::stdout_contents(void) const
+{
+    return _pbimpl->generic.stdout_contents();
+}
+
+
+/// Returns the test's stderr if it was captured in memory.
+///
+/// \return The output of the test, or none if it lives in stderr_file().
+const optional< std::string >&
+scheduler::result_handle::stderr_contents(void) const
+{
+    return _pbimpl->generic.stderr_contents();
+}
+
+
 /// Internal implementation for the test_result_handle class.
 struct engine::scheduler::test_result_handle::impl : utils::noncopyable {
     /// Test program data for this test case.
@@ -806,12 +936,22 @@ struct engine::scheduler::scheduler_handle::impl : utils::noncopyable {
     /// Mapping of exec handles to the data required at run time.
     exec_data_map all_exec_data;
 
+    /// Listing operations started by prefetch_tests() still in execution.
+    list_exec_data_map pending_lists;
+
+    /// Listing operations that completed before list_tests() asked for them.
+    test_cases_lists_map finished_lists;
+
+    /// Persistent cache of test program listings, if enabled.
+    optional< store::list_cache > list_cache;
+
     /// Collection of test_exec_data objects.
     typedef std::vector< const test_exec_data* > test_exec_data_vector;
 
     /// Constructor.
     impl(void) : generic(executor::setup())
     {
+        generic.enable_output_capture(max_captured_output_size);
     }
 
     /// Destructor.
@@ -885,6 +1025,136 @@ struct engine::scheduler::scheduler_handle::impl : utils::noncopyable {
         generic.wait(cleanup_handle);
     }
 
+    /// Forks and executes a test program listing asynchronously.
+    ///
+    /// \param interface Interface of the test program to list.
+    /// \param test_program The test program to list.
+    /// \param user_config User-provided configuration variables.
+    ///
+    /// \return A handle for the background operation.
+    executor::exec_handle
+    spawn_list(const std::shared_ptr< scheduler::interface > interface,
+               const model::test_program* test_program,
+               const config::tree& user_config)
+    {
+        LI(F("Spawning %s (list)") % test_program->absolute_path());
+        return generic.spawn(
+            list_test_cases(interface, test_program, user_config),
+            list_timeout, none);
+    }
+
+    /// Looks up the test cases list of a test program in the list cache.
+    ///
+    /// Cached entries that cannot be parsed are discarded so that they get
+    /// repopulated by the caller.
+    ///
+    /// \param test_program The test program to look up.
+    /// \param interface Interface of the test program.
+    /// \param vars Configuration variables passed to the test program.
+    ///
+    /// \return The list of test cases, or none if the list has to be obtained
+    /// by executing the test program.
+    optional< model::test_cases_map >
+    lookup_list(const model::test_program* test_program,
+                const std::shared_ptr< scheduler::interface > interface,
+                const config::properties_map& vars)
+    {
+        if (!list_cache)
+            return none;
+
+        const optional< store::cached_list > entry = list_cache.get().lookup(
+            test_program->absolute_path(), test_program->interface_name(),
+            vars);
+        if (!entry)
+            return none;
+
+        try {
+            const model::test_cases_map test_cases = interface->parse_list(
+                utils::make_optional(process::status::fake_exited(
+                    entry.get().exit_status())),
+                entry.get().stdout_file(),
+                entry.get().stderr_file());
+            if (!test_cases.empty())
+                return utils::make_optional(test_cases);
+            LW(F("Cached test cases list of %s is empty") %
+               test_program->absolute_path());
+        } catch (const std::runtime_error& e) {
+            LW(F("Cannot parse cached test cases list of %s: %s") %
+               test_program->absolute_path() % e.what());
+        }
+        list_cache.get().invalidate(test_program->absolute_path(),
+                                    test_program->interface_name(), vars);
+        return none;
+    }
+
+    /// Computes the test cases list out of a terminated listing subprocess.
+    ///
+    /// Successful listings are recorded in the list cache, if enabled.
+    ///
+    /// This operation should never throw.  Any errors during the processing of
+    /// the test case list are subsumed into a single test case in the return
+    /// value that represents the failed retrieval.
+    ///
+    /// \param test_program The test program that was listed.
+    /// \param interface The interface of the test program that was listed.
+    /// \param vars Configuration variables passed to the test program.
+    /// \param exit_handle The termination handle of the listing subprocess.
+    ///
+    /// \return The list of test cases.
+    model::test_cases_map
+    finish_list(const model::test_program* test_program,
+                const std::shared_ptr< scheduler::interface > interface,
+                const config::properties_map& vars,
+                executor::exit_handle exit_handle)
+    {
+        try {
+            exit_handle.write_output();
+            const model::test_cases_map test_cases = interface->parse_list(
+                exit_handle.status(),
+                exit_handle.stdout_file(),
+                exit_handle.stderr_file());
+
+            if (list_cache && !test_cases.empty() && exit_handle.status() &&
+                exit_handle.status().get().exited()) {
+                list_cache.get().put(
+                    test_program->absolute_path(),
+                    test_program->interface_name(), vars,
+                    exit_handle.status().get().exitstatus(),
+                    exit_handle.stdout_file(), exit_handle.stderr_file());
+            }
+
+            exit_handle.cleanup();
+
+            if (test_cases.empty())
+                throw std::runtime_error("Empty test cases list");
+
+            return test_cases;
+        } catch (const std::runtime_error& e) {
+            return broken_test_cases_list(e.what());
+        }
+    }
+
+    /// Processes the termination of a listing started by prefetch_tests().
+    ///
+    /// \param exit_handle The termination handle of the listing subprocess.
+    ///
+    /// \return The test program whose test cases list is now available in
+    /// finished_lists.
+    const model::test_program*
+    finish_pending_list(const executor::exit_handle& exit_handle)
+    {
+        const list_exec_data_map::iterator iter = pending_lists.find(
+            exit_handle.original_pid());
+        PRE(iter != pending_lists.end());
+        const list_exec_data data = (*iter).second;
+        pending_lists.erase(iter);
+
+        LD(F("Got %s from pending_lists") % exit_handle.original_pid());
+        finished_lists[data.test_program] = finish_list(
+            data.test_program, data.interface, data.vars, exit_handle);
+        return data.test_program;
+    }
+
     /// Forks and executes a test case cleanup routine asynchronously.
     ///
     /// \param test_program The container test program.
@@ -951,6 +1221,20 @@ scheduler::scheduler_handle::root_work_directory(void) const
 }
 
 
+/// Enables the persistent cache of test case lists.
+///
+/// Once enabled, list_tests() and prefetch_tests() reuse the results of
+/// previous listings of unmodified test programs instead of executing them.
+///
+/// \param directory Path to the directory holding the cache.  It is created on
+///     demand.
+void
+scheduler::scheduler_handle::enable_list_cache(const fs::path& directory)
+{
+    _pimpl->list_cache = store::list_cache(directory);
+}
+
+
 /// Cleans up the scheduler state.
 ///
 /// This function should be called explicitly as it provides the means to
@@ -1021,7 +1305,9 @@ scheduler::setup(void)
 
 /// Retrieves the list of test cases from a test program.
 ///
-/// This operation is currently synchronous.
+/// If the listing of the test program was previously started with
+/// prefetch_tests(), this picks up its results, waiting for its completion
+/// if necessary.  Otherwise, this operation is synchronous.
 ///
 /// This operation should never throw.  Any errors during the processing of the
 /// test case list are subsumed into a single test case in the return value that
@@ -1039,38 +1325,101 @@ scheduler::scheduler_handle::list_tests(
 {
     _pimpl->generic.check_interrupt();
 
+    for (list_exec_data_map::const_iterator iter =
+             _pimpl->pending_lists.begin();
+         iter != _pimpl->pending_lists.end(); ++iter) {
+        if ((*iter).second.test_program == test_program) {
+            _pimpl->finish_pending_list(
+                _pimpl->generic.wait((*iter).second.exec_handle));
+            break;
+        }
+    }
+
+    {
+        const test_cases_lists_map::iterator iter =
+            _pimpl->finished_lists.find(test_program);
+        if (iter != _pimpl->finished_lists.end()) {
+            const model::test_cases_map test_cases = (*iter).second;
+            _pimpl->finished_lists.erase(iter);
+            return test_cases;
+        }
+    }
+
     const std::shared_ptr< scheduler::interface > interface = find_interface(
         test_program->interface_name());
+    const config::properties_map vars = scheduler::generate_config(
+        user_config, test_program->test_suite_name());
+
+    const optional< model::test_cases_map > cached_test_cases =
+        _pimpl->lookup_list(test_program, interface, vars);
+    if (cached_test_cases)
+        return cached_test_cases.get();
 
     try {
-        const executor::exec_handle exec_handle = _pimpl->generic.spawn(
-            list_test_cases(interface, test_program, user_config),
-            list_timeout, none);
-        executor::exit_handle exit_handle = _pimpl->generic.wait(exec_handle);
+        const executor::exec_handle exec_handle = _pimpl->spawn_list(
+            interface, test_program, user_config);
+        return _pimpl->finish_list(test_program, interface, vars,
+                                   _pimpl->generic.wait(exec_handle));
+    } catch (const std::runtime_error& e) {
+        return broken_test_cases_list(e.what());
+    }
+}
+
 
-        const model::test_cases_map test_cases = interface->parse_list(
-            exit_handle.status(),
-            exit_handle.stdout_file(),
-            exit_handle.stderr_file());
+/// Starts retrieving the list of test cases from a test program.
+///
+/// The listing runs in the background, concurrently with any other listings or
+/// tests, and its results are later returned by list_tests().  Completions of
+/// these listings are processed transparently by wait_any(), so the caller does
+/// not need to care about them.
+///
+/// This operation should never throw.  Any errors during the spawning of the
+/// listing are reported by list_tests() in the same way as if the listing had
+/// been synchronous.
+///
+/// \param test_program The test program from which to obtain the list of test
+/// cases.  The caller must keep this object alive until the list is retrieved
+/// with list_tests().
+/// \param user_config User-provided configuration variables.
+void
+scheduler::scheduler_handle::prefetch_tests(
+    const model::test_program* test_program,
+    const config::tree& user_config)
+{
+    _pimpl->generic.check_interrupt();
 
-        exit_handle.cleanup();
+    if (_pimpl->finished_lists.find(test_program) !=
+        _pimpl->finished_lists.end())
+        return;
+    for (list_exec_data_map::const_iterator iter =
+             _pimpl->pending_lists.begin();
+         iter != _pimpl->pending_lists.end(); ++iter) {
+        if ((*iter).second.test_program == test_program)
+            return;
+    }
 
-        if (test_cases.empty())
-            throw std::runtime_error("Empty test cases list");
+    const std::shared_ptr< scheduler::interface > interface = find_interface(
+        test_program->interface_name());
+    const config::properties_map vars = scheduler::generate_config(
+        user_config, test_program->test_suite_name());
+
+    const optional< model::test_cases_map > cached_test_cases =
+        _pimpl->lookup_list(test_program, interface, vars);
+    if (cached_test_cases) {
+        _pimpl->finished_lists[test_program] = cached_test_cases.get();
+        return;
+    }
 
-        return test_cases;
+    try {
+        const executor::exec_handle exec_handle = _pimpl->spawn_list(
+            interface, test_program, user_config);
+        LD(F("Inserting %s into pending_lists") % exec_handle.pid());
+        _pimpl->pending_lists.insert(list_exec_data_map::value_type(
+            exec_handle.pid(),
+            list_exec_data(test_program, interface, vars, exec_handle)));
     } catch (const std::runtime_error& e) {
-        // TODO(jmmv): This is a very ugly workaround for the fact that we
-        // cannot report failures at the test-program level.
-        LW(F("Failed to load test cases list: %s") % e.what());
-        model::test_cases_map fake_test_cases;
-        fake_test_cases.insert(model::test_cases_map::value_type(
-            "__test_cases_list__",
-            model::test_case(
-                "__test_cases_list__",
-                "Represents the correct processing of the test cases list",
-                model::test_result(model::test_result_broken, e.what()))));
-        return fake_test_cases;
+        _pimpl->finished_lists[test_program] = broken_test_cases_list(
+            e.what());
     }
 }
 
@@ -1132,6 +1481,9 @@ scheduler::scheduler_handle::spawn_test(
 /// Note that if the terminated test case has a cleanup routine, this function
 /// is the one in charge of spawning the cleanup routine asynchronously.
 ///
+/// \pre There must be at least one test case in execution: listings started
+/// by prefetch_tests() are processed internally and do not count.
+///
 /// \return The result of the execution of a subprocess.  This is a dynamically
 /// allocated object because the scheduler can spawn subprocesses of various
 /// types and, at wait time, we don't know upfront what we are going to get.
@@ -1142,6 +1494,14 @@ scheduler::scheduler_handle::wait_any(void)
 
     executor::exit_handle handle = _pimpl->generic.wait_any();
 
+    if (_pimpl->pending_lists.find(handle.original_pid()) !=
+        _pimpl->pending_lists.end()) {
+        // Listings started by prefetch_tests() are not visible to the caller:
+        // stash their results for list_tests() and keep waiting for a test.
+        _pimpl->finish_pending_list(handle);
+        return wait_any();
+    }
+
     const exec_data_map::iterator iter = _pimpl->all_exec_data.find(
         handle.original_pid());
     exec_data_ptr data = (*iter).second;
@@ -1188,6 +1548,8 @@ scheduler::scheduler_handle::wait_any(void)
             }
         }
         if (!result) {
+            if (test_data->interface->needs_output_files())
+                handle.write_output();
             result = test_data->interface->compute_result(
                 handle.status(),
                 handle.control_directory(),
@@ -1197,6 +1559,7 @@ scheduler::scheduler_handle::wait_any(void)
         INV(result);
 
         if (!result.get().good()) {
+            handle.write_output();
             append_files_listing(handle.work_directory(),
                                  handle.stderr_file());
         }
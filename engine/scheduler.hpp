@@ -162,6 +162,16 @@ public:
         const utils::fs::path& control_directory,
         const utils::fs::path& stdout_path,
         const utils::fs::path& stderr_path) const = 0;
+
+    /// Checks whether compute_result() reads the output of the test case.
+    ///
+    /// The scheduler keeps the output of the test cases in memory when it can,
+    /// so it needs to know whether to write the output files before calling
+    /// compute_result().
+    ///
+    /// \return True if compute_result() needs the stdout and stderr files to
+    /// exist; false if it ignores them.
+    virtual bool needs_output_files(void) const;
 };
 
 
@@ -180,6 +190,7 @@ public:
                       scheduler_handle&);
 
     const model::test_cases_map& test_cases(void) const;
+    void prefetch_test_cases(void) const;
 };
 
 
@@ -207,6 +218,8 @@ public:
     utils::fs::path work_directory(void) const;
     const utils::fs::path& stdout_file(void) const;
     const utils::fs::path& stderr_file(void) const;
+    const utils::optional< std::string >& stdout_contents(void) const;
+    const utils::optional< std::string >& stderr_contents(void) const;
 };
 
 
@@ -242,10 +255,13 @@ public:
 
     const utils::fs::path& root_work_directory(void) const;
 
+    void enable_list_cache(const utils::fs::path&);
     void cleanup(void);
 
     model::test_cases_map list_tests(const model::test_program*,
                                      const utils::config::tree&);
+    void prefetch_tests(const model::test_program*,
+                        const utils::config::tree&);
     exec_handle spawn_test(const model::test_program_ptr,
                            const std::string&,
                            const utils::config::tree&);
@@ -55,6 +55,7 @@ extern "C" {
 #include "utils/env.hpp"
 #include "utils/format/containers.ipp"
 #include "utils/format/macros.hpp"
+#include "utils/fs/directory.hpp"
 #include "utils/fs/operations.hpp"
 #include "utils/fs/path.hpp"
 #include "utils/optional.ipp"
@@ -559,6 +560,161 @@ ATF_TEST_CASE_BODY(integration__list_empty)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(integration__list_prefetch);
+ATF_TEST_CASE_BODY(integration__list_prefetch)
+{
+    config::tree user_config = engine::empty_config();
+    user_config.set_string("test_suites.the-suite.first", "test");
+
+    const model::test_program program1 = model::test_program_builder(
+        "mock", fs::path("vars"), fs::path("."), "the-suite").build();
+    const model::test_program program2 = model::test_program_builder(
+        "mock", fs::path("empty"), fs::path("."), "the-suite").build();
+    const model::test_program program3 = model::test_program_builder(
+        "mock", fs::path("misbehave"), fs::path("."), "the-suite").build();
+
+    scheduler::scheduler_handle handle = scheduler::setup();
+    handle.prefetch_tests(&program1, user_config);
+    handle.prefetch_tests(&program2, user_config);
+    handle.prefetch_tests(&program3, user_config);
+    handle.prefetch_tests(&program1, user_config);  // Must be idempotent.
+
+    // Retrieve the lists in a different order than they were started.
+    {
+        const model::test_cases_map test_cases = handle.list_tests(
+            &program3, user_config);
+        ATF_REQUIRE_EQ(1, test_cases.size());
+        ATF_REQUIRE_EQ(model::test_result(model::test_result_broken,
+                                          "misbehaved in parse_list"),
+                       test_cases.begin()->second.fake_result().get());
+    }
+    {
+        const model::test_cases_map test_cases = handle.list_tests(
+            &program1, user_config);
+        const model::test_cases_map exp_test_cases =
+            model::test_cases_map_builder().add("first_test").build();
+        ATF_REQUIRE_EQ(exp_test_cases, test_cases);
+    }
+    {
+        const model::test_cases_map test_cases = handle.list_tests(
+            &program2, user_config);
+        ATF_REQUIRE_EQ(1, test_cases.size());
+        ATF_REQUIRE_EQ(model::test_result(model::test_result_broken,
+                                          "Empty test cases list"),
+                       test_cases.begin()->second.fake_result().get());
+    }
+
+    handle.cleanup();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(integration__list_prefetch_while_running);
+ATF_TEST_CASE_BODY(integration__list_prefetch_while_running)
+{
+    config::tree user_config = engine::empty_config();
+    user_config.set_string("test_suites.the-suite.first", "test");
+
+    const model::test_program list_program = model::test_program_builder(
+        "mock", fs::path("vars"), fs::path("."), "the-suite").build();
+    const model::test_program_ptr run_program = model::test_program_builder(
+        "mock", fs::path("the-program"), fs::current_path(), "the-suite")
+        .add_test_case("exit 41").build_ptr();
+
+    scheduler::scheduler_handle handle = scheduler::setup();
+
+    handle.prefetch_tests(&list_program, user_config);
+    const scheduler::exec_handle exec_handle = handle.spawn_test(
+        run_program, "exit 41", user_config);
+
+    // The listing may complete before the test does, but wait_any() must only
+    // ever return the results of tests.
+    scheduler::result_handle_ptr result_handle = handle.wait_any();
+    ATF_REQUIRE_EQ(exec_handle, result_handle->original_pid());
+    result_handle->cleanup();
+    result_handle.reset();
+
+    const model::test_cases_map test_cases = handle.list_tests(
+        &list_program, user_config);
+    const model::test_cases_map exp_test_cases =
+        model::test_cases_map_builder().add("first_test").build();
+    ATF_REQUIRE_EQ(exp_test_cases, test_cases);
+
+    handle.cleanup();
+}
+
+
+/// Overwrites a file in all the entries of a list cache.
+///
+/// \param cache_dir Path to the directory holding the list cache.
+/// \param name Basename of the file to overwrite within each entry.
+/// \param contents New contents of the file.
+static void
+tamper_list_cache(const fs::path& cache_dir, const char* name,
+                  const std::string& contents)
+{
+    const fs::directory dir(cache_dir);
+    for (fs::directory::const_iterator iter = dir.begin(); iter != dir.end();
+         ++iter) {
+        if (iter->name == "." || iter->name == "..")
+            continue;
+        atf::utils::create_file((cache_dir / iter->name / name).str(),
+                                contents);
+    }
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(integration__list_cache);
+ATF_TEST_CASE_BODY(integration__list_cache)
+{
+    config::tree user_config = engine::empty_config();
+    user_config.set_string("test_suites.the-suite.first", "test");
+
+    atf::utils::create_file("vars", "");
+    const model::test_program program = model::test_program_builder(
+        "mock", fs::path("vars"), fs::current_path(), "the-suite").build();
+    const fs::path cache_dir("cache");
+
+    const model::test_cases_map exp_listed_test_cases =
+        model::test_cases_map_builder().add("first_test").build();
+    const model::test_cases_map exp_cached_test_cases =
+        model::test_cases_map_builder().add("cached_test").build();
+
+    {
+        scheduler::scheduler_handle handle = scheduler::setup();
+        handle.enable_list_cache(cache_dir);
+        ATF_REQUIRE_EQ(exp_listed_test_cases,
+                       handle.list_tests(&program, user_config));
+        handle.cleanup();
+    }
+
+    // Alter the cached output to prove that the test program is not executed
+    // again while its binary remains unmodified.
+    tamper_list_cache(cache_dir, "stdout.txt", "cached_test\n");
+
+    {
+        scheduler::scheduler_handle handle = scheduler::setup();
+        handle.enable_list_cache(cache_dir);
+        ATF_REQUIRE_EQ(exp_cached_test_cases,
+                       handle.list_tests(&program, user_config));
+        handle.prefetch_tests(&program, user_config);
+        ATF_REQUIRE_EQ(exp_cached_test_cases,
+                       handle.list_tests(&program, user_config));
+        handle.cleanup();
+    }
+
+    // Make the cached entry unparseable, which must cause a new execution.
+    tamper_list_cache(cache_dir, "stderr.txt", "misbehave");
+
+    {
+        scheduler::scheduler_handle handle = scheduler::setup();
+        handle.enable_list_cache(cache_dir);
+        ATF_REQUIRE_EQ(exp_listed_test_cases,
+                       handle.list_tests(&program, user_config));
+        handle.cleanup();
+    }
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(integration__run_one);
 ATF_TEST_CASE_BODY(integration__run_one)
 {
@@ -1209,6 +1365,9 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, integration__list_timeout);
     ATF_ADD_TEST_CASE(tcs, integration__list_fail);
     ATF_ADD_TEST_CASE(tcs, integration__list_empty);
+    ATF_ADD_TEST_CASE(tcs, integration__list_prefetch);
+    ATF_ADD_TEST_CASE(tcs, integration__list_prefetch_while_running);
+    ATF_ADD_TEST_CASE(tcs, integration__list_cache);
 
     ATF_ADD_TEST_CASE(tcs, integration__run_one);
     ATF_ADD_TEST_CASE(tcs, integration__run_many);
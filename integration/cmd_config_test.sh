@@ -325,7 +325,7 @@ EOF
 utils_test_case variable_flag__invalid_value
 variable_flag__invalid_value_body() {
     cat >experr <<EOF
-kyua: E: Invalid value for property 'parallelism': Must be a positive integer.
+kyua: E: Invalid value for property 'parallelism': Must be a positive integer or 'auto'.
 EOF
     atf_check -s exit:2 -o empty -e file:experr kyua \
         -v "parallelism=0" config
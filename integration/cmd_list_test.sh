@@ -281,6 +281,31 @@ EOF
 }
 
 
+utils_test_case cache_test_lists
+cache_test_lists_body() {
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass"}
+EOF
+    utils_cp_helper simple_all_pass .
+
+    atf_check -s exit:0 -o ignore -e empty kyua list
+    [ ! -d "${HOME}/.kyua/store/lists" ] || \
+        atf_fail "Test case lists cached by default"
+
+    atf_check -s exit:0 -o ignore -e empty \
+        kyua -v cache_test_lists=false list
+    [ ! -d "${HOME}/.kyua/store/lists" ] || \
+        atf_fail "Test case lists cached despite cache_test_lists=false"
+
+    atf_check -s exit:0 -o ignore -e empty \
+        kyua -v cache_test_lists=true list
+    [ -d "${HOME}/.kyua/store/lists" ] || \
+        atf_fail "Test case lists not cached with cache_test_lists=true"
+}
+
+
 utils_test_case config_behavior
 config_behavior_body() {
     cat >"my-config" <<EOF
@@ -310,6 +335,30 @@ EOF
 }
 
 
+utils_test_case parallelism
+parallelism_body() {
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass"}
+atf_test_program{name="simple_some_fail"}
+EOF
+    utils_cp_helper simple_all_pass .
+    utils_cp_helper simple_some_fail .
+
+    cat >expout <<EOF
+simple_all_pass:pass
+simple_all_pass:skip
+simple_some_fail:fail
+simple_some_fail:pass
+EOF
+    for parallelism in 1 3 auto; do
+        atf_check -s exit:0 -o file:expout -e empty \
+            kyua -v parallelism="${parallelism}" list
+    done
+}
+
+
 utils_test_case build_root_flag
 build_root_flag_body() {
     mkdir subdir
@@ -578,7 +627,9 @@ atf_init_test_cases() {
 
     atf_add_test_case only_load_used_test_programs
 
+    atf_add_test_case cache_test_lists
     atf_add_test_case config_behavior
+    atf_add_test_case parallelism
 
     atf_add_test_case build_root_flag
 
@@ -218,12 +218,19 @@ results_filter__ok_body() {
         html/simple_all_pass_pass.html \
         html/simple_some_fail_pass.html \
         html/metadata_no_properties.html \
-        html/metadata_with_cleanup.html
+        html/metadata_with_cleanup.html \
+        html/lists/passed_1.html
     do
         test -f "${f}" || atf_fail "Missing ${f}"
     done
 
     atf_check -o match:"2 TESTS FAILING" cat html/index.html
+    atf_check -o match:'href="lists/passed_1.html"' cat html/index.html
+    check_not_in_file html/index.html "simple_all_pass_pass.html"
+    check_in_file html/lists/passed_1.html \
+        'href="../simple_all_pass_pass.html"' \
+        'href="../simple_some_fail_pass.html"'
+    check_not_in_file html/lists/passed_1.html "Next page" "Previous page"
 
     check_in_file html/simple_all_pass_pass.html \
         "This is the stdout of pass" "This is the stderr of pass"
@@ -250,6 +257,30 @@ results_filter__invalid_body() {
 }
 
 
+utils_test_case jobs__ok
+jobs__ok_body() {
+    run_tests "mock1" unused_dbfile_name
+
+    atf_check -s exit:0 -o save:serial.out -e empty kyua report-html \
+        --jobs=1 --output=serial --results-filter=
+    atf_check -s exit:0 -o save:parallel.out -e empty kyua report-html \
+        --jobs=3 --output=parallel --results-filter=
+    sed -e 's,serial,parallel,' serial.out >expout
+    atf_check -o file:expout cat parallel.out
+    atf_check -o empty diff -r serial parallel
+}
+
+
+utils_test_case jobs__invalid
+jobs__invalid_body() {
+    cat >experr <<EOF
+Usage error for command report-html: Invalid number of jobs '-1'; must be a non-negative number.
+Type 'kyua help report-html' for usage information.
+EOF
+    atf_check -s exit:3 -o empty -e file:experr kyua report-html --jobs=-1
+}
+
+
 atf_init_test_cases() {
     atf_add_test_case default_behavior__ok
     atf_add_test_case default_behavior__no_store
@@ -264,4 +295,7 @@ atf_init_test_cases() {
 
     atf_add_test_case results_filter__ok
     atf_add_test_case results_filter__invalid
+
+    atf_add_test_case jobs__ok
+    atf_add_test_case jobs__invalid
 }
@@ -97,8 +97,10 @@ CONTENTS STRIPPED BY TEST
 allowed_architectures is empty
 allowed_platforms is empty
 description is empty
+exclusive_group is empty
 has_cleanup = false
 is_exclusive = false
+max_output_size = 0
 required_configs is empty
 required_disk_space = 0
 required_files is empty
@@ -135,8 +137,10 @@ Test case metadata
 allowed_architectures is empty
 allowed_platforms is empty
 description is empty
+exclusive_group is empty
 has_cleanup = false
 is_exclusive = false
+max_output_size = 0
 required_configs is empty
 required_disk_space = 0
 required_files is empty
@@ -211,8 +215,10 @@ CONTENTS STRIPPED BY TEST
 allowed_architectures is empty
 allowed_platforms is empty
 description is empty
+exclusive_group is empty
 has_cleanup = false
 is_exclusive = false
+max_output_size = 0
 required_configs is empty
 required_disk_space = 0
 required_files is empty
@@ -249,8 +255,10 @@ Test case metadata
 allowed_architectures is empty
 allowed_platforms is empty
 description is empty
+exclusive_group is empty
 has_cleanup = false
 is_exclusive = false
+max_output_size = 0
 required_configs is empty
 required_disk_space = 0
 required_files is empty
@@ -251,8 +251,10 @@ Metadata:
     allowed_architectures is empty
     allowed_platforms is empty
     description is empty
+    exclusive_group is empty
     has_cleanup = false
     is_exclusive = false
+    max_output_size = 0
     required_configs is empty
     required_disk_space = 0
     required_files is empty
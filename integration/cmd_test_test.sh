@@ -680,6 +680,43 @@ EOF
 }
 
 
+utils_test_case longest_first
+longest_first_body() {
+    utils_install_stable_test_wrapper
+
+    cat >Kyuafile <<EOF
+syntax(2)
+test_suite("integration")
+atf_test_program{name="simple_all_pass"}
+atf_test_program{name="simple_some_fail"}
+EOF
+    utils_cp_helper simple_all_pass .
+    utils_cp_helper simple_some_fail .
+
+    atf_check -s exit:0 -o ignore -e match:"Cannot load the durations" \
+        kyua test --longest-first simple_all_pass
+    atf_check -s exit:0 -o ignore -e empty \
+        kyua db-exec "UPDATE test_results SET end_time = start_time +" \
+        "(SELECT CASE name WHEN 'skip' THEN 20000000 ELSE 10000000 END" \
+        " FROM test_cases" \
+        " WHERE test_cases.test_case_id = test_results.test_case_id)"
+
+    cat >expout <<EOF
+simple_all_pass:skip  ->  skipped: The reason for skipping is this  [S.UUUs]
+simple_some_fail:fail  ->  failed: This fails on purpose  [S.UUUs]
+simple_some_fail:pass  ->  passed  [S.UUUs]
+simple_all_pass:pass  ->  passed  [S.UUUs]
+
+Results file id is $(utils_results_id)
+Results saved to $(utils_results_file)
+
+3/4 passed (1 failed)
+EOF
+    atf_check -s exit:1 -o file:expout -e empty \
+        kyua test --longest-first --default-duration=15
+}
+
+
 utils_test_case build_root_flag
 build_root_flag_body() {
     utils_install_stable_test_wrapper
@@ -854,6 +891,80 @@ EOF
 }
 
 
+utils_test_case exclusive_groups
+exclusive_groups_body() {
+    cat >Kyuafile <<EOF
+syntax(2)
+EOF
+    for i in $(seq 50); do
+        echo 'plain_test_program{name="race", test_suite="first",' \
+            'exclusive_group="first"}' >>Kyuafile
+        echo 'plain_test_program{name="race", test_suite="second",' \
+            'exclusive_group="second"}' >>Kyuafile
+    done
+    utils_cp_helper race .
+
+    atf_check \
+        -s exit:0 \
+        -o match:"100/100 passed" \
+        kyua \
+        -v parallelism=20 \
+        -v test_suites.first.shared_file="$(pwd)/shared_file_1" \
+        -v test_suites.second.shared_file="$(pwd)/shared_file_2" \
+        test
+}
+
+
+utils_test_case memory_budget
+memory_budget_body() {
+    cat >Kyuafile <<EOF
+syntax(2)
+EOF
+    for i in $(seq 100); do
+        echo 'plain_test_program{name="race", test_suite="integration",' \
+            'required_memory="1k"}' >>Kyuafile
+        # Tests without requirements must not wait behind those that do.
+        if [ $((i % 5)) -eq 0 ]; then
+            echo 'plain_test_program{name="pass", test_suite="integration"}' \
+                >>Kyuafile
+        fi
+    done
+    utils_cp_helper race .
+    printf '#! /bin/sh\nexit 0\n' >pass
+    chmod +x pass
+
+    atf_check \
+        -s exit:0 \
+        -o match:"120/120 passed" \
+        kyua \
+        -v memory_budget=1k \
+        -v parallelism=20 \
+        -v test_suites.integration.shared_file="$(pwd)/shared_file" \
+        test
+}
+
+
+utils_test_case parallelism_auto
+parallelism_auto_body() {
+    cat >Kyuafile <<EOF
+syntax(2)
+EOF
+    for i in $(seq 100); do
+        echo 'plain_test_program{name="race", test_suite="integration",' \
+            'exclusive_group="race"}' >>Kyuafile
+    done
+    utils_cp_helper race .
+
+    atf_check \
+        -s exit:0 \
+        -o match:"100/100 passed" \
+        kyua \
+        -v parallelism=auto \
+        -v test_suites.integration.shared_file="$(pwd)/shared_file" \
+        test
+}
+
+
 utils_test_case no_test_program_match
 no_test_program_match_body() {
     utils_install_stable_test_wrapper
@@ -1048,6 +1159,8 @@ atf_init_test_cases() {
     atf_add_test_case results_file__fail
     atf_add_test_case results_file__reuse
 
+    atf_add_test_case longest_first
+
     atf_add_test_case build_root_flag
 
     atf_add_test_case kyuafile_flag__no_args
@@ -1056,6 +1169,9 @@ atf_init_test_cases() {
     atf_add_test_case interrupt
 
     atf_add_test_case exclusive_tests
+    atf_add_test_case exclusive_groups
+    atf_add_test_case memory_budget
+    atf_add_test_case parallelism_auto
 
     atf_add_test_case no_test_program_match
     atf_add_test_case no_test_case_match
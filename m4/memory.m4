@@ -52,6 +52,10 @@ AC_DEFUN([KYUA_MEMORY], [
         fi
     fi
 
+    if test "${memory_query}" = unknown; then
+        _KYUA_SYSCONF_PHYS_PAGES([memory_query=sysconf], [])
+    fi
+
     if test "${memory_query}" = unknown; then
         AC_MSG_WARN([Don't know how to query the amount of physical memory])
         AC_MSG_WARN([The test case's require.memory property will not work])
@@ -76,6 +80,23 @@ AC_DEFUN([_KYUA_SYSCTLBYNAME], [
 ])
 
 
+dnl Detects if sysconf(3) can report the number of physical memory pages.
+dnl
+dnl \param action_if_found Code to run if the query is supported.
+dnl \param action_if_not_found Code to run if the query is not supported.
+AC_DEFUN([_KYUA_SYSCONF_PHYS_PAGES], [
+    AC_CHECK_DECLS([_SC_PHYS_PAGES, _SC_PAGESIZE], [], [], [
+#include <unistd.h>
+])
+    if test "${ac_cv_have_decl__SC_PHYS_PAGES}" = yes -a \
+            "${ac_cv_have_decl__SC_PAGESIZE}" = yes; then
+        m4_default([$1], [:])
+    else
+        m4_default([$2], [:])
+    fi
+])
+
+
 dnl Looks for a specific sysctl MIB.
 dnl
 dnl \pre sysctlbyname(3) must be present in the system.
@@ -66,36 +66,6 @@ namespace {
 static optional< config::tree > defaults;
 
 
-/// A leaf node that holds a bytes quantity.
-class bytes_node : public config::native_leaf_node< units::bytes > {
-public:
-    /// Copies the node.
-    ///
-    /// \return A dynamically-allocated node.
-    virtual base_node*
-    deep_copy(void) const
-    {
-        std::auto_ptr< bytes_node > new_node(new bytes_node());
-        new_node->_value = _value;
-        return new_node.release();
-    }
-
-    /// Pushes the node's value onto the Lua stack.
-    void
-    push_lua(lutok::state& /* state */) const
-    {
-        UNREACHABLE;
-    }
-
-    /// Sets the value of the node from an entry in the Lua stack.
-    void
-    set_lua(lutok::state& /* state */, const int /* index */)
-    {
-        UNREACHABLE;
-    }
-};
-
-
 /// A leaf node that holds a time delta.
 class delta_node : public config::typed_leaf_node< datetime::delta > {
 public:
@@ -247,12 +217,14 @@ init_tree(config::tree& tree)
     tree.define< config::strings_set_node >("allowed_platforms");
     tree.define_dynamic("custom");
     tree.define< config::string_node >("description");
+    tree.define< config::string_node >("exclusive_group");
     tree.define< config::bool_node >("has_cleanup");
     tree.define< config::bool_node >("is_exclusive");
+    tree.define< config::bytes_node >("max_output_size");
     tree.define< config::strings_set_node >("required_configs");
-    tree.define< bytes_node >("required_disk_space");
+    tree.define< config::bytes_node >("required_disk_space");
     tree.define< paths_set_node >("required_files");
-    tree.define< bytes_node >("required_memory");
+    tree.define< config::bytes_node >("required_memory");
     tree.define< paths_set_node >("required_programs");
     tree.define< user_node >("required_user");
     tree.define< delta_node >("timeout");
@@ -270,13 +242,15 @@ set_defaults(config::tree& tree)
     tree.set< config::strings_set_node >("allowed_platforms",
                                          model::strings_set());
     tree.set< config::string_node >("description", "");
+    tree.set< config::string_node >("exclusive_group", "");
     tree.set< config::bool_node >("has_cleanup", false);
     tree.set< config::bool_node >("is_exclusive", false);
+    tree.set< config::bytes_node >("max_output_size", units::bytes(0));
     tree.set< config::strings_set_node >("required_configs",
                                          model::strings_set());
-    tree.set< bytes_node >("required_disk_space", units::bytes(0));
+    tree.set< config::bytes_node >("required_disk_space", units::bytes(0));
     tree.set< paths_set_node >("required_files", model::paths_set());
-    tree.set< bytes_node >("required_memory", units::bytes(0));
+    tree.set< config::bytes_node >("required_memory", units::bytes(0));
     tree.set< paths_set_node >("required_programs", model::paths_set());
     tree.set< user_node >("required_user", "");
     // TODO(jmmv): We shouldn't be setting a default timeout like this.  See
@@ -464,6 +438,21 @@ model::metadata::description(void) const
 }
 
 
+/// Returns the name of the group of mutually exclusive tests of the test.
+///
+/// \return The name of the group, or the empty string if the test does not
+/// belong to any group.
+const std::string&
+model::metadata::exclusive_group(void) const
+{
+    if (_pimpl->props.is_set("exclusive_group")) {
+        return _pimpl->props.lookup< config::string_node >("exclusive_group");
+    } else {
+        return get_defaults().lookup< config::string_node >("exclusive_group");
+    }
+}
+
+
 /// Returns whether the test has a cleanup part or not.
 ///
 /// \return True if there is a cleanup part; false otherwise.
@@ -493,6 +482,20 @@ model::metadata::is_exclusive(void) const
 }
 
 
+/// Returns the maximum size of each output of the test to store.
+///
+/// \return Number of bytes, or 0 if this is not set by the test.
+const units::bytes&
+model::metadata::max_output_size(void) const
+{
+    if (_pimpl->props.is_set("max_output_size")) {
+        return _pimpl->props.lookup< config::bytes_node >("max_output_size");
+    } else {
+        return get_defaults().lookup< config::bytes_node >("max_output_size");
+    }
+}
+
+
 /// Returns the list of configuration variables needed by the test.
 ///
 /// \return Set of configuration variables.
@@ -516,9 +519,11 @@ const units::bytes&
 model::metadata::required_disk_space(void) const
 {
     if (_pimpl->props.is_set("required_disk_space")) {
-        return _pimpl->props.lookup< bytes_node >("required_disk_space");
+        return _pimpl->props.lookup< config::bytes_node >(
+            "required_disk_space");
     } else {
-        return get_defaults().lookup< bytes_node >("required_disk_space");
+        return get_defaults().lookup< config::bytes_node >(
+            "required_disk_space");
     }
 }
 
@@ -544,9 +549,9 @@ const units::bytes&
 model::metadata::required_memory(void) const
 {
     if (_pimpl->props.is_set("required_memory")) {
-        return _pimpl->props.lookup< bytes_node >("required_memory");
+        return _pimpl->props.lookup< config::bytes_node >("required_memory");
     } else {
-        return get_defaults().lookup< bytes_node >("required_memory");
+        return get_defaults().lookup< config::bytes_node >("required_memory");
     }
 }
 
@@ -890,6 +895,22 @@ model::metadata_builder::set_description(const std::string& description)
 }
 
 
+/// Sets the name of the group of mutually exclusive tests of the test.
+///
+/// \param group The name of the group, or the empty string to not put the test
+///     in any group.
+///
+/// \return A reference to this builder.
+///
+/// \throw model::error If the value is invalid.
+model::metadata_builder&
+model::metadata_builder::set_exclusive_group(const std::string& group)
+{
+    set< config::string_node >(_pimpl->props, "exclusive_group", group);
+    return *this;
+}
+
+
 /// Sets whether the test has a cleanup part or not.
 ///
 /// \param cleanup True if the test has a cleanup part; false otherwise.
@@ -920,6 +941,21 @@ model::metadata_builder::set_is_exclusive(const bool exclusive)
 }
 
 
+/// Sets the maximum size of each output of the test to store.
+///
+/// \param bytes Number of bytes, or 0 to not set a limit for the test.
+///
+/// \return A reference to this builder.
+///
+/// \throw model::error If the value is invalid.
+model::metadata_builder&
+model::metadata_builder::set_max_output_size(const units::bytes& bytes)
+{
+    set< config::bytes_node >(_pimpl->props, "max_output_size", bytes);
+    return *this;
+}
+
+
 /// Sets the list of configuration variables needed by the test.
 ///
 /// \param vars Set of configuration variables.
@@ -945,7 +981,7 @@ model::metadata_builder::set_required_configs(const model::strings_set& vars)
 model::metadata_builder&
 model::metadata_builder::set_required_disk_space(const units::bytes& bytes)
 {
-    set< bytes_node >(_pimpl->props, "required_disk_space", bytes);
+    set< config::bytes_node >(_pimpl->props, "required_disk_space", bytes);
     return *this;
 }
 
@@ -975,7 +1011,7 @@ model::metadata_builder::set_required_files(const model::paths_set& files)
 model::metadata_builder&
 model::metadata_builder::set_required_memory(const units::bytes& bytes)
 {
-    set< bytes_node >(_pimpl->props, "required_memory", bytes);
+    set< config::bytes_node >(_pimpl->props, "required_memory", bytes);
     return *this;
 }
 
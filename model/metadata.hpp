@@ -67,8 +67,10 @@ public:
     const strings_set& allowed_platforms(void) const;
     model::properties_map custom(void) const;
     const std::string& description(void) const;
+    const std::string& exclusive_group(void) const;
     bool has_cleanup(void) const;
     bool is_exclusive(void) const;
+    const utils::units::bytes& max_output_size(void) const;
     const strings_set& required_configs(void) const;
     const utils::units::bytes& required_disk_space(void) const;
     const paths_set& required_files(void) const;
@@ -110,8 +112,10 @@ public:
     metadata_builder& set_allowed_platforms(const strings_set&);
     metadata_builder& set_custom(const model::properties_map&);
     metadata_builder& set_description(const std::string&);
+    metadata_builder& set_exclusive_group(const std::string&);
     metadata_builder& set_has_cleanup(const bool);
     metadata_builder& set_is_exclusive(const bool);
+    metadata_builder& set_max_output_size(const utils::units::bytes&);
     metadata_builder& set_required_configs(const strings_set&);
     metadata_builder& set_required_disk_space(const utils::units::bytes&);
     metadata_builder& set_required_files(const paths_set&);
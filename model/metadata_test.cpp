@@ -52,8 +52,10 @@ ATF_TEST_CASE_BODY(defaults)
     ATF_REQUIRE(md.allowed_platforms().empty());
     ATF_REQUIRE(md.custom().empty());
     ATF_REQUIRE(md.description().empty());
+    ATF_REQUIRE(md.exclusive_group().empty());
     ATF_REQUIRE(!md.has_cleanup());
     ATF_REQUIRE(!md.is_exclusive());
+    ATF_REQUIRE_EQ(units::bytes(0), md.max_output_size());
     ATF_REQUIRE(md.required_configs().empty());
     ATF_REQUIRE_EQ(units::bytes(0), md.required_disk_space());
     ATF_REQUIRE(md.required_files().empty());
@@ -204,8 +206,10 @@ ATF_TEST_CASE_BODY(override_all_with_setters)
         .set_allowed_platforms(platforms)
         .set_custom(custom)
         .set_description(description)
+        .set_exclusive_group("the-group")
         .set_has_cleanup(true)
         .set_is_exclusive(true)
+        .set_max_output_size(units::bytes(64 * units::KB))
         .set_required_configs(configs)
         .set_required_disk_space(disk_space)
         .set_required_files(files)
@@ -219,8 +223,10 @@ ATF_TEST_CASE_BODY(override_all_with_setters)
     ATF_REQUIRE(platforms == md.allowed_platforms());
     ATF_REQUIRE(custom == md.custom());
     ATF_REQUIRE_EQ(description, md.description());
+    ATF_REQUIRE_EQ("the-group", md.exclusive_group());
     ATF_REQUIRE(md.has_cleanup());
     ATF_REQUIRE(md.is_exclusive());
+    ATF_REQUIRE_EQ(units::bytes(64 * units::KB), md.max_output_size());
     ATF_REQUIRE(configs == md.required_configs());
     ATF_REQUIRE_EQ(disk_space, md.required_disk_space());
     ATF_REQUIRE(files == md.required_files());
@@ -272,8 +278,10 @@ ATF_TEST_CASE_BODY(override_all_with_set_string)
         .set_string("allowed_platforms", "p1 p2")
         .set_string("custom.user-defined", "the-value")
         .set_string("description", "Another long text")
+        .set_string("exclusive_group", "the-group")
         .set_string("has_cleanup", "true")
         .set_string("is_exclusive", "true")
+        .set_string("max_output_size", "64k")
         .set_string("required_configs", "config-var")
         .set_string("required_disk_space", "16G")
         .set_string("required_files", "plain /absolute/path")
@@ -287,8 +295,10 @@ ATF_TEST_CASE_BODY(override_all_with_set_string)
     ATF_REQUIRE(platforms == md.allowed_platforms());
     ATF_REQUIRE(custom == md.custom());
     ATF_REQUIRE_EQ(description, md.description());
+    ATF_REQUIRE_EQ("the-group", md.exclusive_group());
     ATF_REQUIRE(md.has_cleanup());
     ATF_REQUIRE(md.is_exclusive());
+    ATF_REQUIRE_EQ(units::bytes(64 * units::KB), md.max_output_size());
     ATF_REQUIRE(configs == md.required_configs());
     ATF_REQUIRE_EQ(disk_space, md.required_disk_space());
     ATF_REQUIRE(files == md.required_files());
@@ -315,8 +325,10 @@ ATF_TEST_CASE_BODY(to_properties)
     props["allowed_platforms"] = "";
     props["custom.foo"] = "bar";
     props["description"] = "";
+    props["exclusive_group"] = "";
     props["has_cleanup"] = "false";
     props["is_exclusive"] = "false";
+    props["max_output_size"] = "0";
     props["required_configs"] = "";
     props["required_disk_space"] = "0";
     props["required_files"] = "bar foo";
@@ -406,7 +418,8 @@ ATF_TEST_CASE_BODY(output__defaults)
     std::ostringstream str;
     str << model::metadata_builder().build();
     ATF_REQUIRE_EQ("metadata{allowed_architectures='', allowed_platforms='', "
-                   "description='', has_cleanup='false', is_exclusive='false', "
+                   "description='', exclusive_group='', has_cleanup='false', "
+                   "is_exclusive='false', max_output_size='0', "
                    "required_configs='', "
                    "required_disk_space='0', required_files='', "
                    "required_memory='0', "
@@ -428,7 +441,8 @@ ATF_TEST_CASE_BODY(output__some_values)
         .build();
     ATF_REQUIRE_EQ(
         "metadata{allowed_architectures='abc', allowed_platforms='', "
-        "description='', has_cleanup='false', is_exclusive='true', "
+        "description='', exclusive_group='', has_cleanup='false', "
+        "is_exclusive='true', max_output_size='0', "
         "required_configs='', "
         "required_disk_space='0', required_files='bar foo', "
         "required_memory='1.00K', "
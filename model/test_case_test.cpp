@@ -200,8 +200,9 @@ ATF_TEST_CASE_BODY(test_case__output)
     ATF_REQUIRE_EQ(
         "test_case{name='the-name', "
         "metadata=metadata{allowed_architectures='', allowed_platforms='foo', "
-        "custom.bar='baz', description='', has_cleanup='false', "
-        "is_exclusive='false', "
+        "custom.bar='baz', description='', exclusive_group='', "
+        "has_cleanup='false', is_exclusive='false', "
+        "max_output_size='0', "
         "required_configs='', required_disk_space='0', required_files='', "
         "required_memory='0', "
         "required_programs='', required_user='', timeout='300'}}",
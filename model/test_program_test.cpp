@@ -544,7 +544,8 @@ check_output__no_test_cases(void)
         "test_program{interface='plain', binary='binary/path', "
         "root='/the/root', test_suite='suite-name', "
         "metadata=metadata{allowed_architectures='a', allowed_platforms='', "
-        "description='', has_cleanup='false', is_exclusive='false', "
+        "description='', exclusive_group='', has_cleanup='false', "
+        "is_exclusive='false', max_output_size='0', "
         "required_configs='', required_disk_space='0', required_files='', "
         "required_memory='0', "
         "required_programs='', required_user='', timeout='300'}, "
@@ -593,21 +594,24 @@ check_output__some_test_cases(void)
         "test_program{interface='plain', binary='binary/path', "
         "root='/the/root', test_suite='suite-name', "
         "metadata=metadata{allowed_architectures='a', allowed_platforms='', "
-        "description='', has_cleanup='false', is_exclusive='false', "
+        "description='', exclusive_group='', has_cleanup='false', "
+        "is_exclusive='false', max_output_size='0', "
         "required_configs='', required_disk_space='0', required_files='', "
         "required_memory='0', "
         "required_programs='', required_user='', timeout='300'}, "
         "test_cases=map("
         "another-name=test_case{name='another-name', "
         "metadata=metadata{allowed_architectures='a', allowed_platforms='', "
-        "description='', has_cleanup='false', is_exclusive='false', "
+        "description='', exclusive_group='', has_cleanup='false', "
+        "is_exclusive='false', max_output_size='0', "
         "required_configs='', required_disk_space='0', required_files='', "
         "required_memory='0', "
         "required_programs='', required_user='', timeout='300'}}, "
         "the-name=test_case{name='the-name', "
         "metadata=metadata{allowed_architectures='a', allowed_platforms='foo', "
-        "custom.bar='baz', description='', has_cleanup='false', "
-        "is_exclusive='false', "
+        "custom.bar='baz', description='', exclusive_group='', "
+        "has_cleanup='false', is_exclusive='false', "
+        "max_output_size='0', "
         "required_configs='', required_disk_space='0', required_files='', "
         "required_memory='0', "
         "required_programs='', required_user='', timeout='300'}})}",
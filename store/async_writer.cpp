@@ -0,0 +1,868 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "store/async_writer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "model/context.hpp"
+#include "model/test_case.hpp"
+#include "model/test_program.hpp"
+#include "model/test_result.hpp"
+#include "store/contents.hpp"
+#include "store/exceptions.hpp"
+#include "store/write_backend.hpp"
+#include "store/write_transaction.hpp"
+#include "utils/datetime.hpp"
+#include "utils/format/macros.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/logging/macros.hpp"
+#include "utils/optional.ipp"
+#include "utils/sanity.hpp"
+#include "utils/signals/misc.hpp"
+#include "utils/stream.hpp"
+
+namespace datetime = utils::datetime;
+namespace fs = utils::fs;
+namespace signals = utils::signals;
+
+using utils::none;
+using utils::optional;
+
+
+namespace {
+
+
+/// Size from which queued files are kept open instead of loaded into memory.
+static const std::size_t min_streamed_file_size = 1024 * 1024;
+
+
+/// Maximum number of files kept open by queued writes.
+///
+/// Further large files are loaded into memory to not run out of descriptors.
+static const std::size_t max_open_files = 32;
+
+
+/// Clock used to schedule the periodic commits.
+typedef std::chrono::steady_clock commit_clock;
+
+
+/// Mapping of the tokens given to the caller to database identifiers.
+///
+/// Tokens are handed out sequentially starting at 0, and the writes that
+/// create the objects are applied in the same order, so the token of an object
+/// is its index in these vectors.
+struct ids_map {
+    /// Database identifiers of the test programs.
+    std::vector< int64_t > test_programs;
+
+    /// Database identifiers of the test cases.
+    std::vector< int64_t > test_cases;
+};
+
+
+/// Abstract representation of a queued write.
+class write_op {
+public:
+    /// Destructor.
+    virtual ~write_op(void)
+    {
+    }
+
+    /// Applies the write to the database.
+    ///
+    /// \param tx The transaction in which to apply the write.
+    /// \param ids The identifiers of the objects written so far.
+    ///
+    /// \throw store::error If there is a problem writing to the database.
+    virtual void apply(store::write_transaction& tx, ids_map& ids) const = 0;
+};
+
+
+/// Queued write of a context.
+class put_context_op : public write_op {
+    /// The context to put.
+    const model::context _context;
+
+public:
+    /// Constructor.
+    ///
+    /// \param context_ The context to put.
+    explicit put_context_op(const model::context& context_) :
+        _context(context_)
+    {
+    }
+
+    /// Applies the write to the database.
+    ///
+    /// \param tx The transaction in which to apply the write.
+    void
+    apply(store::write_transaction& tx, ids_map& /* ids */) const
+    {
+        tx.put_context(_context);
+    }
+};
+
+
+/// Queued write of the completion status of the run.
+class put_run_status_op : public write_op {
+    /// Whether the run has completed or not.
+    const bool _completed;
+
+public:
+    /// Constructor.
+    ///
+    /// \param completed_ Whether the run has completed or not.
+    explicit put_run_status_op(const bool completed_) :
+        _completed(completed_)
+    {
+    }
+
+    /// Applies the write to the database.
+    ///
+    /// \param tx The transaction in which to apply the write.
+    void
+    apply(store::write_transaction& tx, ids_map& /* ids */) const
+    {
+        tx.put_run_status(_completed);
+    }
+};
+
+
+/// Queued write of a test program.
+class put_test_program_op : public write_op {
+    /// The test program to put.
+    const model::test_program_ptr _test_program;
+
+public:
+    /// Constructor.
+    ///
+    /// \param test_program_ The test program to put.
+    explicit put_test_program_op(const model::test_program_ptr test_program_) :
+        _test_program(test_program_)
+    {
+    }
+
+    /// Applies the write to the database.
+    ///
+    /// \param tx The transaction in which to apply the write.
+    /// \param [in,out] ids The identifiers of the objects written so far.
+    void
+    apply(store::write_transaction& tx, ids_map& ids) const
+    {
+        ids.test_programs.push_back(tx.put_test_program(*_test_program));
+    }
+};
+
+
+/// Queued write of a test case.
+class put_test_case_op : public write_op {
+    /// The test case to put.
+    const model::test_case _test_case;
+
+    /// Token of the test program the test case belongs to.
+    const int64_t _test_program_token;
+
+public:
+    /// Constructor.
+    ///
+    /// \param test_case_ The test case to put.
+    /// \param test_program_token_ Token of the test program the test case
+    ///     belongs to.
+    put_test_case_op(const model::test_case& test_case_,
+                     const int64_t test_program_token_) :
+        _test_case(test_case_),
+        _test_program_token(test_program_token_)
+    {
+    }
+
+    /// Applies the write to the database.
+    ///
+    /// \param tx The transaction in which to apply the write.
+    /// \param [in,out] ids The identifiers of the objects written so far.
+    void
+    apply(store::write_transaction& tx, ids_map& ids) const
+    {
+        ids.test_cases.push_back(tx.put_test_case(
+            _test_case, ids.test_programs[_test_program_token]));
+    }
+};
+
+
+/// Queued write of a file generated by a test case.
+class put_test_case_file_op : public write_op {
+    /// The name of the file.
+    const std::string _name;
+
+    /// The contents of the file.
+    const std::string _contents;
+
+    /// Token of the test case the file belongs to.
+    const int64_t _test_case_token;
+
+public:
+    /// Constructor.
+    ///
+    /// \param name_ The name of the file.
+    /// \param contents_ The contents of the file.
+    /// \param test_case_token_ Token of the test case the file belongs to.
+    put_test_case_file_op(const std::string& name_,
+                          const std::string& contents_,
+                          const int64_t test_case_token_) :
+        _name(name_),
+        _contents(contents_),
+        _test_case_token(test_case_token_)
+    {
+    }
+
+    /// Applies the write to the database.
+    ///
+    /// \param tx The transaction in which to apply the write.
+    /// \param ids The identifiers of the objects written so far.
+    void
+    apply(store::write_transaction& tx, ids_map& ids) const
+    {
+        tx.put_test_case_contents(_name, _contents,
+                                  ids.test_cases[_test_case_token]);
+    }
+};
+
+
+/// Queued write of a large file generated by a test case.
+///
+/// The file is kept open instead of being loaded into memory and the writer
+/// thread copies it into the database piece by piece.  The file can be deleted
+/// in the meantime because an open file survives its removal.
+class put_test_case_stream_op : public write_op {
+    /// The name of the file.
+    const std::string _name;
+
+    /// The open file.
+    const std::shared_ptr< std::ifstream > _input;
+
+    /// Token of the test case the file belongs to.
+    const int64_t _test_case_token;
+
+    /// Maximum length of the file to store, or 0 for no limit.
+    const std::size_t _max_length;
+
+    /// Counter of the files kept open by queued writes.
+    std::atomic< std::size_t >& _open_files;
+
+public:
+    /// Constructor.
+    ///
+    /// \param name_ The name of the file.
+    /// \param input_ The open file.
+    /// \param test_case_token_ Token of the test case the file belongs to.
+    /// \param max_length_ Maximum length of the file to store, or 0 for no
+    ///     limit.
+    /// \param [in,out] open_files_ Counter of the files kept open by queued
+    ///     writes.  This write accounts for its file while it exists.
+    put_test_case_stream_op(const std::string& name_,
+                            const std::shared_ptr< std::ifstream > input_,
+                            const int64_t test_case_token_,
+                            const std::size_t max_length_,
+                            std::atomic< std::size_t >& open_files_) :
+        _name(name_),
+        _input(input_),
+        _test_case_token(test_case_token_),
+        _max_length(max_length_),
+        _open_files(open_files_)
+    {
+        ++_open_files;
+    }
+
+    /// Destructor.
+    ~put_test_case_stream_op(void)
+    {
+        --_open_files;
+    }
+
+    /// Applies the write to the database.
+    ///
+    /// \param tx The transaction in which to apply the write.
+    /// \param ids The identifiers of the objects written so far.
+    void
+    apply(store::write_transaction& tx, ids_map& ids) const
+    {
+        tx.put_test_case_stream(_name, *_input,
+                                ids.test_cases[_test_case_token],
+                                _max_length);
+    }
+};
+
+
+/// Queued write of a test result.
+class put_result_op : public write_op {
+    /// The result to put.
+    const model::test_result _result;
+
+    /// Token of the test case the result belongs to.
+    const int64_t _test_case_token;
+
+    /// The time when the test started to run.
+    const datetime::timestamp _start_time;
+
+    /// The time when the test finished running.
+    const datetime::timestamp _end_time;
+
+public:
+    /// Constructor.
+    ///
+    /// \param result_ The result to put.
+    /// \param test_case_token_ Token of the test case the result belongs to.
+    /// \param start_time_ The time when the test started to run.
+    /// \param end_time_ The time when the test finished running.
+    put_result_op(const model::test_result& result_,
+                  const int64_t test_case_token_,
+                  const datetime::timestamp& start_time_,
+                  const datetime::timestamp& end_time_) :
+        _result(result_),
+        _test_case_token(test_case_token_),
+        _start_time(start_time_),
+        _end_time(end_time_)
+    {
+    }
+
+    /// Applies the write to the database.
+    ///
+    /// \param tx The transaction in which to apply the write.
+    /// \param ids The identifiers of the objects written so far.
+    void
+    apply(store::write_transaction& tx, ids_map& ids) const
+    {
+        tx.put_result(_result, ids.test_cases[_test_case_token], _start_time,
+                      _end_time);
+    }
+};
+
+
+/// Shared pointer to a queued write.
+typedef std::shared_ptr< const write_op > write_op_ptr;
+
+
+}  // anonymous namespace
+
+
+/// Internal implementation of the asynchronous writer.
+struct store::async_writer::impl : utils::noncopyable {
+    /// The store being written to.  Only accessed by the writer thread.
+    store::write_backend backend;
+
+    /// The currently-open transaction, if any.  Only accessed by the writer
+    /// thread.
+    std::auto_ptr< store::write_transaction > tx;
+
+    /// Identifiers of the objects written so far.  Only accessed by the
+    /// writer thread.
+    ids_map ids;
+
+    /// Time by which the current transaction must be committed.  Only
+    /// accessed by the writer thread.
+    commit_clock::time_point commit_deadline;
+
+    /// Maximum number of writes waiting in the queue.
+    const std::size_t max_queued;
+
+    /// Maximum number of applied writes that remain uncommitted.
+    const std::size_t max_uncommitted;
+
+    /// Maximum time that applied writes remain uncommitted.
+    const commit_clock::duration commit_interval;
+
+    /// Number of files kept open by queued writes.  Declared before the queue
+    /// so that it outlives the writes in it.
+    std::atomic< std::size_t > open_files;
+
+    /// Last token given to a test program.  Only accessed by the caller.
+    int64_t last_test_program_token;
+
+    /// Last token given to a test case.  Only accessed by the caller.
+    int64_t last_test_case_token;
+
+    /// Protects all the mutable fields below.
+    std::mutex mutex;
+
+    /// Signals the writer thread that there are new writes, that a commit was
+    /// requested or that it must terminate.
+    std::condition_variable work_available;
+
+    /// Signals the caller that there is space in the queue or that more
+    /// writes have been committed.
+    std::condition_variable progress;
+
+    /// Writes waiting to be applied.
+    std::deque< write_op_ptr > queue;
+
+    /// Number of writes queued so far.
+    std::size_t queued_ops;
+
+    /// Number of writes committed so far.
+    std::size_t committed_ops;
+
+    /// Number of writes that must be committed as soon as possible.
+    std::size_t flush_target;
+
+    /// Whether the writer thread has been asked to terminate.
+    bool stopping;
+
+    /// First error found by the writer thread, after which no more writes are
+    /// applied.
+    optional< std::string > error;
+
+    /// The writer thread.
+    std::thread writer;
+
+    /// Constructor.
+    ///
+    /// \param backend_ The store to write to.
+    /// \param max_queued_ Maximum number of writes waiting in the queue.
+    /// \param max_uncommitted_ Maximum number of applied writes that remain
+    ///     uncommitted.
+    /// \param commit_interval_ Maximum time that applied writes remain
+    ///     uncommitted.
+    impl(const store::write_backend& backend_, const std::size_t max_queued_,
+         const std::size_t max_uncommitted_,
+         const datetime::delta& commit_interval_) :
+        backend(backend_),
+        max_queued(max_queued_),
+        max_uncommitted(max_uncommitted_),
+        commit_interval(std::chrono::microseconds(
+            commit_interval_.to_microseconds())),
+        open_files(0),
+        last_test_program_token(-1),
+        last_test_case_token(-1),
+        queued_ops(0),
+        committed_ops(0),
+        flush_target(0),
+        stopping(false)
+    {
+        PRE(max_queued > 0);
+        PRE(max_uncommitted > 0);
+    }
+
+    /// Starts the writer thread.
+    void
+    start(void)
+    {
+        writer = signals::start_masked_thread(std::bind(&impl::run, this));
+    }
+
+    /// Stops the writer thread after committing all pending writes.
+    void
+    stop(void)
+    {
+        {
+            std::lock_guard< std::mutex > lock(mutex);
+            stopping = true;
+            work_available.notify_one();
+        }
+        writer.join();
+    }
+
+    /// Queues a write for the writer thread.
+    ///
+    /// Blocks while the queue is full.
+    ///
+    /// \param op The write to queue.
+    ///
+    /// \throw store::error If a previous write failed.
+    void
+    enqueue(const write_op_ptr op)
+    {
+        std::unique_lock< std::mutex > lock(mutex);
+        while (queue.size() >= max_queued && !error)
+            progress.wait(lock);
+        if (error)
+            throw store::error(error.get());
+
+        queue.push_back(op);
+        ++queued_ops;
+        if (queue.size() == 1)
+            work_available.notify_one();
+    }
+
+    /// Applies a batch of writes to the database.
+    ///
+    /// \param batch The writes to apply.
+    ///
+    /// \throw store::error If any of the writes fails.
+    void
+    apply(const std::deque< write_op_ptr >& batch)
+    {
+        if (tx.get() == NULL) {
+            tx.reset(new store::write_transaction(backend.start_write()));
+            commit_deadline = commit_clock::now() + commit_interval;
+        }
+        for (std::deque< write_op_ptr >::const_iterator iter = batch.begin();
+             iter != batch.end(); ++iter)
+            (*iter)->apply(*tx, ids);
+    }
+
+    /// Commits the writes applied so far.
+    ///
+    /// \throw store::error If the commit fails.
+    void
+    checkpoint(void)
+    {
+        std::auto_ptr< store::write_transaction > old_tx = tx;
+        old_tx->commit();
+    }
+
+    /// Discards the writes applied since the last commit.
+    void
+    discard(void)
+    {
+        std::auto_ptr< store::write_transaction > old_tx = tx;
+        if (old_tx.get() != NULL) {
+            try {
+                old_tx->rollback();
+            } catch (const store::error& e) {
+                LW(F("Failed to roll back pending writes: %s") % e.what());
+            }
+        }
+    }
+
+    /// Waits until the writer thread has something to do.
+    ///
+    /// \pre The mutex must be held by the caller through \p lock.
+    ///
+    /// \param lock The lock on the mutex.
+    void
+    wait_for_work(std::unique_lock< std::mutex >& lock)
+    {
+        for (;;) {
+            if (!queue.empty() || stopping)
+                return;
+            if (error || tx.get() == NULL) {
+                work_available.wait(lock);
+                continue;
+            }
+            if (flush_target > committed_ops ||
+                commit_clock::now() >= commit_deadline)
+                return;
+            work_available.wait_until(lock, commit_deadline);
+        }
+    }
+
+    /// Body of the writer thread.
+    ///
+    /// Takes all queued writes at once and applies them in the current
+    /// transaction.  The transaction is committed once it holds
+    /// max_uncommitted writes or has been open for commit_interval, when the
+    /// caller requests a flush, or on termination.  Each commit only has to
+    /// persist the writes since the previous one, and a burst of results is
+    /// stored with a single commit.
+    void
+    run(void)
+    {
+        std::size_t applied_ops = 0;
+
+        std::unique_lock< std::mutex > lock(mutex);
+        for (;;) {
+            wait_for_work(lock);
+
+            std::deque< write_op_ptr > batch;
+            batch.swap(queue);
+            progress.notify_all();
+            const bool flush = stopping || flush_target > committed_ops;
+            const bool failed = error;
+            lock.unlock();
+
+            optional< std::string > new_error;
+            if (!failed) {
+                try {
+                    if (!batch.empty())
+                        apply(batch);
+                    applied_ops += batch.size();
+                    if (tx.get() != NULL &&
+                        (flush ||
+                         applied_ops - committed_ops >= max_uncommitted ||
+                         commit_clock::now() >= commit_deadline))
+                        checkpoint();
+                } catch (const std::exception& e) {
+                    new_error = e.what();
+                    discard();
+                    LE(F("Failed to store results: %s") % e.what());
+                }
+            }
+            batch.clear();
+
+            lock.lock();
+            if (new_error) {
+                error = new_error;
+                progress.notify_all();
+            } else if (!failed && tx.get() == NULL &&
+                       committed_ops != applied_ops) {
+                committed_ops = applied_ops;
+                progress.notify_all();
+            }
+            if (stopping && queue.empty())
+                break;
+        }
+    }
+};
+
+
+/// Opens the store and starts the writer thread.
+///
+/// \param store_file The store to write to.  It is opened, and created if
+///     necessary, before this returns.
+/// \param max_queued Maximum number of writes waiting to be applied.  The
+///     put_*() methods block while the queue is full.
+/// \param max_uncommitted Maximum number of applied writes that remain
+///     uncommitted.
+/// \param commit_interval Maximum time that applied writes remain uncommitted.
+///
+/// \throw store::error If the store cannot be opened.
+store::async_writer::async_writer(const fs::path& store_file,
+                                  const std::size_t max_queued,
+                                  const std::size_t max_uncommitted,
+                                  const datetime::delta& commit_interval) :
+    _pimpl(new impl(store::write_backend::open_rw(store_file), max_queued,
+                    max_uncommitted, commit_interval))
+{
+    _pimpl->start();
+}
+
+
+/// Destructor.
+///
+/// Commits all pending writes and stops the writer thread.  Errors are logged;
+/// call commit() explicitly to get them reported.
+store::async_writer::~async_writer(void)
+{
+    _pimpl->stop();
+    if (_pimpl->error)
+        LW(F("Some results were not stored: %s") % _pimpl->error.get());
+}
+
+
+/// Queues the storage of a context.
+///
+/// \param context The context to put.
+///
+/// \throw store::error If a previous write failed.
+void
+store::async_writer::put_context(const model::context& context)
+{
+    _pimpl->enqueue(write_op_ptr(new put_context_op(context)));
+}
+
+
+/// Queues the storage of the completion status of the run.
+///
+/// \param completed False while the run is in progress; true once it is done.
+///
+/// \throw store::error If a previous write failed.
+void
+store::async_writer::put_run_status(const bool completed)
+{
+    _pimpl->enqueue(write_op_ptr(new put_run_status_op(completed)));
+}
+
+
+/// Queues the storage of a test program.
+///
+/// \param test_program The test program to put.  The writer keeps a reference
+///     to it until it is written.
+///
+/// \return A token to refer to the test program in put_test_case().
+///
+/// \throw store::error If a previous write failed.
+int64_t
+store::async_writer::put_test_program(const model::test_program_ptr test_program)
+{
+    _pimpl->enqueue(write_op_ptr(new put_test_program_op(test_program)));
+    return ++_pimpl->last_test_program_token;
+}
+
+
+/// Queues the storage of a test case.
+///
+/// \param test_case The test case to put.
+/// \param test_program_token The token of the test program this test case
+///     belongs to, as returned by put_test_program().
+///
+/// \return A token to refer to the test case in put_test_case_file() and
+/// put_result().
+///
+/// \throw store::error If a previous write failed.
+int64_t
+store::async_writer::put_test_case(const model::test_case& test_case,
+                                   const int64_t test_program_token)
+{
+    PRE(test_program_token <= _pimpl->last_test_program_token);
+    _pimpl->enqueue(write_op_ptr(new put_test_case_op(test_case,
+                                                      test_program_token)));
+    return ++_pimpl->last_test_case_token;
+}
+
+
+/// Queues the storage of a file generated by a test case.
+///
+/// The file is read, or kept open if it is large, before this returns, so the
+/// caller is free to delete it right away.  Empty files are not stored.
+///
+/// \param name The name of the file to store in the database.  See
+///     write_transaction::put_test_case_file() for details.
+/// \param path The path to the file to be stored.
+/// \param test_case_token The token of the test case this file belongs to, as
+///     returned by put_test_case().
+/// \param max_length Maximum length of the file to store, or 0 for no limit.
+///     See write_transaction::put_test_case_file() for details.
+///
+/// \throw store::error If the file cannot be read or if a previous write
+///     failed.
+void
+store::async_writer::put_test_case_file(const std::string& name,
+                                        const fs::path& path,
+                                        const int64_t test_case_token,
+                                        const std::size_t max_length)
+{
+    PRE(test_case_token <= _pimpl->last_test_case_token);
+
+    const std::shared_ptr< std::ifstream > input(
+        new std::ifstream(path.c_str(), std::ios::binary));
+    if (!*input)
+        throw store::error(F("Cannot open file %s") % path);
+
+    const std::size_t length = utils::stream_length(*input);
+    if (length == 0)
+        return;
+    const bool truncate = max_length > 0 && length > max_length;
+    if ((truncate ? max_length : length) >= min_streamed_file_size &&
+        _pimpl->open_files < max_open_files) {
+        _pimpl->enqueue(write_op_ptr(new put_test_case_stream_op(
+            name, input, test_case_token, max_length, _pimpl->open_files)));
+        return;
+    }
+
+    std::string contents;
+    if (truncate) {
+        truncated_istream truncated(*input, length, max_length);
+        contents = utils::read_stream(truncated);
+    } else {
+        contents = utils::read_stream(*input);
+    }
+    if (contents.empty())
+        return;
+
+    _pimpl->enqueue(write_op_ptr(new put_test_case_file_op(
+        name, contents, test_case_token)));
+}
+
+
+/// Queues the storage of a file generated by a test case from memory.
+///
+/// This is the same as put_test_case_file() but for callers that already hold
+/// the contents of the file in memory, such as those that capture the output
+/// of the test cases without going through the file system.  Empty files are
+/// not stored.
+///
+/// \param name The name of the file to store in the database.  See
+///     write_transaction::put_test_case_file() for details.
+/// \param contents The contents of the file.
+/// \param test_case_token The token of the test case this file belongs to, as
+///     returned by put_test_case().
+/// \param max_length Maximum length of the file to store, or 0 for no limit.
+///     See write_transaction::put_test_case_file() for details.
+///
+/// \throw store::error If a previous write failed.
+void
+store::async_writer::put_test_case_contents(const std::string& name,
+                                            const std::string& contents,
+                                            const int64_t test_case_token,
+                                            const std::size_t max_length)
+{
+    PRE(test_case_token <= _pimpl->last_test_case_token);
+
+    if (contents.empty())
+        return;
+
+    if (max_length > 0 && contents.length() > max_length) {
+        std::istringstream input(contents);
+        truncated_istream truncated(input, contents.length(), max_length);
+        _pimpl->enqueue(write_op_ptr(new put_test_case_file_op(
+            name, utils::read_stream(truncated), test_case_token)));
+        return;
+    }
+
+    _pimpl->enqueue(write_op_ptr(new put_test_case_file_op(
+        name, contents, test_case_token)));
+}
+
+
+/// Queues the storage of a result.
+///
+/// \param result The result to put.
+/// \param test_case_token The token of the test case this result corresponds
+///     to, as returned by put_test_case().
+/// \param start_time The time when the test started to run.
+/// \param end_time The time when the test finished running.
+///
+/// \throw store::error If a previous write failed.
+void
+store::async_writer::put_result(const model::test_result& result,
+                                const int64_t test_case_token,
+                                const datetime::timestamp& start_time,
+                                const datetime::timestamp& end_time)
+{
+    PRE(test_case_token <= _pimpl->last_test_case_token);
+    _pimpl->enqueue(write_op_ptr(new put_result_op(
+        result, test_case_token, start_time, end_time)));
+}
+
+
+/// Waits until all the writes queued so far have been committed.
+///
+/// The writer remains usable after this returns.
+///
+/// \throw store::error If any write failed.
+void
+store::async_writer::commit(void)
+{
+    std::unique_lock< std::mutex > lock(_pimpl->mutex);
+    _pimpl->flush_target = _pimpl->queued_ops;
+    _pimpl->work_available.notify_one();
+    while (_pimpl->committed_ops < _pimpl->flush_target && !_pimpl->error)
+        _pimpl->progress.wait(lock);
+    if (_pimpl->error)
+        throw store::error(_pimpl->error.get());
+}
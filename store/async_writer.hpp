@@ -0,0 +1,97 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/// \file store/async_writer.hpp
+/// Background writer of test results into the store.
+
+#if !defined(STORE_ASYNC_WRITER_HPP)
+#define STORE_ASYNC_WRITER_HPP
+
+#include "store/async_writer_fwd.hpp"
+
+extern "C" {
+#include <stdint.h>
+}
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "model/context_fwd.hpp"
+#include "model/test_case_fwd.hpp"
+#include "model/test_program_fwd.hpp"
+#include "model/test_result_fwd.hpp"
+#include "utils/datetime_fwd.hpp"
+#include "utils/fs/path_fwd.hpp"
+#include "utils/noncopyable.hpp"
+
+namespace store {
+
+
+/// Writes results into the store from a dedicated thread.
+///
+/// The put_*() methods only queue the data to be written and return
+/// immediately unless the queue is full, so that the caller can keep running
+/// tests while the database is being updated.  The background thread owns the
+/// database and applies all queued writes in batches, committing them every
+/// few writes or every few seconds, whatever comes first, so that the results
+/// stored so far survive an interruption of the caller.
+///
+/// The identifiers returned by put_test_program() and put_test_case() are
+/// opaque tokens that are only valid as arguments to the other methods of the
+/// same writer; they are not the identifiers of the objects in the database.
+class async_writer : utils::noncopyable {
+    struct impl;
+
+    /// Pointer to the internal implementation.
+    std::auto_ptr< impl > _pimpl;
+
+public:
+    async_writer(const utils::fs::path&, const std::size_t, const std::size_t,
+                 const utils::datetime::delta&);
+    ~async_writer(void);
+
+    void put_context(const model::context&);
+    void put_run_status(const bool);
+    int64_t put_test_program(const model::test_program_ptr);
+    int64_t put_test_case(const model::test_case&, const int64_t);
+    void put_test_case_file(const std::string&, const utils::fs::path&,
+                            const int64_t, const std::size_t = 0);
+    void put_test_case_contents(const std::string&, const std::string&,
+                                const int64_t, const std::size_t = 0);
+    void put_result(const model::test_result&, const int64_t,
+                    const utils::datetime::timestamp&,
+                    const utils::datetime::timestamp&);
+
+    void commit(void);
+};
+
+
+}  // namespace store
+
+#endif  // !defined(STORE_ASYNC_WRITER_HPP)
@@ -0,0 +1,548 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "store/async_writer.hpp"
+
+extern "C" {
+#include <unistd.h>
+}
+
+#include <iostream>
+#include <map>
+#include <string>
+
+#include <atf-c++.hpp>
+
+#include "model/context.hpp"
+#include "model/metadata.hpp"
+#include "model/test_case.hpp"
+#include "model/test_program.hpp"
+#include "model/test_result.hpp"
+#include "store/exceptions.hpp"
+#include "store/read_backend.hpp"
+#include "store/read_transaction.hpp"
+#include "store/write_backend.hpp"
+#include "utils/datetime.hpp"
+#include "utils/format/macros.hpp"
+#include "utils/fs/operations.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/logging/operations.hpp"
+#include "utils/sqlite/database.hpp"
+#include "utils/sqlite/statement.ipp"
+#include "utils/test_utils.ipp"
+
+namespace datetime = utils::datetime;
+namespace fs = utils::fs;
+namespace logging = utils::logging;
+namespace sqlite = utils::sqlite;
+
+
+namespace {
+
+
+/// Commit interval long enough to never trigger during a test.
+static const datetime::delta never(3600, 0);
+
+
+/// Number of writes large enough to never trigger a commit during a test.
+static const std::size_t lots = 1000000;
+
+
+/// Counts the results stored in a database.
+///
+/// \param file The database to query.
+///
+/// \return The number of results.
+static int
+count_results(const fs::path& file)
+{
+    store::read_backend backend = store::read_backend::open_ro(file);
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT COUNT(*) FROM test_results");
+    ATF_REQUIRE(stmt.step());
+    return stmt.column_int(0);
+}
+
+
+/// Waits for the results stored in a database to reach a given count.
+///
+/// \param file The database to query.
+/// \param expected The number of results to wait for.
+///
+/// \return The number of results found, which may be lower than \p expected
+/// if we gave up waiting.
+static int
+wait_for_results(const fs::path& file, const int expected)
+{
+    int results = 0;
+    for (int i = 0; i < 500 && results < expected; ++i) {
+        try {
+            results = count_results(file);
+        } catch (const store::error& e) {
+            // The database may be momentarily locked by the writer.
+        }
+        if (results < expected)
+            ::usleep(10000);
+    }
+    return results;
+}
+
+
+/// Creates a test program with the given number of test cases.
+///
+/// \param num_tests Number of test cases to add, named test0, test1, etc.
+///
+/// \return A new test program.
+static model::test_program_ptr
+make_test_program(const int num_tests)
+{
+    model::test_program_builder builder(
+        "plain", fs::path("the/binary"), fs::path("/some/root"), "the-suite");
+    for (int i = 0; i < num_tests; ++i)
+        builder.add_test_case(F("test%s") % i);
+    return builder.build_ptr();
+}
+
+
+}  // anonymous namespace
+
+
+ATF_TEST_CASE(put_and_commit);
+ATF_TEST_CASE_HEAD(put_and_commit)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_and_commit)
+{
+    atf::utils::create_file("stdout.txt", "The output\n");
+    atf::utils::create_file("stderr.txt", "");
+
+    const model::test_program_ptr test_program = make_test_program(1);
+    const model::test_result result(model::test_result_failed, "Oops");
+    const datetime::timestamp start =
+        datetime::timestamp::from_microseconds(1000);
+    const datetime::timestamp end =
+        datetime::timestamp::from_microseconds(5000);
+
+    store::async_writer writer(fs::path("test.db"), 10, lots, never);
+    writer.put_context(model::context(
+        fs::path("/foo/bar"), std::map< std::string, std::string >()));
+    const int64_t test_program_token = writer.put_test_program(test_program);
+    const int64_t test_case_token = writer.put_test_case(
+        test_program->find("test0"), test_program_token);
+    writer.put_test_case_file("__STDOUT__", fs::path("stdout.txt"),
+                              test_case_token);
+    writer.put_test_case_file("__STDERR__", fs::path("stderr.txt"),
+                              test_case_token);
+    writer.put_result(result, test_case_token, start, end);
+    writer.commit();
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+    ATF_REQUIRE_EQ(fs::path("/foo/bar"), tx.get_context().cwd());
+    store::results_iterator iter = tx.get_results();
+    ATF_REQUIRE(iter);
+    ATF_REQUIRE_EQ(fs::path("the/binary"),
+                   iter.test_program()->relative_path());
+    ATF_REQUIRE_EQ("test0", iter.test_case_name());
+    ATF_REQUIRE_EQ(result, iter.result());
+    ATF_REQUIRE_EQ(start, iter.start_time());
+    ATF_REQUIRE_EQ(end, iter.end_time());
+    ATF_REQUIRE_EQ("The output\n", iter.stdout_contents());
+    ATF_REQUIRE(iter.stderr_contents().empty());
+    ++iter;
+    ATF_REQUIRE(!iter);
+    tx.finish();
+}
+
+
+ATF_TEST_CASE(commit__reusable);
+ATF_TEST_CASE_HEAD(commit__reusable)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(commit__reusable)
+{
+    const model::test_program_ptr test_program = make_test_program(2);
+    const model::test_result result(model::test_result_passed);
+    const datetime::timestamp zero = datetime::timestamp::from_microseconds(0);
+
+    store::async_writer writer(fs::path("test.db"), 10, lots, never);
+    const int64_t test_program_token = writer.put_test_program(test_program);
+
+    const int64_t test_case_token1 = writer.put_test_case(
+        test_program->find("test0"), test_program_token);
+    writer.put_result(result, test_case_token1, zero, zero);
+    writer.commit();
+    ATF_REQUIRE_EQ(1, count_results(fs::path("test.db")));
+    writer.commit();
+
+    const int64_t test_case_token2 = writer.put_test_case(
+        test_program->find("test1"), test_program_token);
+    writer.put_result(result, test_case_token2, zero, zero);
+    writer.commit();
+    ATF_REQUIRE_EQ(2, count_results(fs::path("test.db")));
+}
+
+
+ATF_TEST_CASE(periodic_commits__time);
+ATF_TEST_CASE_HEAD(periodic_commits__time)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+    set_md_var("timeout", "60");
+}
+ATF_TEST_CASE_BODY(periodic_commits__time)
+{
+    const model::test_program_ptr test_program = make_test_program(1);
+    const datetime::timestamp zero = datetime::timestamp::from_microseconds(0);
+
+    store::async_writer writer(fs::path("test.db"), 10, lots,
+                               datetime::delta(0, 100000));
+    const int64_t test_case_token = writer.put_test_case(
+        test_program->find("test0"), writer.put_test_program(test_program));
+    writer.put_result(model::test_result(model::test_result_passed),
+                      test_case_token, zero, zero);
+
+    // No explicit commit: the result must become visible on its own.
+    ATF_REQUIRE_EQ(1, wait_for_results(fs::path("test.db"), 1));
+}
+
+
+ATF_TEST_CASE(periodic_commits__writes);
+ATF_TEST_CASE_HEAD(periodic_commits__writes)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+    set_md_var("timeout", "60");
+}
+ATF_TEST_CASE_BODY(periodic_commits__writes)
+{
+    const model::test_program_ptr test_program = make_test_program(1);
+    const datetime::timestamp zero = datetime::timestamp::from_microseconds(0);
+
+    store::async_writer writer(fs::path("test.db"), 10, 3, never);
+    const int64_t test_case_token = writer.put_test_case(
+        test_program->find("test0"), writer.put_test_program(test_program));
+    writer.put_result(model::test_result(model::test_result_passed),
+                      test_case_token, zero, zero);
+
+    // No explicit commit: the result must become visible on its own.
+    ATF_REQUIRE_EQ(1, wait_for_results(fs::path("test.db"), 1));
+}
+
+
+ATF_TEST_CASE(put_run_status);
+ATF_TEST_CASE_HEAD(put_run_status)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_run_status)
+{
+    store::async_writer writer(fs::path("test.db"), 10, lots, never);
+
+    writer.put_run_status(false);
+    writer.commit();
+    {
+        store::read_backend backend = store::read_backend::open_ro(
+            fs::path("test.db"));
+        ATF_REQUIRE(!backend.start_read().get_completed());
+    }
+
+    writer.put_run_status(true);
+    writer.commit();
+    {
+        store::read_backend backend = store::read_backend::open_ro(
+            fs::path("test.db"));
+        ATF_REQUIRE(backend.start_read().get_completed());
+    }
+}
+
+
+ATF_TEST_CASE(destructor__commits);
+ATF_TEST_CASE_HEAD(destructor__commits)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(destructor__commits)
+{
+    const model::test_program_ptr test_program = make_test_program(10);
+    const datetime::timestamp zero = datetime::timestamp::from_microseconds(0);
+
+    {
+        store::async_writer writer(fs::path("test.db"), 1, lots, never);
+        const int64_t test_program_token = writer.put_test_program(
+            test_program);
+        for (int i = 0; i < 10; ++i) {
+            const int64_t test_case_token = writer.put_test_case(
+                test_program->find(F("test%s") % i), test_program_token);
+            writer.put_result(model::test_result(model::test_result_passed),
+                              test_case_token, zero, zero);
+        }
+    }
+    ATF_REQUIRE_EQ(10, count_results(fs::path("test.db")));
+}
+
+
+ATF_TEST_CASE(put_test_case_file__missing);
+ATF_TEST_CASE_HEAD(put_test_case_file__missing)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_test_case_file__missing)
+{
+    const model::test_program_ptr test_program = make_test_program(1);
+
+    store::async_writer writer(fs::path("test.db"), 10, lots, never);
+    const int64_t test_case_token = writer.put_test_case(
+        test_program->find("test0"), writer.put_test_program(test_program));
+    ATF_REQUIRE_THROW_RE(store::error, "Cannot open file.*missing",
+                         writer.put_test_case_file("__STDOUT__",
+                                                   fs::path("missing"),
+                                                   test_case_token));
+    writer.commit();
+}
+
+
+ATF_TEST_CASE(put_test_case_file__large_deleted);
+ATF_TEST_CASE_HEAD(put_test_case_file__large_deleted)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_test_case_file__large_deleted)
+{
+    std::string contents;
+    for (int i = 0; contents.length() < 3 * 1024 * 1024; ++i)
+        contents += F("Line %s of the output\n") % i;
+    atf::utils::create_file("stdout.txt", contents);
+
+    const model::test_program_ptr test_program = make_test_program(1);
+    const datetime::timestamp zero = datetime::timestamp::from_microseconds(0);
+
+    store::async_writer writer(fs::path("test.db"), 10, lots, never);
+    const int64_t test_case_token = writer.put_test_case(
+        test_program->find("test0"), writer.put_test_program(test_program));
+    writer.put_test_case_file("__STDOUT__", fs::path("stdout.txt"),
+                              test_case_token);
+    fs::unlink(fs::path("stdout.txt"));
+    writer.put_result(model::test_result(model::test_result_passed),
+                      test_case_token, zero, zero);
+    writer.commit();
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+    store::results_iterator iter = tx.get_results();
+    ATF_REQUIRE(iter);
+    ATF_REQUIRE(contents == iter.stdout_contents());
+    tx.finish();
+}
+
+
+ATF_TEST_CASE(put_test_case_file__truncated);
+ATF_TEST_CASE_HEAD(put_test_case_file__truncated)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_test_case_file__truncated)
+{
+    atf::utils::create_file("stdout.txt", "The first line\n"
+                            "Some more output\n"
+                            "The last line\n");
+    atf::utils::create_file("stderr.txt", "Short\n");
+
+    const model::test_program_ptr test_program = make_test_program(1);
+    const datetime::timestamp zero = datetime::timestamp::from_microseconds(0);
+
+    store::async_writer writer(fs::path("test.db"), 10, lots, never);
+    const int64_t test_case_token = writer.put_test_case(
+        test_program->find("test0"), writer.put_test_program(test_program));
+    writer.put_test_case_file("__STDOUT__", fs::path("stdout.txt"),
+                              test_case_token, 30);
+    writer.put_test_case_file("__STDERR__", fs::path("stderr.txt"),
+                              test_case_token, 30);
+    writer.put_result(model::test_result(model::test_result_passed),
+                      test_case_token, zero, zero);
+    writer.commit();
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+    store::results_iterator iter = tx.get_results();
+    ATF_REQUIRE(iter);
+    ATF_REQUIRE_EQ("The first line\n"
+                   "\n\n[16 bytes of output omitted; original size was 46 "
+                   "bytes]\n\n"
+                   "\nThe last line\n", iter.stdout_contents());
+    ATF_REQUIRE_EQ("Short\n", iter.stderr_contents());
+    tx.finish();
+}
+
+
+ATF_TEST_CASE(put_test_case_contents);
+ATF_TEST_CASE_HEAD(put_test_case_contents)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_test_case_contents)
+{
+    const model::test_program_ptr test_program = make_test_program(1);
+    const datetime::timestamp zero = datetime::timestamp::from_microseconds(0);
+
+    store::async_writer writer(fs::path("test.db"), 10, lots, never);
+    const int64_t test_case_token = writer.put_test_case(
+        test_program->find("test0"), writer.put_test_program(test_program));
+    writer.put_test_case_contents("__STDOUT__",
+                                  "The first line\n"
+                                  "Some more output\n"
+                                  "The last line\n",
+                                  test_case_token, 30);
+    writer.put_test_case_contents("__STDERR__", "Short\n", test_case_token,
+                                  30);
+    writer.put_result(model::test_result(model::test_result_passed),
+                      test_case_token, zero, zero);
+    writer.commit();
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+    store::results_iterator iter = tx.get_results();
+    ATF_REQUIRE(iter);
+    ATF_REQUIRE_EQ("The first line\n"
+                   "\n\n[16 bytes of output omitted; original size was 46 "
+                   "bytes]\n\n"
+                   "\nThe last line\n", iter.stdout_contents());
+    ATF_REQUIRE_EQ("Short\n", iter.stderr_contents());
+    tx.finish();
+}
+
+
+ATF_TEST_CASE(write_error);
+ATF_TEST_CASE_HEAD(write_error)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(write_error)
+{
+    const model::test_program_ptr test_program = make_test_program(1);
+    const datetime::timestamp zero = datetime::timestamp::from_microseconds(0);
+
+    store::async_writer writer(fs::path("test.db"), 10, lots, never);
+    const int64_t test_case_token = writer.put_test_case(
+        test_program->find("test0"), writer.put_test_program(test_program));
+    writer.put_result(model::test_result(model::test_result_passed),
+                      test_case_token, zero, zero);
+    writer.put_result(model::test_result(model::test_result_failed, "Dup"),
+                      test_case_token, zero, zero);
+    ATF_REQUIRE_THROW_RE(store::error, "test_results", writer.commit());
+    ATF_REQUIRE_THROW_RE(store::error, "test_results",
+                         writer.put_test_program(test_program));
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT COUNT(*) FROM test_cases");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(0, stmt.column_int(0));
+}
+
+
+ATF_TEST_CASE(put__many_tests);
+ATF_TEST_CASE_HEAD(put__many_tests)
+{
+    logging::set_inmemory();
+    set_md_var("descr", "Stores the results of lots of test cases, as kyua "
+               "test does, and reports the average time the caller is "
+               "blocked per test case");
+    set_md_var("require.files", store::detail::schema_file().c_str());
+    set_md_var("timeout", "300");
+}
+ATF_TEST_CASE_BODY(put__many_tests)
+{
+    utils::require_run_benchmarks(this);
+
+    const int num_tests = 5000;
+
+    const model::test_program_ptr test_program = make_test_program(num_tests);
+    atf::utils::create_file("stdout.txt", "Some output of the test\n");
+    const model::test_result result(model::test_result_failed, "Some reason");
+    const datetime::timestamp zero = datetime::timestamp::from_microseconds(0);
+
+    // Make the queue big enough to never block so that we measure the cost
+    // of queuing the writes, which is what the caller pays.
+    store::async_writer writer(fs::path("test.db"), 3 * num_tests + 1, 1000,
+                               datetime::delta(5, 0));
+    const int64_t test_program_token = writer.put_test_program(test_program);
+
+    const datetime::timestamp start = datetime::timestamp::now();
+    for (int i = 0; i < num_tests; ++i) {
+        const int64_t test_case_token = writer.put_test_case(
+            test_program->find(F("test%s") % i), test_program_token);
+        writer.put_test_case_file("__STDOUT__", fs::path("stdout.txt"),
+                                  test_case_token);
+        writer.put_result(result, test_case_token, zero, zero);
+    }
+    const datetime::timestamp end = datetime::timestamp::now();
+    writer.commit();
+    const datetime::timestamp flushed = datetime::timestamp::now();
+
+    std::cout << F("Queued %s test cases at %sus per test case; flushed in "
+                   "%sus\n") %
+        num_tests % ((end - start).to_microseconds() / num_tests) %
+        (flushed - end).to_microseconds();
+
+    ATF_REQUIRE_EQ(num_tests, count_results(fs::path("test.db")));
+}
+
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    ATF_ADD_TEST_CASE(tcs, put_and_commit);
+    ATF_ADD_TEST_CASE(tcs, commit__reusable);
+    ATF_ADD_TEST_CASE(tcs, periodic_commits__time);
+    ATF_ADD_TEST_CASE(tcs, periodic_commits__writes);
+    ATF_ADD_TEST_CASE(tcs, put_run_status);
+    ATF_ADD_TEST_CASE(tcs, destructor__commits);
+    ATF_ADD_TEST_CASE(tcs, put_test_case_file__missing);
+    ATF_ADD_TEST_CASE(tcs, put_test_case_file__large_deleted);
+    ATF_ADD_TEST_CASE(tcs, put_test_case_file__truncated);
+    ATF_ADD_TEST_CASE(tcs, put_test_case_contents);
+    ATF_ADD_TEST_CASE(tcs, write_error);
+
+    ATF_ADD_TEST_CASE(tcs, put__many_tests);
+}
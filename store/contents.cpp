@@ -0,0 +1,589 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "store/contents.hpp"
+
+#if defined(HAVE_CONFIG_H)
+#   include "config.h"
+#endif
+
+#if defined(HAVE_ZLIB)
+extern "C" {
+#   include <zlib.h>
+}
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#include "store/exceptions.hpp"
+#include "utils/format/macros.hpp"
+#include "utils/sanity.hpp"
+
+
+/// Codec for contents that are stored verbatim.
+const char* const store::codec_none = "none";
+
+
+/// Codec for contents compressed with zlib's deflate algorithm.
+const char* const store::codec_zlib = "zlib";
+
+
+namespace {
+
+
+#if defined(HAVE_ZLIB)
+/// Minimum size of the contents worth compressing.
+///
+/// Tiny files barely shrink, if at all, and are not worth the cost of setting
+/// up a zlib stream.
+static const std::size_t min_compressed_size = 128;
+#endif
+
+
+}  // anonymous namespace
+
+
+/// Internal implementation of the codec_stream.
+struct store::codec_stream::impl : utils::noncopyable {
+    /// Whether the stream uses zlib or stores the contents verbatim.
+    bool zlib;
+
+    /// Whether the stream encodes or decodes the contents.
+    bool encode;
+
+    /// Input that has not been processed yet.
+    const char* input;
+
+    /// Length of the input that has not been processed yet.
+    std::size_t input_length;
+
+    /// Whether all the output has been produced.
+    bool finished;
+
+#if defined(HAVE_ZLIB)
+    /// The zlib stream, if zlib is true.
+    ::z_stream stream;
+#endif
+
+    /// Constructor.
+    ///
+    /// \param codec The name of the codec to use.
+    /// \param encode_ Whether to encode or decode the contents.
+    ///
+    /// \throw integrity_error If the codec is unknown or unsupported.
+    impl(const std::string& codec, const bool encode_) :
+        zlib(false),
+        encode(encode_),
+        input(NULL),
+        input_length(0),
+        finished(false)
+    {
+        if (codec == codec_none) {
+            // Nothing to do.
+        } else if (codec == codec_zlib) {
+#if defined(HAVE_ZLIB)
+            std::memset(&stream, 0, sizeof(stream));
+            const int error = encode ?
+                ::deflateInit(&stream, Z_DEFAULT_COMPRESSION) :
+                ::inflateInit(&stream);
+            if (error != Z_OK)
+                throw store::error("Cannot initialize zlib stream");
+            zlib = true;
+#else
+            throw integrity_error("Cannot decode file contents compressed "
+                                  "with zlib; Kyua was built without zlib "
+                                  "support");
+#endif
+        } else {
+            throw integrity_error(F("Unknown codec '%s' for file contents") %
+                                  codec);
+        }
+    }
+
+    /// Destructor.
+    ~impl(void)
+    {
+#if defined(HAVE_ZLIB)
+        if (zlib) {
+            if (encode)
+                ::deflateEnd(&stream);
+            else
+                ::inflateEnd(&stream);
+        }
+#endif
+    }
+
+#if defined(HAVE_ZLIB)
+    /// Runs the zlib stream on the pending input.
+    ///
+    /// \param buffer Memory into which to store the output.
+    /// \param size Size of the buffer.
+    /// \param last Whether there will be no more input.
+    ///
+    /// \return The number of bytes stored in the buffer.
+    ///
+    /// \throw integrity_error If the contents being decoded are invalid.
+    std::size_t
+    process_zlib(void* buffer, const std::size_t size, const bool last)
+    {
+        stream.next_in = reinterpret_cast< Bytef* >(
+            const_cast< char* >(input));
+        stream.avail_in = static_cast< uInt >(input_length);
+        stream.next_out = static_cast< Bytef* >(buffer);
+        stream.avail_out = static_cast< uInt >(size);
+
+        const int status = encode ?
+            ::deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH) :
+            ::inflate(&stream, Z_NO_FLUSH);
+
+        input = reinterpret_cast< const char* >(stream.next_in);
+        input_length = stream.avail_in;
+
+        if (status == Z_STREAM_END) {
+            finished = true;
+        } else if (status == Z_BUF_ERROR) {
+            // No progress was possible, which is only an error if the decoder
+            // will not get any more input.
+            if (!encode && last && input_length == 0)
+                throw integrity_error("Invalid compressed file contents: "
+                                      "truncated");
+        } else if (status != Z_OK) {
+            throw integrity_error(F("Invalid compressed file contents: %s") %
+                                  (stream.msg != NULL ? stream.msg : "error"));
+        }
+        return size - stream.avail_out;
+    }
+#endif
+};
+
+
+/// Constructs a new digester for empty contents.
+store::digester::digester(void) :
+    _hash(14695981039346656037ULL),
+    _length(0)
+{
+}
+
+
+/// Adds a piece of the contents to the digest.
+///
+/// \param data The piece of the contents.
+/// \param size The length of data in bytes.
+void
+store::digester::update(const void* data, const std::size_t size)
+{
+    const unsigned char* bytes = static_cast< const unsigned char* >(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        _hash ^= bytes[i];
+        _hash *= 1099511628211ULL;
+    }
+    _length += size;
+}
+
+
+/// Returns the length of the contents processed so far.
+///
+/// \return A length in bytes.
+std::size_t
+store::digester::length(void) const
+{
+    return _length;
+}
+
+
+/// Returns the digest of the contents processed so far.
+///
+/// \return The digest as a printable string.
+std::string
+store::digester::digest(void) const
+{
+    std::ostringstream digest;
+    digest << std::hex << std::setw(16) << std::setfill('0') << _hash
+           << std::dec << '-' << _length;
+    return digest.str();
+}
+
+
+/// Constructs a new codec stream.
+///
+/// \param codec The name of the codec to use.
+/// \param encode Whether to encode raw contents or to decode encoded ones.
+///
+/// \throw integrity_error If the codec is unknown or unsupported.
+store::codec_stream::codec_stream(const std::string& codec, const bool encode) :
+    _pimpl(new impl(codec, encode))
+{
+}
+
+
+/// Destructor.
+store::codec_stream::~codec_stream(void)
+{
+}
+
+
+/// Provides the next piece of input to the stream.
+///
+/// \pre The previous piece of input must have been consumed.
+///
+/// \param data The piece of input.  This memory must remain valid until the
+///     stream has consumed it.
+/// \param size The length of data in bytes.
+void
+store::codec_stream::feed(const void* data, const std::size_t size)
+{
+    PRE(needs_input());
+    _pimpl->input = static_cast< const char* >(data);
+    _pimpl->input_length = size;
+}
+
+
+/// Checks whether the stream has consumed all of its input.
+///
+/// \return True if the caller should feed() more input.
+bool
+store::codec_stream::needs_input(void) const
+{
+    return _pimpl->input_length == 0;
+}
+
+
+/// Produces the next piece of output.
+///
+/// \param buffer Memory into which to store the output.
+/// \param size Size of the buffer.
+/// \param last Whether there will be no more input after the current one.
+///     The caller must keep calling this with last set to true until
+///     finished() returns true to get all the output.
+///
+/// \return The number of bytes stored in the buffer, which may be zero if the
+/// stream needs more input.
+///
+/// \throw integrity_error If the contents being decoded are invalid.
+std::size_t
+store::codec_stream::process(void* buffer, const std::size_t size,
+                             const bool last)
+{
+    PRE(size > 0);
+    if (_pimpl->finished)
+        return 0;
+#if defined(HAVE_ZLIB)
+    if (_pimpl->zlib)
+        return _pimpl->process_zlib(buffer, size, last);
+#endif
+    const std::size_t length = std::min(size, _pimpl->input_length);
+    std::memcpy(buffer, _pimpl->input, length);
+    _pimpl->input += length;
+    _pimpl->input_length -= length;
+    if (last && _pimpl->input_length == 0)
+        _pimpl->finished = true;
+    return length;
+}
+
+
+/// Checks whether the stream has produced all of its output.
+///
+/// \return True if the stream is done.
+bool
+store::codec_stream::finished(void) const
+{
+    return _pimpl->finished;
+}
+
+
+/// Buffer that reads the retained parts of a truncated stream.
+///
+/// Offsets in this buffer refer to the truncated view of the stream, which is
+/// made of the head of the underlying stream, the truncation note and the tail
+/// of the underlying stream.
+class store::truncated_istream::buffer : public std::streambuf,
+                                         utils::noncopyable {
+    /// Size of the pieces in which the underlying stream is read.
+    static const std::size_t chunk_size = 64 * 1024;
+
+    /// The underlying stream.
+    std::istream& _input;
+
+    /// Length of the head of the underlying stream to retain.
+    const std::size_t _head_length;
+
+    /// Note that replaces the omitted part of the underlying stream.
+    const std::string _note;
+
+    /// Offset of the retained tail within the underlying stream.
+    const std::size_t _tail_offset;
+
+    /// Length of the truncated view of the stream.
+    const std::size_t _length;
+
+    /// Offset of the end of the current piece within the truncated view.
+    std::size_t _offset;
+
+    /// Piece of the truncated view made available to the reader.
+    char _buffer[chunk_size];
+
+    /// Reads a piece of the underlying stream into the buffer.
+    ///
+    /// \param offset Offset of the piece within the underlying stream.
+    /// \param length Length of the piece.
+    ///
+    /// \return The number of bytes read, which is smaller than length if the
+    /// underlying stream is shorter than expected.
+    std::size_t
+    read_input(const std::size_t offset, const std::size_t length)
+    {
+        _input.clear();
+        _input.seekg(offset, std::ios::beg);
+        _input.read(_buffer, length);
+        return _input.gcount();
+    }
+
+protected:
+    /// Fetches the next piece of the truncated view.
+    ///
+    /// \return The next character in the view, or EOF if there are no more.
+    int_type
+    underflow(void)
+    {
+        if (_offset >= _length)
+            return traits_type::eof();
+
+        std::size_t length;
+        if (_offset < _head_length) {
+            length = read_input(
+                _offset, std::min(chunk_size, _head_length - _offset));
+        } else if (_offset < _head_length + _note.length()) {
+            const std::size_t start = _offset - _head_length;
+            length = std::min(chunk_size, _note.length() - start);
+            std::memcpy(_buffer, _note.data() + start, length);
+        } else {
+            const std::size_t start = _offset - _head_length - _note.length();
+            length = read_input(_tail_offset + start,
+                                std::min(chunk_size, _length - _offset));
+        }
+        if (length == 0)
+            return traits_type::eof();
+
+        setg(_buffer, _buffer, _buffer + length);
+        _offset += length;
+        return traits_type::to_int_type(_buffer[0]);
+    }
+
+    /// Moves the read position within the truncated view.
+    ///
+    /// \param off The offset to move to, relative to dir.
+    /// \param dir The position off is relative to.
+    /// \param which The positions to move; only the input one is supported.
+    ///
+    /// \return The new position, or -1 if it is out of the view.
+    pos_type
+    seekoff(off_type off, std::ios_base::seekdir dir,
+            std::ios_base::openmode which = std::ios_base::in)
+    {
+        if (!(which & std::ios_base::in))
+            return pos_type(off_type(-1));
+
+        off_type base;
+        if (dir == std::ios_base::beg)
+            base = 0;
+        else if (dir == std::ios_base::cur)
+            base = _offset - (egptr() - gptr());
+        else
+            base = _length;
+        const off_type position = base + off;
+        if (position < 0 || position > static_cast< off_type >(_length))
+            return pos_type(off_type(-1));
+
+        _offset = position;
+        setg(_buffer, _buffer, _buffer);
+        return pos_type(position);
+    }
+
+    /// Moves the read position within the truncated view.
+    ///
+    /// \param pos The absolute position to move to.
+    /// \param which The positions to move; only the input one is supported.
+    ///
+    /// \return The new position, or -1 if it is out of the view.
+    pos_type
+    seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in)
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
+public:
+    /// Constructor.
+    ///
+    /// \param input The underlying stream.
+    /// \param head_length Length of the head of the stream to retain.
+    /// \param note Note that replaces the omitted part of the stream.
+    /// \param tail_offset Offset of the tail of the stream to retain.
+    /// \param length Length of the underlying stream.
+    buffer(std::istream& input, const std::size_t head_length,
+           const std::string& note, const std::size_t tail_offset,
+           const std::size_t length) :
+        _input(input),
+        _head_length(head_length),
+        _note(note),
+        _tail_offset(tail_offset),
+        _length(head_length + note.length() + (length - tail_offset)),
+        _offset(0)
+    {
+        setg(_buffer, _buffer, _buffer);
+    }
+};
+
+
+/// Constructor.
+///
+/// \pre The stream must be longer than the maximum length.
+///
+/// \param input The stream to truncate.  Must be seekable and must outlive this
+///     object.
+/// \param length The length of the stream.
+/// \param max_length Maximum length of the contents of the stream to retain,
+///     half of which comes from its beginning and half from its end.
+store::truncated_istream::truncated_istream(std::istream& input,
+                                            const std::size_t length,
+                                            const std::size_t max_length) :
+    std::istream(NULL)
+{
+    PRE(length > max_length);
+
+    const std::size_t tail_length = max_length / 2;
+    const std::size_t head_length = max_length - tail_length;
+    const std::string note = F("\n\n[%s bytes of output omitted; original "
+                               "size was %s bytes]\n\n") %
+        (length - max_length) % length;
+    _buffer.reset(new buffer(input, head_length, note, length - tail_length,
+                             length));
+    rdbuf(_buffer.get());
+}
+
+
+/// Destructor.
+store::truncated_istream::~truncated_istream(void)
+{
+}
+
+
+/// Computes the digest that identifies some contents.
+///
+/// The digest is the 64-bit FNV-1a hash of the contents followed by their
+/// length.  This is not a cryptographic hash, so callers must compare the
+/// contents of two files with the same digest before treating them as
+/// identical.
+///
+/// \param contents The raw contents to digest.
+///
+/// \return The digest as a printable string.
+std::string
+store::digest_contents(const std::string& contents)
+{
+    digester digester;
+    digester.update(contents.data(), contents.length());
+    return digester.digest();
+}
+
+
+/// Selects the codec with which to try to encode some contents.
+///
+/// Contents are compressed with zlib if Kyua was built with it, unless they
+/// are too small to be worth it.  The caller should still store the contents
+/// verbatim if compressing them does not make them smaller.
+///
+/// \param length The length of the raw contents.
+///
+/// \return The name of a codec.
+const char*
+store::preferred_codec(const std::size_t length)
+{
+#if defined(HAVE_ZLIB)
+    if (length >= min_compressed_size)
+        return codec_zlib;
+#else
+    (void)length;
+#endif
+    return codec_none;
+}
+
+
+/// Encodes some contents for storage in the database.
+///
+/// \param contents The raw contents to encode.
+///
+/// \return A pair with the name of the codec used and the encoded contents.
+std::pair< std::string, std::string >
+store::encode_contents(const std::string& contents)
+{
+    const std::string codec = preferred_codec(contents.length());
+    if (codec != codec_none) {
+        codec_stream encoder(codec, true);
+        encoder.feed(contents.data(), contents.length());
+
+        std::string encoded;
+        char buffer[16 * 1024];
+        while (!encoder.finished() && encoded.length() < contents.length())
+            encoded.append(buffer, encoder.process(buffer, sizeof(buffer),
+                                                   true));
+        if (encoded.length() < contents.length())
+            return std::make_pair(codec, encoded);
+    }
+    return std::make_pair(std::string(codec_none), contents);
+}
+
+
+/// Decodes some contents stored in the database.
+///
+/// \param codec The name of the codec with which the contents were encoded.
+/// \param data The encoded contents.
+/// \param size The length of data in bytes.
+///
+/// \return The raw contents.
+///
+/// \throw integrity_error If the codec is unknown or unsupported, or if the
+///     encoded contents are invalid.
+std::string
+store::decode_contents(const std::string& codec, const void* data,
+                       const std::size_t size)
+{
+    if (codec == codec_none)
+        return std::string(static_cast< const char* >(data), size);
+
+    codec_stream decoder(codec, false);
+    decoder.feed(data, size);
+
+    std::string contents;
+    char buffer[64 * 1024];
+    while (!decoder.finished())
+        contents.append(buffer, decoder.process(buffer, sizeof(buffer), true));
+    return contents;
+}
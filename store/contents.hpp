@@ -0,0 +1,132 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/// \file store/contents.hpp
+/// Functions to encode the contents of files stored in the database.
+///
+/// Files are content-addressed by a digest of their raw contents and may be
+/// compressed before being stored, in which case the codec used to encode them
+/// is recorded along the encoded contents.
+///
+/// These helper functions are only provided to help in the implementation of
+/// other modules.  Therefore, this header file should never be included from
+/// other header files.
+
+#if defined(STORE_CONTENTS_HPP)
+#   error "Do not include contents.hpp multiple times"
+#endif  // !defined(STORE_CONTENTS_HPP)
+#define STORE_CONTENTS_HPP
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+#include <utility>
+
+extern "C" {
+#include <stdint.h>
+}
+
+#include "utils/noncopyable.hpp"
+
+namespace store {
+
+
+/// Codec for contents that are stored verbatim.
+extern const char* const codec_none;
+
+/// Codec for contents compressed with zlib's deflate algorithm.
+extern const char* const codec_zlib;
+
+
+/// Incremental computation of the digest of some contents.
+///
+/// This yields the same digest as digest_contents() for the concatenation of
+/// all the pieces passed to update().
+class digester {
+    /// The hash of the contents processed so far.
+    uint64_t _hash;
+
+    /// The length of the contents processed so far.
+    std::size_t _length;
+
+public:
+    digester(void);
+
+    void update(const void*, const std::size_t);
+    std::size_t length(void) const;
+    std::string digest(void) const;
+};
+
+
+/// Incremental encoder or decoder of contents.
+///
+/// The caller provides the input in pieces with feed() and extracts the
+/// output in pieces with process(), so that neither the raw nor the encoded
+/// contents have to be held in memory at once.
+class codec_stream : utils::noncopyable {
+    struct impl;
+
+    /// Pointer to the internal implementation.
+    std::auto_ptr< impl > _pimpl;
+
+public:
+    codec_stream(const std::string&, const bool);
+    ~codec_stream(void);
+
+    void feed(const void*, const std::size_t);
+    bool needs_input(void) const;
+    std::size_t process(void*, const std::size_t, const bool);
+    bool finished(void) const;
+};
+
+
+/// Input stream that only yields the beginning and the end of another stream.
+///
+/// The omitted middle of the stream is replaced by a note that records the
+/// original length of the stream.  The underlying stream is read on demand, so
+/// it is never loaded into memory, and the truncated stream can be rewound.
+class truncated_istream : public std::istream, utils::noncopyable {
+    class buffer;
+
+    /// The buffer that reads the retained parts of the stream.
+    std::auto_ptr< buffer > _buffer;
+
+public:
+    truncated_istream(std::istream&, const std::size_t, const std::size_t);
+    ~truncated_istream(void);
+};
+
+
+std::string digest_contents(const std::string&);
+const char* preferred_codec(const std::size_t);
+std::pair< std::string, std::string > encode_contents(const std::string&);
+std::string decode_contents(const std::string&, const void*, const std::size_t);
+
+
+}  // namespace store
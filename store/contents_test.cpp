@@ -0,0 +1,280 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "store/contents.hpp"
+
+#if defined(HAVE_CONFIG_H)
+#   include "config.h"
+#endif
+
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include <atf-c++.hpp>
+
+#include "store/exceptions.hpp"
+#include "utils/format/macros.hpp"
+#include "utils/stream.hpp"
+
+
+namespace {
+
+
+/// Generates contents that compress well.
+///
+/// \return A long string with many repetitions.
+static std::string
+compressible_contents(void)
+{
+    std::string contents;
+    for (int i = 0; i < 1000; ++i)
+        contents += "This is a line of output that repeats a lot\n";
+    return contents;
+}
+
+
+/// Encodes and decodes some contents and checks that they are unchanged.
+///
+/// \param contents The raw contents to process.
+///
+/// \return The codec with which the contents were encoded.
+static std::string
+do_round_trip(const std::string& contents)
+{
+    const std::pair< std::string, std::string > encoded =
+        store::encode_contents(contents);
+    ATF_REQUIRE_EQ(contents, store::decode_contents(
+        encoded.first, encoded.second.data(), encoded.second.length()));
+    return encoded.first;
+}
+
+
+}  // anonymous namespace
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(digest_contents__stable);
+ATF_TEST_CASE_BODY(digest_contents__stable)
+{
+    ATF_REQUIRE_EQ("cbf29ce484222325-0", store::digest_contents(""));
+    ATF_REQUIRE_EQ(store::digest_contents("foo bar"),
+                   store::digest_contents("foo bar"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(digest_contents__different);
+ATF_TEST_CASE_BODY(digest_contents__different)
+{
+    ATF_REQUIRE(store::digest_contents("foo") !=
+                store::digest_contents("bar"));
+    ATF_REQUIRE(store::digest_contents("foo") !=
+                store::digest_contents(std::string("foo\0", 4)));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(digester__incremental);
+ATF_TEST_CASE_BODY(digester__incremental)
+{
+    store::digester digester;
+    ATF_REQUIRE_EQ(store::digest_contents(""), digester.digest());
+    digester.update("foo ", 4);
+    digester.update("", 0);
+    digester.update("bar", 3);
+    ATF_REQUIRE_EQ(7, digester.length());
+    ATF_REQUIRE_EQ(store::digest_contents("foo bar"), digester.digest());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(encode_contents__small);
+ATF_TEST_CASE_BODY(encode_contents__small)
+{
+    const std::pair< std::string, std::string > encoded =
+        store::encode_contents("Some short output\n");
+    ATF_REQUIRE_EQ(store::codec_none, encoded.first);
+    ATF_REQUIRE_EQ("Some short output\n", encoded.second);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(encode_contents__compressible);
+ATF_TEST_CASE_BODY(encode_contents__compressible)
+{
+    const std::string contents = compressible_contents();
+    const std::pair< std::string, std::string > encoded =
+        store::encode_contents(contents);
+#if defined(HAVE_ZLIB)
+    ATF_REQUIRE_EQ(store::codec_zlib, encoded.first);
+    ATF_REQUIRE(encoded.second.length() < contents.length() / 10);
+#else
+    ATF_REQUIRE_EQ(store::codec_none, encoded.first);
+    ATF_REQUIRE_EQ(contents, encoded.second);
+#endif
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(round_trip);
+ATF_TEST_CASE_BODY(round_trip)
+{
+    do_round_trip("");
+    do_round_trip(std::string("binary\0data\xff", 12));
+    do_round_trip(compressible_contents());
+
+    std::string random;
+    unsigned int seed = 1;
+    for (int i = 0; i < 4096; ++i) {
+        seed = seed * 1103515245 + 12345;
+        random += static_cast< char >(seed >> 16);
+    }
+    ATF_REQUIRE_EQ(store::codec_none, do_round_trip(random));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(codec_stream__pieces);
+ATF_TEST_CASE_BODY(codec_stream__pieces)
+{
+    const std::string contents = compressible_contents();
+    const std::string codec = store::preferred_codec(contents.length());
+
+    std::string encoded;
+    {
+        store::codec_stream encoder(codec, true);
+        char buffer[7];
+        for (std::string::size_type i = 0; i < contents.length(); i += 100) {
+            const std::string piece = contents.substr(i, 100);
+            encoder.feed(piece.data(), piece.length());
+            while (!encoder.needs_input())
+                encoded.append(buffer, encoder.process(buffer, sizeof(buffer),
+                                                       false));
+        }
+        while (!encoder.finished())
+            encoded.append(buffer, encoder.process(buffer, sizeof(buffer),
+                                                   true));
+    }
+    ATF_REQUIRE_EQ(store::encode_contents(contents).second, encoded);
+
+    std::string decoded;
+    {
+        store::codec_stream decoder(codec, false);
+        char buffer[13];
+        for (std::string::size_type i = 0; i < encoded.length(); i += 5) {
+            const std::string piece = encoded.substr(i, 5);
+            decoder.feed(piece.data(), piece.length());
+            const bool last = i + 5 >= encoded.length();
+            while (!decoder.needs_input() || (last && !decoder.finished()))
+                decoded.append(buffer, decoder.process(buffer, sizeof(buffer),
+                                                       last));
+        }
+    }
+    ATF_REQUIRE_EQ(contents, decoded);
+}
+
+
+#if defined(HAVE_ZLIB)
+ATF_TEST_CASE_WITHOUT_HEAD(codec_stream__truncated);
+ATF_TEST_CASE_BODY(codec_stream__truncated)
+{
+    const std::string encoded = store::encode_contents(
+        compressible_contents()).second;
+
+    store::codec_stream decoder(store::codec_zlib, false);
+    decoder.feed(encoded.data(), encoded.length() / 2);
+    char buffer[1024];
+    ATF_REQUIRE_THROW_RE(store::integrity_error, "truncated",
+                         while (!decoder.finished())
+                             decoder.process(buffer, sizeof(buffer), true));
+}
+#endif
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(truncated_istream__read);
+ATF_TEST_CASE_BODY(truncated_istream__read)
+{
+    std::istringstream input("0123456789abcdefghij");
+    store::truncated_istream truncated(input, 20, 7);
+    ATF_REQUIRE_EQ("0123\n\n[13 bytes of output omitted; original size was 20 "
+                   "bytes]\n\nhij", utils::read_stream(truncated));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(truncated_istream__large);
+ATF_TEST_CASE_BODY(truncated_istream__large)
+{
+    std::string contents;
+    for (int i = 0; contents.length() < 1024 * 1024; ++i)
+        contents += F("Line %s\n") % i;
+    const std::size_t max_length = 300 * 1024;
+    std::istringstream input(contents);
+    store::truncated_istream truncated(input, contents.length(), max_length);
+
+    const std::string note = F("\n\n[%s bytes of output omitted; original "
+                               "size was %s bytes]\n\n") %
+        (contents.length() - max_length) % contents.length();
+    const std::string expected =
+        contents.substr(0, max_length / 2) + note +
+        contents.substr(contents.length() - max_length / 2);
+    ATF_REQUIRE_EQ(expected.length(), utils::stream_length(truncated));
+    ATF_REQUIRE(expected == utils::read_stream(truncated));
+
+    truncated.clear();
+    truncated.seekg(0, std::ios::beg);
+    ATF_REQUIRE(expected == utils::read_stream(truncated));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(decode_contents__unknown_codec);
+ATF_TEST_CASE_BODY(decode_contents__unknown_codec)
+{
+    ATF_REQUIRE_THROW_RE(store::integrity_error, "Unknown codec 'foo'",
+                         store::decode_contents("foo", "abc", 3));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(decode_contents__invalid_zlib);
+ATF_TEST_CASE_BODY(decode_contents__invalid_zlib)
+{
+    ATF_REQUIRE_THROW(store::integrity_error,
+                      store::decode_contents(store::codec_zlib, "abc", 3));
+}
+
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    ATF_ADD_TEST_CASE(tcs, digest_contents__stable);
+    ATF_ADD_TEST_CASE(tcs, digest_contents__different);
+    ATF_ADD_TEST_CASE(tcs, digester__incremental);
+    ATF_ADD_TEST_CASE(tcs, encode_contents__small);
+    ATF_ADD_TEST_CASE(tcs, encode_contents__compressible);
+    ATF_ADD_TEST_CASE(tcs, round_trip);
+    ATF_ADD_TEST_CASE(tcs, codec_stream__pieces);
+#if defined(HAVE_ZLIB)
+    ATF_ADD_TEST_CASE(tcs, codec_stream__truncated);
+#endif
+    ATF_ADD_TEST_CASE(tcs, truncated_istream__read);
+    ATF_ADD_TEST_CASE(tcs, truncated_istream__large);
+    ATF_ADD_TEST_CASE(tcs, decode_contents__unknown_codec);
+    ATF_ADD_TEST_CASE(tcs, decode_contents__invalid_zlib);
+}
@@ -244,6 +244,19 @@ layout::query_store_dir(void)
 }
 
 
+/// Gets the path to the directory holding the cache of test case lists.
+///
+/// Note that this function does not create the determined directory.  It is the
+/// responsibility of the caller to do so.
+///
+/// \return Path to the directory holding the cached listings of test programs.
+fs::path
+layout::query_list_cache_dir(void)
+{
+    return query_store_dir() / "lists";
+}
+
+
 /// Returns the test suite name for the current directory.
 ///
 /// \return The identifier of the current test suite.
@@ -0,0 +1,540 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "store/list_cache.hpp"
+
+#if defined(HAVE_CONFIG_H)
+#   include "config.h"
+#endif
+
+extern "C" {
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+}
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "utils/auto_array.ipp"
+#include "utils/format/macros.hpp"
+#include "utils/fs/exceptions.hpp"
+#include "utils/fs/operations.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/logging/macros.hpp"
+#include "utils/noncopyable.hpp"
+#include "utils/optional.ipp"
+#include "utils/sanity.hpp"
+#include "utils/stream.hpp"
+#include "utils/text/exceptions.hpp"
+#include "utils/text/operations.ipp"
+
+namespace config = utils::config;
+namespace fs = utils::fs;
+namespace text = utils::text;
+
+using utils::none;
+using utils::optional;
+
+
+namespace {
+
+
+/// Basename of the file holding the full key of a cache entry.
+static const char* key_name = "key";
+
+
+/// Basename of the file holding the exit status of a cached listing.
+static const char* status_name = "status";
+
+
+/// Basename of the file holding the stdout of a cached listing.
+static const char* stdout_name = "stdout.txt";
+
+
+/// Basename of the file holding the stderr of a cached listing.
+static const char* stderr_name = "stderr.txt";
+
+
+/// Computes the name of a test program listing.
+///
+/// The name does not depend on the contents of the binary so that rebuilding
+/// a test program replaces its cache entry instead of creating a new one.
+///
+/// \param binary Absolute path to the test program binary.
+/// \param interface_name Name of the interface used to list the test program.
+/// \param vars Configuration variables passed to the test program.
+///
+/// \return The textual representation of the name.
+static std::string
+compute_name(const fs::path& binary, const std::string& interface_name,
+             const config::properties_map& vars)
+{
+    std::ostringstream name;
+    name << "binary=" << binary.str() << '\n'
+         << "interface=" << interface_name << '\n';
+    for (config::properties_map::const_iterator iter = vars.begin();
+         iter != vars.end(); ++iter) {
+        name << "var." << (*iter).first << '=' << (*iter).second << '\n';
+    }
+    return name.str();
+}
+
+
+/// Computes the identity of a test program listing.
+///
+/// \param name The name of the listing, as returned by compute_name().
+/// \param binary Absolute path to the test program binary.
+///
+/// \return The textual representation of the key, or none if the binary cannot
+/// be queried, in which case the listing must not be cached.
+static optional< std::string >
+compute_key(const std::string& name, const fs::path& binary)
+{
+    struct ::stat sb;
+    if (::stat(binary.c_str(), &sb) == -1) {
+        const int original_errno = errno;
+        LD(F("Cannot stat %s: %s; not caching its test cases list") % binary %
+           std::strerror(original_errno));
+        return none;
+    }
+
+    // Binaries can be rebuilt more than once per second, so use the most
+    // precise timestamps available to tell their versions apart.
+    std::ostringstream key;
+    key << name
+        << "identity=" << sb.st_dev << ':' << sb.st_ino << ':' << sb.st_size
+#if defined(HAVE_STRUCT_STAT_ST_MTIM)
+        << ':' << sb.st_mtim.tv_sec << '.' << sb.st_mtim.tv_nsec
+        << ':' << sb.st_ctim.tv_sec << '.' << sb.st_ctim.tv_nsec
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+        << ':' << sb.st_mtimespec.tv_sec << '.' << sb.st_mtimespec.tv_nsec
+        << ':' << sb.st_ctimespec.tv_sec << '.' << sb.st_ctimespec.tv_nsec
+#else
+        << ':' << sb.st_mtime << ':' << sb.st_ctime
+#endif
+        << '\n';
+    return utils::make_optional(key.str());
+}
+
+
+/// Computes the basename of the cache entry for a listing.
+///
+/// This uses the 64-bit FNV-1a hash of the name of the listing, which is
+/// stable across platforms and program invocations.  Collisions are harmless
+/// because the full key is stored in the entry and validated on lookup.
+///
+/// \param name The name of the listing, as returned by compute_name().
+///
+/// \return The basename of the entry within the cache directory.
+static std::string
+entry_name(const std::string& name)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    for (std::string::const_iterator iter = name.begin(); iter != name.end();
+         ++iter) {
+        hash ^= static_cast< unsigned char >(*iter);
+        hash *= 1099511628211ULL;
+    }
+
+    std::ostringstream basename;
+    basename << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return basename.str();
+}
+
+
+/// Creates a new temporary directory within the cache directory.
+///
+/// \param directory Path to the cache directory.
+///
+/// \return The path to the new directory.
+///
+/// \throw fs::system_error If the directory cannot be created.
+static fs::path
+create_temp_entry(const fs::path& directory)
+{
+    const std::string temp_template = (directory / "tmp.XXXXXX").str();
+    utils::auto_array< char > buf(new char[temp_template.length() + 1]);
+    std::strcpy(buf.get(), temp_template.c_str());
+    if (::mkdtemp(buf.get()) == NULL) {
+        const int original_errno = errno;
+        throw fs::system_error(F("Cannot create temporary directory using "
+                                 "template %s") % temp_template,
+                               original_errno);
+    }
+    return fs::path(buf.get());
+}
+
+
+/// Reads a file within a directory.
+///
+/// \param dir_fd Descriptor of the directory containing the file.
+/// \param name Basename of the file.
+///
+/// \return The contents of the file.
+///
+/// \throw fs::system_error If the file cannot be read.
+static std::string
+read_file_at(const int dir_fd, const char* name)
+{
+    const int fd = ::openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        const int original_errno = errno;
+        throw fs::system_error(F("Cannot open %s") % name, original_errno);
+    }
+
+    std::string contents;
+    char buffer[4096];
+    ssize_t length;
+    while ((length = ::read(fd, buffer, sizeof(buffer))) != 0) {
+        if (length == -1) {
+            const int original_errno = errno;
+            if (original_errno == EINTR)
+                continue;
+            ::close(fd);
+            throw fs::system_error(F("Cannot read %s") % name,
+                                   original_errno);
+        }
+        contents.append(buffer, length);
+    }
+    ::close(fd);
+    return contents;
+}
+
+
+/// Writes a new file.
+///
+/// \param file Path to the file to create.
+/// \param contents The contents of the file.
+///
+/// \throw std::runtime_error If the file cannot be written.
+static void
+write_file(const fs::path& file, const std::string& contents)
+{
+    std::ofstream output(file.c_str(), std::ios::binary);
+    output << contents;
+    if (!output)
+        throw std::runtime_error(F("Failed to write %s") % file);
+}
+
+
+/// Removes a cache entry ignoring any errors.
+///
+/// \param entry Path to the entry to remove.
+static void
+remove_entry(const fs::path& entry)
+{
+    try {
+        fs::rm_r(entry);
+    } catch (const fs::error& e) {
+        LW(F("Failed to remove cache entry %s: %s") % entry % e.what());
+    }
+}
+
+
+}  // anonymous namespace
+
+
+/// Constructor.
+///
+/// \param exit_status_ Exit code of the listing subprocess.
+/// \param directory_ Directory holding the copy of the outputs of the
+///     listing.  Ownership of the directory and its contents is taken.
+store::cached_list::cached_list(const int exit_status_,
+                                const fs::path& directory_) :
+    _exit_status(exit_status_),
+    _directory(directory_),
+    _stdout_file(directory_ / stdout_name),
+    _stderr_file(directory_ / stderr_name)
+{
+}
+
+
+/// Returns the exit code of the listing subprocess.
+///
+/// \return An exit code.
+int
+store::cached_list::exit_status(void) const
+{
+    return _exit_status;
+}
+
+
+/// Returns the path to the file containing the stdout of the listing.
+///
+/// \return A path that remains valid while this object is alive.
+const fs::path&
+store::cached_list::stdout_file(void) const
+{
+    return _stdout_file.file();
+}
+
+
+/// Returns the path to the file containing the stderr of the listing.
+///
+/// \return A path that remains valid while this object is alive.
+const fs::path&
+store::cached_list::stderr_file(void) const
+{
+    return _stderr_file.file();
+}
+
+
+/// Internal implementation for the list_cache.
+struct store::list_cache::impl : utils::noncopyable {
+    /// Path to the directory holding the cache entries.
+    fs::path directory;
+
+    /// Number of successful lookups.
+    std::size_t hits;
+
+    /// Number of failed lookups.
+    std::size_t misses;
+
+    /// Constructor.
+    ///
+    /// \param directory_ Path to the directory holding the cache entries.
+    impl(const fs::path& directory_) :
+        directory(directory_), hits(0), misses(0)
+    {
+    }
+
+    /// Destructor.
+    ~impl(void)
+    {
+        LI(F("Test cases list cache: %s hits, %s misses") % hits % misses);
+    }
+};
+
+
+/// Constructor.
+///
+/// \param directory Path to the directory holding the cache entries.  The
+///     directory is created on demand.
+store::list_cache::list_cache(const fs::path& directory) :
+    _pimpl(new impl(directory))
+{
+}
+
+
+/// Destructor.
+store::list_cache::~list_cache(void)
+{
+}
+
+
+/// Looks up the cached listing of a test program.
+///
+/// All the files of the entry are read through a descriptor to its directory,
+/// so they all come from the same version of the entry even if a concurrent
+/// instance replaces it in the meantime.  The outputs are copied out of the
+/// entry once its key has been validated.
+///
+/// \param binary Absolute path to the test program binary.
+/// \param interface_name Name of the interface used to list the test program.
+/// \param vars Configuration variables passed to the test program.
+///
+/// \return The outputs of the cached listing, or none if there is no valid
+/// entry for the given test program in its current state.
+optional< store::cached_list >
+store::list_cache::lookup(const fs::path& binary,
+                          const std::string& interface_name,
+                          const config::properties_map& vars)
+{
+    const std::string name = compute_name(binary, interface_name, vars);
+    const optional< std::string > key = compute_key(name, binary);
+    if (!key) {
+        _pimpl->misses++;
+        return none;
+    }
+
+    const fs::path entry = _pimpl->directory / entry_name(name);
+    const int dir_fd = ::open(entry.c_str(),
+                              O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd == -1) {
+        LD(F("Test cases list cache miss for %s") % binary);
+        _pimpl->misses++;
+        return none;
+    }
+
+    optional< fs::path > snapshot;
+    try {
+        if (read_file_at(dir_fd, key_name) != key.get()) {
+            // Do not remove the entry: a concurrent instance may have just
+            // replaced it, and storing the new listing replaces it anyway.
+            LD(F("Stale test cases list cache entry for %s") % binary);
+            ::close(dir_fd);
+            _pimpl->misses++;
+            return none;
+        }
+        const int exit_status = text::to_type< int >(
+            read_file_at(dir_fd, status_name));
+
+        snapshot = create_temp_entry(_pimpl->directory);
+        write_file(snapshot.get() / stdout_name,
+                   read_file_at(dir_fd, stdout_name));
+        write_file(snapshot.get() / stderr_name,
+                   read_file_at(dir_fd, stderr_name));
+        ::close(dir_fd);
+
+        LD(F("Test cases list cache hit for %s") % binary);
+        _pimpl->hits++;
+        return utils::make_optional(cached_list(exit_status, snapshot.get()));
+    } catch (const std::runtime_error& e) {
+        ::close(dir_fd);
+        LW(F("Invalid test cases list cache entry %s: %s") % entry % e.what());
+        if (snapshot)
+            remove_entry(snapshot.get());
+        _pimpl->misses++;
+        return none;
+    }
+}
+
+
+/// Records the outputs of a test program listing in the cache.
+///
+/// \param binary Absolute path to the test program binary.
+/// \param interface_name Name of the interface used to list the test program.
+/// \param vars Configuration variables passed to the test program.
+/// \param exit_status Exit code of the listing subprocess.
+/// \param stdout_file Path to the file containing the stdout of the listing.
+///     The file is copied so the caller can delete it afterwards.
+/// \param stderr_file Path to the file containing the stderr of the listing.
+///     The file is copied so the caller can delete it afterwards.
+void
+store::list_cache::put(const fs::path& binary,
+                       const std::string& interface_name,
+                       const config::properties_map& vars,
+                       const int exit_status,
+                       const fs::path& stdout_file,
+                       const fs::path& stderr_file)
+{
+    const std::string name = compute_name(binary, interface_name, vars);
+    const optional< std::string > key = compute_key(name, binary);
+    if (!key)
+        return;
+
+    const fs::path entry = _pimpl->directory / entry_name(name);
+
+    optional< fs::path > temp_entry;
+    try {
+        fs::mkdir_p(_pimpl->directory, 0755);
+
+        temp_entry = create_temp_entry(_pimpl->directory);
+
+        fs::copy(stdout_file, temp_entry.get() / stdout_name);
+        fs::copy(stderr_file, temp_entry.get() / stderr_name);
+        {
+            std::ofstream output((temp_entry.get() / status_name).c_str());
+            output << exit_status;
+        }
+        // The key file must be written last: its presence marks the entry as
+        // complete, although the rename below already guarantees atomicity.
+        {
+            std::ofstream output((temp_entry.get() / key_name).c_str());
+            output << key.get();
+            if (!output)
+                throw std::runtime_error("Failed to write key");
+        }
+
+        if (::rename(temp_entry.get().c_str(), entry.c_str()) == -1) {
+            if (fs::exists(entry / key_name) &&
+                utils::read_file(entry / key_name) == key.get()) {
+                // A concurrent instance populated the same entry.  That's
+                // fine: just discard ours.
+                LD(F("Test cases list cache entry %s already exists") % entry);
+                remove_entry(temp_entry.get());
+            } else {
+                // The entry describes a previous build of the binary.
+                // rename(2) only replaces empty directories, so move the old
+                // entry out of the way first.
+                const fs::path old_entry = create_temp_entry(
+                    _pimpl->directory);
+                if (::rename(entry.c_str(), old_entry.c_str()) == -1 ||
+                    ::rename(temp_entry.get().c_str(), entry.c_str()) == -1) {
+                    const int original_errno = errno;
+                    LD(F("Cannot install test cases list cache entry %s: %s")
+                       % entry % std::strerror(original_errno));
+                    remove_entry(temp_entry.get());
+                }
+                remove_entry(old_entry);
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        LW(F("Failed to cache test cases list of %s: %s") % binary % e.what());
+        if (temp_entry)
+            remove_entry(temp_entry.get());
+    }
+}
+
+
+/// Removes the cached listing of a test program, if any.
+///
+/// This is intended to discard entries whose contents turn out to be invalid
+/// when processed by the caller.
+///
+/// \param binary Absolute path to the test program binary.
+/// \param interface_name Name of the interface used to list the test program.
+/// \param vars Configuration variables passed to the test program.
+void
+store::list_cache::invalidate(const fs::path& binary,
+                              const std::string& interface_name,
+                              const config::properties_map& vars)
+{
+    const fs::path entry = _pimpl->directory / entry_name(
+        compute_name(binary, interface_name, vars));
+    if (fs::exists(entry))
+        remove_entry(entry);
+}
+
+
+/// Returns the number of successful lookups performed on this cache.
+///
+/// \return A counter.
+std::size_t
+store::list_cache::hits(void) const
+{
+    return _pimpl->hits;
+}
+
+
+/// Returns the number of failed lookups performed on this cache.
+///
+/// \return A counter.
+std::size_t
+store::list_cache::misses(void) const
+{
+    return _pimpl->misses;
+}
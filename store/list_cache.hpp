@@ -0,0 +1,125 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/// \file store/list_cache.hpp
+/// Persistent cache of the test case lists of test programs.
+///
+/// Loading the list of test cases of a test program requires executing it,
+/// which is expensive when done for thousands of test programs on every run.
+/// This module remembers the raw outputs of such executions on disk so that
+/// they can be reused for as long as the test program binary does not change.
+///
+/// There is one entry per absolute path of a binary, name of the interface used
+/// to list it and set of configuration variables passed to it.  Each entry also
+/// records the identity of the binary (its device, inode, size and
+/// modification times) and is only reused while the binary keeps that identity;
+/// rebuilding a test program replaces its entry.  Note that other files the
+/// test program depends on, such as the scripts sourced by an interpreted test
+/// program, are not part of this identity.  Each entry is a directory
+/// within the cache directory that is created atomically and read through a
+/// single descriptor, so concurrent instances of Kyua can safely share the
+/// same cache.
+
+#if !defined(STORE_LIST_CACHE_HPP)
+#define STORE_LIST_CACHE_HPP
+
+#include "store/list_cache_fwd.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "utils/config/tree_fwd.hpp"
+#include "utils/fs/auto_cleaners.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/optional_fwd.hpp"
+
+namespace store {
+
+
+/// Representation of the outputs of a cached test program listing.
+///
+/// The outputs are a private copy of those in the cache entry, so they remain
+/// valid even if a concurrent instance replaces the entry.  The copy is
+/// deleted when the last instance of this class goes away.
+class cached_list {
+    /// Exit code of the listing subprocess.
+    int _exit_status;
+
+    /// Directory holding the copy of the outputs.
+    ///
+    /// This must be declared before the files so that it is removed after
+    /// them.
+    utils::fs::auto_directory _directory;
+
+    /// File containing the stdout of the listing.
+    utils::fs::auto_file _stdout_file;
+
+    /// File containing the stderr of the listing.
+    utils::fs::auto_file _stderr_file;
+
+public:
+    cached_list(const int, const utils::fs::path&);
+
+    int exit_status(void) const;
+    const utils::fs::path& stdout_file(void) const;
+    const utils::fs::path& stderr_file(void) const;
+};
+
+
+/// Handle to an on-disk cache of test program listings.
+///
+/// All operations on the cache are best-effort: problems accessing the cache
+/// are logged and result in cache misses, never in errors.
+class list_cache {
+    struct impl;
+
+    /// Pointer to the shared internal implementation.
+    std::shared_ptr< impl > _pimpl;
+
+public:
+    explicit list_cache(const utils::fs::path&);
+    ~list_cache(void);
+
+    utils::optional< cached_list > lookup(
+        const utils::fs::path&, const std::string&,
+        const utils::config::properties_map&);
+    void put(const utils::fs::path&, const std::string&,
+             const utils::config::properties_map&, const int,
+             const utils::fs::path&, const utils::fs::path&);
+    void invalidate(const utils::fs::path&, const std::string&,
+                    const utils::config::properties_map&);
+
+    std::size_t hits(void) const;
+    std::size_t misses(void) const;
+};
+
+
+}  // namespace store
+
+#endif  // !defined(STORE_LIST_CACHE_HPP)
@@ -0,0 +1,364 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "store/list_cache.hpp"
+
+#if defined(HAVE_CONFIG_H)
+#   include "config.h"
+#endif
+
+extern "C" {
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <utime.h>
+}
+
+#include <atf-c++.hpp>
+
+#include "utils/config/tree.ipp"
+#include "utils/fs/directory.hpp"
+#include "utils/fs/operations.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/optional.ipp"
+
+namespace config = utils::config;
+namespace fs = utils::fs;
+
+using utils::optional;
+
+
+namespace {
+
+
+/// Records a fake listing for a test program in a cache.
+///
+/// \param cache The cache in which to record the listing.
+/// \param binary Path to the test program.
+/// \param interface_name Name of the interface of the test program.
+/// \param vars Configuration variables of the test program.
+/// \param contents Contents of the stdout of the fake listing.
+static void
+put_listing(store::list_cache& cache, const fs::path& binary,
+            const std::string& interface_name,
+            const config::properties_map& vars, const std::string& contents)
+{
+    atf::utils::create_file("stdout.txt", contents);
+    atf::utils::create_file("stderr.txt", "some error\n");
+    cache.put(binary, interface_name, vars, 3, fs::path("stdout.txt"),
+              fs::path("stderr.txt"));
+    fs::unlink(fs::path("stdout.txt"));
+    fs::unlink(fs::path("stderr.txt"));
+}
+
+
+}  // anonymous namespace
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(lookup__hit);
+ATF_TEST_CASE_BODY(lookup__hit)
+{
+    atf::utils::create_file("program", "binary contents");
+    const fs::path binary = fs::path("program").to_absolute();
+    config::properties_map vars;
+    vars["a"] = "b";
+
+    store::list_cache cache(fs::path("cache"));
+    put_listing(cache, binary, "mock", vars, "the listing\n");
+    ATF_REQUIRE(fs::is_directory(fs::path("cache")));
+
+    const optional< store::cached_list > entry = cache.lookup(
+        binary, "mock", vars);
+    ATF_REQUIRE(entry);
+    ATF_REQUIRE_EQ(3, entry.get().exit_status());
+    ATF_REQUIRE(atf::utils::compare_file(entry.get().stdout_file().str(),
+                                         "the listing\n"));
+    ATF_REQUIRE(atf::utils::compare_file(entry.get().stderr_file().str(),
+                                         "some error\n"));
+    ATF_REQUIRE_EQ(1, cache.hits());
+    ATF_REQUIRE_EQ(0, cache.misses());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(lookup__hit_across_instances);
+ATF_TEST_CASE_BODY(lookup__hit_across_instances)
+{
+    atf::utils::create_file("program", "binary contents");
+    const fs::path binary = fs::path("program").to_absolute();
+
+    {
+        store::list_cache cache(fs::path("cache"));
+        put_listing(cache, binary, "mock", config::properties_map(), "foo\n");
+    }
+
+    store::list_cache cache(fs::path("cache"));
+    const optional< store::cached_list > entry = cache.lookup(
+        binary, "mock", config::properties_map());
+    ATF_REQUIRE(entry);
+    ATF_REQUIRE(atf::utils::compare_file(entry.get().stdout_file().str(),
+                                         "foo\n"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(lookup__hit_survives_replacement);
+ATF_TEST_CASE_BODY(lookup__hit_survives_replacement)
+{
+    atf::utils::create_file("program", "binary contents");
+    const fs::path binary = fs::path("program").to_absolute();
+
+    store::list_cache cache(fs::path("cache"));
+    put_listing(cache, binary, "mock", config::properties_map(), "foo\n");
+
+    fs::path stdout_file("unused");
+    {
+        const optional< store::cached_list > entry = cache.lookup(
+            binary, "mock", config::properties_map());
+        ATF_REQUIRE(entry);
+        stdout_file = entry.get().stdout_file();
+
+        struct ::utimbuf times;
+        times.actime = 1000;
+        times.modtime = 2000;
+        ATF_REQUIRE(::utime(binary.c_str(), &times) != -1);
+        put_listing(cache, binary, "mock", config::properties_map(), "bar\n");
+        cache.invalidate(binary, "mock", config::properties_map());
+
+        ATF_REQUIRE(atf::utils::compare_file(entry.get().stdout_file().str(),
+                                             "foo\n"));
+        ATF_REQUIRE(atf::utils::compare_file(entry.get().stderr_file().str(),
+                                             "some error\n"));
+    }
+    ATF_REQUIRE(!fs::exists(stdout_file));
+    ATF_REQUIRE(!fs::exists(stdout_file.branch_path()));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(lookup__miss_empty);
+ATF_TEST_CASE_BODY(lookup__miss_empty)
+{
+    atf::utils::create_file("program", "binary contents");
+    const fs::path binary = fs::path("program").to_absolute();
+
+    store::list_cache cache(fs::path("cache"));
+    ATF_REQUIRE(!cache.lookup(binary, "mock", config::properties_map()));
+    ATF_REQUIRE_EQ(0, cache.hits());
+    ATF_REQUIRE_EQ(1, cache.misses());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(lookup__miss_missing_binary);
+ATF_TEST_CASE_BODY(lookup__miss_missing_binary)
+{
+    atf::utils::create_file("program", "binary contents");
+    const fs::path binary = fs::path("program").to_absolute();
+
+    store::list_cache cache(fs::path("cache"));
+    put_listing(cache, binary, "mock", config::properties_map(), "foo\n");
+    fs::unlink(binary);
+    ATF_REQUIRE(!cache.lookup(binary, "mock", config::properties_map()));
+    ATF_REQUIRE_EQ(1, cache.misses());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(lookup__miss_modified_binary);
+ATF_TEST_CASE_BODY(lookup__miss_modified_binary)
+{
+    atf::utils::create_file("program", "binary contents");
+    const fs::path binary = fs::path("program").to_absolute();
+
+    store::list_cache cache(fs::path("cache"));
+    put_listing(cache, binary, "mock", config::properties_map(), "foo\n");
+    ATF_REQUIRE(cache.lookup(binary, "mock", config::properties_map()));
+
+    struct ::utimbuf times;
+    times.actime = 1000;
+    times.modtime = 2000;
+    ATF_REQUIRE(::utime(binary.c_str(), &times) != -1);
+    ATF_REQUIRE(!cache.lookup(binary, "mock", config::properties_map()));
+    ATF_REQUIRE_EQ(1, cache.hits());
+    ATF_REQUIRE_EQ(1, cache.misses());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(lookup__miss_rebuilt_within_second);
+ATF_TEST_CASE_BODY(lookup__miss_rebuilt_within_second)
+{
+    atf::utils::create_file("program", "binary contents");
+    const fs::path binary = fs::path("program").to_absolute();
+
+    struct ::timespec times[2];
+    times[0].tv_sec = times[1].tv_sec = 2000;
+    times[0].tv_nsec = times[1].tv_nsec = 100;
+    ATF_REQUIRE(::utimensat(AT_FDCWD, binary.c_str(), times, 0) != -1);
+    struct ::stat sb;
+    ATF_REQUIRE(::stat(binary.c_str(), &sb) != -1);
+#if defined(HAVE_STRUCT_STAT_ST_MTIM)
+    const long nsec = sb.st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    const long nsec = sb.st_mtimespec.tv_nsec;
+#else
+    const long nsec = 0;
+#endif
+    if (nsec != 100)
+        ATF_SKIP("Sub-second timestamps are not supported");
+
+    store::list_cache cache(fs::path("cache"));
+    put_listing(cache, binary, "mock", config::properties_map(), "foo\n");
+    ATF_REQUIRE(cache.lookup(binary, "mock", config::properties_map()));
+
+    // Rewrite the binary in place with the same size and a modification time
+    // within the same second.
+    atf::utils::create_file("program", "other contents!");
+    times[0].tv_nsec = times[1].tv_nsec = 200;
+    ATF_REQUIRE(::utimensat(AT_FDCWD, binary.c_str(), times, 0) != -1);
+    ATF_REQUIRE(!cache.lookup(binary, "mock", config::properties_map()));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(lookup__miss_different_interface);
+ATF_TEST_CASE_BODY(lookup__miss_different_interface)
+{
+    atf::utils::create_file("program", "binary contents");
+    const fs::path binary = fs::path("program").to_absolute();
+
+    store::list_cache cache(fs::path("cache"));
+    put_listing(cache, binary, "mock", config::properties_map(), "foo\n");
+    ATF_REQUIRE(!cache.lookup(binary, "atf", config::properties_map()));
+    ATF_REQUIRE( cache.lookup(binary, "mock", config::properties_map()));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(lookup__miss_different_vars);
+ATF_TEST_CASE_BODY(lookup__miss_different_vars)
+{
+    atf::utils::create_file("program", "binary contents");
+    const fs::path binary = fs::path("program").to_absolute();
+    config::properties_map vars1;
+    vars1["a"] = "b";
+    config::properties_map vars2;
+    vars2["a"] = "c";
+
+    store::list_cache cache(fs::path("cache"));
+    put_listing(cache, binary, "mock", vars1, "foo\n");
+    put_listing(cache, binary, "mock", config::properties_map(), "bar\n");
+
+    ATF_REQUIRE(!cache.lookup(binary, "mock", vars2));
+
+    const optional< store::cached_list > entry1 = cache.lookup(
+        binary, "mock", vars1);
+    ATF_REQUIRE(entry1);
+    ATF_REQUIRE(atf::utils::compare_file(entry1.get().stdout_file().str(),
+                                         "foo\n"));
+
+    const optional< store::cached_list > entry2 = cache.lookup(
+        binary, "mock", config::properties_map());
+    ATF_REQUIRE(entry2);
+    ATF_REQUIRE(atf::utils::compare_file(entry2.get().stdout_file().str(),
+                                         "bar\n"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(put__cannot_create);
+ATF_TEST_CASE_BODY(put__cannot_create)
+{
+    atf::utils::create_file("program", "binary contents");
+    const fs::path binary = fs::path("program").to_absolute();
+    atf::utils::create_file("cache", "not a directory");
+
+    store::list_cache cache(fs::path("cache"));
+    put_listing(cache, binary, "mock", config::properties_map(), "foo\n");
+    ATF_REQUIRE(!cache.lookup(binary, "mock", config::properties_map()));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(put__replaces_modified_binary);
+ATF_TEST_CASE_BODY(put__replaces_modified_binary)
+{
+    atf::utils::create_file("program", "binary contents");
+    const fs::path binary = fs::path("program").to_absolute();
+
+    store::list_cache cache(fs::path("cache"));
+    put_listing(cache, binary, "mock", config::properties_map(), "foo\n");
+
+    struct ::utimbuf times;
+    times.actime = 1000;
+    times.modtime = 2000;
+    ATF_REQUIRE(::utime(binary.c_str(), &times) != -1);
+    put_listing(cache, binary, "mock", config::properties_map(), "bar\n");
+
+    {
+        const optional< store::cached_list > entry = cache.lookup(
+            binary, "mock", config::properties_map());
+        ATF_REQUIRE(entry);
+        ATF_REQUIRE(atf::utils::compare_file(entry.get().stdout_file().str(),
+                                             "bar\n"));
+    }
+
+    std::size_t entries = 0;
+    const fs::directory directory(fs::path("cache"));
+    for (fs::directory::const_iterator iter = directory.begin();
+         iter != directory.end(); ++iter) {
+        if (iter->name != "." && iter->name != "..")
+            ++entries;
+    }
+    ATF_REQUIRE_EQ(1, entries);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(invalidate);
+ATF_TEST_CASE_BODY(invalidate)
+{
+    atf::utils::create_file("program", "binary contents");
+    const fs::path binary = fs::path("program").to_absolute();
+
+    store::list_cache cache(fs::path("cache"));
+    cache.invalidate(binary, "mock", config::properties_map());
+    put_listing(cache, binary, "mock", config::properties_map(), "foo\n");
+    ATF_REQUIRE( cache.lookup(binary, "mock", config::properties_map()));
+    cache.invalidate(binary, "mock", config::properties_map());
+    ATF_REQUIRE(!cache.lookup(binary, "mock", config::properties_map()));
+}
+
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    ATF_ADD_TEST_CASE(tcs, lookup__hit);
+    ATF_ADD_TEST_CASE(tcs, lookup__hit_across_instances);
+    ATF_ADD_TEST_CASE(tcs, lookup__hit_survives_replacement);
+    ATF_ADD_TEST_CASE(tcs, lookup__miss_empty);
+    ATF_ADD_TEST_CASE(tcs, lookup__miss_missing_binary);
+    ATF_ADD_TEST_CASE(tcs, lookup__miss_modified_binary);
+    ATF_ADD_TEST_CASE(tcs, lookup__miss_rebuilt_within_second);
+    ATF_ADD_TEST_CASE(tcs, lookup__miss_different_interface);
+    ATF_ADD_TEST_CASE(tcs, lookup__miss_different_vars);
+
+    ATF_ADD_TEST_CASE(tcs, put__cannot_create);
+    ATF_ADD_TEST_CASE(tcs, put__replaces_modified_binary);
+
+    ATF_ADD_TEST_CASE(tcs, invalidate);
+}
@@ -29,7 +29,11 @@
 #include "store/migrate.hpp"
 
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "store/contents.hpp"
 #include "store/dbtypes.hpp"
 #include "store/exceptions.hpp"
 #include "store/layout.hpp"
@@ -49,6 +53,7 @@
 #include "utils/sqlite/database.hpp"
 #include "utils/sqlite/exceptions.hpp"
 #include "utils/sqlite/statement.ipp"
+#include "utils/sqlite/transaction.hpp"
 #include "utils/text/operations.hpp"
 
 namespace datetime = utils::datetime;
@@ -81,6 +86,116 @@ get_schema_version(const fs::path& file)
 }
 
 
+/// Computes the digests of the files imported from an older database.
+///
+/// The digests cannot be computed by the SQL migration script, so this
+/// completes the upgrade of the files table to schema version 4: files with
+/// identical contents are merged into one and the remaining ones are recoded
+/// with the codec that new files would get.  Files with the same digest are
+/// only merged if their contents match.
+///
+/// \param db The database being migrated.
+///
+/// \throw sqlite::error If there is a problem updating the database.
+static void
+encode_old_files(sqlite::database& db)
+{
+    std::vector< int64_t > file_ids;
+    {
+        sqlite::statement stmt = db.create_statement(
+            "SELECT file_id FROM files WHERE digest IS NULL");
+        while (stmt.step())
+            file_ids.push_back(stmt.safe_column_int64("file_id"));
+    }
+    if (file_ids.empty())
+        return;
+
+    LI(F("Deduplicating and encoding %s files") % file_ids.size());
+
+    sqlite::transaction tx = db.begin_transaction();
+
+    sqlite::statement get_stmt = db.create_statement(
+        "SELECT contents FROM files WHERE file_id == :file_id");
+    sqlite::statement find_stmt = db.create_statement(
+        "SELECT file_id, codec, contents FROM files WHERE digest == :digest");
+    sqlite::statement merge_stmt = db.create_statement(
+        "UPDATE test_case_files SET file_id = :new_file_id "
+        "WHERE file_id == :old_file_id");
+    sqlite::statement delete_stmt = db.create_statement(
+        "DELETE FROM files WHERE file_id == :file_id");
+    sqlite::statement update_stmt = db.create_statement(
+        "UPDATE files SET contents = :contents, digest = :digest, "
+        "codec = :codec WHERE file_id == :file_id");
+
+    for (std::vector< int64_t >::const_iterator iter = file_ids.begin();
+         iter != file_ids.end(); ++iter) {
+        get_stmt.reset();
+        get_stmt.bind(":file_id", *iter);
+        if (!get_stmt.step())
+            UNREACHABLE;
+        const sqlite::blob raw_contents = get_stmt.safe_column_blob(
+            "contents");
+        const std::string contents(
+            static_cast< const char* >(raw_contents.memory), raw_contents.size);
+        get_stmt.reset();
+
+        const std::string digest = store::digest_contents(contents);
+
+        find_stmt.reset();
+        find_stmt.bind(":digest", digest);
+        optional< int64_t > same_file_id;
+        bool collision = false;
+        if (find_stmt.step()) {
+            const sqlite::blob other_contents = find_stmt.safe_column_blob(
+                "contents");
+            if (store::decode_contents(find_stmt.safe_column_text("codec"),
+                                       other_contents.memory,
+                                       other_contents.size) == contents) {
+                same_file_id = find_stmt.safe_column_int64("file_id");
+            } else {
+                LW(F("Digest collision between files %s and %s; not "
+                     "merging them") % find_stmt.safe_column_int64("file_id") %
+                   *iter);
+                collision = true;
+            }
+        }
+        find_stmt.reset();
+
+        if (same_file_id) {
+            const int64_t file_id = same_file_id.get();
+
+            merge_stmt.reset();
+            merge_stmt.bind(":new_file_id", file_id);
+            merge_stmt.bind(":old_file_id", *iter);
+            merge_stmt.step_without_results();
+
+            delete_stmt.reset();
+            delete_stmt.bind(":file_id", *iter);
+            delete_stmt.step_without_results();
+        } else {
+            const std::pair< std::string, std::string > encoded =
+                store::encode_contents(contents);
+
+            update_stmt.reset();
+            update_stmt.bind(":contents", sqlite::blob(
+                encoded.second.c_str(), encoded.second.length()));
+            if (collision)
+                update_stmt.bind(":digest", sqlite::null());
+            else
+                update_stmt.bind(":digest", digest);
+            update_stmt.bind(":codec", encoded.first);
+            update_stmt.bind(":file_id", *iter);
+            update_stmt.step_without_results();
+        }
+    }
+
+    tx.commit();
+
+    // Merging and compressing files can free a lot of space, so give it back.
+    db.exec("VACUUM");
+}
+
+
 /// Performs a single migration step.
 ///
 /// Both action_id and old_database are little hacks to support the migration
@@ -130,16 +245,49 @@ migrate_schema_step(const fs::path& file,
     }
     try {
         db.exec(migration_string);
+        if (version_to == 4)
+            encode_old_files(db);
     } catch (const sqlite::error& e) {
         throw store::error(F("Schema migration failed: %s") % e.what());
     }
 }
 
 
+/// Initializes an empty results file with the first chunked schema.
+///
+/// The data extracted from a historical database can only be imported into the
+/// schema that was current when we switched to results files, so these files
+/// have to be created with that schema and later upgraded to the current one.
+///
+/// \param db The database to initialize.
+///
+/// \throw error If there is a problem initializing the database.
+static void
+initialize_chunk(sqlite::database& db)
+{
+    const fs::path schema = fs::path(utils::getenv_with_default(
+        "KYUA_STOREDIR", KYUA_STOREDIR)) /
+        (F("schema_v%s.sql") % first_chunked_schema_version);
+
+    std::string schema_string;
+    try {
+        schema_string = utils::read_file(schema);
+    } catch (const std::runtime_error& unused_e) {
+        throw store::error(F("Cannot read database schema '%s'") % schema);
+    }
+    try {
+        db.exec(schema_string);
+    } catch (const sqlite::error& e) {
+        throw store::error(F("Failed to initialize database: %s") % e.what());
+    }
+}
+
+
 /// Given a historical database, chunks it up into results files.
 ///
 /// The given database is DELETED on success given that it will have been
-/// split up into various different files.
+/// split up into various different files, each of which is upgraded to the
+/// current schema version.
 ///
 /// \param old_file Path to the old database.
 static void
@@ -194,13 +342,16 @@ chunk_database(const fs::path& old_file)
             fs::mkdir_p(new_file.branch_path(), 0755);
             sqlite::database db = store::detail::open_and_setup(
                 new_file, sqlite::open_readwrite | sqlite::open_create);
-            store::detail::initialize(db);
+            initialize_chunk(db);
             db.close();
             migrate_schema_step(new_file,
                                 first_chunked_schema_version - 1,
                                 first_chunked_schema_version,
                                 utils::make_optional(action_id),
                                 utils::make_optional(old_file));
+            for (int i = first_chunked_schema_version;
+                 i < store::detail::current_schema_version; ++i)
+                migrate_schema_step(new_file, i, i + 1);
         } catch (...) {
             // TODO(jmmv): Handle this better.
             fs::unlink(new_file);
@@ -278,10 +429,14 @@ store::migrate_schema(const utils::fs::path& file)
 
     detail::backup_database(file, version_from);
 
-    int i;
-    for (i = version_from; i < first_chunked_schema_version - 1; ++i) {
-        migrate_schema_step(file, i, i + 1);
+    if (version_from < first_chunked_schema_version) {
+        for (int i = version_from; i < first_chunked_schema_version - 1; ++i) {
+            migrate_schema_step(file, i, i + 1);
+        }
+        chunk_database(file);
+    } else {
+        for (int i = version_from; i < version_to; ++i) {
+            migrate_schema_step(file, i, i + 1);
+        }
     }
-    chunk_database(file);
-    INV(version_to == first_chunked_schema_version);
 }
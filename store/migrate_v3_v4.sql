@@ -0,0 +1,161 @@
+-- Copyright 2026 The Kyua Authors.
+-- All rights reserved.
+--
+-- Redistribution and use in source and binary forms, with or without
+-- modification, are permitted provided that the following conditions are
+-- met:
+--
+-- * Redistributions of source code must retain the above copyright
+--   notice, this list of conditions and the following disclaimer.
+-- * Redistributions in binary form must reproduce the above copyright
+--   notice, this list of conditions and the following disclaimer in the
+--   documentation and/or other materials provided with the distribution.
+-- * Neither the name of Google Inc. nor the names of its contributors
+--   may be used to endorse or promote products derived from this software
+--   without specific prior written permission.
+--
+-- THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+-- "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+-- LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+-- A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+-- OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+-- SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+-- LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+-- DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+-- THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+-- (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+-- OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+-- \file store/migrate_v3_v4.sql
+-- Migration of a database with version 3 of the schema to version 4.
+--
+-- Version 4 appeared in Kyua 0.14 and its changes were:
+--
+-- * Deduplication of metadata objects: test programs and test cases with
+--   identical metadata now share a single set of rows in the metadatas
+--   table.
+--
+-- * Added the metadata_sets table, which allocates the identifiers of the
+--   metadata objects and indexes them by the digest of their contents.
+--
+-- * Added indexes to look up test programs by their relative path, test
+--   cases by their name and test results by their type, which speed up the
+--   filtering of reports.
+--
+-- * Made the files table content-addressed by adding a digest of the raw
+--   contents of every file, and allowed storing these contents compressed
+--   by adding the codec column.
+--
+-- * Added the run_status table, which records whether the test run that
+--   generated the results completed.  Databases migrated from older versions
+--   have no rows in it and are considered complete.
+--
+-- The digests of the existing files cannot be computed in SQL, so Kyua
+-- completes this migration after running this script by computing them,
+-- merging identical files and compressing the contents of the rest.
+
+
+--
+-- Merge identical metadata objects.
+--
+
+
+-- Auxiliary table with a canonical representation of every metadata object.
+--
+-- Every property is encoded with length prefixes so that different objects
+-- cannot map to the same string.  We rely on group_concat preserving the
+-- order of the subquery; if it did not, identical objects would simply not be
+-- merged.
+CREATE TEMPORARY TABLE tmp_metadata_contents AS
+    SELECT metadata_id,
+        group_concat(length(property_name) || ':' || property_name || '=' ||
+                     IFNULL(length(property_value) || ':' || property_value,
+                            '-'), ',') AS contents
+    FROM (SELECT * FROM metadatas ORDER BY metadata_id, property_name)
+    GROUP BY metadata_id;
+
+CREATE INDEX tmp_index_metadata_contents
+    ON tmp_metadata_contents (contents);
+
+
+-- Auxiliary table mapping duplicate metadata objects to the object with the
+-- lowest identifier among those with the same contents.
+CREATE TEMPORARY TABLE tmp_metadata_ids (
+    old_id INTEGER PRIMARY KEY,
+    new_id INTEGER NOT NULL
+);
+
+INSERT INTO tmp_metadata_ids (old_id, new_id)
+    SELECT metadata_id, (
+        SELECT MIN(others.metadata_id)
+        FROM tmp_metadata_contents AS others
+        WHERE others.contents == tmp_metadata_contents.contents)
+    FROM tmp_metadata_contents;
+
+DELETE FROM tmp_metadata_ids WHERE old_id == new_id;
+
+
+UPDATE test_programs
+    SET metadata_id = (SELECT new_id FROM tmp_metadata_ids
+                       WHERE old_id == test_programs.metadata_id)
+    WHERE metadata_id IN (SELECT old_id FROM tmp_metadata_ids);
+
+UPDATE test_cases
+    SET metadata_id = (SELECT new_id FROM tmp_metadata_ids
+                       WHERE old_id == test_cases.metadata_id)
+    WHERE metadata_id IN (SELECT old_id FROM tmp_metadata_ids);
+
+DELETE FROM metadatas
+    WHERE metadata_id IN (SELECT old_id FROM tmp_metadata_ids);
+
+
+DROP TABLE tmp_metadata_ids;
+DROP INDEX tmp_index_metadata_contents;
+DROP TABLE tmp_metadata_contents;
+
+
+--
+-- Add the new tables.
+--
+
+
+CREATE TABLE metadata_sets (
+    metadata_id INTEGER PRIMARY KEY,
+    digest TEXT UNIQUE
+);
+
+-- The digests of the existing objects are left unset: they are computed by
+-- the writer, and results files are not modified once written anyway.
+INSERT INTO metadata_sets (metadata_id)
+    SELECT metadata_id FROM metadatas
+    UNION SELECT metadata_id FROM test_programs WHERE metadata_id IS NOT NULL
+    UNION SELECT metadata_id FROM test_cases WHERE metadata_id IS NOT NULL;
+
+
+CREATE TABLE run_status (
+    completed TEXT NOT NULL
+);
+
+
+ALTER TABLE files ADD COLUMN digest TEXT;
+ALTER TABLE files ADD COLUMN codec TEXT NOT NULL DEFAULT 'none';
+
+CREATE UNIQUE INDEX index_files_by_digest
+    ON files (digest);
+
+
+CREATE INDEX index_test_programs_by_relative_path
+    ON test_programs (relative_path);
+CREATE INDEX index_test_cases_by_name
+    ON test_cases (name);
+CREATE INDEX index_test_results_by_result_type
+    ON test_results (result_type);
+
+
+--
+-- Update the metadata version.
+--
+
+
+INSERT INTO metadata (timestamp, schema_version)
+    VALUES (strftime('%s', 'now'), 4);
@@ -34,6 +34,7 @@
 #include "store/write_backend.hpp"
 #include "utils/format/macros.hpp"
 #include "utils/fs/path.hpp"
+#include "utils/logging/macros.hpp"
 #include "utils/noncopyable.hpp"
 #include "utils/sqlite/database.hpp"
 #include "utils/sqlite/exceptions.hpp"
@@ -42,6 +43,57 @@ namespace fs = utils::fs;
 namespace sqlite = utils::sqlite;
 
 
+namespace {
+
+
+/// Checks if a database was left behind by an interrupted writer.
+///
+/// Results files are committed periodically while tests run, so a kyua test
+/// process that is killed in the middle of a transaction leaves a hot journal
+/// next to the database.  SQLite refuses to read such a database from a
+/// read-only connection because it cannot roll the journal back.  Note that a
+/// journal that belongs to a writer that is still running is not hot and does
+/// not prevent reads.
+///
+/// \param db The database to check, opened in read-only mode.
+///
+/// \return True if the database has to be recovered by a read-write
+/// connection before it can be read; false otherwise.  Any other error is
+/// ignored here and left for the actual reads to report.
+static bool
+needs_rollback(sqlite::database& db)
+{
+    try {
+        db.exec("SELECT COUNT(*) FROM sqlite_master");
+        return false;
+    } catch (const sqlite::api_error& e) {
+        return e.is_readonly_rollback();
+    }
+}
+
+
+/// Rolls back the changes left behind by an interrupted writer.
+///
+/// \param file The database file to be recovered.
+static void
+recover_interrupted_writes(const fs::path& file)
+{
+    LI(F("Found hot journal for %s; recovering interrupted writes") % file);
+    try {
+        sqlite::database db = store::detail::open_and_setup(
+            file, sqlite::open_readwrite);
+        (void)store::metadata::fetch_latest(db);
+        db.close();
+    } catch (const store::error& e) {
+        LW(F("Failed to recover interrupted writes to %s: %s") % file %
+           e.what());
+    }
+}
+
+
+}  // anonymous namespace
+
+
 /// Opens a database and defines session pragmas.
 ///
 /// This auxiliary function ensures that, every time we open a SQLite database,
@@ -128,6 +180,11 @@ store::read_backend
 store::read_backend::open_ro(const fs::path& file)
 {
     sqlite::database db = detail::open_and_setup(file, sqlite::open_readonly);
+    if (needs_rollback(db)) {
+        db.close();
+        recover_interrupted_writes(file);
+        db = detail::open_and_setup(file, sqlite::open_readonly);
+    }
     return read_backend(new impl(db, metadata::fetch_latest(db)));
 }
 
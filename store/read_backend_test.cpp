@@ -28,6 +28,14 @@
 
 #include "store/read_backend.hpp"
 
+extern "C" {
+#include <sys/wait.h>
+
+#include <unistd.h>
+}
+
+#include <cstdlib>
+
 #include <atf-c++.hpp>
 
 #include "store/exceptions.hpp"
@@ -122,6 +130,72 @@ ATF_TEST_CASE_BODY(read_backend__open_ro__integrity_error)
 }
 
 
+ATF_TEST_CASE(read_backend__open_ro__active_writer);
+ATF_TEST_CASE_HEAD(read_backend__open_ro__active_writer)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(read_backend__open_ro__active_writer)
+{
+    store::write_backend::open_rw(fs::path("test.db"));  // Create database.
+
+    sqlite::database writer = sqlite::database::open(
+        fs::path("test.db"), sqlite::open_readwrite);
+    writer.exec("BEGIN TRANSACTION");
+    writer.exec("CREATE TABLE pending (data TEXT)");
+    writer.exec("INSERT INTO pending VALUES ('foo')");
+    ATF_REQUIRE(fs::exists(fs::path("test.db-journal")));
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    backend.database().exec("SELECT * FROM metadata");
+    ATF_REQUIRE_THROW_RE(sqlite::error, "pending",
+                         backend.database().exec("SELECT * FROM pending"));
+
+    writer.exec("COMMIT");
+    backend.database().exec("SELECT * FROM pending");
+}
+
+
+ATF_TEST_CASE(read_backend__open_ro__interrupted_writer);
+ATF_TEST_CASE_HEAD(read_backend__open_ro__interrupted_writer)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(read_backend__open_ro__interrupted_writer)
+{
+    store::write_backend::open_rw(fs::path("test.db")).close();
+
+    const pid_t pid = ::fork();
+    ATF_REQUIRE(pid != -1);
+    if (pid == 0) {
+        // Leave a hot journal behind by dying in the middle of a transaction
+        // that is large enough to spill modified pages to the database.
+        sqlite::database db = sqlite::database::open(
+            fs::path("test.db"), sqlite::open_readwrite);
+        db.exec("PRAGMA cache_size = 10");
+        db.exec("BEGIN TRANSACTION");
+        db.exec("CREATE TABLE garbage (data TEXT)");
+        for (int i = 0; i < 1000; ++i)
+            db.exec("INSERT INTO garbage VALUES (hex(zeroblob(1000)))");
+        ::_exit(fs::exists(fs::path("test.db-journal")) ?
+                EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    int status;
+    ATF_REQUIRE(::waitpid(pid, &status, 0) != -1);
+    ATF_REQUIRE(WIFEXITED(status));
+    ATF_REQUIRE_EQ(EXIT_SUCCESS, WEXITSTATUS(status));
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    backend.database().exec("SELECT * FROM metadata");
+    ATF_REQUIRE_THROW_RE(sqlite::error, "garbage",
+                         backend.database().exec("SELECT * FROM garbage"));
+}
+
+
 ATF_TEST_CASE(read_backend__close);
 ATF_TEST_CASE_HEAD(read_backend__close)
 {
@@ -148,5 +222,7 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, read_backend__open_ro__ok);
     ATF_ADD_TEST_CASE(tcs, read_backend__open_ro__missing_file);
     ATF_ADD_TEST_CASE(tcs, read_backend__open_ro__integrity_error);
+    ATF_ADD_TEST_CASE(tcs, read_backend__open_ro__active_writer);
+    ATF_ADD_TEST_CASE(tcs, read_backend__open_ro__interrupted_writer);
     ATF_ADD_TEST_CASE(tcs, read_backend__close);
 }
@@ -32,14 +32,21 @@ extern "C" {
 #include <stdint.h>
 }
 
+#include <algorithm>
+#include <istream>
+#include <list>
 #include <map>
+#include <sstream>
+#include <streambuf>
 #include <utility>
+#include <vector>
 
 #include "model/context.hpp"
 #include "model/metadata.hpp"
 #include "model/test_case.hpp"
 #include "model/test_program.hpp"
 #include "model/test_result.hpp"
+#include "store/contents.hpp"
 #include "store/dbtypes.hpp"
 #include "store/exceptions.hpp"
 #include "store/read_backend.hpp"
@@ -48,18 +55,18 @@ extern "C" {
 #include "utils/fs/path.hpp"
 #include "utils/logging/macros.hpp"
 #include "utils/noncopyable.hpp"
-#include "utils/optional.ipp"
 #include "utils/sanity.hpp"
+#include "utils/sqlite/blob_io.hpp"
 #include "utils/sqlite/database.hpp"
 #include "utils/sqlite/exceptions.hpp"
 #include "utils/sqlite/statement.ipp"
 #include "utils/sqlite/transaction.hpp"
+#include "utils/text/operations.ipp"
 
 namespace datetime = utils::datetime;
 namespace fs = utils::fs;
 namespace sqlite = utils::sqlite;
-
-using utils::optional;
+namespace text = utils::text;
 
 
 namespace {
@@ -127,7 +134,7 @@ static std::string
 get_file(sqlite::database& db, const int64_t file_id)
 {
     sqlite::statement stmt = db.create_statement(
-        "SELECT contents FROM files WHERE file_id == :file_id");
+        "SELECT codec, contents FROM files WHERE file_id == :file_id");
     stmt.bind(":file_id", file_id);
     if (!stmt.step())
         throw store::integrity_error(F("Cannot find referenced file %s") %
@@ -135,8 +142,9 @@ get_file(sqlite::database& db, const int64_t file_id)
 
     try {
         const sqlite::blob raw_contents = stmt.safe_column_blob("contents");
-        const std::string contents(
-            static_cast< const char *>(raw_contents.memory), raw_contents.size);
+        const std::string contents = store::decode_contents(
+            stmt.safe_column_text("codec"), raw_contents.memory,
+            raw_contents.size);
 
         const bool more = stmt.step();
         INV(!more);
@@ -148,6 +156,115 @@ get_file(sqlite::database& db, const int64_t file_id)
 }
 
 
+/// A std::streambuf that decodes a file stored in the database piece by piece.
+class file_streambuf : public std::streambuf, utils::noncopyable {
+    /// Size of the pieces in which the file is read and decoded.
+    static const std::size_t chunk_size = 64 * 1024;
+
+    /// The backend the file belongs to, kept alive while the file is open.
+    store::read_backend _backend;
+
+    /// Handle to the encoded contents of the file.
+    sqlite::blob_io _blob;
+
+    /// Size of the encoded contents of the file.
+    const int _size;
+
+    /// Offset of the next piece of encoded contents to read.
+    int _offset;
+
+    /// The decoder for the contents of the file.
+    store::codec_stream _decoder;
+
+    /// Piece of the encoded contents being decoded.
+    char _raw[chunk_size];
+
+    /// Piece of the decoded contents made available to the reader.
+    char _buffer[chunk_size];
+
+protected:
+    /// Decodes the next piece of the file.
+    ///
+    /// \return The next character in the file, or EOF if there are no more.
+    ///
+    /// \throw store::integrity_error If the file cannot be read or decoded.
+    int_type
+    underflow(void)
+    {
+        try {
+            for (;;) {
+                if (_decoder.needs_input() && _offset < _size) {
+                    const int length = std::min(
+                        _size - _offset, static_cast< int >(chunk_size));
+                    _blob.read(_raw, length, _offset);
+                    _offset += length;
+                    _decoder.feed(_raw, length);
+                }
+                if (_decoder.finished())
+                    return traits_type::eof();
+
+                const std::size_t length = _decoder.process(
+                    _buffer, sizeof(_buffer), _offset == _size);
+                if (length > 0) {
+                    setg(_buffer, _buffer, _buffer + length);
+                    return traits_type::to_int_type(_buffer[0]);
+                }
+            }
+        } catch (const sqlite::error& e) {
+            throw store::integrity_error(e.what());
+        }
+    }
+
+public:
+    /// Constructor.
+    ///
+    /// \param backend The backend the file belongs to.
+    /// \param file_id The identifier of the file to read.
+    /// \param codec The codec with which the file is encoded.
+    ///
+    /// \throw sqlite::error If the file cannot be opened.
+    /// \throw store::integrity_error If the codec is not supported.
+    file_streambuf(store::read_backend& backend, const int64_t file_id,
+                   const std::string& codec) :
+        _backend(backend),
+        _blob(_backend.database().open_blob("files", "contents", file_id,
+                                            false)),
+        _size(_blob.size()),
+        _offset(0),
+        _decoder(codec, false)
+    {
+    }
+};
+
+
+/// A std::istream to read a file stored in the database.
+class file_istream : public std::istream, utils::noncopyable {
+    /// The buffer that reads and decodes the file.
+    file_streambuf _buffer;
+
+public:
+    /// Constructor.
+    ///
+    /// Errors while reading the file are reported as exceptions instead of
+    /// just leaving the stream in a bad state.
+    ///
+    /// \param backend The backend the file belongs to.
+    /// \param file_id The identifier of the file to read.
+    /// \param codec The codec with which the file is encoded.
+    ///
+    /// \throw sqlite::error If the file cannot be opened.
+    /// \throw store::integrity_error If the codec is not supported.
+    file_istream(store::read_backend& backend, const int64_t file_id,
+                 const std::string& codec) :
+        std::istream(NULL),
+        _buffer(backend, file_id, codec)
+    {
+        rdbuf(&_buffer);
+        exceptions(std::ios::badbit);
+    }
+};
+
+
 /// Gets all the test cases within a particular test program.
 ///
 /// \param db The database to query the information from.
@@ -162,6 +279,9 @@ get_test_cases(sqlite::database& db, const int64_t test_program_id)
 {
     model::test_cases_map_builder test_cases;
 
+    // Test cases often share their metadata object, so load each one once.
+    std::map< int64_t, model::metadata > metadatas;
+
     sqlite::statement stmt = db.create_statement(
         "SELECT name, metadata_id "
         "FROM test_cases WHERE test_program_id == :test_program_id");
@@ -170,15 +290,191 @@ get_test_cases(sqlite::database& db, const int64_t test_program_id)
         const std::string name = stmt.safe_column_text("name");
         const int64_t metadata_id = stmt.safe_column_int64("metadata_id");
 
-        const model::metadata metadata = get_metadata(db, metadata_id);
+        std::map< int64_t, model::metadata >::const_iterator iter =
+            metadatas.find(metadata_id);
+        if (iter == metadatas.end()) {
+            iter = metadatas.insert(std::make_pair(
+                metadata_id, get_metadata(db, metadata_id))).first;
+        }
         LD(F("Loaded test case '%s'") % name);
-        test_cases.add(name, metadata);
+        test_cases.add(name, (*iter).second);
     }
 
     return test_cases.build();
 }
 
 
+/// A test program whose test cases are loaded from the database on demand.
+///
+/// Most users of the results only need the properties of the test program and
+/// those of the test case that each result belongs to, so loading all other
+/// test cases of the program upfront is wasteful.
+class lazy_test_program : public model::test_program {
+    /// The backend to load the test cases from.
+    mutable store::read_backend _backend;
+
+    /// The identifier of the test program in the database.
+    const int64_t _test_program_id;
+
+    /// Whether the test cases have been loaded yet or not.
+    mutable bool _loaded;
+
+public:
+    /// Constructor.
+    ///
+    /// \param backend The backend to load the test cases from.
+    /// \param test_program_id The identifier of the test program.
+    /// \param interface_name Name of the test program interface.
+    /// \param binary The name of the test program relative to root.
+    /// \param root The root of the test suite containing the test program.
+    /// \param test_suite_name The name of the test suite.
+    /// \param md Metadata of the test program.
+    lazy_test_program(store::read_backend& backend,
+                      const int64_t test_program_id,
+                      const std::string& interface_name,
+                      const fs::path& binary,
+                      const fs::path& root,
+                      const std::string& test_suite_name,
+                      const model::metadata& md) :
+        test_program(interface_name, binary, root, test_suite_name, md,
+                     model::test_cases_map()),
+        _backend(backend),
+        _test_program_id(test_program_id),
+        _loaded(false)
+    {
+    }
+
+    /// Gets or loads the test cases of the test program.
+    ///
+    /// \return The collection of test cases.
+    ///
+    /// \throw integrity_error If there is any problem in the loaded data.
+    const model::test_cases_map&
+    test_cases(void) const
+    {
+        if (!_loaded) {
+            const model::test_cases_map tcs = get_test_cases(
+                _backend.database(), _test_program_id);
+
+            // Due to the restrictions on when set_test_cases() may be called
+            // (as a way to lazily initialize the test cases list before it is
+            // ever returned), this cast is valid.
+            const_cast< lazy_test_program* >(this)->set_test_cases(tcs);
+
+            _loaded = true;
+        }
+        return test_program::test_cases();
+    }
+};
+
+
+/// Loads a test program from the database without its test cases.
+///
+/// \param backend The store backend we are dealing with.
+/// \param id The identifier of the test program to load.
+///
+/// \return The test program, which loads its test cases when first queried.
+static model::test_program_ptr
+get_lazy_test_program(store::read_backend& backend, const int64_t id)
+{
+    sqlite::database& db = backend.database();
+
+    sqlite::statement stmt = db.create_statement(
+        "SELECT * FROM test_programs WHERE test_program_id == :id");
+    stmt.bind(":id", id);
+    stmt.step();
+    const model::test_program_ptr test_program(new lazy_test_program(
+        backend, id,
+        stmt.safe_column_text("interface"),
+        fs::path(stmt.safe_column_text("relative_path")),
+        fs::path(stmt.safe_column_text("root")),
+        stmt.safe_column_text("test_suite_name"),
+        get_metadata(db, stmt.safe_column_int64("metadata_id"))));
+    const bool more = stmt.step();
+    INV(!more);
+
+    LD(F("Loaded test program '%s'") % test_program->relative_path());
+    return test_program;
+}
+
+
+/// Cache of objects loaded from the database that evicts the least recently
+/// used ones once full.
+///
+/// \tparam Value The type of the cached objects.
+template< typename Value >
+class lru_cache : utils::noncopyable {
+    /// The cached objects keyed by their identifier, most recent first.
+    typedef std::list< std::pair< int64_t, Value > > entries_list;
+
+    /// The cached objects.
+    entries_list _entries;
+
+    /// Index of the cached objects by their identifier.
+    std::map< int64_t, typename entries_list::iterator > _index;
+
+    /// Maximum number of objects to keep.
+    const std::size_t _capacity;
+
+public:
+    /// Constructor.
+    ///
+    /// \param capacity Maximum number of objects to keep.  Must be positive.
+    explicit lru_cache(const std::size_t capacity) :
+        _capacity(capacity)
+    {
+        PRE(capacity > 0);
+    }
+
+    /// Looks up an object and marks it as the most recently used.
+    ///
+    /// \param id The identifier of the object.
+    ///
+    /// \return The cached object, or NULL if it is not in the cache.
+    const Value*
+    find(const int64_t id)
+    {
+        const typename std::map< int64_t, typename entries_list::iterator >::
+            const_iterator iter = _index.find(id);
+        if (iter == _index.end())
+            return NULL;
+        _entries.splice(_entries.begin(), _entries, (*iter).second);
+        return &(*(*iter).second).second;
+    }
+
+    /// Adds an object to the cache, evicting the least recently used one if
+    /// the cache is full.
+    ///
+    /// \param id The identifier of the object.  Must not be in the cache.
+    /// \param value The object to add.
+    ///
+    /// \return The cached object.
+    const Value&
+    insert(const int64_t id, const Value& value)
+    {
+        PRE(_index.find(id) == _index.end());
+        if (_entries.size() == _capacity) {
+            _index.erase(_entries.back().first);
+            _entries.pop_back();
+        }
+        _entries.push_front(std::make_pair(id, value));
+        _index[id] = _entries.begin();
+        return _entries.front().second;
+    }
+};
+
+
+/// Number of test programs cached by a results iterator.
+///
+/// The results are sorted by test program, so one would be enough in general.
+/// A few more cover the test programs that share their absolute path.
+static const std::size_t cached_test_programs = 16;
+
+
+/// Number of metadata objects cached by a results iterator.
+static const std::size_t cached_metadatas = 64;
+
+
 /// Retrieves a result from the database.
 ///
 /// \param stmt The statement with the data for the result to load.
@@ -212,6 +508,198 @@ parse_result(sqlite::statement& stmt, const char* type_column,
 }
 
 
+/// Tables that hold the data of the test case results.
+static const char* results_tables =
+    "test_programs "
+    "    JOIN test_cases "
+    "    ON test_programs.test_program_id = test_cases.test_program_id "
+    "    JOIN test_results "
+    "    ON test_cases.test_case_id = test_results.test_case_id ";
+
+
+/// Maximum number of test case filters to match within the SQL queries.
+///
+/// Each test case filter takes up to three parameters of a query, and SQLite
+/// versions before 3.32.0 limit queries to 999 parameters by default.  Larger
+/// sets of test case filters are matched in memory by match_test_cases()
+/// against the results returned by a query that only filters by type.
+static const std::size_t max_sql_test_cases = 250;
+
+
+/// Checks whether the test case filters of a results filter are done in SQL.
+///
+/// \param filter The filter to check.
+///
+/// \return True if filter_to_sql() handles the test case filters; false if
+/// the results need to be matched with match_test_cases().
+static bool
+test_cases_in_sql(const store::results_filter& filter)
+{
+    return filter.test_cases.size() <= max_sql_test_cases;
+}
+
+
+/// Checks whether a result matches the test case filters of a results filter.
+///
+/// This is the in-memory equivalent of the test case conditions generated by
+/// filter_to_sql().
+///
+/// \param filter The filter to check against.
+/// \param relative_path The relative path of the test program of the result.
+/// \param test_case_name The name of the test case of the result.
+///
+/// \return True if the result matches; false otherwise.
+static bool
+match_test_cases(const store::results_filter& filter,
+                 const std::string& relative_path,
+                 const std::string& test_case_name)
+{
+    if (filter.test_cases.empty())
+        return true;
+
+    const fs::path program(relative_path);
+    if (filter.test_cases.find(std::make_pair(program, test_case_name)) !=
+        filter.test_cases.end() ||
+        filter.test_cases.find(std::make_pair(program, std::string())) !=
+        filter.test_cases.end())
+        return true;
+
+    for (fs::path directory = program.branch_path();
+         directory != fs::path("."); directory = directory.branch_path()) {
+        if (filter.test_cases.find(std::make_pair(directory, std::string())) !=
+            filter.test_cases.end())
+            return true;
+        if (directory == directory.branch_path())
+            break;
+    }
+    return false;
+}
+
+
+/// Translates a results filter into an SQL condition.
+///
+/// The values to compare against are left as parameters to be bound by
+/// bind_filter().  The test case filters are left out if there are too many
+/// of them; see test_cases_in_sql().
+///
+/// \param filter The filter to translate.
+///
+/// \return A WHERE clause for a query on the results_tables, or an empty
+/// string if the filter matches all results.
+static std::string
+filter_to_sql(const store::results_filter& filter)
+{
+    std::vector< std::string > conditions;
+
+    if (!filter.test_cases.empty() && test_cases_in_sql(filter)) {
+        std::vector< std::string > test_cases;
+        std::size_t i = 0;
+        for (std::set< std::pair< fs::path, std::string > >::const_iterator
+                 iter = filter.test_cases.begin();
+             iter != filter.test_cases.end(); ++iter, ++i) {
+            if ((*iter).second.empty()) {
+                // Test programs within a directory sort right after the
+                // directory name followed by a slash and before the directory
+                // name followed by the character after the slash, so look
+                // them up as a range to allow the use of the index.
+                test_cases.push_back(F(
+                    "(test_programs.relative_path == :program_%s OR "
+                    "(test_programs.relative_path > :directory_%s AND "
+                    "test_programs.relative_path < :directory_end_%s))") %
+                    i % i % i);
+            } else {
+                test_cases.push_back(F(
+                    "(test_programs.relative_path == :program_%s AND "
+                    "test_cases.name == :test_case_%s)") % i % i);
+            }
+        }
+        conditions.push_back("(" + text::join(test_cases, " OR ") + ")");
+    }
+
+    if (!filter.types.empty()) {
+        std::vector< std::string > types;
+        for (std::size_t i = 0; i < filter.types.size(); ++i)
+            types.push_back(F(":type_%s") % i);
+        conditions.push_back(F("test_results.result_type IN (%s)") %
+                             text::join(types, ", "));
+    }
+
+    if (conditions.empty())
+        return "";
+    else
+        return "WHERE " + text::join(conditions, " AND ") + " ";
+}
+
+
+/// Translates the ordering of a results filter into an SQL clause.
+///
+/// The values to compare against are left as parameters to be bound by
+/// bind_order().
+///
+/// \param filter The filter to translate.
+///
+/// \return An ORDER BY clause for a query on the results_tables.
+static std::string
+order_to_sql(const store::results_filter& filter)
+{
+    std::string types_order;
+    if (!filter.types_order.empty()) {
+        types_order = "CASE test_results.result_type ";
+        for (std::size_t i = 0; i < filter.types_order.size(); ++i)
+            types_order += F("WHEN :order_%s THEN %s ") % i % i;
+        types_order += F("ELSE %s END, ") % filter.types_order.size();
+    }
+    return "ORDER BY " + types_order +
+        "test_programs.absolute_path, test_cases.name";
+}
+
+
+/// Binds the values of the ordering of a results filter to a statement.
+///
+/// \param stmt The statement whose query was built with order_to_sql().
+/// \param filter The filter used to build the statement.
+static void
+bind_order(sqlite::statement& stmt, const store::results_filter& filter)
+{
+    for (std::size_t i = 0; i < filter.types_order.size(); ++i)
+        store::bind_test_result_type(
+            stmt, (F(":order_%s") % i).str().c_str(), filter.types_order[i]);
+}
+
+
+/// Binds the values of a results filter to a statement.
+///
+/// \param stmt The statement whose query was built with filter_to_sql().
+/// \param filter The filter used to build the statement.
+static void
+bind_filter(sqlite::statement& stmt, const store::results_filter& filter)
+{
+    std::size_t i = 0;
+    for (std::set< std::pair< fs::path, std::string > >::const_iterator
+             iter = filter.test_cases.begin();
+         test_cases_in_sql(filter) && iter != filter.test_cases.end();
+         ++iter, ++i) {
+        const std::string program = (*iter).first.str();
+        stmt.bind((F(":program_%s") % i).str().c_str(), program);
+        if ((*iter).second.empty()) {
+            stmt.bind((F(":directory_%s") % i).str().c_str(), program + "/");
+            stmt.bind((F(":directory_end_%s") % i).str().c_str(),
+                      program + static_cast< char >('/' + 1));
+        } else {
+            stmt.bind((F(":test_case_%s") % i).str().c_str(), (*iter).second);
+        }
+    }
+
+    i = 0;
+    for (std::set< model::test_result_type >::const_iterator
+             iter = filter.types.begin(); iter != filter.types.end();
+         ++iter, ++i) {
+        store::bind_test_result_type(
+            stmt, (F(":type_%s") % i).str().c_str(), *iter);
+    }
+}
+
+
 }  // anonymous namespace
 
 
@@ -258,9 +746,14 @@ struct store::results_iterator::impl : utils::noncopyable {
     /// The statement to iterate on.
     sqlite::statement _stmt;
 
-    /// A cache for the last loaded test program.
-    optional< std::pair< int64_t, model::test_program_ptr > >
-        _last_test_program;
+    /// Cache of the recently loaded test programs.
+    lru_cache< model::test_program_ptr > _test_programs;
+
+    /// Cache of the recently loaded metadata objects of the test cases.
+    lru_cache< model::metadata > _metadatas;
+
+    /// The restrictions on the results to iterate on.
+    const store::results_filter _filter;
 
     /// Whether the iterator is still valid or not.
     bool _valid;
@@ -268,22 +761,39 @@ struct store::results_iterator::impl : utils::noncopyable {
     /// Constructor.
     ///
     /// \param backend_ The store backend implementation.
-    impl(store::read_backend& backend_) :
+    /// \param filter The restrictions on the results to iterate on.
+    impl(store::read_backend& backend_, const store::results_filter& filter) :
         _backend(backend_),
         _stmt(backend_.database().create_statement(
-            "SELECT test_programs.test_program_id, "
-            "    test_programs.interface, "
-            "    test_cases.test_case_id, test_cases.name, "
-            "    test_results.result_type, test_results.result_reason, "
-            "    test_results.start_time, test_results.end_time "
-            "FROM test_programs "
-            "    JOIN test_cases "
-            "    ON test_programs.test_program_id = test_cases.test_program_id "
-            "    JOIN test_results "
-            "    ON test_cases.test_case_id = test_results.test_case_id "
-            "ORDER BY test_programs.absolute_path, test_cases.name"))
+            std::string(
+                "SELECT test_programs.test_program_id, "
+                "    test_programs.interface, test_programs.relative_path, "
+                "    test_cases.test_case_id, test_cases.name, "
+                "    test_cases.metadata_id, "
+                "    test_results.result_type, test_results.result_reason, "
+                "    test_results.start_time, test_results.end_time "
+                "FROM ") + results_tables + filter_to_sql(filter) +
+            order_to_sql(filter))),
+        _test_programs(cached_test_programs),
+        _metadatas(cached_metadatas),
+        _filter(filter)
+    {
+        bind_filter(_stmt, filter);
+        bind_order(_stmt, filter);
+        next();
+    }
+
+    /// Moves the statement to the next result that matches the filter.
+    void
+    next(void)
     {
         _valid = _stmt.step();
+        if (test_cases_in_sql(_filter))
+            return;
+        while (_valid && !match_test_cases(
+                   _filter, _stmt.safe_column_text("relative_path"),
+                   _stmt.safe_column_text("name")))
+            _valid = _stmt.step();
     }
 };
 
@@ -310,7 +820,7 @@ store::results_iterator::~results_iterator(void)
 store::results_iterator&
 store::results_iterator::operator++(void)
 {
-    _pimpl->_valid = _pimpl->_stmt.step();
+    _pimpl->next();
     return *this;
 }
 
@@ -326,19 +836,49 @@ store::results_iterator::operator bool(void) const
 
 /// Gets the test program this result belongs to.
 ///
+/// The test cases of the returned test program are only loaded from the
+/// database if queried.  Use test_case() to get the test case of this result
+/// alone.
+///
 /// \return The representation of a test program.
 const model::test_program_ptr
 store::results_iterator::test_program(void) const
 {
     const int64_t id = _pimpl->_stmt.safe_column_int64("test_program_id");
-    if (!_pimpl->_last_test_program ||
-        _pimpl->_last_test_program.get().first != id)
-    {
-        const model::test_program_ptr tp = detail::get_test_program(
-            _pimpl->_backend, id);
-        _pimpl->_last_test_program = std::make_pair(id, tp);
+    const model::test_program_ptr* test_program =
+        _pimpl->_test_programs.find(id);
+    if (test_program == NULL) {
+        return _pimpl->_test_programs.insert(
+            id, get_lazy_test_program(_pimpl->_backend, id));
     }
-    return _pimpl->_last_test_program.get().second;
+    return *test_program;
+}
+
+
+/// Gets the test case pointed by the iterator.
+///
+/// Unlike test_program()->find(), this only loads the metadata of this test
+/// case from the database.
+///
+/// \return The representation of a test case, with the defaults of the
+/// metadata of its test program applied.
+///
+/// \throw integrity_error If there is any problem in the loaded data.
+model::test_case
+store::results_iterator::test_case(void) const
+{
+    const model::test_program_ptr program = test_program();
+
+    const int64_t metadata_id = _pimpl->_stmt.safe_column_int64("metadata_id");
+    const model::metadata* metadata = _pimpl->_metadatas.find(metadata_id);
+    if (metadata == NULL) {
+        metadata = &_pimpl->_metadatas.insert(
+            metadata_id, get_metadata(_pimpl->_backend.database(),
+                                      metadata_id));
+    }
+
+    return model::test_case(test_case_name(), *metadata)
+        .apply_metadata_defaults(&program->get_metadata());
 }
 
 
@@ -437,6 +977,75 @@ store::results_iterator::stderr_contents(void) const
 }
 
 
+/// Opens a file from a test case for reading.
+///
+/// \param backend The backend to read the file from.
+/// \param test_case_id The identifier of the test case.
+/// \param filename The name of the file to be opened.
+///
+/// \return A stream to read the file contents, which is empty if the test case
+/// did not store such a file.
+///
+/// \throw integrity_error If there is any problem in the loaded data or if the
+///     file cannot be found.
+static std::auto_ptr< std::istream >
+open_test_case_file(store::read_backend& backend, const int64_t test_case_id,
+                    const char* filename)
+{
+    try {
+        sqlite::statement stmt = backend.database().create_statement(
+            "SELECT file_id, codec "
+            "FROM test_case_files NATURAL JOIN files "
+            "WHERE test_case_id == :test_case_id AND file_name == :file_name");
+        stmt.bind(":test_case_id", test_case_id);
+        stmt.bind(":file_name", filename);
+        if (!stmt.step())
+            return std::auto_ptr< std::istream >(new std::istringstream(""));
+        return std::auto_ptr< std::istream >(new file_istream(
+            backend, stmt.safe_column_int64("file_id"),
+            stmt.safe_column_text("codec")));
+    } catch (const sqlite::error& e) {
+        throw store::integrity_error(e.what());
+    }
+}
+
+
+/// Opens the stdout of a test case for reading.
+///
+/// Use this instead of stdout_contents() to avoid loading large files into
+/// memory.
+///
+/// \return A stream to read the stdout contents of the test case.  This may of
+/// course be empty if the test case didn't print anything.
+///
+/// \throw integrity_error If the file cannot be read.
+std::auto_ptr< std::istream >
+store::results_iterator::stdout_stream(void) const
+{
+    return open_test_case_file(_pimpl->_backend,
+                               _pimpl->_stmt.safe_column_int64("test_case_id"),
+                               "__STDOUT__");
+}
+
+
+/// Opens the stderr of a test case for reading.
+///
+/// Use this instead of stderr_contents() to avoid loading large files into
+/// memory.
+///
+/// \return A stream to read the stderr contents of the test case.  This may of
+/// course be empty if the test case didn't print anything.
+///
+/// \throw integrity_error If the file cannot be read.
+std::auto_ptr< std::istream >
+store::results_iterator::stderr_stream(void) const
+{
+    return open_test_case_file(_pimpl->_backend,
+                               _pimpl->_stmt.safe_column_int64("test_case_id"),
+                               "__STDERR__");
+}
+
+
 /// Internal implementation for a store read-only transaction.
 struct store::read_transaction::impl : utils::noncopyable {
     /// The backend instance.
@@ -515,6 +1124,28 @@ store::read_transaction::get_context(void)
 }
 
 
+/// Checks whether the test run that generated the results completed.
+///
+/// \return False if the run was interrupted and the results are partial; true
+/// otherwise, including for databases migrated from versions that did not
+/// record this status.
+///
+/// \throw error If there is any problem loading the status.
+bool
+store::read_transaction::get_completed(void)
+{
+    try {
+        sqlite::statement stmt = _pimpl->_db.create_statement(
+            "SELECT completed FROM run_status");
+        if (!stmt.step())
+            return true;
+        return store::column_bool(stmt, "completed");
+    } catch (const sqlite::error& e) {
+        throw error(F("Error loading run status: %s") % e.what());
+    }
+}
+
+
 /// Creates a new iterator to scan tests results.
 ///
 /// \return The constructed iterator.
@@ -522,10 +1153,131 @@ store::read_transaction::get_context(void)
 /// \throw error If there is any problem constructing the iterator.
 store::results_iterator
 store::read_transaction::get_results(void)
+{
+    return get_results(results_filter());
+}
+
+
+/// Creates a new iterator to scan the tests results that match a filter.
+///
+/// \param filter The restrictions on the results to scan.
+///
+/// \return The constructed iterator.
+///
+/// \throw error If there is any problem constructing the iterator.
+store::results_iterator
+store::read_transaction::get_results(const results_filter& filter)
 {
     try {
         return results_iterator(std::shared_ptr< results_iterator::impl >(
-           new results_iterator::impl(_pimpl->_backend)));
+           new results_iterator::impl(_pimpl->_backend, filter)));
+    } catch (const sqlite::error& e) {
+        throw error(e.what());
+    }
+}
+
+
+/// Checks whether any test result matches a filter.
+///
+/// \param filter The restrictions on the results to look for.
+///
+/// \return True if there is at least one matching result.
+///
+/// \throw error If there is any problem querying the results.
+bool
+store::read_transaction::has_results(const results_filter& filter)
+{
+    if (!test_cases_in_sql(filter))
+        return get_results(filter);
+
+    try {
+        sqlite::statement stmt = _pimpl->_db.create_statement(
+            std::string("SELECT 1 FROM ") + results_tables +
+            filter_to_sql(filter) + "LIMIT 1");
+        bind_filter(stmt, filter);
+        return stmt.step();
+    } catch (const sqlite::error& e) {
+        throw error(e.what());
+    }
+}
+
+
+/// Computes aggregated data of test results in memory.
+///
+/// This is the in-memory equivalent of the query of get_results_totals(), used
+/// for filters that cannot be expressed in SQL.
+///
+/// \param iter The results to aggregate.
+///
+/// \return The aggregated data broken down by result type.
+static store::results_totals_map
+sum_results(store::results_iterator iter)
+{
+    store::results_totals_map totals;
+    for (; iter; ++iter) {
+        const model::test_result_type type = iter.result().type();
+        const datetime::timestamp start_time = iter.start_time();
+        const datetime::timestamp end_time = iter.end_time();
+        const datetime::delta duration = end_time - start_time;
+
+        const store::results_totals_map::iterator entry = totals.find(type);
+        if (entry == totals.end()) {
+            totals.insert(std::make_pair(
+                type, store::results_totals(1, duration, start_time,
+                                            end_time)));
+        } else {
+            store::results_totals& current = (*entry).second;
+            current.count++;
+            current.runtime += duration;
+            if (start_time < current.start_time)
+                current.start_time = start_time;
+            if (current.end_time < end_time)
+                current.end_time = end_time;
+        }
+    }
+    return totals;
+}
+
+
+/// Computes aggregated data of the test results that match a filter.
+///
+/// This allows summarizing all results without fetching them one by one.
+///
+/// \param filter The restrictions on the results to aggregate.
+///
+/// \return The aggregated data broken down by result type.  Types without any
+/// matching results are not present.
+///
+/// \throw error If there is any problem querying the results.
+store::results_totals_map
+store::read_transaction::get_results_totals(const results_filter& filter)
+{
+    try {
+        if (!test_cases_in_sql(filter))
+            return sum_results(get_results(filter));
+
+        sqlite::statement stmt = _pimpl->_db.create_statement(
+            std::string(
+                "SELECT test_results.result_type AS result_type, "
+                "    COUNT(*) AS count, "
+                "    SUM(test_results.end_time - test_results.start_time) "
+                "        AS runtime, "
+                "    MIN(test_results.start_time) AS start_time, "
+                "    MAX(test_results.end_time) AS end_time "
+                "FROM ") + results_tables + filter_to_sql(filter) +
+            "GROUP BY test_results.result_type");
+        bind_filter(stmt, filter);
+
+        results_totals_map totals;
+        while (stmt.step()) {
+            totals.insert(std::make_pair(
+                column_test_result_type(stmt, "result_type"),
+                results_totals(stmt.safe_column_int64("count"),
+                               column_delta(stmt, "runtime"),
+                               column_timestamp(stmt, "start_time"),
+                               column_timestamp(stmt, "end_time"))));
+        }
+        return totals;
     } catch (const sqlite::error& e) {
         throw error(e.what());
     }
@@ -38,15 +38,22 @@ extern "C" {
 #include <stdint.h>
 }
 
+#include <cstddef>
+#include <istream>
 #include <memory>
+#include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "model/context_fwd.hpp"
+#include "model/test_case_fwd.hpp"
 #include "model/test_program_fwd.hpp"
 #include "model/test_result_fwd.hpp"
 #include "store/read_backend_fwd.hpp"
 #include "store/read_transaction_fwd.hpp"
-#include "utils/datetime_fwd.hpp"
+#include "utils/datetime.hpp"
+#include "utils/fs/path.hpp"
 
 namespace store {
 
@@ -60,6 +67,69 @@ model::test_program_ptr get_test_program(read_backend&, const int64_t);
 }  // namespace detail
 
 
+/// Restriction of the results to be retrieved from the database.
+///
+/// The restrictions are translated into the query that fetches the results so
+/// that the database only returns the matching ones.  A default-constructed
+/// object matches all results.
+class results_filter {
+public:
+    /// Test cases to match, as pairs of a test program and a test case name.
+    ///
+    /// The test program can also be the name of a directory to match all the
+    /// test programs within it, and the test case name can be empty to match
+    /// all test cases of the test program.  If empty, no results are excluded
+    /// by their test case.
+    std::set< std::pair< utils::fs::path, std::string > > test_cases;
+
+    /// Types of the results to match.
+    ///
+    /// If empty, no results are excluded by their type.
+    std::set< model::test_result_type > types;
+
+    /// Order in which to return the results by their type.
+    ///
+    /// If not empty, the results are grouped by their type in this order, and
+    /// the results whose type is not listed come last.  Within each group,
+    /// and if empty, the results are sorted by test case.  This does not
+    /// exclude any results; use types for that.
+    std::vector< model::test_result_type > types_order;
+};
+
+
+/// Aggregated data of a collection of test case results.
+struct results_totals {
+    /// Number of results in the collection.
+    std::size_t count;
+
+    /// Sum of the durations of the test cases.
+    utils::datetime::delta runtime;
+
+    /// Start time of the test case that started first.
+    utils::datetime::timestamp start_time;
+
+    /// End time of the test case that finished last.
+    utils::datetime::timestamp end_time;
+
+    /// Initializer for the tuple's fields.
+    ///
+    /// \param count_ Number of results in the collection.
+    /// \param runtime_ Sum of the durations of the test cases.
+    /// \param start_time_ Start time of the test case that started first.
+    /// \param end_time_ End time of the test case that finished last.
+    results_totals(const std::size_t count_,
+                   const utils::datetime::delta& runtime_,
+                   const utils::datetime::timestamp& start_time_,
+                   const utils::datetime::timestamp& end_time_) :
+        count(count_),
+        runtime(runtime_),
+        start_time(start_time_),
+        end_time(end_time_)
+    {
+    }
+};
+
+
 /// Iterator for the set of test case results that are part of an action.
 ///
 /// \todo Note that this is not a "standard" C++ iterator.  I have chosen to
@@ -83,12 +153,15 @@ public:
 
     const model::test_program_ptr test_program(void) const;
     std::string test_case_name(void) const;
+    model::test_case test_case(void) const;
     model::test_result result(void) const;
     utils::datetime::timestamp start_time(void) const;
     utils::datetime::timestamp end_time(void) const;
 
     std::string stdout_contents(void) const;
     std::string stderr_contents(void) const;
+    std::auto_ptr< std::istream > stdout_stream(void) const;
+    std::auto_ptr< std::istream > stderr_stream(void) const;
 };
 
 
@@ -111,7 +184,11 @@ public:
     void finish(void);
 
     model::context get_context(void);
+    bool get_completed(void);
     results_iterator get_results(void);
+    results_iterator get_results(const results_filter&);
+    bool has_results(const results_filter&);
+    results_totals_map get_results_totals(const results_filter&);
 };
 
 
@@ -32,11 +32,21 @@
 #if !defined(STORE_READ_TRANSACTION_FWD_HPP)
 #define STORE_READ_TRANSACTION_FWD_HPP
 
+#include <map>
+
+#include "model/test_result_fwd.hpp"
+
 namespace store {
 
 
 class read_transaction;
+class results_filter;
 class results_iterator;
+struct results_totals;
+
+
+/// Aggregated data of the results, broken down by their type.
+typedef std::map< model::test_result_type, results_totals > results_totals_map;
 
 
 }  // namespace store
@@ -28,13 +28,19 @@
 
 #include "store/read_transaction.hpp"
 
+#include <fstream>
+#include <istream>
 #include <map>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <atf-c++.hpp>
 
 #include "model/context.hpp"
 #include "model/metadata.hpp"
+#include "model/test_case.hpp"
 #include "model/test_program.hpp"
 #include "model/test_result.hpp"
 #include "store/exceptions.hpp"
@@ -42,11 +48,13 @@
 #include "store/write_backend.hpp"
 #include "store/write_transaction.hpp"
 #include "utils/datetime.hpp"
+#include "utils/format/macros.hpp"
 #include "utils/fs/path.hpp"
 #include "utils/logging/operations.hpp"
 #include "utils/optional.ipp"
 #include "utils/sqlite/database.hpp"
 #include "utils/sqlite/statement.ipp"
+#include "utils/stream.hpp"
 
 namespace datetime = utils::datetime;
 namespace fs = utils::fs;
@@ -54,6 +62,89 @@ namespace logging = utils::logging;
 namespace sqlite = utils::sqlite;
 
 
+namespace {
+
+
+/// Populates a results file with various test programs for filtering tests.
+///
+/// The results are:
+/// - dir/prog1:a, which passed between seconds 10 and 15.
+/// - dir/prog1:b, which failed between seconds 11 and 13.
+/// - dir/prog10:a, which passed between seconds 12 and 20.
+/// - dir/sub/prog2:a, which was skipped between seconds 5 and 6.
+/// - other/prog3:a, which failed between seconds 14 and 30.
+///
+/// \param db_name The database to create.
+static void
+populate_filter_results(const char* db_name)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path(db_name));
+    store::write_transaction tx = backend.start_write();
+
+    tx.put_context(model::context(fs::path("/foo/bar"),
+                                  std::map< std::string, std::string >()));
+
+    const struct {
+        const char* program;
+        const char* test_case;
+        model::test_result_type type;
+        int64_t start;
+        int64_t end;
+    } results[] = {
+        { "dir/prog1", "a", model::test_result_passed, 10, 15 },
+        { "dir/prog1", "b", model::test_result_failed, 11, 13 },
+        { "dir/prog10", "a", model::test_result_passed, 12, 20 },
+        { "dir/sub/prog2", "a", model::test_result_skipped, 5, 6 },
+        { "other/prog3", "a", model::test_result_failed, 14, 30 },
+    };
+
+    for (std::size_t i = 0; i < sizeof(results) / sizeof(results[0]); ++i) {
+        const model::test_program test_program = model::test_program_builder(
+            "plain", fs::path(results[i].program), fs::path("/the/root"),
+            "suite")
+            .add_test_case("a")
+            .add_test_case("b")
+            .build();
+        const int64_t tp_id = tx.put_test_program(test_program);
+        const int64_t tc_id = tx.put_test_case(
+            test_program, results[i].test_case, tp_id);
+        const model::test_result result =
+            results[i].type == model::test_result_passed ?
+            model::test_result(results[i].type) :
+            model::test_result(results[i].type, "Reason");
+        tx.put_result(
+            result, tc_id,
+            datetime::timestamp::from_microseconds(results[i].start * 1000000),
+            datetime::timestamp::from_microseconds(results[i].end * 1000000));
+    }
+
+    tx.commit();
+}
+
+
+/// Gets the identifiers of the results that match a filter.
+///
+/// \param tx The transaction to query the results from.
+/// \param filter The filter to apply.
+///
+/// \return The matching results as program:test_case strings, in the order
+/// returned by the iterator.
+static std::vector< std::string >
+filtered_results(store::read_transaction& tx,
+                 const store::results_filter& filter)
+{
+    std::vector< std::string > ids;
+    for (store::results_iterator iter = tx.get_results(filter); iter; ++iter)
+        ids.push_back(F("%s:%s") % iter.test_program()->relative_path() %
+                      iter.test_case_name());
+    return ids;
+}
+
+
+}  // anonymous namespace
+
+
 ATF_TEST_CASE(get_context__missing);
 ATF_TEST_CASE_HEAD(get_context__missing)
 {
@@ -150,6 +241,74 @@ ATF_TEST_CASE_BODY(get_context__invalid_env_vars)
 }
 
 
+ATF_TEST_CASE(get_completed__unknown);
+ATF_TEST_CASE_HEAD(get_completed__unknown)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_completed__unknown)
+{
+    {
+        store::write_backend backend = store::write_backend::open_rw(
+            fs::path("test.db"));
+        store::write_transaction tx = backend.start_write();
+        tx.commit();
+    }
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+    ATF_REQUIRE(tx.get_completed());
+}
+
+
+ATF_TEST_CASE(get_completed__true);
+ATF_TEST_CASE_HEAD(get_completed__true)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_completed__true)
+{
+    {
+        store::write_backend backend = store::write_backend::open_rw(
+            fs::path("test.db"));
+        store::write_transaction tx = backend.start_write();
+        tx.put_run_status(true);
+        tx.commit();
+    }
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+    ATF_REQUIRE(tx.get_completed());
+}
+
+
+ATF_TEST_CASE(get_completed__false);
+ATF_TEST_CASE_HEAD(get_completed__false)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_completed__false)
+{
+    {
+        store::write_backend backend = store::write_backend::open_rw(
+            fs::path("test.db"));
+        store::write_transaction tx = backend.start_write();
+        tx.put_run_status(false);
+        tx.commit();
+    }
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+    ATF_REQUIRE(!tx.get_completed());
+}
+
+
 ATF_TEST_CASE(get_results__none);
 ATF_TEST_CASE_HEAD(get_results__none)
 {
@@ -251,12 +410,518 @@ ATF_TEST_CASE_BODY(get_results__many)
 }
 
 
+ATF_TEST_CASE(get_results__large_files);
+ATF_TEST_CASE_HEAD(get_results__large_files)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_results__large_files)
+{
+    std::string stdout_contents;
+    while (stdout_contents.length() < 3 * 1024 * 1024)
+        stdout_contents += F("Line %s of a very verbose test\n") %
+            stdout_contents.length();
+    std::string stderr_contents;
+    unsigned int seed = 1;
+    while (stderr_contents.length() < 2 * 1024 * 1024) {
+        seed = seed * 1103515245 + 12345;
+        stderr_contents += static_cast< char >(seed >> 16);
+    }
+    {
+        std::ofstream output("test.out", std::ios::binary);
+        output << stdout_contents;
+    }
+    {
+        std::ofstream output("test.err", std::ios::binary);
+        output << stderr_contents;
+    }
+
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    store::write_transaction tx = backend.start_write();
+    tx.put_context(model::context(fs::path("/foo/bar"),
+                                  std::map< std::string, std::string >()));
+    const model::test_program test_program = model::test_program_builder(
+        "plain", fs::path("a/prog1"), fs::path("/the/root"), "suite1")
+        .add_test_case("main")
+        .build();
+    const int64_t tp_id = tx.put_test_program(test_program);
+    const int64_t tc_id = tx.put_test_case(test_program, "main", tp_id);
+    tx.put_test_case_file("__STDOUT__", fs::path("test.out"), tc_id);
+    tx.put_test_case_file("__STDERR__", fs::path("test.err"), tc_id);
+    tx.put_result(model::test_result(model::test_result_passed), tc_id,
+                  datetime::timestamp::from_microseconds(1000),
+                  datetime::timestamp::from_microseconds(2000));
+    tx.commit();
+    backend.close();
+
+    store::read_backend backend2 = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx2 = backend2.start_read();
+    store::results_iterator iter = tx2.get_results();
+    ATF_REQUIRE(iter);
+    ATF_REQUIRE(stdout_contents == iter.stdout_contents());
+    ATF_REQUIRE(stdout_contents == utils::read_stream(*iter.stdout_stream()));
+    ATF_REQUIRE(stderr_contents == iter.stderr_contents());
+    ATF_REQUIRE(stderr_contents == utils::read_stream(*iter.stderr_stream()));
+    ATF_REQUIRE(!++iter);
+}
+
+
+ATF_TEST_CASE(get_results__streams);
+ATF_TEST_CASE_HEAD(get_results__streams)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_results__streams)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    store::write_transaction tx = backend.start_write();
+    tx.put_context(model::context(fs::path("/foo/bar"),
+                                  std::map< std::string, std::string >()));
+    const model::test_program test_program = model::test_program_builder(
+        "plain", fs::path("a/prog1"), fs::path("/the/root"), "suite1")
+        .add_test_case("main")
+        .build();
+    const int64_t tp_id = tx.put_test_program(test_program);
+    const int64_t tc_id = tx.put_test_case(test_program, "main", tp_id);
+    tx.put_test_case_contents("__STDOUT__", "Line 1\nLine 2\n", tc_id);
+    tx.put_result(model::test_result(model::test_result_passed), tc_id,
+                  datetime::timestamp::from_microseconds(1000),
+                  datetime::timestamp::from_microseconds(2000));
+    tx.commit();
+    backend.close();
+
+    store::read_backend backend2 = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx2 = backend2.start_read();
+    store::results_iterator iter = tx2.get_results();
+    ATF_REQUIRE(iter);
+
+    std::auto_ptr< std::istream > input = iter.stdout_stream();
+    std::string line;
+    ATF_REQUIRE(std::getline(*input, line));
+    ATF_REQUIRE_EQ("Line 1", line);
+    ATF_REQUIRE(std::getline(*input, line));
+    ATF_REQUIRE_EQ("Line 2", line);
+    ATF_REQUIRE(!std::getline(*input, line));
+
+    ATF_REQUIRE(utils::read_stream(*iter.stderr_stream()).empty());
+}
+
+
+ATF_TEST_CASE(get_results__test_case);
+ATF_TEST_CASE_HEAD(get_results__test_case)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_results__test_case)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    store::write_transaction tx = backend.start_write();
+    tx.put_context(model::context(fs::path("/foo/bar"),
+                                  std::map< std::string, std::string >()));
+
+    const model::test_program test_program = model::test_program_builder(
+        "atf", fs::path("dir/prog"), fs::path("/the/root"), "suite")
+        .set_metadata(model::metadata_builder()
+                      .add_custom("program-var", "program-value")
+                      .build())
+        .add_test_case("first", model::metadata_builder()
+                       .set_description("First description")
+                       .build())
+        .add_test_case("second", model::metadata_builder()
+                       .add_custom("case-var", "case-value")
+                       .build())
+        .build();
+    const datetime::timestamp start_time =
+        datetime::timestamp::from_microseconds(1000000);
+    const datetime::timestamp end_time =
+        datetime::timestamp::from_microseconds(2000000);
+    {
+        const int64_t tp_id = tx.put_test_program(test_program);
+        tx.put_test_case(test_program, "first", tp_id);
+        const int64_t tc_id = tx.put_test_case(test_program, "second", tp_id);
+        tx.put_result(model::test_result(model::test_result_passed), tc_id,
+                      start_time, end_time);
+    }
+    tx.commit();
+    backend.close();
+
+    store::read_backend backend2 = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx2 = backend2.start_read();
+    store::results_iterator iter = tx2.get_results();
+    ATF_REQUIRE(iter);
+    ATF_REQUIRE_EQ(test_program.find("second"), iter.test_case());
+    ATF_REQUIRE_EQ(test_program, *iter.test_program());
+    ATF_REQUIRE(!++iter);
+}
+
+
+ATF_TEST_CASE(get_results__many_programs);
+ATF_TEST_CASE_HEAD(get_results__many_programs)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_results__many_programs)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    store::write_transaction tx = backend.start_write();
+    tx.put_context(model::context(fs::path("/foo/bar"),
+                                  std::map< std::string, std::string >()));
+
+    std::vector< model::test_program > test_programs;
+    for (int i = 0; i < 50; ++i) {
+        const model::test_program test_program = model::test_program_builder(
+            "plain", fs::path(F("prog%s%s") % (i / 10) % (i % 10)), fs::path("/the/root"),
+            "suite")
+            .add_test_case("main", model::metadata_builder()
+                           .add_custom("index", F("%s") % i)
+                           .build())
+            .build();
+        const int64_t tp_id = tx.put_test_program(test_program);
+        const int64_t tc_id = tx.put_test_case(test_program, "main", tp_id);
+        tx.put_result(model::test_result(model::test_result_passed), tc_id,
+                      datetime::timestamp::from_microseconds(1000000),
+                      datetime::timestamp::from_microseconds(2000000));
+        test_programs.push_back(test_program);
+    }
+    tx.commit();
+    backend.close();
+
+    store::read_backend backend2 = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx2 = backend2.start_read();
+    store::results_iterator iter = tx2.get_results();
+    for (std::vector< model::test_program >::const_iterator tp_iter =
+             test_programs.begin(); tp_iter != test_programs.end();
+         ++tp_iter) {
+        ATF_REQUIRE(iter);
+        ATF_REQUIRE_EQ((*tp_iter).relative_path(),
+                       iter.test_program()->relative_path());
+        ATF_REQUIRE_EQ((*tp_iter).find("main"), iter.test_case());
+        ATF_REQUIRE_EQ(*tp_iter, *iter.test_program());
+        ++iter;
+    }
+    ATF_REQUIRE(!iter);
+}
+
+
+ATF_TEST_CASE(get_results__filter__test_cases);
+ATF_TEST_CASE_HEAD(get_results__filter__test_cases)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_results__filter__test_cases)
+{
+    populate_filter_results("test.db");
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+
+    {
+        store::results_filter filter;
+        filter.test_cases.insert(std::make_pair(fs::path("dir/prog1"), ""));
+        std::vector< std::string > exp_ids;
+        exp_ids.push_back("dir/prog1:a");
+        exp_ids.push_back("dir/prog1:b");
+        ATF_REQUIRE(exp_ids == filtered_results(tx, filter));
+    }
+
+    {
+        store::results_filter filter;
+        filter.test_cases.insert(std::make_pair(fs::path("dir"), ""));
+        std::vector< std::string > exp_ids;
+        exp_ids.push_back("dir/prog1:a");
+        exp_ids.push_back("dir/prog1:b");
+        exp_ids.push_back("dir/prog10:a");
+        exp_ids.push_back("dir/sub/prog2:a");
+        ATF_REQUIRE(exp_ids == filtered_results(tx, filter));
+    }
+
+    {
+        store::results_filter filter;
+        filter.test_cases.insert(std::make_pair(fs::path("dir/prog1"), "b"));
+        filter.test_cases.insert(std::make_pair(fs::path("other"), ""));
+        std::vector< std::string > exp_ids;
+        exp_ids.push_back("dir/prog1:b");
+        exp_ids.push_back("other/prog3:a");
+        ATF_REQUIRE(exp_ids == filtered_results(tx, filter));
+    }
+
+    {
+        store::results_filter filter;
+        filter.test_cases.insert(std::make_pair(fs::path("dir/prog"), ""));
+        filter.test_cases.insert(std::make_pair(fs::path("dir/sub"), "b"));
+        ATF_REQUIRE(filtered_results(tx, filter).empty());
+    }
+}
+
+
+ATF_TEST_CASE(get_results__filter__many_test_cases);
+ATF_TEST_CASE_HEAD(get_results__filter__many_test_cases)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_results__filter__many_test_cases)
+{
+    populate_filter_results("test.db");
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+
+    // Use more filters than fit in a single SQL query, most of which do not
+    // match anything.
+    store::results_filter filter;
+    for (int i = 0; i < 1000; ++i) {
+        filter.test_cases.insert(std::make_pair(
+            fs::path(F("missing/prog%s") % i), ""));
+        filter.test_cases.insert(std::make_pair(
+            fs::path(F("dir/prog%s") % i), "b"));
+    }
+    filter.test_cases.insert(std::make_pair(fs::path("dir/sub"), ""));
+    filter.test_cases.insert(std::make_pair(fs::path("other/prog3"), "a"));
+
+    std::vector< std::string > exp_ids;
+    exp_ids.push_back("dir/prog1:b");
+    exp_ids.push_back("dir/sub/prog2:a");
+    exp_ids.push_back("other/prog3:a");
+    ATF_REQUIRE(exp_ids == filtered_results(tx, filter));
+    ATF_REQUIRE(tx.has_results(filter));
+
+    const store::results_totals_map totals = tx.get_results_totals(filter);
+    ATF_REQUIRE_EQ(2, totals.size());
+    const store::results_totals& failed = totals.find(
+        model::test_result_failed)->second;
+    ATF_REQUIRE_EQ(2, failed.count);
+    ATF_REQUIRE_EQ(datetime::delta(18, 0), failed.runtime);
+    ATF_REQUIRE_EQ(datetime::timestamp::from_microseconds(11000000),
+                   failed.start_time);
+    ATF_REQUIRE_EQ(datetime::timestamp::from_microseconds(30000000),
+                   failed.end_time);
+    ATF_REQUIRE_EQ(1, totals.find(model::test_result_skipped)->second.count);
+
+    filter.types.insert(model::test_result_passed);
+    ATF_REQUIRE(filtered_results(tx, filter).empty());
+    ATF_REQUIRE(!tx.has_results(filter));
+    ATF_REQUIRE(tx.get_results_totals(filter).empty());
+}
+
+
+ATF_TEST_CASE(get_results__filter__types);
+ATF_TEST_CASE_HEAD(get_results__filter__types)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_results__filter__types)
+{
+    populate_filter_results("test.db");
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+
+    {
+        store::results_filter filter;
+        filter.types.insert(model::test_result_failed);
+        std::vector< std::string > exp_ids;
+        exp_ids.push_back("dir/prog1:b");
+        exp_ids.push_back("other/prog3:a");
+        ATF_REQUIRE(exp_ids == filtered_results(tx, filter));
+    }
+
+    {
+        store::results_filter filter;
+        filter.test_cases.insert(std::make_pair(fs::path("dir"), ""));
+        filter.types.insert(model::test_result_failed);
+        filter.types.insert(model::test_result_skipped);
+        std::vector< std::string > exp_ids;
+        exp_ids.push_back("dir/prog1:b");
+        exp_ids.push_back("dir/sub/prog2:a");
+        ATF_REQUIRE(exp_ids == filtered_results(tx, filter));
+    }
+
+    {
+        store::results_filter filter;
+        filter.types.insert(model::test_result_broken);
+        ATF_REQUIRE(filtered_results(tx, filter).empty());
+    }
+}
+
+
+ATF_TEST_CASE(get_results__order__types);
+ATF_TEST_CASE_HEAD(get_results__order__types)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_results__order__types)
+{
+    populate_filter_results("test.db");
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+
+    {
+        store::results_filter filter;
+        filter.types_order.push_back(model::test_result_skipped);
+        filter.types_order.push_back(model::test_result_failed);
+        filter.types_order.push_back(model::test_result_passed);
+        std::vector< std::string > exp_ids;
+        exp_ids.push_back("dir/sub/prog2:a");
+        exp_ids.push_back("dir/prog1:b");
+        exp_ids.push_back("other/prog3:a");
+        exp_ids.push_back("dir/prog1:a");
+        exp_ids.push_back("dir/prog10:a");
+        ATF_REQUIRE(exp_ids == filtered_results(tx, filter));
+    }
+
+    {
+        store::results_filter filter;
+        filter.types_order.push_back(model::test_result_failed);
+        std::vector< std::string > exp_ids;
+        exp_ids.push_back("dir/prog1:b");
+        exp_ids.push_back("other/prog3:a");
+        exp_ids.push_back("dir/prog1:a");
+        exp_ids.push_back("dir/prog10:a");
+        exp_ids.push_back("dir/sub/prog2:a");
+        ATF_REQUIRE(exp_ids == filtered_results(tx, filter));
+    }
+
+    {
+        store::results_filter filter;
+        filter.test_cases.insert(std::make_pair(fs::path("dir"), ""));
+        filter.types.insert(model::test_result_passed);
+        filter.types.insert(model::test_result_failed);
+        filter.types_order.push_back(model::test_result_passed);
+        filter.types_order.push_back(model::test_result_failed);
+        std::vector< std::string > exp_ids;
+        exp_ids.push_back("dir/prog1:a");
+        exp_ids.push_back("dir/prog10:a");
+        exp_ids.push_back("dir/prog1:b");
+        ATF_REQUIRE(exp_ids == filtered_results(tx, filter));
+    }
+}
+
+
+ATF_TEST_CASE(has_results);
+ATF_TEST_CASE_HEAD(has_results)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(has_results)
+{
+    populate_filter_results("test.db");
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+
+    ATF_REQUIRE(tx.has_results(store::results_filter()));
+
+    store::results_filter filter;
+    filter.test_cases.insert(std::make_pair(fs::path("dir/sub"), ""));
+    ATF_REQUIRE(tx.has_results(filter));
+    filter.types.insert(model::test_result_passed);
+    ATF_REQUIRE(!tx.has_results(filter));
+
+    store::results_filter missing_filter;
+    missing_filter.test_cases.insert(
+        std::make_pair(fs::path("dir/prog1"), "c"));
+    ATF_REQUIRE(!tx.has_results(missing_filter));
+}
+
+
+ATF_TEST_CASE(get_results_totals);
+ATF_TEST_CASE_HEAD(get_results_totals)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(get_results_totals)
+{
+    populate_filter_results("test.db");
+
+    store::read_backend backend = store::read_backend::open_ro(
+        fs::path("test.db"));
+    store::read_transaction tx = backend.start_read();
+
+    {
+        const store::results_totals_map totals = tx.get_results_totals(
+            store::results_filter());
+        ATF_REQUIRE_EQ(3, totals.size());
+
+        const store::results_totals& passed = totals.find(
+            model::test_result_passed)->second;
+        ATF_REQUIRE_EQ(2, passed.count);
+        ATF_REQUIRE_EQ(datetime::delta(13, 0), passed.runtime);
+        ATF_REQUIRE_EQ(datetime::timestamp::from_microseconds(10000000),
+                       passed.start_time);
+        ATF_REQUIRE_EQ(datetime::timestamp::from_microseconds(20000000),
+                       passed.end_time);
+
+        const store::results_totals& failed = totals.find(
+            model::test_result_failed)->second;
+        ATF_REQUIRE_EQ(2, failed.count);
+        ATF_REQUIRE_EQ(datetime::delta(18, 0), failed.runtime);
+        ATF_REQUIRE_EQ(datetime::timestamp::from_microseconds(11000000),
+                       failed.start_time);
+        ATF_REQUIRE_EQ(datetime::timestamp::from_microseconds(30000000),
+                       failed.end_time);
+
+        const store::results_totals& skipped = totals.find(
+            model::test_result_skipped)->second;
+        ATF_REQUIRE_EQ(1, skipped.count);
+        ATF_REQUIRE_EQ(datetime::delta(1, 0), skipped.runtime);
+    }
+
+    {
+        store::results_filter filter;
+        filter.test_cases.insert(std::make_pair(fs::path("dir/prog1"), ""));
+        const store::results_totals_map totals = tx.get_results_totals(filter);
+        ATF_REQUIRE_EQ(2, totals.size());
+        ATF_REQUIRE_EQ(1, totals.find(model::test_result_passed)->second.count);
+        ATF_REQUIRE_EQ(1, totals.find(model::test_result_failed)->second.count);
+    }
+}
+
+
 ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, get_context__missing);
     ATF_ADD_TEST_CASE(tcs, get_context__invalid_cwd);
     ATF_ADD_TEST_CASE(tcs, get_context__invalid_env_vars);
 
+    ATF_ADD_TEST_CASE(tcs, get_completed__unknown);
+    ATF_ADD_TEST_CASE(tcs, get_completed__true);
+    ATF_ADD_TEST_CASE(tcs, get_completed__false);
+
     ATF_ADD_TEST_CASE(tcs, get_results__none);
     ATF_ADD_TEST_CASE(tcs, get_results__many);
+    ATF_ADD_TEST_CASE(tcs, get_results__large_files);
+    ATF_ADD_TEST_CASE(tcs, get_results__streams);
+    ATF_ADD_TEST_CASE(tcs, get_results__test_case);
+    ATF_ADD_TEST_CASE(tcs, get_results__many_programs);
+    ATF_ADD_TEST_CASE(tcs, get_results__filter__test_cases);
+    ATF_ADD_TEST_CASE(tcs, get_results__filter__many_test_cases);
+    ATF_ADD_TEST_CASE(tcs, get_results__filter__types);
+    ATF_ADD_TEST_CASE(tcs, get_results__order__types);
+
+    ATF_ADD_TEST_CASE(tcs, has_results);
+    ATF_ADD_TEST_CASE(tcs, get_results_totals);
 }
@@ -34,6 +34,7 @@
 #include "model/metadata.hpp"
 #include "model/test_program.hpp"
 #include "model/test_result.hpp"
+#include "store/contents.hpp"
 #include "store/migrate.hpp"
 #include "store/read_backend.hpp"
 #include "store/read_transaction.hpp"
@@ -44,6 +45,7 @@
 #include "utils/fs/path.hpp"
 #include "utils/logging/operations.hpp"
 #include "utils/sqlite/database.hpp"
+#include "utils/sqlite/statement.ipp"
 #include "utils/stream.hpp"
 #include "utils/units.hpp"
 
@@ -76,6 +78,19 @@ testdata_file(const std::string& name)
 }
 
 
+/// Gets the schema file with which results files were first created.
+///
+/// Unlike older schemas, this one is installed along the migration files
+/// because it is needed to split historical databases into results files.
+///
+/// \return The path to the installed schema_v3.sql file.
+static fs::path
+chunk_schema_file(void)
+{
+    return store::detail::migration_file(3, 4).branch_path() / "schema_v3.sql";
+}
+
+
 /// Validates the contents of the action with identifier 1.
 ///
 /// \param dbpath Path to the database in which to check the action contents.
@@ -451,6 +466,7 @@ CURRENT_SCHEMA_TEST(4);
              ++i) \
             required_files += " " + store::detail::migration_file( \
                 i, i + 1).str(); \
+        required_files += " " + chunk_schema_file().str(); \
         \
         set_md_var("require.files", required_files); \
     } \
@@ -480,6 +496,117 @@ MIGRATE_SCHEMA_TEST(1);
 MIGRATE_SCHEMA_TEST(2);
 
 
+ATF_TEST_CASE(migrate_schema__from_v3);
+ATF_TEST_CASE_HEAD(migrate_schema__from_v3)
+{
+    logging::set_inmemory();
+
+    std::string required_files =
+        chunk_schema_file().str() + " " +
+        testdata_file("testdata_v3_2.sql").str();
+    for (int i = 3; i < store::detail::current_schema_version; ++i)
+        required_files += " " + store::detail::migration_file(i, i + 1).str();
+
+    set_md_var("require.files", required_files);
+}
+ATF_TEST_CASE_BODY(migrate_schema__from_v3)
+{
+    const fs::path testpath("test.db");
+
+    {
+        sqlite::database db = sqlite::database::open(
+            testpath, sqlite::open_readwrite | sqlite::open_create);
+        db.exec(utils::read_file(chunk_schema_file()));
+        db.exec(utils::read_file(testdata_file("testdata_v3_2.sql")));
+        db.close();
+    }
+
+    store::migrate_schema(testpath);
+
+    check_action_2(testpath);
+
+    // Test programs 1, 3, 4 and 5 of the test data share their metadata.
+    sqlite::database db = sqlite::database::open(
+        testpath, sqlite::open_readonly);
+    sqlite::statement stmt = db.create_statement(
+        "SELECT COUNT(DISTINCT metadata_id) FROM metadatas");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(2, stmt.column_int64(0));
+    sqlite::statement sets_stmt = db.create_statement(
+        "SELECT COUNT(*) FROM metadata_sets");
+    ATF_REQUIRE(sets_stmt.step());
+    ATF_REQUIRE_EQ(2, sets_stmt.column_int64(0));
+
+    // Runs recorded before version 4 did not track their status.
+    sqlite::statement status_stmt = db.create_statement(
+        "SELECT COUNT(*) FROM run_status");
+    ATF_REQUIRE(status_stmt.step());
+    ATF_REQUIRE_EQ(0, status_stmt.column_int64(0));
+}
+
+
+ATF_TEST_CASE(migrate_schema__from_v3__files);
+ATF_TEST_CASE_HEAD(migrate_schema__from_v3__files)
+{
+    logging::set_inmemory();
+
+    std::string required_files = chunk_schema_file().str();
+    for (int i = 3; i < store::detail::current_schema_version; ++i)
+        required_files += " " + store::detail::migration_file(i, i + 1).str();
+
+    set_md_var("require.files", required_files);
+}
+ATF_TEST_CASE_BODY(migrate_schema__from_v3__files)
+{
+    const fs::path testpath("test.db");
+
+    std::string contents;
+    for (int i = 0; i < 100; ++i)
+        contents += "Repeated output line\n";
+
+    {
+        sqlite::database db = sqlite::database::open(
+            testpath, sqlite::open_readwrite | sqlite::open_create);
+        db.exec(utils::read_file(chunk_schema_file()));
+        for (int i = 1; i <= 3; ++i) {
+            const std::string file = i == 2 ? "Different" : contents;
+            sqlite::statement stmt = db.create_statement(
+                "INSERT INTO files (file_id, contents) VALUES (:id, :contents)");
+            stmt.bind(":id", i);
+            stmt.bind(":contents", sqlite::blob(file.c_str(), file.length()));
+            stmt.step_without_results();
+        }
+        db.exec("INSERT INTO test_case_files (test_case_id, file_name, file_id) "
+                "VALUES (1, '__STDOUT__', 1);"
+                "INSERT INTO test_case_files (test_case_id, file_name, file_id) "
+                "VALUES (1, '__STDERR__', 2);"
+                "INSERT INTO test_case_files (test_case_id, file_name, file_id) "
+                "VALUES (2, '__STDOUT__', 3);");
+        db.close();
+    }
+
+    store::migrate_schema(testpath);
+
+    sqlite::database db = sqlite::database::open(
+        testpath, sqlite::open_readonly);
+
+    sqlite::statement count_stmt = db.create_statement(
+        "SELECT COUNT(*) FROM files WHERE digest IS NOT NULL");
+    ATF_REQUIRE(count_stmt.step());
+    ATF_REQUIRE_EQ(2, count_stmt.column_int64(0));
+
+    sqlite::statement stmt = db.create_statement(
+        "SELECT DISTINCT file_id, codec, contents "
+        "FROM test_case_files NATURAL JOIN files "
+        "WHERE file_name == '__STDOUT__'");
+    ATF_REQUIRE(stmt.step());
+    const sqlite::blob blob = stmt.safe_column_blob("contents");
+    ATF_REQUIRE_EQ(contents, store::decode_contents(
+        stmt.safe_column_text("codec"), blob.memory, blob.size));
+    ATF_REQUIRE(!stmt.step());
+}
+
+
 ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, current_schema_1);
@@ -489,4 +616,6 @@ ATF_INIT_TEST_CASES(tcs)
 
     ATF_ADD_TEST_CASE(tcs, migrate_schema__from_v1);
     ATF_ADD_TEST_CASE(tcs, migrate_schema__from_v2);
+    ATF_ADD_TEST_CASE(tcs, migrate_schema__from_v3);
+    ATF_ADD_TEST_CASE(tcs, migrate_schema__from_v3__files);
 }
@@ -32,8 +32,14 @@ extern "C" {
 #include <stdint.h>
 }
 
+#include <algorithm>
+#include <climits>
+#include <cstring>
 #include <fstream>
+#include <istream>
 #include <map>
+#include <sstream>
+#include <utility>
 
 #include "model/context.hpp"
 #include "model/metadata.hpp"
@@ -41,6 +47,7 @@ extern "C" {
 #include "model/test_program.hpp"
 #include "model/test_result.hpp"
 #include "model/types.hpp"
+#include "store/contents.hpp"
 #include "store/dbtypes.hpp"
 #include "store/exceptions.hpp"
 #include "store/write_backend.hpp"
@@ -52,6 +59,7 @@ extern "C" {
 #include "utils/optional.ipp"
 #include "utils/sanity.hpp"
 #include "utils/stream.hpp"
+#include "utils/sqlite/blob_io.hpp"
 #include "utils/sqlite/database.hpp"
 #include "utils/sqlite/exceptions.hpp"
 #include "utils/sqlite/statement.ipp"
@@ -68,6 +76,16 @@ using utils::optional;
 namespace {
 
 
+/// Size of the pieces in which files are copied into the database.
+static const std::size_t stream_chunk_size = 64 * 1024;
+
+
+/// Size from which files are copied into the database piece by piece.
+///
+/// Smaller files are loaded into memory, which is faster.
+static const std::size_t max_inmemory_file_size = 1024 * 1024;
+
+
 /// Stores the environment variables of a context.
 ///
 /// \param db The SQLite database.
@@ -91,41 +109,110 @@ put_env_vars(sqlite::database& db,
 }
 
 
-/// Calculates the last rowid of a table.
+/// Serializes the properties of a metadata object.
 ///
-/// \param db The SQLite database.
-/// \param table Name of the table.
+/// The properties are serialized with length prefixes so that different
+/// objects yield different strings.
 ///
-/// \return The last rowid; 0 if the table is empty.
-static int64_t
-last_rowid(sqlite::database& db, const std::string& table)
+/// \param props The properties of the metadata object.
+///
+/// \return The serialized properties.
+static std::string
+metadata_contents(const model::properties_map& props)
 {
-    sqlite::statement stmt = db.create_statement(
-        F("SELECT MAX(ROWID) AS max_rowid FROM %s") % table);
-    stmt.step();
-    if (stmt.column_type(0) == sqlite::type_null) {
-        return 0;
-    } else {
-        INV(stmt.column_type(0) == sqlite::type_integer);
-        return stmt.column_int64(0);
+    std::ostringstream contents;
+    for (model::properties_map::const_iterator iter = props.begin();
+         iter != props.end(); ++iter) {
+        contents << (*iter).first.length() << ':' << (*iter).first
+                 << (*iter).second.length() << ':' << (*iter).second;
     }
+    return contents.str();
 }
 
 
-/// Stores a metadata object.
+/// Loads the properties of a stored metadata object.
+///
+/// \param db The database from which to load the properties.
+/// \param metadata_id The identifier of the metadata object.
+///
+/// \return The properties of the metadata object.
+///
+/// \throw sqlite::error If there are problems reading the database.
+static model::properties_map
+get_properties(sqlite::database& db, const int64_t metadata_id)
+{
+    model::properties_map props;
+
+    sqlite::statement stmt = db.cached_statement(
+        "SELECT property_name, property_value FROM metadatas "
+        "WHERE metadata_id == :metadata_id");
+    stmt.bind(":metadata_id", metadata_id);
+    while (stmt.step()) {
+        props[stmt.safe_column_text("property_name")] =
+            stmt.safe_column_text("property_value");
+    }
+    return props;
+}
+
+
+/// Stores a metadata object unless an identical one already exists.
+///
+/// Existing objects are located by the digest of their properties, and their
+/// properties are compared to the given ones before reusing them.  On the
+/// unlikely collision of two different objects, the new one is stored without
+/// a digest.
 ///
 /// \param db The database into which to store the information.
 /// \param md The metadata to store.
+/// \param [in,out] metadata_ids Identifiers of the metadata objects already
+///     stored or looked up within the current transaction, keyed by their
+///     serialized properties.  This saves a query to the database for every
+///     object that is reused.
 ///
-/// \return The identifier of the new metadata object.
+/// \return The identifier of the new or existing metadata object.
 static int64_t
-put_metadata(sqlite::database& db, const model::metadata& md)
+put_metadata(sqlite::database& db, const model::metadata& md,
+             std::map< std::string, int64_t >& metadata_ids)
 {
     const model::properties_map props = md.to_properties();
+    const std::string contents = metadata_contents(props);
 
-    const int64_t metadata_id = last_rowid(db, "metadatas");
+    const std::map< std::string, int64_t >::const_iterator known =
+        metadata_ids.find(contents);
+    if (known != metadata_ids.end())
+        return (*known).second;
 
-    sqlite::statement stmt = db.create_statement(
+    const std::string digest = store::digest_contents(contents);
+
+    bool collision = false;
+    {
+        sqlite::statement find_stmt = db.cached_statement(
+            "SELECT metadata_id FROM metadata_sets WHERE digest == :digest");
+        find_stmt.bind(":digest", digest);
+        if (find_stmt.step()) {
+            const int64_t metadata_id = find_stmt.safe_column_int64(
+                "metadata_id");
+            find_stmt.reset();
+            if (get_properties(db, metadata_id) == props) {
+                metadata_ids[contents] = metadata_id;
+                return metadata_id;
+            }
+            LW(F("Digest collision between metadata object %s and a new "
+                 "one; not sharing them") % metadata_id);
+            collision = true;
+        }
+    }
+
+    sqlite::statement set_stmt = db.cached_statement(
+        "INSERT INTO metadata_sets (digest) VALUES (:digest)");
+    if (collision)
+        set_stmt.bind(":digest", sqlite::null());
+    else
+        set_stmt.bind(":digest", digest);
+    set_stmt.step_without_results();
+    const int64_t metadata_id = db.last_insert_rowid();
+
+    sqlite::statement stmt = db.cached_statement(
         "INSERT INTO metadatas (metadata_id, property_name, property_value) "
         "VALUES (:metadata_id, :property_name, :property_value)");
     stmt.bind(":metadata_id", metadata_id);
@@ -138,47 +225,290 @@ put_metadata(sqlite::database& db, const model::metadata& md)
         stmt.reset();
     }
 
+    metadata_ids[contents] = metadata_id;
     return metadata_id;
 }
 
 
-/// Stores an arbitrary file into the database as a BLOB.
+/// Stores an arbitrary blob into the database unless it is already there.
 ///
-/// \param db The database into which to store the file.
-/// \param path Path to the file to be stored.
+/// Blobs are content-addressed: if the database already contains a blob with
+/// the same digest, its contents are compared to the new ones and its
+/// identifier is reused if they match.  A blob whose digest collides with
+/// that of a different one is stored without a digest.  New blobs are
+/// compressed if doing so is worthwhile.
 ///
-/// \return The identifier of the stored file, or none if the file was empty.
+/// \param db The database into which to store the blob.
+/// \param contents The raw contents to store.
+///
+/// \return The identifier of the stored blob, or none if it was empty.
 ///
 /// \throw sqlite::error If there are problems writing to the database.
 static optional< int64_t >
-put_file(sqlite::database& db, const fs::path& path)
+put_blob(sqlite::database& db, const std::string& contents)
 {
-    std::ifstream input(path.c_str());
+    if (contents.empty())
+        return none;
+
+    const std::string digest = store::digest_contents(contents);
+
+    bool collision = false;
+    {
+        sqlite::statement find_stmt = db.cached_statement(
+            "SELECT file_id, codec, contents FROM files "
+            "WHERE digest == :digest");
+        find_stmt.bind(":digest", digest);
+        if (find_stmt.step()) {
+            const int64_t file_id = find_stmt.safe_column_int64("file_id");
+            const sqlite::blob raw_contents = find_stmt.safe_column_blob(
+                "contents");
+            const bool same = store::decode_contents(
+                find_stmt.safe_column_text("codec"), raw_contents.memory,
+                raw_contents.size) == contents;
+            find_stmt.reset();
+            if (same)
+                return optional< int64_t >(file_id);
+            LW(F("Digest collision between file %s and a new one; not "
+                 "sharing them") % file_id);
+            collision = true;
+        }
+    }
+
+    const std::pair< std::string, std::string > encoded =
+        store::encode_contents(contents);
+
+    sqlite::statement stmt = db.cached_statement(
+        "INSERT INTO files (contents, digest, codec) "
+        "VALUES (:contents, :digest, :codec)");
+    stmt.bind(":contents", sqlite::blob(encoded.second.c_str(),
+                                        encoded.second.length()));
+    if (collision)
+        stmt.bind(":digest", sqlite::null());
+    else
+        stmt.bind(":digest", digest);
+    stmt.bind(":codec", encoded.first);
+    stmt.step_without_results();
+
+    return optional< int64_t >(db.last_insert_rowid());
+}
+
+
+/// Rewinds a stream to its beginning.
+///
+/// \param input The stream to rewind.
+///
+/// \throw store::error If the stream cannot be rewound.
+static void
+rewind(std::istream& input)
+{
+    input.clear();
+    input.seekg(0, std::ios::beg);
     if (!input)
-        throw store::error(F("Cannot open file %s") % path);
+        throw store::error("Cannot rewind file to store it");
+}
 
-    try {
-        if (utils::stream_length(input) == 0)
-            return none;
-    } catch (const std::runtime_error& e) {
-        // Skipping empty files is an optimization.  If we fail to calculate the
-        // size of the file, just ignore the problem.  If there are real issues
-        // with the file, the read below will fail anyway.
-        LD(F("Cannot determine if file is empty: %s") % e.what());
+
+/// Encodes the contents of a stream piece by piece.
+///
+/// \param input The stream with the raw contents, positioned at its beginning.
+/// \param codec The codec with which to encode the contents.
+/// \param max_length Maximum length of the encoded contents.  Encoding stops
+///     once this length is exceeded.
+/// \param [out] output If not NULL, BLOB into which to write the encoded
+///     contents, which must be exactly as long as these.
+///
+/// \return The length of the encoded contents, or a number larger than
+/// max_length if encoding was stopped early.
+///
+/// \throw sqlite::error If there are problems writing to the BLOB.
+/// \throw store::error If there are problems reading the stream.
+static std::size_t
+encode_stream(std::istream& input, const std::string& codec,
+              const std::size_t max_length, sqlite::blob_io* output)
+{
+    store::codec_stream encoder(codec, true);
+    char raw[stream_chunk_size];
+    char encoded[stream_chunk_size];
+    std::size_t length = 0;
+    bool last = false;
+    while (!encoder.finished() && length <= max_length) {
+        if (encoder.needs_input() && !last) {
+            input.read(raw, sizeof(raw));
+            if (input.bad())
+                throw store::error("Failed to read file to store it");
+            encoder.feed(raw, input.gcount());
+            last = input.eof();
+        }
+        const std::size_t chunk_length = encoder.process(
+            encoded, sizeof(encoded), last);
+        if (output != NULL && chunk_length > 0)
+            output->write(encoded, static_cast< int >(chunk_length),
+                          static_cast< int >(length));
+        length += chunk_length;
     }
+    return length;
+}
 
-    // TODO(jmmv): This will probably cause an unreasonable amount of memory
-    // consumption if we decide to store arbitrary files in the database (other
-    // than stdout or stderr).  Should this happen, we need to investigate a
-    // better way to feel blobs into SQLite.
-    const std::string contents = utils::read_stream(input);
 
-    sqlite::statement stmt = db.create_statement(
-        "INSERT INTO files (contents) VALUES (:contents)");
-    stmt.bind(":contents", sqlite::blob(contents.c_str(), contents.length()));
+/// Checks whether a stored file has the same contents as a stream.
+///
+/// \param db The database containing the file.
+/// \param file_id The identifier of the file.
+/// \param codec The codec with which the file is encoded.
+/// \param input The stream with the raw contents to compare.  Must be
+///     seekable.
+///
+/// \return True if the decoded contents of the file match the stream.
+///
+/// \throw sqlite::error If there are problems reading the file.
+/// \throw store::error If there are problems reading the stream.
+static bool
+same_contents(sqlite::database& db, const int64_t file_id,
+              const std::string& codec, std::istream& input)
+{
+    rewind(input);
+
+    sqlite::blob_io blob = db.open_blob("files", "contents", file_id, false);
+    const int size = blob.size();
+    int offset = 0;
+
+    store::codec_stream decoder(codec, false);
+    char raw[stream_chunk_size];
+    char decoded[stream_chunk_size];
+    char expected[stream_chunk_size];
+    for (;;) {
+        if (decoder.needs_input() && offset < size) {
+            const int length = std::min(size - offset,
+                                        static_cast< int >(sizeof(raw)));
+            blob.read(raw, length, offset);
+            offset += length;
+            decoder.feed(raw, length);
+        }
+        if (decoder.finished())
+            break;
+
+        const std::size_t length = decoder.process(
+            decoded, sizeof(decoded), offset == size);
+        if (length > 0) {
+            input.read(expected, length);
+            if (input.bad())
+                throw store::error("Failed to read file to store it");
+            if (static_cast< std::size_t >(input.gcount()) != length ||
+                std::memcmp(decoded, expected, length) != 0)
+                return false;
+        }
+    }
+    return input.peek() == std::istream::traits_type::eof();
+}
+
+
+/// Stores the contents of a stream into the database unless already there.
+///
+/// This is the same as put_blob() but the contents are never held in memory
+/// at once: the stream is read once to compute its digest, once more to
+/// compare it to a stored blob with the same digest if there is one, once
+/// more to compute the length of the encoded contents if they are to be
+/// compressed, and a last time to write them into space reserved in advance
+/// in the database.
+///
+/// \param db The database into which to store the blob.
+/// \param input The stream with the contents to store.  Must be seekable.
+///
+/// \return The identifier of the stored blob, or none if it was empty.
+///
+/// \throw sqlite::error If there are problems writing to the database.
+/// \throw store::error If there are problems reading the stream.
+static optional< int64_t >
+put_blob_stream(sqlite::database& db, std::istream& input)
+{
+    store::digester digester;
+    {
+        char buffer[stream_chunk_size];
+        while (input.read(buffer, sizeof(buffer)) || input.gcount() > 0)
+            digester.update(buffer, input.gcount());
+        if (input.bad())
+            throw store::error("Failed to read file to store it");
+    }
+    if (digester.length() == 0)
+        return none;
+    if (digester.length() > static_cast< std::size_t >(INT_MAX))
+        throw store::error("File is too large to be stored");
+
+    const std::string digest = digester.digest();
+
+    bool collision = false;
+    {
+        sqlite::statement find_stmt = db.cached_statement(
+            "SELECT file_id, codec FROM files WHERE digest == :digest");
+        find_stmt.bind(":digest", digest);
+        if (find_stmt.step()) {
+            const int64_t file_id = find_stmt.safe_column_int64("file_id");
+            const std::string codec = find_stmt.safe_column_text("codec");
+            find_stmt.reset();
+            if (same_contents(db, file_id, codec, input))
+                return optional< int64_t >(file_id);
+            LW(F("Digest collision between file %s and a new one; not "
+                 "sharing them") % file_id);
+            collision = true;
+        }
+    }
+
+    std::string codec = store::preferred_codec(digester.length());
+    std::size_t length = digester.length();
+    if (codec != store::codec_none) {
+        rewind(input);
+        const std::size_t encoded_length = encode_stream(
+            input, codec, digester.length() - 1, NULL);
+        if (encoded_length < digester.length())
+            length = encoded_length;
+        else
+            codec = store::codec_none;
+    }
+
+    sqlite::statement stmt = db.cached_statement(
+        "INSERT INTO files (contents, digest, codec) "
+        "VALUES (:contents, :digest, :codec)");
+    stmt.bind(":contents", sqlite::zeroblob(static_cast< int >(length)));
+    if (collision)
+        stmt.bind(":digest", sqlite::null());
+    else
+        stmt.bind(":digest", digest);
+    stmt.bind(":codec", codec);
     stmt.step_without_results();
+    const int64_t file_id = db.last_insert_rowid();
 
-    return optional< int64_t >(db.last_insert_rowid());
+    rewind(input);
+    sqlite::blob_io output = db.open_blob("files", "contents", file_id, true);
+    const std::size_t written = encode_stream(input, codec, length, &output);
+    if (written != length)
+        throw store::error("File changed while it was being stored");
+
+    return optional< int64_t >(file_id);
+}
+
+
+/// Attaches a stored file to a test case.
+///
+/// \param db The database into which to store the information.
+/// \param name The name of the file within the test case.
+/// \param file_id The identifier of the stored file.
+/// \param test_case_id The identifier of the test case.
+///
+/// \return The identifier of the new attachment.
+///
+/// \throw sqlite::error If there are problems writing to the database.
+static int64_t
+put_test_case_file_id(sqlite::database& db, const std::string& name,
+                      const int64_t file_id, const int64_t test_case_id)
+{
+    sqlite::statement stmt = db.cached_statement(
+        "INSERT INTO test_case_files (test_case_id, file_name, file_id) "
+        "VALUES (:test_case_id, :file_name, :file_id)");
+    stmt.bind(":test_case_id", test_case_id);
+    stmt.bind(":file_name", name);
+    stmt.bind(":file_id", file_id);
+    stmt.step_without_results();
+    return db.last_insert_rowid();
 }
 
 
@@ -196,6 +526,10 @@ struct store::write_transaction::impl : utils::noncopyable {
     /// The backing SQLite transaction.
     sqlite::transaction _tx;
 
+    /// Identifiers of the metadata objects known to this transaction, keyed by
+    /// their serialized properties.
+    std::map< std::string, int64_t > _metadata_ids;
+
     /// Opens a transaction.
     ///
     /// \param backend_ The backend this transaction is connected to.
@@ -275,6 +609,29 @@ store::write_transaction::put_context(const model::context& context)
 }
 
 
+/// Records whether the test run has completed or not.
+///
+/// Any previously-recorded status is replaced.
+///
+/// \param completed False while the run is in progress; true once it is done.
+///
+/// \throw error If there is any problem when talking to the database.
+void
+store::write_transaction::put_run_status(const bool completed)
+{
+    try {
+        _pimpl->_db.exec("DELETE FROM run_status");
+
+        sqlite::statement stmt = _pimpl->_db.create_statement(
+            "INSERT INTO run_status (completed) VALUES (:completed)");
+        store::bind_bool(stmt, ":completed", completed);
+        stmt.step_without_results();
+    } catch (const sqlite::error& e) {
+        throw error(e.what());
+    }
+}
+
+
 /// Puts a test program into the database.
 ///
 /// \pre The test program has not been put yet.
@@ -291,9 +648,9 @@ store::write_transaction::put_test_program(
 {
     try {
         const int64_t metadata_id = put_metadata(
-            _pimpl->_db, test_program.get_metadata());
+            _pimpl->_db, test_program.get_metadata(), _pimpl->_metadata_ids);
 
-        sqlite::statement stmt = _pimpl->_db.create_statement(
+        sqlite::statement stmt = _pimpl->_db.cached_statement(
             "INSERT INTO test_programs (absolute_path, "
             "                           root, relative_path, test_suite_name, "
             "                           metadata_id, interface) "
@@ -333,13 +690,30 @@ store::write_transaction::put_test_case(const model::test_program& test_program,
                                         const std::string& test_case_name,
                                         const int64_t test_program_id)
 {
-    const model::test_case& test_case = test_program.find(test_case_name);
+    return put_test_case(test_program.find(test_case_name), test_program_id);
+}
+
 
+/// Puts a test case into the database.
+///
+/// \pre The test case has not been put yet.
+/// \post The test case is stored into the database with a new identifier.
+///
+/// \param test_case The test case to put.
+/// \param test_program_id The test program this test case belongs to.
+///
+/// \return The identifier of the inserted test case.
+///
+/// \throw error If there is any problem when talking to the database.
+int64_t
+store::write_transaction::put_test_case(const model::test_case& test_case,
+                                        const int64_t test_program_id)
+{
     try {
         const int64_t metadata_id = put_metadata(
-            _pimpl->_db, test_case.get_raw_metadata());
+            _pimpl->_db, test_case.get_raw_metadata(), _pimpl->_metadata_ids);
 
-        sqlite::statement stmt = _pimpl->_db.create_statement(
+        sqlite::statement stmt = _pimpl->_db.cached_statement(
             "INSERT INTO test_cases (test_program_id, name, metadata_id) "
             "VALUES (:test_program_id, :name, :metadata_id)");
         stmt.bind(":test_program_id", test_program_id);
@@ -361,6 +735,9 @@ store::write_transaction::put_test_case(const model::test_program& test_program,
 ///     __STDOUT__ the stdout of the test case so that it is easy to locate.
 /// \param path The path to the file to be stored.
 /// \param test_case_id The identifier of the test case this file belongs to.
+/// \param max_length Maximum length of the file to store, or 0 for no limit.
+///     Longer files are stored truncated: only their beginning and their end
+///     are kept, separated by a note that records their original length.
 ///
 /// \return The identifier of the stored file, or none if the file was empty.
 ///
@@ -368,25 +745,100 @@ store::write_transaction::put_test_case(const model::test_program& test_program,
 optional< int64_t >
 store::write_transaction::put_test_case_file(const std::string& name,
                                              const fs::path& path,
-                                             const int64_t test_case_id)
+                                             const int64_t test_case_id,
+                                             const std::size_t max_length)
 {
     LD(F("Storing %s (%s) of test case %s") % name % path % test_case_id);
+    std::ifstream input(path.c_str(), std::ios::binary);
+    if (!input)
+        throw store::error(F("Cannot open file %s") % path);
+    return put_test_case_stream(name, input, test_case_id, max_length);
+}
+
+
+/// Stores the contents of a file generated by a test case as a BLOB.
+///
+/// This is the same as put_test_case_file() but for callers that have already
+/// read the file into memory, such as the asynchronous writer, which must
+/// capture the contents of the file before the test case's work directory is
+/// deleted.
+///
+/// \param name The name of the file to store in the database.  See
+///     put_test_case_file() for details.
+/// \param contents The contents of the file.
+/// \param test_case_id The identifier of the test case this file belongs to.
+///
+/// \return The identifier of the stored file, or none if the file was empty.
+///
+/// \throw store::error If there are problems writing to the database.
+optional< int64_t >
+store::write_transaction::put_test_case_contents(const std::string& name,
+                                                 const std::string& contents,
+                                                 const int64_t test_case_id)
+{
     try {
-        const optional< int64_t > file_id = put_file(_pimpl->_db, path);
+        const optional< int64_t > file_id = put_blob(_pimpl->_db, contents);
         if (!file_id) {
-            LD("Not storing empty file");
+            LD(F("Not storing empty file %s of test case %s") % name %
+               test_case_id);
             return none;
         }
 
-        sqlite::statement stmt = _pimpl->_db.create_statement(
-            "INSERT INTO test_case_files (test_case_id, file_name, file_id) "
-            "VALUES (:test_case_id, :file_name, :file_id)");
-        stmt.bind(":test_case_id", test_case_id);
-        stmt.bind(":file_name", name);
-        stmt.bind(":file_id", file_id.get());
-        stmt.step_without_results();
+        return optional< int64_t >(put_test_case_file_id(
+            _pimpl->_db, name, file_id.get(), test_case_id));
+    } catch (const sqlite::error& e) {
+        throw error(e.what());
+    }
+}
 
-        return optional< int64_t >(_pimpl->_db.last_insert_rowid());
+
+/// Stores the contents of a stream generated by a test case as a BLOB.
+///
+/// This is the same as put_test_case_file() but for callers that have already
+/// opened the file.  Large files are copied into the database piece by piece
+/// instead of being loaded into memory.
+///
+/// \param name The name of the file to store in the database.  See
+///     put_test_case_file() for details.
+/// \param input The stream with the contents of the file.  Must be seekable
+///     and positioned at its beginning.
+/// \param test_case_id The identifier of the test case this file belongs to.
+/// \param max_length Maximum length of the file to store, or 0 for no limit.
+///     See put_test_case_file() for details.
+///
+/// \return The identifier of the stored file, or none if the file was empty.
+///
+/// \throw store::error If there are problems reading the stream or writing to
+///     the database.
+optional< int64_t >
+store::write_transaction::put_test_case_stream(const std::string& name,
+                                               std::istream& input,
+                                               const int64_t test_case_id,
+                                               const std::size_t max_length)
+{
+    const std::size_t length = utils::stream_length(input);
+    if (max_length > 0 && length > max_length) {
+        LD(F("Truncating %s of test case %s from %s to %s bytes") % name %
+           test_case_id % length % max_length);
+        truncated_istream truncated(input, length, max_length);
+        return put_test_case_stream(name, truncated, test_case_id);
+    }
+
+    if (length < max_inmemory_file_size)
+        return put_test_case_contents(name, utils::read_stream(input),
+                                      test_case_id);
+
+    try {
+        const optional< int64_t > file_id = put_blob_stream(_pimpl->_db,
+                                                            input);
+        if (!file_id) {
+            LD(F("Not storing empty file %s of test case %s") % name %
+               test_case_id);
+            return none;
+        }
+
+        return optional< int64_t >(put_test_case_file_id(
+            _pimpl->_db, name, file_id.get(), test_case_id));
     } catch (const sqlite::error& e) {
         throw error(e.what());
     }
@@ -413,7 +865,7 @@ store::write_transaction::put_result(const model::test_result& result,
                                      const datetime::timestamp& end_time)
 {
     try {
-        sqlite::statement stmt = _pimpl->_db.create_statement(
+        sqlite::statement stmt = _pimpl->_db.cached_statement(
             "INSERT INTO test_results (test_case_id, result_type, "
             "                          result_reason, start_time, "
             "                          end_time) "
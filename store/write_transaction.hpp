@@ -38,10 +38,13 @@ extern "C" {
 #include <stdint.h>
 }
 
+#include <cstddef>
+#include <istream>
 #include <memory>
 #include <string>
 
 #include "model/context_fwd.hpp"
+#include "model/test_case_fwd.hpp"
 #include "model/test_program_fwd.hpp"
 #include "model/test_result_fwd.hpp"
 #include "store/write_backend_fwd.hpp"
@@ -72,12 +75,22 @@ public:
     void rollback(void);
 
     void put_context(const model::context&);
+    void put_run_status(const bool);
     int64_t put_test_program(const model::test_program&);
     int64_t put_test_case(const model::test_program&, const std::string&,
                           const int64_t);
+    int64_t put_test_case(const model::test_case&, const int64_t);
     utils::optional< int64_t > put_test_case_file(const std::string&,
                                                   const utils::fs::path&,
-                                                  const int64_t);
+                                                  const int64_t,
+                                                  const std::size_t = 0);
+    utils::optional< int64_t > put_test_case_contents(const std::string&,
+                                                      const std::string&,
+                                                      const int64_t);
+    utils::optional< int64_t > put_test_case_stream(const std::string&,
+                                                    std::istream&,
+                                                    const int64_t,
+                                                    const std::size_t = 0);
     int64_t put_result(const model::test_result&, const int64_t,
                        const utils::datetime::timestamp&,
                        const utils::datetime::timestamp&);
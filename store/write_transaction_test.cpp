@@ -28,7 +28,13 @@
 
 #include "store/write_transaction.hpp"
 
+#if defined(HAVE_CONFIG_H)
+#   include "config.h"
+#endif
+
 #include <cstring>
+#include <fstream>
+#include <iostream>
 #include <map>
 #include <string>
 
@@ -39,15 +45,18 @@
 #include "model/test_case.hpp"
 #include "model/test_program.hpp"
 #include "model/test_result.hpp"
+#include "store/contents.hpp"
 #include "store/exceptions.hpp"
 #include "store/write_backend.hpp"
 #include "utils/datetime.hpp"
+#include "utils/format/macros.hpp"
 #include "utils/fs/path.hpp"
 #include "utils/logging/operations.hpp"
 #include "utils/optional.ipp"
 #include "utils/sqlite/database.hpp"
 #include "utils/sqlite/exceptions.hpp"
 #include "utils/sqlite/statement.ipp"
+#include "utils/test_utils.ipp"
 
 namespace datetime = utils::datetime;
 namespace fs = utils::fs;
@@ -168,6 +177,29 @@ ATF_TEST_CASE_BODY(rollback__ok)
 }
 
 
+ATF_TEST_CASE(put_run_status__ok);
+ATF_TEST_CASE_HEAD(put_run_status__ok)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_run_status__ok)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    store::write_transaction tx = backend.start_write();
+    tx.put_run_status(false);
+    tx.put_run_status(true);
+    tx.commit();
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT completed FROM run_status");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ("true", stmt.safe_column_text("completed"));
+    ATF_REQUIRE(!stmt.step());
+}
+
+
 ATF_TEST_CASE(put_test_program__ok);
 ATF_TEST_CASE_HEAD(put_test_program__ok)
 {
@@ -229,6 +261,114 @@ ATF_TEST_CASE_BODY(put_test_case__fail)
 }
 
 
+ATF_TEST_CASE(put_test_case__shared_metadata);
+ATF_TEST_CASE_HEAD(put_test_case__shared_metadata)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_test_case__shared_metadata)
+{
+    const model::metadata custom_md = model::metadata_builder()
+        .set_timeout(datetime::delta(10, 0))
+        .build();
+    const model::test_program test_program = model::test_program_builder(
+        "plain", fs::path("the/binary"), fs::path("/some/root"), "the-suite")
+        .add_test_case("first")
+        .add_test_case("second")
+        .add_test_case("custom", custom_md)
+        .add_test_case("third")
+        .build();
+
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    int64_t first_id, second_id, custom_id, third_id;
+    {
+        store::write_transaction tx = backend.start_write();
+        const int64_t test_program_id = tx.put_test_program(test_program);
+        first_id = tx.put_test_case(test_program, "first", test_program_id);
+        second_id = tx.put_test_case(test_program, "second", test_program_id);
+        custom_id = tx.put_test_case(test_program, "custom", test_program_id);
+        tx.commit();
+    }
+    {
+        // A new transaction must find the metadata stored by the previous one.
+        store::write_transaction tx = backend.start_write();
+        third_id = tx.put_test_case(test_program, "third", 1);
+        tx.commit();
+    }
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT test_case_id, metadata_id FROM test_cases "
+        "ORDER BY test_case_id");
+    std::map< int64_t, int64_t > metadata_ids;
+    while (stmt.step())
+        metadata_ids[stmt.safe_column_int64("test_case_id")] =
+            stmt.safe_column_int64("metadata_id");
+    ATF_REQUIRE_EQ(4, metadata_ids.size());
+    ATF_REQUIRE_EQ(metadata_ids[first_id], metadata_ids[second_id]);
+    ATF_REQUIRE_EQ(metadata_ids[first_id], metadata_ids[third_id]);
+    ATF_REQUIRE(metadata_ids[first_id] != metadata_ids[custom_id]);
+
+    sqlite::statement count_stmt = backend.database().create_statement(
+        "SELECT COUNT(DISTINCT metadata_id) FROM metadatas");
+    ATF_REQUIRE(count_stmt.step());
+    ATF_REQUIRE_EQ(2, count_stmt.column_int64(0));
+}
+
+
+ATF_TEST_CASE(put_test_case__metadata_collision);
+ATF_TEST_CASE_HEAD(put_test_case__metadata_collision)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_test_case__metadata_collision)
+{
+    const model::metadata custom_md = model::metadata_builder()
+        .set_timeout(datetime::delta(10, 0))
+        .build();
+    const model::test_program test_program = model::test_program_builder(
+        "plain", fs::path("the/binary"), fs::path("/some/root"), "the-suite")
+        .add_test_case("custom", custom_md)
+        .build();
+
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    int64_t first_id, second_id;
+    {
+        store::write_transaction tx = backend.start_write();
+        const int64_t test_program_id = tx.put_test_program(test_program);
+        first_id = tx.put_test_case(test_program, "custom", test_program_id);
+        tx.commit();
+    }
+
+    // Simulate a stored object whose digest matches that of different
+    // properties.
+    backend.database().exec(
+        "UPDATE metadatas SET property_value = '20' "
+        "WHERE property_name == 'timeout' AND property_value == '10'");
+
+    {
+        store::write_transaction tx = backend.start_write();
+        second_id = tx.put_test_case(test_program, "custom", 1);
+        tx.commit();
+    }
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT test_cases.test_case_id, property_value "
+        "FROM test_cases NATURAL JOIN metadatas "
+        "WHERE property_name == 'timeout' ORDER BY test_case_id");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(first_id, stmt.safe_column_int64("test_case_id"));
+    ATF_REQUIRE_EQ("20", stmt.safe_column_text("property_value"));
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(second_id, stmt.safe_column_int64("test_case_id"));
+    ATF_REQUIRE_EQ("10", stmt.safe_column_text("property_value"));
+    ATF_REQUIRE(!stmt.step());
+}
+
+
 ATF_TEST_CASE(put_test_case_file__empty);
 ATF_TEST_CASE_HEAD(put_test_case_file__empty)
 {
@@ -288,6 +428,142 @@ ATF_TEST_CASE_BODY(put_test_case_file__some)
 }
 
 
+ATF_TEST_CASE(put_test_case_file__collision);
+ATF_TEST_CASE_HEAD(put_test_case_file__collision)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_test_case_file__collision)
+{
+    std::string contents;
+    for (int i = 0; i < 100; ++i)
+        contents += "Repeated output line\n";
+    atf::utils::create_file("input.txt", contents);
+
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    backend.database().exec("PRAGMA foreign_keys = OFF");
+    {
+        store::write_transaction tx = backend.start_write();
+        ATF_REQUIRE(tx.put_test_case_file("my-file", fs::path("input.txt"),
+                                          1L));
+        ATF_REQUIRE(tx.put_test_case_file("my-file", fs::path("input.txt"),
+                                          2L));
+        tx.commit();
+    }
+
+    // Simulate a stored file whose digest matches that of different contents.
+    backend.database().exec(
+        "UPDATE files SET codec = 'none', contents = CAST('Other' AS BLOB)");
+
+    {
+        store::write_transaction tx = backend.start_write();
+        ATF_REQUIRE(tx.put_test_case_file("my-file", fs::path("input.txt"),
+                                          3L));
+        tx.commit();
+    }
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT file_id, digest FROM test_case_files NATURAL JOIN files "
+        "ORDER BY test_case_id");
+    ATF_REQUIRE(stmt.step());
+    const int64_t first_id = stmt.safe_column_int64("file_id");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(first_id, stmt.safe_column_int64("file_id"));
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE(first_id != stmt.safe_column_int64("file_id"));
+    ATF_REQUIRE(stmt.column_type(stmt.column_id("digest")) ==
+                sqlite::type_null);
+    ATF_REQUIRE(!stmt.step());
+}
+
+
+ATF_TEST_CASE(put_test_case_file__large);
+ATF_TEST_CASE_HEAD(put_test_case_file__large)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_test_case_file__large)
+{
+    std::string contents;
+    while (contents.length() < 2 * 1024 * 1024)
+        contents += F("Line %s of a very verbose test\n") % contents.length();
+    {
+        std::ofstream output("input.txt", std::ios::binary);
+        output << contents;
+    }
+
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    backend.database().exec("PRAGMA foreign_keys = OFF");
+    store::write_transaction tx = backend.start_write();
+    ATF_REQUIRE(tx.put_test_case_file("__STDOUT__", fs::path("input.txt"),
+                                      1L));
+    ATF_REQUIRE(tx.put_test_case_file("__STDOUT__", fs::path("input.txt"),
+                                      2L));
+    tx.commit();
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT DISTINCT digest, codec, contents "
+        "FROM test_case_files NATURAL JOIN files");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(store::digest_contents(contents),
+                   stmt.safe_column_text("digest"));
+    const sqlite::blob blob = stmt.safe_column_blob("contents");
+#if defined(HAVE_ZLIB)
+    ATF_REQUIRE_EQ("zlib", stmt.safe_column_text("codec"));
+    ATF_REQUIRE(static_cast< std::size_t >(blob.size) < contents.length());
+#endif
+    ATF_REQUIRE(contents == store::decode_contents(
+        stmt.safe_column_text("codec"), blob.memory, blob.size));
+    ATF_REQUIRE(!stmt.step());
+}
+
+
+ATF_TEST_CASE(put_test_case_file__truncated);
+ATF_TEST_CASE_HEAD(put_test_case_file__truncated)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_test_case_file__truncated)
+{
+    std::string contents;
+    while (contents.length() < 3 * 1024 * 1024)
+        contents += F("Line %s of a very verbose test\n") % contents.length();
+    {
+        std::ofstream output("input.txt", std::ios::binary);
+        output << contents;
+    }
+    const std::size_t max_length = 2 * 1024 * 1024;
+
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    backend.database().exec("PRAGMA foreign_keys = OFF");
+    store::write_transaction tx = backend.start_write();
+    ATF_REQUIRE(tx.put_test_case_file("__STDOUT__", fs::path("input.txt"),
+                                      1L, max_length));
+    tx.commit();
+
+    const std::string note = F("\n\n[%s bytes of output omitted; original "
+                               "size was %s bytes]\n\n") %
+        (contents.length() - max_length) % contents.length();
+    const std::string expected =
+        contents.substr(0, max_length / 2) + note +
+        contents.substr(contents.length() - max_length / 2);
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT codec, contents FROM test_case_files NATURAL JOIN files");
+    ATF_REQUIRE(stmt.step());
+    const sqlite::blob blob = stmt.safe_column_blob("contents");
+    ATF_REQUIRE(expected == store::decode_contents(
+        stmt.safe_column_text("codec"), blob.memory, blob.size));
+    ATF_REQUIRE(!stmt.step());
+}
+
+
 ATF_TEST_CASE(put_test_case_file__fail);
 ATF_TEST_CASE_HEAD(put_test_case_file__fail)
 {
@@ -310,6 +586,120 @@ ATF_TEST_CASE_BODY(put_test_case_file__fail)
 }
 
 
+ATF_TEST_CASE(put_test_case_contents__some);
+ATF_TEST_CASE_HEAD(put_test_case_contents__some)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_test_case_contents__some)
+{
+    const std::string contents("Some\0binary", 11);
+
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    backend.database().exec("PRAGMA foreign_keys = OFF");
+    store::write_transaction tx = backend.start_write();
+    ATF_REQUIRE(!tx.put_test_case_contents("empty-file", "", 123L));
+    ATF_REQUIRE(tx.put_test_case_contents("my-file", contents, 123L));
+    tx.commit();
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT * FROM test_case_files NATURAL JOIN files");
+
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(123L, stmt.safe_column_int64("test_case_id"));
+    ATF_REQUIRE_EQ("my-file", stmt.safe_column_text("file_name"));
+    const sqlite::blob blob = stmt.safe_column_blob("contents");
+    ATF_REQUIRE(contents.length() == static_cast< std::size_t >(blob.size));
+    ATF_REQUIRE(std::memcmp(contents.c_str(), blob.memory, blob.size) == 0);
+    ATF_REQUIRE(!stmt.step());
+}
+
+
+ATF_TEST_CASE(put_test_case_contents__shared);
+ATF_TEST_CASE_HEAD(put_test_case_contents__shared)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_test_case_contents__shared)
+{
+    std::string contents;
+    for (int i = 0; i < 100; ++i)
+        contents += "Repeated output line\n";
+
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    backend.database().exec("PRAGMA foreign_keys = OFF");
+    store::write_transaction tx = backend.start_write();
+    ATF_REQUIRE(tx.put_test_case_contents("__STDOUT__", contents, 1L));
+    ATF_REQUIRE(tx.put_test_case_contents("__STDOUT__", contents, 2L));
+    ATF_REQUIRE(tx.put_test_case_contents("__STDERR__", "Different", 2L));
+    tx.commit();
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT DISTINCT codec, length(contents) AS length "
+        "FROM test_case_files NATURAL JOIN files "
+        "WHERE file_name == '__STDOUT__'");
+    ATF_REQUIRE(stmt.step());
+#if defined(HAVE_ZLIB)
+    ATF_REQUIRE_EQ("zlib", stmt.safe_column_text("codec"));
+    ATF_REQUIRE(stmt.safe_column_int64("length") <
+                static_cast< int64_t >(contents.length()));
+#else
+    ATF_REQUIRE_EQ("none", stmt.safe_column_text("codec"));
+#endif
+    ATF_REQUIRE(!stmt.step());
+
+    sqlite::statement count_stmt = backend.database().create_statement(
+        "SELECT COUNT(*) FROM files");
+    ATF_REQUIRE(count_stmt.step());
+    ATF_REQUIRE_EQ(2, count_stmt.column_int64(0));
+}
+
+
+ATF_TEST_CASE(put_test_case_contents__collision);
+ATF_TEST_CASE_HEAD(put_test_case_contents__collision)
+{
+    logging::set_inmemory();
+    set_md_var("require.files", store::detail::schema_file().c_str());
+}
+ATF_TEST_CASE_BODY(put_test_case_contents__collision)
+{
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    backend.database().exec("PRAGMA foreign_keys = OFF");
+    {
+        store::write_transaction tx = backend.start_write();
+        ATF_REQUIRE(tx.put_test_case_contents("__STDOUT__", "Some text", 1L));
+        tx.commit();
+    }
+
+    // Simulate a stored file whose digest matches that of different contents.
+    backend.database().exec(
+        "UPDATE files SET contents = CAST('Some TEXT' AS BLOB)");
+
+    {
+        store::write_transaction tx = backend.start_write();
+        ATF_REQUIRE(tx.put_test_case_contents("__STDOUT__", "Some text", 2L));
+        tx.commit();
+    }
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT test_case_id, contents FROM test_case_files NATURAL JOIN files "
+        "ORDER BY test_case_id");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(1, stmt.safe_column_int64("test_case_id"));
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(2, stmt.safe_column_int64("test_case_id"));
+    const sqlite::blob blob = stmt.safe_column_blob("contents");
+    ATF_REQUIRE_EQ("Some text", std::string(
+        static_cast< const char* >(blob.memory), blob.size));
+    ATF_REQUIRE(!stmt.step());
+}
+
+
 ATF_TEST_CASE(put_result__ok__broken);
 ATF_TEST_CASE_HEAD(put_result__ok__broken)
 {
@@ -395,17 +785,78 @@ ATF_TEST_CASE_BODY(put_result__fail)
 }
 
 
+ATF_TEST_CASE(put__many_tests);
+ATF_TEST_CASE_HEAD(put__many_tests)
+{
+    logging::set_inmemory();
+    set_md_var("descr", "Stores the results of lots of test cases, as kyua "
+               "test does, and reports the average cost per test case");
+    set_md_var("require.files", store::detail::schema_file().c_str());
+    set_md_var("timeout", "300");
+}
+ATF_TEST_CASE_BODY(put__many_tests)
+{
+    utils::require_run_benchmarks(this);
+
+    const int num_tests = 5000;
+
+    model::test_program_builder builder(
+        "plain", fs::path("the/binary"), fs::path("/some/root"), "the-suite");
+    for (int i = 0; i < num_tests; ++i)
+        builder.add_test_case(F("test%s") % i);
+    const model::test_program test_program = builder.build();
+
+    atf::utils::create_file("stdout.txt", "Some output of the test\n");
+    const model::test_result result(model::test_result_failed, "Some reason");
+    const datetime::timestamp zero = datetime::timestamp::from_microseconds(0);
+
+    store::write_backend backend = store::write_backend::open_rw(
+        fs::path("test.db"));
+    store::write_transaction tx = backend.start_write();
+    const int64_t test_program_id = tx.put_test_program(test_program);
+
+    const datetime::timestamp start = datetime::timestamp::now();
+    for (int i = 0; i < num_tests; ++i) {
+        const int64_t test_case_id = tx.put_test_case(
+            test_program, F("test%s") % i, test_program_id);
+        tx.put_test_case_file("__STDOUT__", fs::path("stdout.txt"),
+                              test_case_id);
+        tx.put_result(result, test_case_id, zero, zero);
+    }
+    const datetime::timestamp end = datetime::timestamp::now();
+    tx.commit();
+
+    std::cout << F("Stored %s test cases at %sus per test case\n") %
+        num_tests % ((end - start).to_microseconds() / num_tests);
+
+    sqlite::statement stmt = backend.database().create_statement(
+        "SELECT COUNT(*) FROM test_results");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(num_tests, stmt.column_int(0));
+}
+
+
 ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, commit__ok);
     ATF_ADD_TEST_CASE(tcs, commit__fail);
     ATF_ADD_TEST_CASE(tcs, rollback__ok);
 
+    ATF_ADD_TEST_CASE(tcs, put_run_status__ok);
+
     ATF_ADD_TEST_CASE(tcs, put_test_program__ok);
     ATF_ADD_TEST_CASE(tcs, put_test_case__fail);
+    ATF_ADD_TEST_CASE(tcs, put_test_case__shared_metadata);
+    ATF_ADD_TEST_CASE(tcs, put_test_case__metadata_collision);
     ATF_ADD_TEST_CASE(tcs, put_test_case_file__empty);
     ATF_ADD_TEST_CASE(tcs, put_test_case_file__some);
+    ATF_ADD_TEST_CASE(tcs, put_test_case_file__collision);
+    ATF_ADD_TEST_CASE(tcs, put_test_case_file__large);
+    ATF_ADD_TEST_CASE(tcs, put_test_case_file__truncated);
     ATF_ADD_TEST_CASE(tcs, put_test_case_file__fail);
+    ATF_ADD_TEST_CASE(tcs, put_test_case_contents__some);
+    ATF_ADD_TEST_CASE(tcs, put_test_case_contents__shared);
+    ATF_ADD_TEST_CASE(tcs, put_test_case_contents__collision);
 
     ATF_ADD_TEST_CASE(tcs, put_result__ok__broken);
     ATF_ADD_TEST_CASE(tcs, put_result__ok__expected_failure);
@@ -413,4 +864,6 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, put_result__ok__passed);
     ATF_ADD_TEST_CASE(tcs, put_result__ok__skipped);
     ATF_ADD_TEST_CASE(tcs, put_result__fail);
+
+    ATF_ADD_TEST_CASE(tcs, put__many_tests);
 }
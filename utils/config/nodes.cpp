@@ -29,6 +29,7 @@
 #include "utils/config/nodes.ipp"
 
 #include <memory>
+#include <stdexcept>
 
 #include <lutok/state.ipp>
 
@@ -37,6 +38,7 @@
 #include "utils/format/macros.hpp"
 
 namespace config = utils::config;
+namespace units = utils::units;
 
 
 /// Destructor.
@@ -526,6 +528,49 @@ config::positive_int_node::validate(const value_type& new_value) const
 }
 
 
+/// Copies the node.
+///
+/// \return A dynamically-allocated node.
+config::detail::base_node*
+config::bytes_node::deep_copy(void) const
+{
+    std::auto_ptr< bytes_node > new_node(new bytes_node());
+    new_node->_value = _value;
+    return new_node.release();
+}
+
+
+/// Pushes the node's value onto the Lua stack.
+///
+/// \param state The Lua state onto which to push the value.
+void
+config::bytes_node::push_lua(lutok::state& state) const
+{
+    state.push_string(F("%s") % static_cast< uint64_t >(value()));
+}
+
+
+/// Sets the value of the node from an entry in the Lua stack.
+///
+/// \param state The Lua state from which to get the value.
+/// \param value_index The stack index in which the value resides.
+///
+/// \throw value_error If the value in state(value_index) cannot be
+///     processed by this node.
+void
+config::bytes_node::set_lua(lutok::state& state, const int value_index)
+{
+    // Numbers are also strings in Lua, so this handles both types.
+    if (!state.is_string(value_index))
+        throw value_error("Invalid amount of bytes");
+    try {
+        set(units::bytes::parse(state.to_string(value_index)));
+    } catch (const std::runtime_error& e) {
+        throw value_error(e.what());
+    }
+}
+
+
 /// Copies the node.
 ///
 /// \return A dynamically-allocated node.
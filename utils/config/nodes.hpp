@@ -43,6 +43,7 @@
 #include "utils/config/nodes_fwd.hpp"
 #include "utils/noncopyable.hpp"
 #include "utils/optional.hpp"
+#include "utils/units.hpp"
 
 namespace utils {
 namespace config {
@@ -184,6 +185,19 @@ class positive_int_node : public int_node {
 };
 
 
+/// A leaf node that holds an amount of bytes.
+///
+/// The textual representation of the value can have a unit suffix, as
+/// understood by units::bytes::parse().
+class bytes_node : public native_leaf_node< units::bytes > {
+public:
+    virtual base_node* deep_copy(void) const;
+
+    void push_lua(lutok::state&) const;
+    void set_lua(lutok::state&, const int);
+};
+
+
 /// A leaf node that holds a string value.
 class string_node : public native_leaf_node< std::string > {
 public:
@@ -59,6 +59,7 @@ template< typename > class native_leaf_node;
 class bool_node;
 class int_node;
 class positive_int_node;
+class bytes_node;
 class string_node;
 template< typename > class base_set_node;
 class strings_set_node;
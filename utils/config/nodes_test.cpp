@@ -35,8 +35,10 @@
 #include "utils/config/exceptions.hpp"
 #include "utils/config/keys.hpp"
 #include "utils/defs.hpp"
+#include "utils/units.hpp"
 
 namespace config = utils::config;
+namespace units = utils::units;
 
 
 namespace {
@@ -413,6 +415,98 @@ ATF_TEST_CASE_BODY(positive_int_node__to_string)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(bytes_node__deep_copy);
+ATF_TEST_CASE_BODY(bytes_node__deep_copy)
+{
+    config::bytes_node node;
+    node.set(units::bytes(5 * units::MB));
+    config::detail::base_node* raw_copy = node.deep_copy();
+    config::bytes_node* copy = static_cast< config::bytes_node* >(raw_copy);
+    ATF_REQUIRE_EQ(units::bytes(5 * units::MB), copy->value());
+    copy->set(units::bytes(10));
+    ATF_REQUIRE_EQ(units::bytes(5 * units::MB), node.value());
+    ATF_REQUIRE_EQ(units::bytes(10), copy->value());
+    delete copy;
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(bytes_node__push_lua);
+ATF_TEST_CASE_BODY(bytes_node__push_lua)
+{
+    lutok::state state;
+
+    config::bytes_node node;
+    node.set(units::bytes(2048));
+    node.push_lua(state);
+    ATF_REQUIRE(state.is_string(-1));
+    ATF_REQUIRE_EQ("2048", state.to_string(-1));
+    state.pop(1);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(bytes_node__set_lua__ok);
+ATF_TEST_CASE_BODY(bytes_node__set_lua__ok)
+{
+    lutok::state state;
+
+    config::bytes_node node;
+    state.push_string("3k");
+    node.set_lua(state, -1);
+    state.pop(1);
+    ATF_REQUIRE_EQ(units::bytes(3 * units::KB), node.value());
+
+    state.push_integer(123);
+    node.set_lua(state, -1);
+    state.pop(1);
+    ATF_REQUIRE_EQ(units::bytes(123), node.value());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(bytes_node__set_lua__invalid_value);
+ATF_TEST_CASE_BODY(bytes_node__set_lua__invalid_value)
+{
+    lutok::state state;
+
+    config::bytes_node node;
+    state.push_string("foo bar");
+    ATF_REQUIRE_THROW(config::value_error, node.set_lua(state, -1));
+    state.pop(1);
+    state.push_boolean(true);
+    ATF_REQUIRE_THROW(config::value_error, node.set_lua(state, -1));
+    state.pop(1);
+    ATF_REQUIRE(!node.is_set());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(bytes_node__set_string__ok);
+ATF_TEST_CASE_BODY(bytes_node__set_string__ok)
+{
+    config::bytes_node node;
+    node.set_string("10M");
+    ATF_REQUIRE_EQ(units::bytes(10 * units::MB), node.value());
+    node.set_string("42");
+    ATF_REQUIRE_EQ(units::bytes(42), node.value());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(bytes_node__set_string__invalid_value);
+ATF_TEST_CASE_BODY(bytes_node__set_string__invalid_value)
+{
+    config::bytes_node node;
+    ATF_REQUIRE_THROW(config::value_error, node.set_string("10 M"));
+    ATF_REQUIRE(!node.is_set());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(bytes_node__to_string);
+ATF_TEST_CASE_BODY(bytes_node__to_string)
+{
+    config::bytes_node node;
+    node.set(units::bytes(1024));
+    ATF_REQUIRE_EQ("1.00K", node.to_string());
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(string_node__deep_copy);
 ATF_TEST_CASE_BODY(string_node__deep_copy)
 {
@@ -673,6 +767,14 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, positive_int_node__set_string__invalid_value);
     ATF_ADD_TEST_CASE(tcs, positive_int_node__to_string);
 
+    ATF_ADD_TEST_CASE(tcs, bytes_node__deep_copy);
+    ATF_ADD_TEST_CASE(tcs, bytes_node__push_lua);
+    ATF_ADD_TEST_CASE(tcs, bytes_node__set_lua__ok);
+    ATF_ADD_TEST_CASE(tcs, bytes_node__set_lua__invalid_value);
+    ATF_ADD_TEST_CASE(tcs, bytes_node__set_string__ok);
+    ATF_ADD_TEST_CASE(tcs, bytes_node__set_string__invalid_value);
+    ATF_ADD_TEST_CASE(tcs, bytes_node__to_string);
+
     ATF_ADD_TEST_CASE(tcs, string_node__deep_copy);
     ATF_ADD_TEST_CASE(tcs, string_node__is_set_and_set);
     ATF_ADD_TEST_CASE(tcs, string_node__value_and_set);
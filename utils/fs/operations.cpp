@@ -56,6 +56,7 @@ extern "C" {
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "utils/auto_array.ipp"
 #include "utils/defs.hpp"
@@ -64,6 +65,7 @@ extern "C" {
 #include "utils/fs/directory.hpp"
 #include "utils/fs/exceptions.hpp"
 #include "utils/fs/path.hpp"
+#include "utils/fs/walker.hpp"
 #include "utils/logging/macros.hpp"
 #include "utils/optional.ipp"
 #include "utils/sanity.hpp"
@@ -495,14 +497,32 @@ fs::mkdir(const fs::path& dir, const int mode)
 void
 fs::mkdir_p(const fs::path& dir, const int mode)
 {
-    try {
-        fs::mkdir(dir, mode);
-    } catch (const fs::system_error& e) {
-        if (e.original_errno() == ENOENT) {
-            fs::mkdir_p(dir.branch_path(), mode);
-            fs::mkdir(dir, mode);
-        } else if (e.original_errno() != EEXIST)
-            throw e;
+    // Walk up until we find an existing parent, remembering which directories
+    // we have to create, and then walk down creating them.  Missing components
+    // are expected in the common case, so we check errno instead of relying on
+    // exceptions for the control flow.
+    std::vector< fs::path > missing;
+    fs::path current = dir;
+    for (;;) {
+        if (::mkdir(current.c_str(), static_cast< mode_t >(mode)) != -1 ||
+            errno == EEXIST)
+            break;
+        const int original_errno = errno;
+        if (original_errno != ENOENT || current.branch_path() == current)
+            throw fs::system_error(F("Failed to create directory %s") %
+                                   current, original_errno);
+        missing.push_back(current);
+        current = current.branch_path();
+    }
+
+    for (std::vector< fs::path >::const_reverse_iterator iter =
+             missing.rbegin(); iter != missing.rend(); ++iter) {
+        if (::mkdir((*iter).c_str(), static_cast< mode_t >(mode)) == -1 &&
+            errno != EEXIST) {
+            const int original_errno = errno;
+            throw fs::system_error(F("Failed to create directory %s") % *iter,
+                                   original_errno);
+        }
     }
 }
 
@@ -690,25 +710,14 @@ retry:
 void
 fs::rm_r(const fs::path& directory)
 {
-    const fs::directory dir(directory);
+    LD(F("Removing directory tree %s") % directory);
 
-    for (fs::directory::const_iterator iter = dir.begin(); iter != dir.end();
-         ++iter) {
-        if (iter->name == "." || iter->name == "..")
-            continue;
-
-        const fs::path entry = directory / iter->name;
-
-        if (fs::is_directory(entry)) {
-            LD(F("Descending into %s") % entry);
-            fs::rm_r(entry);
-        } else {
-            LD(F("Removing file %s") % entry);
-            fs::unlink(entry);
-        }
+    fs::walker walker(directory, true);
+    while (walker.next()) {
+        if (walker.event() != fs::walker::pre_directory_event)
+            walker.remove();
     }
 
-    LD(F("Removing empty directory %s") % directory);
     fs::rmdir(directory);
 }
 
@@ -741,11 +750,12 @@ fs::scan_directory(const fs::path& path)
 {
     std::set< fs::directory_entry > contents;
 
-    fs::directory dir(path);
-    for (fs::directory::const_iterator iter = dir.begin(); iter != dir.end();
-         ++iter) {
-        contents.insert(*iter);
-    }
+    fs::walker walker(path, false);
+    // The walker skips the dot entries, but our callers expect to see them.
+    contents.insert(fs::directory_entry("."));
+    contents.insert(fs::directory_entry(".."));
+    while (walker.next())
+        contents.insert(fs::directory_entry(walker.name()));
 
     return contents;
 }
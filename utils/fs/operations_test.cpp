@@ -34,6 +34,7 @@ extern "C" {
 #include <sys/wait.h>
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <unistd.h>
 }
@@ -48,6 +49,7 @@ extern "C" {
 
 #include <atf-c++.hpp>
 
+#include "utils/datetime.hpp"
 #include "utils/env.hpp"
 #include "utils/format/containers.ipp"
 #include "utils/format/macros.hpp"
@@ -57,8 +59,10 @@ extern "C" {
 #include "utils/optional.ipp"
 #include "utils/passwd.hpp"
 #include "utils/stream.hpp"
+#include "utils/test_utils.ipp"
 #include "utils/units.hpp"
 
+namespace datetime = utils::datetime;
 namespace fs = utils::fs;
 namespace passwd = utils::passwd;
 namespace units = utils::units;
@@ -664,6 +668,70 @@ ATF_TEST_CASE_BODY(rm_r__files_and_directories)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(rm_r__deep);
+ATF_TEST_CASE_BODY(rm_r__deep)
+{
+    fs::path dir("root");
+    fs::mkdir(dir, 0755);
+    for (int i = 0; i < 100; i++) {
+        dir = dir / "d";
+        fs::mkdir(dir, 0755);
+        atf::utils::create_file((dir / "file").str(), "");
+    }
+    fs::rm_r(fs::path("root"));
+    ATF_REQUIRE(!lookup(".", "root", S_IFDIR));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(rm_r__symlinks_not_followed);
+ATF_TEST_CASE_BODY(rm_r__symlinks_not_followed)
+{
+    fs::mkdir(fs::path("keep"), 0755);
+    atf::utils::create_file("keep/file", "");
+    fs::mkdir(fs::path("root"), 0755);
+    ATF_REQUIRE(::symlink("../keep", "root/link") != -1);
+    fs::rm_r(fs::path("root"));
+    ATF_REQUIRE(!lookup(".", "root", S_IFDIR));
+    ATF_REQUIRE(lookup("keep", "file", S_IFREG));
+}
+
+
+ATF_TEST_CASE(rm_r__many_files);
+ATF_TEST_CASE_HEAD(rm_r__many_files)
+{
+    set_md_var("descr", "Removes a tree with 100k files, like the ones left "
+               "behind by some test cases, and reports how long this takes");
+    set_md_var("timeout", "300");
+}
+ATF_TEST_CASE_BODY(rm_r__many_files)
+{
+    utils::require_run_benchmarks(this);
+
+    const int num_dirs = 100;
+    const int files_per_dir = 1000;
+
+    fs::mkdir(fs::path("root"), 0755);
+    for (int i = 0; i < num_dirs; i++) {
+        const fs::path dir = fs::path("root") / (F("dir%s") % i);
+        fs::mkdir(dir, 0755);
+        for (int j = 0; j < files_per_dir; j++) {
+            const fs::path file = dir / (F("file%s") % j);
+            const int fd = ::open(file.c_str(), O_WRONLY | O_CREAT, 0644);
+            ATF_REQUIRE(fd != -1);
+            ::close(fd);
+        }
+    }
+
+    const datetime::timestamp start = datetime::timestamp::now();
+    fs::rm_r(fs::path("root"));
+    const datetime::timestamp end = datetime::timestamp::now();
+    ATF_REQUIRE(!lookup(".", "root", S_IFDIR));
+
+    std::cout << F("Removed %s files in %sus\n") % (num_dirs * files_per_dir)
+        % (end - start).to_microseconds();
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(rmdir__ok)
 ATF_TEST_CASE_BODY(rmdir__ok)
 {
@@ -811,6 +879,9 @@ ATF_INIT_TEST_CASES(tcs)
 
     ATF_ADD_TEST_CASE(tcs, rm_r__empty);
     ATF_ADD_TEST_CASE(tcs, rm_r__files_and_directories);
+    ATF_ADD_TEST_CASE(tcs, rm_r__deep);
+    ATF_ADD_TEST_CASE(tcs, rm_r__symlinks_not_followed);
+    ATF_ADD_TEST_CASE(tcs, rm_r__many_files);
 
     ATF_ADD_TEST_CASE(tcs, rmdir__ok);
     ATF_ADD_TEST_CASE(tcs, rmdir__fail);
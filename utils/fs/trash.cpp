@@ -0,0 +1,298 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "utils/fs/trash.hpp"
+
+extern "C" {
+#include <stdio.h>
+#include <unistd.h>
+}
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/format/macros.hpp"
+#include "utils/fs/exceptions.hpp"
+#include "utils/fs/operations.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/fs/walker.hpp"
+#include "utils/logging/macros.hpp"
+#include "utils/noncopyable.hpp"
+#include "utils/sanity.hpp"
+#include "utils/signals/misc.hpp"
+
+namespace fs = utils::fs;
+namespace signals = utils::signals;
+
+
+namespace {
+
+
+/// Removes a directory tree.
+///
+/// This is equivalent to fs::rm_r() but ignores entries that vanish while we
+/// process them.
+///
+/// \param directory The directory to remove.
+///
+/// \throw fs::error If there is a problem removing any directory or file.
+static void
+remove_tree(const fs::path& directory)
+{
+    fs::walker walker(directory, true);
+    while (walker.next()) {
+        if (walker.event() == fs::walker::pre_directory_event)
+            continue;
+        try {
+            walker.remove();
+        } catch (const fs::system_error& e) {
+            if (e.original_errno() != ENOENT)
+                throw;
+        }
+    }
+
+    if (::rmdir(directory.c_str()) == -1 && errno != ENOENT) {
+        const int original_errno = errno;
+        throw fs::system_error(F("Removal of %s failed") % directory,
+                               original_errno);
+    }
+}
+
+
+}  // anonymous namespace
+
+
+/// Internal implementation of the trash.
+struct utils::fs::trash::impl : utils::noncopyable {
+    /// Directory into which to move the trees to remove.
+    const fs::path directory;
+
+    /// Maximum number of background threads removing trees.
+    const std::size_t max_workers;
+
+    /// Protects all the mutable fields below.
+    std::mutex mutex;
+
+    /// Signals the workers that there is more work to do or that they must
+    /// terminate.
+    std::condition_variable work_available;
+
+    /// Trees within the trash directory that are pending removal.
+    std::deque< fs::path > pending;
+
+    /// Background threads removing trees.
+    std::vector< std::thread > workers;
+
+    /// Number of workers currently removing a tree.
+    std::size_t busy_workers;
+
+    /// Whether the workers have been asked to terminate.
+    bool stopping;
+
+    /// Errors found while removing trees in the background.
+    std::vector< std::string > errors;
+
+    /// Whether the trash directory has been created or not.
+    bool created;
+
+    /// Whether drain() has been called, after which removals are synchronous.
+    bool drained;
+
+    /// Sequence number to give unique names to the trees in the trash.
+    std::size_t last_id;
+
+    /// Constructor.
+    ///
+    /// \param directory_ Directory into which to move the trees to remove.
+    /// \param max_workers_ Maximum number of background threads.
+    impl(const fs::path& directory_, const std::size_t max_workers_) :
+        directory(directory_), max_workers(max_workers_), busy_workers(0),
+        stopping(false), created(false), drained(false), last_id(0)
+    {
+        PRE(max_workers > 0);
+    }
+
+    /// Body of the background threads.
+    void
+    worker(void)
+    {
+        std::unique_lock< std::mutex > lock(mutex);
+        for (;;) {
+            while (pending.empty() && !stopping)
+                work_available.wait(lock);
+            if (pending.empty())
+                return;
+
+            const fs::path victim = pending.front();
+            pending.pop_front();
+            ++busy_workers;
+            lock.unlock();
+
+            std::string error;
+            try {
+                remove_tree(victim);
+            } catch (const fs::error& e) {
+                error = e.what();
+            }
+
+            lock.lock();
+            --busy_workers;
+            if (!error.empty())
+                errors.push_back(error);
+        }
+    }
+
+    /// Starts a new background thread.
+    ///
+    /// \pre The mutex must be held by the caller.
+    void
+    start_worker(void)
+    {
+        workers.push_back(signals::start_masked_thread(
+            std::bind(&impl::worker, this)));
+    }
+};
+
+
+/// Constructor.
+///
+/// \param directory Directory into which to move the trees to remove.  It is
+///     created on the first call to dispose() and deleted by drain().
+/// \param max_workers Maximum number of background threads to use to remove
+///     the trees concurrently.
+fs::trash::trash(const fs::path& directory, const std::size_t max_workers) :
+    _pimpl(new impl(directory, max_workers))
+{
+}
+
+
+/// Destructor.
+///
+/// Waits for all pending removals to complete.  Errors are logged; call drain()
+/// explicitly to get them reported.
+fs::trash::~trash(void)
+{
+    if (!_pimpl->drained) {
+        try {
+            drain();
+        } catch (const fs::error& e) {
+            LW(F("Ignoring errors while emptying the trash: %s") % e.what());
+        }
+    }
+}
+
+
+/// Schedules the removal of a directory tree.
+///
+/// The tree is moved into the trash directory and removed in the background.
+/// If the tree cannot be moved or if the trash has already been drained, the
+/// tree is removed synchronously instead.
+///
+/// \param victim The directory to remove.
+///
+/// \throw fs::error If the tree has to be removed synchronously and this fails.
+void
+fs::trash::dispose(const fs::path& victim)
+{
+    if (_pimpl->drained) {
+        fs::rm_r(victim);
+        return;
+    }
+
+    try {
+        if (!_pimpl->created) {
+            fs::mkdir_p(_pimpl->directory, 0755);
+            _pimpl->created = true;
+        }
+    } catch (const fs::error& e) {
+        LW(F("Cannot create trash directory %s; removing %s synchronously: "
+             "%s") % _pimpl->directory % victim % e.what());
+        fs::rm_r(victim);
+        return;
+    }
+
+    const fs::path target = _pimpl->directory / (F("%s") % ++_pimpl->last_id);
+    if (::rename(victim.c_str(), target.c_str()) == -1) {
+        const int original_errno = errno;
+        LW(F("Cannot move %s to the trash; removing synchronously: %s") %
+           victim % std::strerror(original_errno));
+        fs::rm_r(victim);
+        return;
+    }
+    LD(F("Moved %s to the trash as %s") % victim % target);
+
+    std::lock_guard< std::mutex > lock(_pimpl->mutex);
+    _pimpl->pending.push_back(target);
+    if (_pimpl->workers.size() < _pimpl->max_workers &&
+        _pimpl->busy_workers + _pimpl->pending.size() >
+        _pimpl->workers.size())
+        _pimpl->start_worker();
+    _pimpl->work_available.notify_one();
+}
+
+
+/// Waits for all pending removals to complete and removes the trash.
+///
+/// After this call, dispose() removes trees synchronously.
+///
+/// \throw fs::error If any of the background removals failed.  The trash
+///     directory is left behind in this case.
+void
+fs::trash::drain(void)
+{
+    PRE(!_pimpl->drained);
+
+    {
+        std::lock_guard< std::mutex > lock(_pimpl->mutex);
+        _pimpl->stopping = true;
+        _pimpl->work_available.notify_all();
+    }
+    for (std::vector< std::thread >::iterator iter = _pimpl->workers.begin();
+         iter != _pimpl->workers.end(); ++iter)
+        (*iter).join();
+    _pimpl->workers.clear();
+    _pimpl->drained = true;
+
+    if (!_pimpl->errors.empty()) {
+        std::string message = _pimpl->errors[0];
+        if (_pimpl->errors.size() > 1)
+            message += F(" (and %s more errors)") % (_pimpl->errors.size() - 1);
+        throw fs::error(F("Failed to empty the trash %s: %s") %
+                        _pimpl->directory % message);
+    }
+
+    if (_pimpl->created)
+        fs::rmdir(_pimpl->directory);
+}
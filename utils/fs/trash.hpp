@@ -0,0 +1,74 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/// \file utils/fs/trash.hpp
+/// Asynchronous removal of directory trees.
+///
+/// Removing a directory tree with lots of files can take a long time.  This
+/// module lets the caller get rid of a tree by atomically moving it into a
+/// trash directory, which is cheap, and deleting the contents of the trash
+/// directory from background threads.
+
+#if !defined(UTILS_FS_TRASH_HPP)
+#define UTILS_FS_TRASH_HPP
+
+#include "utils/fs/trash_fwd.hpp"
+
+#include <cstddef>
+#include <memory>
+
+#include "utils/fs/path_fwd.hpp"
+#include "utils/noncopyable.hpp"
+
+namespace utils {
+namespace fs {
+
+
+/// Directory into which to move trees for their asynchronous removal.
+///
+/// The trash directory must live in the same file system as the trees passed
+/// to dispose() so that they can be renamed into it.
+class trash : noncopyable {
+    struct impl;
+
+    /// Pointer to the internal implementation.
+    std::auto_ptr< impl > _pimpl;
+
+public:
+    trash(const path&, const std::size_t);
+    ~trash(void);
+
+    void dispose(const path&);
+    void drain(void);
+};
+
+
+}  // namespace fs
+}  // namespace utils
+
+#endif  // !defined(UTILS_FS_TRASH_HPP)
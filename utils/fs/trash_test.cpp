@@ -0,0 +1,173 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "utils/fs/trash.hpp"
+
+extern "C" {
+#include <sys/stat.h>
+
+#include <unistd.h>
+}
+
+#include <atf-c++.hpp>
+
+#include "utils/format/macros.hpp"
+#include "utils/fs/exceptions.hpp"
+#include "utils/fs/operations.hpp"
+#include "utils/fs/path.hpp"
+
+namespace fs = utils::fs;
+
+
+namespace {
+
+
+/// Creates a directory tree with a bunch of files in it.
+///
+/// \param root The directory to create.
+static void
+create_tree(const fs::path& root)
+{
+    fs::mkdir(root, 0755);
+    fs::mkdir(root / "dir1", 0755);
+    fs::mkdir(root / "dir1/dir2", 0755);
+    for (int i = 0; i < 10; ++i) {
+        atf::utils::create_file((root / (F("file%s") % i)).str(), "");
+        atf::utils::create_file((root / "dir1/dir2" / (F("file%s") % i)).str(),
+                                "");
+    }
+    ATF_REQUIRE(::symlink("../..", (root / "dir1/link").c_str()) != -1);
+}
+
+
+}  // anonymous namespace
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(dispose__one);
+ATF_TEST_CASE_BODY(dispose__one)
+{
+    create_tree(fs::path("root"));
+
+    fs::trash trash(fs::path("trash"), 1);
+    trash.dispose(fs::path("root"));
+    ATF_REQUIRE(!fs::exists(fs::path("root")));
+    trash.drain();
+    ATF_REQUIRE(!fs::exists(fs::path("trash")));
+    ATF_REQUIRE(fs::exists(fs::path(".")));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(dispose__many);
+ATF_TEST_CASE_BODY(dispose__many)
+{
+    fs::trash trash(fs::path("trash"), 3);
+    for (int i = 0; i < 50; ++i) {
+        const fs::path root(F("root%s") % i);
+        create_tree(root);
+        trash.dispose(root);
+        ATF_REQUIRE(!fs::exists(root));
+    }
+    trash.drain();
+    ATF_REQUIRE(!fs::exists(fs::path("trash")));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(dispose__after_drain);
+ATF_TEST_CASE_BODY(dispose__after_drain)
+{
+    fs::trash trash(fs::path("trash"), 1);
+    trash.drain();
+
+    create_tree(fs::path("root"));
+    trash.dispose(fs::path("root"));
+    ATF_REQUIRE(!fs::exists(fs::path("root")));
+    ATF_REQUIRE(!fs::exists(fs::path("trash")));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(dispose__missing);
+ATF_TEST_CASE_BODY(dispose__missing)
+{
+    fs::trash trash(fs::path("trash"), 1);
+    ATF_REQUIRE_THROW(fs::error, trash.dispose(fs::path("missing")));
+    trash.drain();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(drain__nothing);
+ATF_TEST_CASE_BODY(drain__nothing)
+{
+    fs::trash trash(fs::path("trash"), 1);
+    trash.drain();
+    ATF_REQUIRE(!fs::exists(fs::path("trash")));
+}
+
+
+ATF_TEST_CASE(drain__errors);
+ATF_TEST_CASE_HEAD(drain__errors)
+{
+    set_md_var("require.user", "unprivileged");
+}
+ATF_TEST_CASE_BODY(drain__errors)
+{
+    create_tree(fs::path("root"));
+    ATF_REQUIRE(::chmod("root/dir1/dir2", 0555) != -1);
+
+    fs::trash trash(fs::path("trash"), 1);
+    trash.dispose(fs::path("root"));
+    ATF_REQUIRE_THROW_RE(fs::error, "Failed to empty the trash.*dir2/file",
+                         trash.drain());
+    ATF_REQUIRE(fs::exists(fs::path("trash")));
+
+    ATF_REQUIRE(::chmod("trash/1/dir1/dir2", 0755) != -1);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(destructor__drains);
+ATF_TEST_CASE_BODY(destructor__drains)
+{
+    create_tree(fs::path("root"));
+    {
+        fs::trash trash(fs::path("trash"), 2);
+        trash.dispose(fs::path("root"));
+    }
+    ATF_REQUIRE(!fs::exists(fs::path("root")));
+    ATF_REQUIRE(!fs::exists(fs::path("trash")));
+}
+
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    ATF_ADD_TEST_CASE(tcs, dispose__one);
+    ATF_ADD_TEST_CASE(tcs, dispose__many);
+    ATF_ADD_TEST_CASE(tcs, dispose__after_drain);
+    ATF_ADD_TEST_CASE(tcs, dispose__missing);
+    ATF_ADD_TEST_CASE(tcs, drain__nothing);
+    ATF_ADD_TEST_CASE(tcs, drain__errors);
+    ATF_ADD_TEST_CASE(tcs, destructor__drains);
+}
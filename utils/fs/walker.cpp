@@ -0,0 +1,495 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "utils/fs/walker.hpp"
+
+#if defined(HAVE_CONFIG_H)
+#   include "config.h"
+#endif
+
+extern "C" {
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+}
+
+#include <cerrno>
+#include <deque>
+#include <vector>
+
+#include "utils/format/macros.hpp"
+#include "utils/fs/exceptions.hpp"
+#include "utils/fs/path.hpp"
+#include "utils/sanity.hpp"
+
+namespace fs = utils::fs;
+
+
+namespace {
+
+
+/// Flags to open subdirectories with.
+static const int open_directory_flags =
+    O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+
+
+/// Directory entry read ahead of time.
+struct buffered_entry {
+    /// Name of the entry.
+    std::string name;
+
+    /// Whether the entry is a directory or not.
+    bool is_directory;
+
+    /// Constructor.
+    ///
+    /// \param name_ Name of the entry.
+    /// \param is_directory_ Whether the entry is a directory or not.
+    buffered_entry(const std::string& name_, const bool is_directory_) :
+        name(name_), is_directory(is_directory_)
+    {
+    }
+};
+
+
+/// A directory being traversed by the walker.
+struct level {
+    /// Name of the directory relative to its parent, or full path for the root.
+    std::string name;
+
+    /// Open directory, or NULL if it has been closed to release its descriptor.
+    ::DIR* dirp;
+
+    /// Whether the remaining entries have been read into the entries field.
+    ///
+    /// If true, reading from dirp is not valid any longer.
+    bool buffered;
+
+    /// Entries of the directory not yet returned, if buffered is true.
+    std::deque< buffered_entry > entries;
+
+    /// Constructor.
+    ///
+    /// \param name_ Name of the directory relative to its parent.
+    /// \param dirp_ Open directory.
+    level(const std::string& name_, ::DIR* dirp_) :
+        name(name_), dirp(dirp_), buffered(false)
+    {
+    }
+};
+
+
+}  // anonymous namespace
+
+
+/// Internal implementation of the walker.
+struct utils::fs::walker::impl : utils::noncopyable {
+    /// Whether to descend into subdirectories or not.
+    const bool recursive;
+
+    /// Maximum number of directories to keep open at once.
+    const std::size_t max_open;
+
+    /// Directories currently being traversed; the root is the first one.
+    std::vector< level > stack;
+
+    /// Number of directories in the stack that are open.
+    std::size_t open_count;
+
+    /// Type of the current entry.
+    event_type event;
+
+    /// Name of the current entry.
+    std::string name;
+
+    /// Whether the current entry is a directory or not.
+    bool is_directory;
+
+    /// Constructor.
+    ///
+    /// \param root_ The directory to traverse.
+    /// \param recursive_ Whether to descend into subdirectories or not.
+    /// \param max_open_ Maximum number of directories to keep open at once.
+    ///
+    /// \throw fs::system_error If the root directory cannot be opened.
+    impl(const fs::path& root_, const bool recursive_,
+         const std::size_t max_open_) :
+        recursive(recursive_), max_open(max_open_), open_count(0),
+        event(entry_event), is_directory(false)
+    {
+        PRE(max_open >= 2);
+
+        ::DIR* dirp = ::opendir(root_.c_str());
+        if (dirp == NULL) {
+            const int original_errno = errno;
+            throw fs::system_error(F("opendir(%s) failed") % root_,
+                                   original_errno);
+        }
+        stack.push_back(level(root_.str(), dirp));
+        ++open_count;
+    }
+
+    /// Destructor.
+    ~impl(void)
+    {
+        while (!stack.empty())
+            pop();
+    }
+
+    /// Computes the path to a directory in the stack.
+    ///
+    /// \param index Position of the directory in the stack.
+    ///
+    /// \return The path to the directory.
+    fs::path
+    level_path(const std::size_t index) const
+    {
+        fs::path path(stack[0].name);
+        for (std::size_t i = 1; i <= index; ++i)
+            path = path / stack[i].name;
+        return path;
+    }
+
+    /// Closes the directory at the top of the stack and discards it.
+    void
+    pop(void)
+    {
+        level& top = stack.back();
+        if (top.dirp != NULL) {
+            ::closedir(top.dirp);
+            --open_count;
+        }
+        stack.pop_back();
+    }
+
+    /// Releases the descriptor of one directory to make room for another one.
+    ///
+    /// The directory chosen is the outermost open one, which is the one we will
+    /// need last.  Its remaining entries are read into memory so that it can be
+    /// reopened later just to access its descriptor.
+    ///
+    /// \param keep Position of a directory in the stack that must remain open.
+    ///
+    /// \throw fs::system_error If reading the directory fails.
+    void
+    evict(const std::size_t keep)
+    {
+        std::size_t victim = 0;
+        while (victim < stack.size() &&
+               (victim == keep || victim == stack.size() - 1 ||
+                stack[victim].dirp == NULL))
+            ++victim;
+        INV_MSG(victim < stack.size(), "max_open must allow for two open "
+                "directories");
+
+        level& l = stack[victim];
+        if (!l.buffered) {
+            const ::dirent* de;
+            while ((de = read_raw(victim)) != NULL) {
+                l.entries.push_back(buffered_entry(
+                    de->d_name, entry_is_directory(victim, de)));
+            }
+            l.buffered = true;
+        }
+        ::closedir(l.dirp);
+        l.dirp = NULL;
+        --open_count;
+    }
+
+    /// Gets the descriptor of a directory in the stack, reopening it if needed.
+    ///
+    /// \param index Position of the directory in the stack.
+    ///
+    /// \return The file descriptor of the directory.
+    ///
+    /// \throw fs::system_error If the directory cannot be reopened.
+    int
+    level_fd(const std::size_t index)
+    {
+        level& l = stack[index];
+        if (l.dirp != NULL)
+            return ::dirfd(l.dirp);
+
+        INV(l.buffered);
+        if (open_count >= max_open)
+            evict(index);
+
+        int fd;
+        if (index > 0 && stack[index - 1].dirp != NULL)
+            fd = ::openat(::dirfd(stack[index - 1].dirp), l.name.c_str(),
+                          open_directory_flags);
+        else
+            fd = ::open(level_path(index).c_str(), open_directory_flags);
+        l.dirp = fd == -1 ? NULL : ::fdopendir(fd);
+        if (l.dirp == NULL) {
+            const int original_errno = errno;
+            if (fd != -1)
+                ::close(fd);
+            throw fs::system_error(F("opendir(%s) failed") % level_path(index),
+                                   original_errno);
+        }
+        ++open_count;
+        return fd;
+    }
+
+    /// Reads the next entry of a directory that has not been buffered.
+    ///
+    /// \param index Position of the directory in the stack.
+    ///
+    /// \return The next entry, or NULL if there are no more.  The dot entries
+    /// are skipped.
+    ///
+    /// \throw fs::system_error If reading the directory fails.
+    const ::dirent*
+    read_raw(const std::size_t index)
+    {
+        level& l = stack[index];
+        PRE(!l.buffered && l.dirp != NULL);
+        for (;;) {
+            errno = 0;
+            const ::dirent* de = ::readdir(l.dirp);
+            if (de == NULL) {
+                if (errno != 0) {
+                    const int original_errno = errno;
+                    throw fs::system_error(F("readdir(%s) failed") %
+                                           level_path(index), original_errno);
+                }
+                return NULL;
+            }
+            const char* name = de->d_name;
+            if (name[0] == '.' &&
+                (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                continue;
+            return de;
+        }
+    }
+
+    /// Determines whether a directory entry is a directory without following it.
+    ///
+    /// \param index Position of the open directory containing the entry in the
+    ///     stack.
+    /// \param de The directory entry.
+    ///
+    /// \return True if the entry is a directory.
+    ///
+    /// \throw fs::system_error If the type of the entry is not known and it
+    ///     cannot be queried.
+    bool
+    entry_is_directory(const std::size_t index, const ::dirent* de) const
+    {
+#if defined(HAVE_STRUCT_DIRENT_D_TYPE)
+        if (de->d_type != DT_UNKNOWN)
+            return de->d_type == DT_DIR;
+#endif
+
+        struct ::stat sb;
+        if (::fstatat(::dirfd(stack[index].dirp), de->d_name, &sb,
+                      AT_SYMLINK_NOFOLLOW) == -1) {
+            const int original_errno = errno;
+            throw fs::system_error(F("Cannot get information about %s") %
+                                   (level_path(index) / de->d_name),
+                                   original_errno);
+        }
+        return S_ISDIR(sb.st_mode);
+    }
+
+    /// Opens the current entry, which must be a directory, and descends into it.
+    ///
+    /// \throw fs::system_error If the directory cannot be opened.
+    void
+    push(void)
+    {
+        const int parent_fd = level_fd(stack.size() - 1);
+        if (open_count >= max_open)
+            evict(stack.size() - 1);
+
+        const int fd = ::openat(parent_fd, name.c_str(), open_directory_flags);
+        ::DIR* dirp = fd == -1 ? NULL : ::fdopendir(fd);
+        if (dirp == NULL) {
+            const int original_errno = errno;
+            if (fd != -1)
+                ::close(fd);
+            throw fs::system_error(F("opendir(%s) failed") %
+                                   (level_path(stack.size() - 1) / name),
+                                   original_errno);
+        }
+        stack.push_back(level(name, dirp));
+        ++open_count;
+    }
+
+    /// Advances to the next entry.
+    ///
+    /// \return False if there are no more entries.
+    ///
+    /// \throw fs::system_error If there is any problem reading the tree.
+    bool
+    next(void)
+    {
+        if (stack.empty())
+            return false;
+
+        if (event == pre_directory_event)
+            push();
+
+        level& top = stack.back();
+        if (top.buffered) {
+            if (!top.entries.empty()) {
+                name = top.entries.front().name;
+                is_directory = top.entries.front().is_directory;
+                top.entries.pop_front();
+                return found();
+            }
+        } else {
+            const ::dirent* de = read_raw(stack.size() - 1);
+            if (de != NULL) {
+                name = de->d_name;
+                is_directory = entry_is_directory(stack.size() - 1, de);
+                return found();
+            }
+        }
+
+        name = top.name;
+        is_directory = true;
+        pop();
+        if (stack.empty())
+            return false;
+        event = post_directory_event;
+        return true;
+    }
+
+    /// Sets the type of the event for a new entry.
+    ///
+    /// \return True, to make next() easier to write.
+    bool
+    found(void)
+    {
+        event = (recursive && is_directory) ?
+            pre_directory_event : entry_event;
+        return true;
+    }
+};
+
+
+/// Starts a traversal of a directory.
+///
+/// \param root The directory to traverse.
+/// \param recursive Whether to descend into subdirectories or not.
+/// \param max_open Maximum number of directories to keep open at once.  Must be
+///     at least 2.
+///
+/// \throw fs::system_error If the root directory cannot be opened.
+fs::walker::walker(const fs::path& root, const bool recursive,
+                   const std::size_t max_open) :
+    _pimpl(new impl(root, recursive, max_open))
+{
+}
+
+
+/// Destructor.
+fs::walker::~walker(void)
+{
+}
+
+
+/// Advances to the next entry.
+///
+/// This must be called before accessing the first entry.
+///
+/// \return False if there are no more entries; true otherwise.
+///
+/// \throw fs::system_error If there is any problem reading the tree.
+bool
+fs::walker::next(void)
+{
+    return _pimpl->next();
+}
+
+
+/// Gets the type of the current entry.
+///
+/// \return The event type.
+fs::walker::event_type
+fs::walker::event(void) const
+{
+    return _pimpl->event;
+}
+
+
+/// Gets the name of the current entry.
+///
+/// \return The base name of the entry.
+const std::string&
+fs::walker::name(void) const
+{
+    return _pimpl->name;
+}
+
+
+/// Checks whether the current entry is a directory.
+///
+/// \return True if the entry is a directory; false otherwise.
+bool
+fs::walker::is_directory(void) const
+{
+    return _pimpl->is_directory;
+}
+
+
+/// Computes the path to the current entry.
+///
+/// This is more expensive than name(), so only use it when necessary.
+///
+/// \return The path to the entry, based on the root given to the constructor.
+fs::path
+fs::walker::current_path(void) const
+{
+    return _pimpl->level_path(_pimpl->stack.size() - 1) / _pimpl->name;
+}
+
+
+/// Removes the current entry.
+///
+/// \pre The current entry must not be a directory to be descended into.
+///
+/// \throw fs::system_error If the removal fails.
+void
+fs::walker::remove(void)
+{
+    PRE(_pimpl->event != pre_directory_event);
+
+    const int parent_fd = _pimpl->level_fd(_pimpl->stack.size() - 1);
+    if (::unlinkat(parent_fd, _pimpl->name.c_str(),
+                   _pimpl->is_directory ? AT_REMOVEDIR : 0) == -1) {
+        const int original_errno = errno;
+        throw fs::system_error(F("Removal of %s failed") % current_path(),
+                               original_errno);
+    }
+}
@@ -0,0 +1,103 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/// \file utils/fs/walker.hpp
+/// Iterative traversal of directory trees.
+///
+/// The walker accesses all entries relative to the file descriptor of their
+/// parent directory and relies on the entry types reported by readdir(3)
+/// whenever possible.  This avoids resolving full paths and calling stat(2)
+/// for every entry, which dominates the cost of processing large trees.
+
+#if !defined(UTILS_FS_WALKER_HPP)
+#define UTILS_FS_WALKER_HPP
+
+#include "utils/fs/walker_fwd.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "utils/fs/path_fwd.hpp"
+#include "utils/noncopyable.hpp"
+
+namespace utils {
+namespace fs {
+
+
+/// Iterator over the entries of a directory tree.
+///
+/// Entries are returned in the order in which the file system reports them.
+/// Subdirectories are reported twice when walking recursively: once before
+/// their contents and once after them, which allows post-order operations like
+/// the removal of a tree.  Symbolic links are never followed.  The root
+/// directory itself is not reported.
+///
+/// Only a bounded number of directories are kept open at any given time,
+/// regardless of the depth of the tree.
+class walker : noncopyable {
+    struct impl;
+
+    /// Pointer to the internal implementation.
+    std::auto_ptr< impl > _pimpl;
+
+public:
+    /// Types of entries returned by the walker.
+    enum event_type {
+        /// A file, or any entry when not walking recursively.
+        entry_event,
+
+        /// A directory whose contents will be returned next.
+        pre_directory_event,
+
+        /// A directory whose contents have all been returned.
+        post_directory_event,
+    };
+
+    /// Default maximum number of directories to keep open.
+    static const std::size_t default_max_open = 32;
+
+    walker(const path&, const bool,
+           const std::size_t = default_max_open);
+    ~walker(void);
+
+    bool next(void);
+
+    event_type event(void) const;
+    const std::string& name(void) const;
+    bool is_directory(void) const;
+    path current_path(void) const;
+
+    void remove(void);
+};
+
+
+}  // namespace fs
+}  // namespace utils
+
+#endif  // !defined(UTILS_FS_WALKER_HPP)
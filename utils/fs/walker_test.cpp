@@ -0,0 +1,250 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "utils/fs/walker.hpp"
+
+extern "C" {
+#include <unistd.h>
+}
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <atf-c++.hpp>
+
+#include "utils/format/containers.ipp"
+#include "utils/format/macros.hpp"
+#include "utils/fs/exceptions.hpp"
+#include "utils/fs/operations.hpp"
+#include "utils/fs/path.hpp"
+
+namespace fs = utils::fs;
+
+
+namespace {
+
+
+/// Walks a tree and records all the events in it.
+///
+/// \param root The directory to walk.
+/// \param recursive Whether to descend into subdirectories or not.
+/// \param max_open Maximum number of directories to keep open at once.
+///
+/// \return The sequence of events as strings of the form 'type:path'.
+static std::vector< std::string >
+walk(const fs::path& root, const bool recursive,
+     const std::size_t max_open = fs::walker::default_max_open)
+{
+    std::vector< std::string > events;
+    fs::walker walker(root, recursive, max_open);
+    while (walker.next()) {
+        const char* type = NULL;
+        switch (walker.event()) {
+        case fs::walker::entry_event:
+            type = walker.is_directory() ? "dir" : "file";
+            break;
+        case fs::walker::pre_directory_event: type = "pre"; break;
+        case fs::walker::post_directory_event: type = "post"; break;
+        }
+        events.push_back(F("%s:%s") % type % walker.current_path());
+    }
+    return events;
+}
+
+
+/// Checks that a pre-order event comes before a post-order event.
+///
+/// \param events The events returned by walk().
+/// \param first The event that must come first.
+/// \param second The event that must come second.
+static void
+require_before(const std::vector< std::string >& events,
+               const std::string& first, const std::string& second)
+{
+    std::vector< std::string >::size_type first_pos = events.size();
+    std::vector< std::string >::size_type second_pos = events.size();
+    for (std::vector< std::string >::size_type i = 0; i < events.size(); ++i) {
+        if (events[i] == first)
+            first_pos = i;
+        else if (events[i] == second)
+            second_pos = i;
+    }
+    ATF_REQUIRE(first_pos < events.size());
+    ATF_REQUIRE(second_pos < events.size());
+    ATF_REQUIRE(first_pos < second_pos);
+}
+
+
+}  // anonymous namespace
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(empty);
+ATF_TEST_CASE_BODY(empty)
+{
+    fs::mkdir(fs::path("root"), 0755);
+    ATF_REQUIRE(walk(fs::path("root"), true).empty());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(not_recursive);
+ATF_TEST_CASE_BODY(not_recursive)
+{
+    fs::mkdir(fs::path("root"), 0755);
+    fs::mkdir(fs::path("root/dir"), 0755);
+    atf::utils::create_file("root/dir/nested", "");
+    atf::utils::create_file("root/.hidden", "");
+    atf::utils::create_file("root/file", "");
+
+    const std::vector< std::string > events = walk(fs::path("root"), false);
+    const std::set< std::string > actual(events.begin(), events.end());
+    ATF_REQUIRE_EQ(events.size(), actual.size());
+
+    std::set< std::string > expected;
+    expected.insert("dir:root/dir");
+    expected.insert("file:root/.hidden");
+    expected.insert("file:root/file");
+    ATF_REQUIRE_EQ(expected, actual);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(recursive);
+ATF_TEST_CASE_BODY(recursive)
+{
+    fs::mkdir(fs::path("root"), 0755);
+    fs::mkdir(fs::path("root/dir1"), 0755);
+    fs::mkdir(fs::path("root/dir1/dir2"), 0755);
+    atf::utils::create_file("root/dir1/dir2/file", "");
+    atf::utils::create_file("root/dir1/file", "");
+    ATF_REQUIRE(::symlink("..", "root/dir1/link") != -1);
+    atf::utils::create_file("root/file", "");
+
+    const std::vector< std::string > events = walk(fs::path("root"), true);
+    const std::set< std::string > actual(events.begin(), events.end());
+    ATF_REQUIRE_EQ(events.size(), actual.size());
+
+    std::set< std::string > expected;
+    expected.insert("pre:root/dir1");
+    expected.insert("pre:root/dir1/dir2");
+    expected.insert("file:root/dir1/dir2/file");
+    expected.insert("post:root/dir1/dir2");
+    expected.insert("file:root/dir1/file");
+    expected.insert("file:root/dir1/link");
+    expected.insert("post:root/dir1");
+    expected.insert("file:root/file");
+    ATF_REQUIRE_EQ(expected, actual);
+
+    require_before(events, "pre:root/dir1", "file:root/dir1/file");
+    require_before(events, "pre:root/dir1/dir2", "file:root/dir1/dir2/file");
+    require_before(events, "file:root/dir1/dir2/file", "post:root/dir1/dir2");
+    require_before(events, "post:root/dir1/dir2", "post:root/dir1");
+    require_before(events, "file:root/dir1/link", "post:root/dir1");
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(bounded_open_directories);
+ATF_TEST_CASE_BODY(bounded_open_directories)
+{
+    // Create a tree deeper than the number of directories we allow the walker
+    // to keep open, with siblings at every level so that it has to come back
+    // to directories it closed.
+    std::set< std::string > expected;
+    fs::path dir("root");
+    fs::mkdir(dir, 0755);
+    for (int i = 0; i < 10; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            const fs::path file = dir / (F("file%s") % j);
+            atf::utils::create_file(file.str(), "");
+            expected.insert(F("file:%s") % file);
+        }
+        dir = dir / "d";
+        fs::mkdir(dir, 0755);
+        expected.insert(F("pre:%s") % dir);
+        expected.insert(F("post:%s") % dir);
+    }
+
+    const std::vector< std::string > events = walk(fs::path("root"), true, 2);
+    const std::set< std::string > actual(events.begin(), events.end());
+    ATF_REQUIRE_EQ(events.size(), actual.size());
+    ATF_REQUIRE_EQ(expected, actual);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(remove);
+ATF_TEST_CASE_BODY(remove)
+{
+    fs::path dir("root");
+    fs::mkdir(dir, 0755);
+    for (int i = 0; i < 10; ++i) {
+        atf::utils::create_file((dir / "file1").str(), "");
+        atf::utils::create_file((dir / "file2").str(), "");
+        dir = dir / "d";
+        fs::mkdir(dir, 0755);
+    }
+
+    fs::walker walker(fs::path("root"), true, 3);
+    while (walker.next()) {
+        if (walker.event() != fs::walker::pre_directory_event)
+            walker.remove();
+    }
+    fs::rmdir(fs::path("root"));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(remove__fail);
+ATF_TEST_CASE_BODY(remove__fail)
+{
+    fs::mkdir(fs::path("root"), 0755);
+    fs::mkdir(fs::path("root/dir"), 0755);
+    atf::utils::create_file("root/dir/file", "");
+
+    fs::walker walker(fs::path("root"), false);
+    ATF_REQUIRE(walker.next());
+    ATF_REQUIRE_THROW_RE(fs::system_error, "Removal of root/dir failed",
+                         walker.remove());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(missing);
+ATF_TEST_CASE_BODY(missing)
+{
+    ATF_REQUIRE_THROW_RE(fs::system_error, "opendir(.*missing.*) failed",
+                         fs::walker(fs::path("missing"), true));
+}
+
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    ATF_ADD_TEST_CASE(tcs, empty);
+    ATF_ADD_TEST_CASE(tcs, not_recursive);
+    ATF_ADD_TEST_CASE(tcs, recursive);
+    ATF_ADD_TEST_CASE(tcs, bounded_open_directories);
+    ATF_ADD_TEST_CASE(tcs, remove);
+    ATF_ADD_TEST_CASE(tcs, remove__fail);
+    ATF_ADD_TEST_CASE(tcs, missing);
+}
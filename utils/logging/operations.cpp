@@ -29,6 +29,7 @@
 #include "utils/logging/operations.hpp"
 
 extern "C" {
+#include <pthread.h>
 #include <unistd.h>
 }
 
@@ -40,6 +41,7 @@ extern "C" {
 #include "utils/datetime.hpp"
 #include "utils/format/macros.hpp"
 #include "utils/fs/path.hpp"
+#include "utils/noncopyable.hpp"
 #include "utils/optional.ipp"
 #include "utils/sanity.hpp"
 #include "utils/stream.hpp"
@@ -127,8 +129,59 @@ struct global_state {
 static struct global_state* globals_singleton = NULL;
 
 
+/// Protects the global state against concurrent access.
+///
+/// Some modules log from background threads, so all accesses to the global
+/// state must happen with this lock held.  This is a plain POSIX mutex for the
+/// same reason globals_singleton is a raw pointer: it must remain usable while
+/// static objects are being destroyed.
+static pthread_mutex_t globals_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+/// Whether the fork handlers for globals_mutex have been installed yet.
+static bool fork_handlers_installed = false;
+
+
+/// Acquires globals_mutex before a fork.
+///
+/// This ensures that no other thread holds the lock at the time of the fork,
+/// which would leave the lock permanently held in the child.
+static void
+lock_before_fork(void)
+{
+    ::pthread_mutex_lock(&globals_mutex);
+}
+
+
+/// Releases globals_mutex after a fork, both in the parent and in the child.
+static void
+unlock_after_fork(void)
+{
+    ::pthread_mutex_unlock(&globals_mutex);
+}
+
+
+/// Scoped holder of globals_mutex.
+class globals_lock : utils::noncopyable {
+public:
+    /// Acquires the lock.
+    globals_lock(void)
+    {
+        ::pthread_mutex_lock(&globals_mutex);
+    }
+
+    /// Releases the lock.
+    ~globals_lock(void)
+    {
+        ::pthread_mutex_unlock(&globals_mutex);
+    }
+};
+
+
 /// Gets the singleton instance of global_state.
 ///
+/// \pre globals_mutex must be held by the caller.
+///
 /// \return A pointer to the unique global_state instance.
 static struct global_state*
 get_globals(void)
@@ -136,6 +189,13 @@ get_globals(void)
     if (globals_singleton == NULL) {
         globals_singleton = new global_state();
     }
+    if (!fork_handlers_installed) {
+        // Subprocesses log right after being forked, so they must not inherit
+        // the lock in a held state.
+        ::pthread_atfork(lock_before_fork, unlock_after_fork,
+                         unlock_after_fork);
+        fork_handlers_installed = true;
+    }
     return globals_singleton;
 }
 
@@ -158,6 +218,53 @@ level_to_char(const logging::level level)
 }
 
 
+/// Makes the log persistent.
+///
+/// \pre globals_mutex must be held by the caller.
+///
+/// \param globals The global state to update.
+/// \param new_level The new log level.
+/// \param path The file to write the logs to.
+///
+/// \throw std::range_error If the given log level is invalid.
+/// \throw std::runtime_error If the given file cannot be created.
+static void
+set_persistency_locked(struct global_state* globals,
+                       const std::string& new_level, const fs::path& path)
+{
+    globals->auto_set_persistency = false;
+
+    PRE(globals->logfile.get() == NULL);
+
+    // Update doc/troubleshooting.info if you change the log levels.
+    if (new_level == "debug")
+        globals->log_level = logging::level_debug;
+    else if (new_level == "error")
+        globals->log_level = logging::level_error;
+    else if (new_level == "info")
+        globals->log_level = logging::level_info;
+    else if (new_level == "warning")
+        globals->log_level = logging::level_warning;
+    else
+        throw std::range_error(F("Unrecognized log level '%s'") % new_level);
+
+    try {
+        globals->logfile = utils::open_ostream(path);
+    } catch (const std::runtime_error& unused_error) {
+        throw std::runtime_error(F("Failed to create log file %s") % path);
+    }
+
+    for (std::vector< std::pair< logging::level, std::string > >::const_iterator
+         iter = globals->backlog.begin(); iter != globals->backlog.end();
+         ++iter) {
+        if ((*iter).first <= globals->log_level)
+            (*globals->logfile) << (*iter).second << '\n';
+    }
+    globals->logfile->flush();
+    globals->backlog.clear();
+}
+
+
 }  // anonymous namespace
 
 
@@ -176,6 +283,7 @@ level_to_char(const logging::level level)
 fs::path
 logging::generate_log_name(const fs::path& logdir, const std::string& progname)
 {
+    globals_lock lock;
     struct global_state* globals = get_globals();
 
     if (!globals->first_timestamp)
@@ -199,6 +307,7 @@ void
 logging::log(const level message_level, const char* file, const int line,
              const std::string& user_message)
 {
+    globals_lock lock;
     struct global_state* globals = get_globals();
 
     const datetime::timestamp now = datetime::timestamp::now();
@@ -210,7 +319,7 @@ logging::log(const level message_level, const char* file, const int line,
         // application should call set_inmemory() by itself during
         // initialization to avoid this, so that it has explicit control on how
         // the call to set_persistency() happens.
-        set_persistency("debug", fs::path("/dev/stderr"));
+        set_persistency_locked(globals, "debug", fs::path("/dev/stderr"));
         globals->auto_set_persistency = false;
     }
 
@@ -238,6 +347,7 @@ logging::log(const level message_level, const char* file, const int line,
 void
 logging::set_inmemory(void)
 {
+    globals_lock lock;
     struct global_state* globals = get_globals();
 
     globals->auto_set_persistency = false;
@@ -268,36 +378,6 @@ logging::set_inmemory(void)
 void
 logging::set_persistency(const std::string& new_level, const fs::path& path)
 {
-    struct global_state* globals = get_globals();
-
-    globals->auto_set_persistency = false;
-
-    PRE(globals->logfile.get() == NULL);
-
-    // Update doc/troubleshooting.info if you change the log levels.
-    if (new_level == "debug")
-        globals->log_level = level_debug;
-    else if (new_level == "error")
-        globals->log_level = level_error;
-    else if (new_level == "info")
-        globals->log_level = level_info;
-    else if (new_level == "warning")
-        globals->log_level = level_warning;
-    else
-        throw std::range_error(F("Unrecognized log level '%s'") % new_level);
-
-    try {
-        globals->logfile = utils::open_ostream(path);
-    } catch (const std::runtime_error& unused_error) {
-        throw std::runtime_error(F("Failed to create log file %s") % path);
-    }
-
-    for (std::vector< std::pair< logging::level, std::string > >::const_iterator
-         iter = globals->backlog.begin(); iter != globals->backlog.end();
-         ++iter) {
-        if ((*iter).first <= globals->log_level)
-            (*globals->logfile) << (*iter).second << '\n';
-    }
-    globals->logfile->flush();
-    globals->backlog.clear();
+    globals_lock lock;
+    set_persistency_locked(get_globals(), new_level, path);
 }
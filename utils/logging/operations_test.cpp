@@ -29,11 +29,16 @@
 #include "utils/logging/operations.hpp"
 
 extern "C" {
+#include <sys/wait.h>
+
 #include <unistd.h>
 }
 
+#include <cstdlib>
 #include <fstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <atf-c++.hpp>
 
@@ -47,6 +52,24 @@ namespace fs = utils::fs;
 namespace logging = utils::logging;
 
 
+namespace {
+
+
+/// Logs a bunch of messages.
+///
+/// \param id Identifier of the caller to include in the messages.
+/// \param count Number of messages to log.
+static void
+log_messages(const int id, const int count)
+{
+    for (int i = 0; i < count; ++i)
+        logging::log(logging::level_info, "file", id, F("Message %s") % i);
+}
+
+
+}  // anonymous namespace
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(generate_log_name__before_log);
 ATF_TEST_CASE_BODY(generate_log_name__before_log)
 {
@@ -124,6 +147,62 @@ ATF_TEST_CASE_BODY(log)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(log__concurrent);
+ATF_TEST_CASE_BODY(log__concurrent)
+{
+    const int num_threads = 4;
+    const int num_messages = 500;
+
+    logging::set_inmemory();
+    log_messages(0, num_messages);
+    logging::set_persistency("debug", fs::path("test.log"));
+
+    std::vector< std::thread > threads;
+    for (int i = 1; i <= num_threads; ++i)
+        threads.push_back(std::thread(log_messages, i, num_messages));
+    for (std::vector< std::thread >::iterator iter = threads.begin();
+         iter != threads.end(); ++iter)
+        (*iter).join();
+
+    std::ifstream input("test.log");
+    ATF_REQUIRE(input);
+    int lines = 0;
+    std::string line;
+    while (std::getline(input, line).good()) {
+        ATF_REQUIRE_MATCH(" I [0-9]+ file:[0-9]: Message [0-9]+$", line);
+        ++lines;
+    }
+    ATF_REQUIRE_EQ((num_threads + 1) * num_messages, lines);
+}
+
+
+ATF_TEST_CASE(log__fork_while_logging);
+ATF_TEST_CASE_HEAD(log__fork_while_logging)
+{
+    set_md_var("timeout", "60");
+}
+ATF_TEST_CASE_BODY(log__fork_while_logging)
+{
+    logging::set_persistency("debug", fs::path("test.log"));
+
+    std::thread logger(log_messages, 1, 20000);
+    for (int i = 0; i < 50; ++i) {
+        const pid_t pid = ::fork();
+        ATF_REQUIRE(pid != -1);
+        if (pid == 0) {
+            // Would deadlock if the lock was inherited in a held state.
+            logging::log(logging::level_info, "child", 2, "Hello");
+            std::exit(EXIT_SUCCESS);
+        }
+        int status;
+        ATF_REQUIRE_EQ(pid, ::waitpid(pid, &status, 0));
+        ATF_REQUIRE(WIFEXITED(status));
+        ATF_REQUIRE_EQ(EXIT_SUCCESS, WEXITSTATUS(status));
+    }
+    logger.join();
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(set_inmemory__reset);
 ATF_TEST_CASE_BODY(set_inmemory__reset)
 {
@@ -342,6 +421,8 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, generate_log_name__after_log);
 
     ATF_ADD_TEST_CASE(tcs, log);
+    ATF_ADD_TEST_CASE(tcs, log__concurrent);
+    ATF_ADD_TEST_CASE(tcs, log__fork_while_logging);
 
     ATF_ADD_TEST_CASE(tcs, set_inmemory__reset);
 
@@ -42,6 +42,8 @@ extern "C" {
 #if defined(HAVE_SYS_SYSCTL_H)
 #   include <sys/sysctl.h>
 #endif
+
+#include <unistd.h>
 }
 
 #include <cerrno>
@@ -73,6 +75,10 @@ static const char* query_type_unknown = "unknown";
 static const char* query_type_sysctlbyname = "sysctlbyname";
 
 
+/// Value of query_type when we have to use sysconf(3).
+static const char* query_type_sysconf = "sysconf";
+
+
 /// Name of the sysctl MIB with the physical memory as detected by configure.
 ///
 /// This should only be used if memory_query_type is 'sysctl'.
@@ -131,6 +137,30 @@ query_sysctl(const char* mib)
 }
 
 
+/// Gets the amount of physical memory by means of sysconf(3).
+///
+/// \pre The system supports the _SC_PHYS_PAGES and _SC_PAGESIZE queries.
+///
+/// \return The amount of physical memory, in bytes.
+///
+/// \throw std::runtime_error If any of the sysconf(3) calls fail.
+static int64_t
+query_sysconf(void)
+{
+#if defined(HAVE_DECL__SC_PHYS_PAGES) && HAVE_DECL__SC_PHYS_PAGES && \
+    defined(HAVE_DECL__SC_PAGESIZE) && HAVE_DECL__SC_PAGESIZE
+    const long pages = ::sysconf(_SC_PHYS_PAGES);
+    const long page_size = ::sysconf(_SC_PAGESIZE);
+    if (pages == -1 || page_size == -1)
+        throw std::runtime_error("Failed to query the number of physical "
+                                 "memory pages with sysconf(3)");
+    return static_cast< int64_t >(pages) * page_size;
+#else
+    UNREACHABLE_MSG("sysconf(3) cannot query the physical memory");
+#endif
+}
+
+
 /// Queries the total amount of physical memory.
 ///
 /// The real query is run only once and the result is cached.  Further calls to
@@ -148,6 +178,8 @@ utils::physical_memory(void)
             amount = 0;
         } else if (std::strcmp(query_type, query_type_sysctlbyname) == 0) {
             amount = query_sysctl(query_sysctl_mib);
+        } else if (std::strcmp(query_type, query_type_sysconf) == 0) {
+            amount = query_sysconf();
         } else
             UNREACHABLE_MSG("Unimplemented memory query type");
         LI(F("Physical memory as returned by query type '%s': %s") %
@@ -67,12 +67,33 @@ struct child::impl : utils::noncopyable {
     /// The input stream for the process' stdout and stderr.  May be NULL.
     std::auto_ptr< process::ifdstream > _output;
 
+    /// Read end of the pipe connected to the process' stdout, or -1.
+    int _stdout_fd;
+
+    /// Read end of the pipe connected to the process' stderr, or -1.
+    int _stderr_fd;
+
     /// Initializes private implementation data.
     ///
     /// \param pid The process identifier.
     /// \param output The input stream.  Grabs ownership of the pointer.
-    impl(const pid_t pid, process::ifdstream* output) :
-        _pid(pid), _output(output) {}
+    /// \param stdout_fd Read end of the stdout pipe, or -1.  Grabs ownership
+    ///     of the file descriptor.
+    /// \param stderr_fd Read end of the stderr pipe, or -1.  Grabs ownership
+    ///     of the file descriptor.
+    impl(const pid_t pid, process::ifdstream* output,
+         const int stdout_fd = -1, const int stderr_fd = -1) :
+        _pid(pid), _output(output), _stdout_fd(stdout_fd),
+        _stderr_fd(stderr_fd) {}
+
+    /// Closes the pipes that have not been released to the caller.
+    ~impl(void)
+    {
+        if (_stdout_fd != -1)
+            ::close(_stdout_fd);
+        if (_stderr_fd != -1)
+            ::close(_stderr_fd);
+    }
 };
 
 
@@ -128,6 +149,27 @@ open_for_append(const fs::path& filename)
 }
 
 
+/// Prepares the read end of a pipe to be drained by the parent process.
+///
+/// The descriptor is made non-blocking so that the parent can drain whatever
+/// is available without stalling, and close-on-exec so that other subprocesses
+/// do not inherit it.
+///
+/// \param fd The read end of the pipe.
+///
+/// \throw process::system_error If the call to fcntl(2) fails.
+static void
+setup_read_end(const int fd)
+{
+    if (::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK) == -1 ||
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC) == -1) {
+        const int original_errno = errno;
+        throw process::system_error(F("Failed to set up pipe %s") % fd,
+                                    original_errno);
+    }
+}
+
+
 /// Logs the execution of another program.
 ///
 /// \param program The binary to execute.
@@ -296,6 +338,83 @@ process::child::fork_files_aux(const fs::path& stdout_file,
 }
 
 
+/// Helper function for fork_pipes().
+///
+/// Please note: if you update this function to change the return type or to
+/// raise different errors, do not forget to update fork_pipes() accordingly.
+///
+/// \return In the case of the parent, a new child object returned as a
+/// dynamically-allocated object because children classes are unique and thus
+/// noncopyable.  In the case of the child, a NULL pointer.
+///
+/// \throw process::system_error If the calls to pipe(2) or fork(2) fail.
+std::auto_ptr< process::child >
+process::child::fork_pipes_aux(void)
+{
+    std::cout.flush();
+    std::cerr.flush();
+
+    int stdout_fds[2];
+    if (detail::syscall_pipe(stdout_fds) == -1)
+        throw process::system_error("pipe(2) failed", errno);
+    int stderr_fds[2];
+    if (detail::syscall_pipe(stderr_fds) == -1) {
+        const int original_errno = errno;
+        ::close(stdout_fds[0]);
+        ::close(stdout_fds[1]);
+        throw process::system_error("pipe(2) failed", original_errno);
+    }
+    try {
+        setup_read_end(stdout_fds[0]);
+        setup_read_end(stderr_fds[0]);
+    } catch (const system_error& unused_error) {
+        ::close(stdout_fds[0]);
+        ::close(stdout_fds[1]);
+        ::close(stderr_fds[0]);
+        ::close(stderr_fds[1]);
+        throw;
+    }
+
+    std::auto_ptr< signals::interrupts_inhibiter > inhibiter(
+        new signals::interrupts_inhibiter);
+    pid_t pid = detail::syscall_fork();
+    if (pid == -1) {
+        const int original_errno = errno;
+        inhibiter.reset(NULL);  // Unblock signals.
+        ::close(stdout_fds[0]);
+        ::close(stdout_fds[1]);
+        ::close(stderr_fds[0]);
+        ::close(stderr_fds[1]);
+        throw process::system_error("fork(2) failed", original_errno);
+    } else if (pid == 0) {
+        inhibiter.reset(NULL);  // Unblock signals.
+        ::setsid();
+
+        try {
+            ::close(stdout_fds[0]);
+            ::close(stderr_fds[0]);
+            safe_dup(stdout_fds[1], STDOUT_FILENO);
+            ::close(stdout_fds[1]);
+            safe_dup(stderr_fds[1], STDERR_FILENO);
+            ::close(stderr_fds[1]);
+        } catch (const system_error& e) {
+            std::cerr << F("Failed to set up subprocess: %s\n") % e.what();
+            std::abort();
+        }
+        return std::auto_ptr< process::child >(NULL);
+    } else {
+        ::close(stdout_fds[1]);
+        ::close(stderr_fds[1]);
+        LD(F("Spawned process %s: stdout and stderr piped") % pid);
+        signals::add_pid_to_kill(pid);
+        inhibiter.reset(NULL);  // Unblock signals.
+        return std::auto_ptr< process::child >(
+            new process::child(new impl(pid, NULL, stdout_fds[0],
+                                        stderr_fds[0])));
+    }
+}
+
+
 /// Spawns a new binary and multiplexes and captures its stdout and stderr.
 ///
 /// If the subprocess cannot be completely set up for any reason, it attempts to
@@ -373,6 +492,38 @@ process::child::output(void)
 }
 
 
+/// Transfers the read end of the pipe connected to the child's stdout.
+///
+/// \pre The child must have been started by fork_pipes() and this must be
+/// the first call to this method.
+///
+/// \return A non-blocking file descriptor owned by the caller from now on.
+int
+process::child::release_stdout_fd(void)
+{
+    PRE(_pimpl->_stdout_fd != -1);
+    const int fd = _pimpl->_stdout_fd;
+    _pimpl->_stdout_fd = -1;
+    return fd;
+}
+
+
+/// Transfers the read end of the pipe connected to the child's stderr.
+///
+/// \pre The child must have been started by fork_pipes() and this must be
+/// the first call to this method.
+///
+/// \return A non-blocking file descriptor owned by the caller from now on.
+int
+process::child::release_stderr_fd(void)
+{
+    PRE(_pimpl->_stderr_fd != -1);
+    const int fd = _pimpl->_stderr_fd;
+    _pimpl->_stderr_fd = -1;
+    return fd;
+}
+
+
 /// Blocks to wait for completion.
 ///
 /// \return The termination status of the child process.
@@ -72,6 +72,43 @@ child::fork_files(Hook hook, const fs::path& stdout_file,
 }
 
 
+/// Spawns a new subprocess and connects its stdout and stderr to pipes.
+///
+/// The read ends of the pipes are non-blocking and can be obtained with
+/// release_stdout_fd() and release_stderr_fd().  The caller must drain the
+/// pipes while the subprocess runs or else the subprocess will block once it
+/// fills them.
+///
+/// If the subprocess cannot be completely set up for any reason, it attempts to
+/// dump an error message to its stderr channel and it then calls std::abort().
+///
+/// \param hook The function to execute in the subprocess.  Must not return.
+///
+/// \return A new child object, returned as a dynamically-allocated object
+/// because children classes are unique and thus noncopyable.
+///
+/// \throw process::system_error If the process cannot be spawned due to a
+///     system call error.
+template< typename Hook >
+std::auto_ptr< child >
+child::fork_pipes(Hook hook)
+{
+    std::auto_ptr< child > child = fork_pipes_aux();
+    if (child.get() == NULL) {
+        try {
+            hook();
+            std::abort();
+        } catch (const std::runtime_error& e) {
+            detail::report_error_and_abort(e);
+        } catch (...) {
+            detail::report_error_and_abort();
+        }
+    }
+
+    return child;
+}
+
+
 /// Spawns a new subprocess and multiplexes and captures its stdout and stderr.
 ///
 /// If the subprocess cannot be completely set up for any reason, it attempts to
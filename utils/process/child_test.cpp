@@ -345,6 +345,25 @@ child__fork_capture__ok(Hook hook)
 }
 
 
+/// Reads the contents of a non-blocking pipe whose writers have terminated.
+///
+/// \param fd The read end of the pipe.  Closed on return.
+///
+/// \return The contents of the pipe.
+static std::string
+read_pipe(const int fd)
+{
+    std::string contents;
+    char buffer[1024];
+    ssize_t length;
+    while ((length = ::read(fd, buffer, sizeof(buffer))) > 0)
+        contents.append(buffer, length);
+    ATF_REQUIRE_EQ(0, length);
+    ::close(fd);
+    return contents;
+}
+
+
 }  // anonymous namespace
 
 
@@ -461,6 +480,64 @@ ATF_TEST_CASE_BODY(child__fork_capture__fork_fail)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(child__fork_pipes__ok);
+ATF_TEST_CASE_BODY(child__fork_pipes__ok)
+{
+    std::auto_ptr< process::child > child = process::child::fork_pipes(
+        child_simple_functor(15, "Z"));
+    const int stdout_fd = child->release_stdout_fd();
+    const int stderr_fd = child->release_stderr_fd();
+    ATF_REQUIRE(::fcntl(stdout_fd, F_GETFL) & O_NONBLOCK);
+    ATF_REQUIRE(::fcntl(stderr_fd, F_GETFL) & O_NONBLOCK);
+
+    const process::status status = child->wait();
+    ATF_REQUIRE(status.exited());
+    ATF_REQUIRE_EQ(15, status.exitstatus());
+
+    ATF_REQUIRE_EQ("To stdout: Z\n", read_pipe(stdout_fd));
+    ATF_REQUIRE_EQ("To stderr: Z\n", read_pipe(stderr_fd));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(child__fork_pipes__new_session);
+ATF_TEST_CASE_BODY(child__fork_pipes__new_session)
+{
+    std::auto_ptr< process::child > child = process::child::fork_pipes(
+        child_check_own_session);
+    const process::status status = child->wait();
+    ATF_REQUIRE(status.exited());
+    ATF_REQUIRE_EQ(EXIT_SUCCESS, status.exitstatus());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(child__fork_pipes__pipe_fail);
+ATF_TEST_CASE_BODY(child__fork_pipes__pipe_fail)
+{
+    process::detail::syscall_pipe = pipe_fail< 23 >;
+    try {
+        process::child::fork_pipes(child_simple_function< 1, 'A' >);
+        fail("Expected exception but none raised");
+    } catch (const process::system_error& e) {
+        ATF_REQUIRE(atf::utils::grep_string("pipe.*failed", e.what()));
+        ATF_REQUIRE_EQ(23, e.original_errno());
+    }
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(child__fork_pipes__fork_fail);
+ATF_TEST_CASE_BODY(child__fork_pipes__fork_fail)
+{
+    process::detail::syscall_fork = fork_fail< 1234 >;
+    try {
+        process::child::fork_pipes(child_simple_function< 1, 'A' >);
+        fail("Expected exception but none raised");
+    } catch (const process::system_error& e) {
+        ATF_REQUIRE(atf::utils::grep_string("fork.*failed", e.what()));
+        ATF_REQUIRE_EQ(1234, e.original_errno());
+    }
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(child__fork_files__ok_function);
 ATF_TEST_CASE_BODY(child__fork_files__ok_function)
 {
@@ -822,6 +899,11 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, child__fork_capture__fork_cannot_unwind);
     ATF_ADD_TEST_CASE(tcs, child__fork_capture__fork_fail);
 
+    ATF_ADD_TEST_CASE(tcs, child__fork_pipes__ok);
+    ATF_ADD_TEST_CASE(tcs, child__fork_pipes__new_session);
+    ATF_ADD_TEST_CASE(tcs, child__fork_pipes__pipe_fail);
+    ATF_ADD_TEST_CASE(tcs, child__fork_pipes__fork_fail);
+
     ATF_ADD_TEST_CASE(tcs, child__fork_files__ok_function);
     ATF_ADD_TEST_CASE(tcs, child__fork_files__ok_functor);
     ATF_ADD_TEST_CASE(tcs, child__fork_files__catch_exceptions);
@@ -34,14 +34,26 @@
 
 extern "C" {
 #include <sys/types.h>
+#if defined(HAVE_SYS_EPOLL_H)
+#   include <sys/epoll.h>
+#   include <sys/syscall.h>
+#endif
 #include <sys/wait.h>
 
 #include <signal.h>
+#include <unistd.h>
 }
 
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <deque>
 #include <fstream>
 #include <map>
 #include <memory>
+#include <set>
 #include <stdexcept>
 
 #include "utils/datetime.hpp"
@@ -50,6 +62,7 @@ extern "C" {
 #include "utils/fs/exceptions.hpp"
 #include "utils/fs/operations.hpp"
 #include "utils/fs/path.hpp"
+#include "utils/fs/trash.hpp"
 #include "utils/logging/macros.hpp"
 #include "utils/logging/operations.hpp"
 #include "utils/noncopyable.hpp"
@@ -57,6 +70,7 @@ extern "C" {
 #include "utils/passwd.hpp"
 #include "utils/process/child.ipp"
 #include "utils/process/deadline_killer.hpp"
+#include "utils/process/exceptions.hpp"
 #include "utils/process/isolation.hpp"
 #include "utils/process/operations.hpp"
 #include "utils/process/status.hpp"
@@ -83,10 +97,239 @@ namespace {
 static const char* work_directory_template = PACKAGE_TARNAME ".XXXXXX";
 
 
+/// Maximum number of threads deleting control directories in the background.
+static const std::size_t max_trash_workers = 2;
+
+
 /// Mapping of active subprocess PIDs to their execution data.
 typedef std::map< int, executor::exec_handle > exec_handles_map;
 
 
+/// Subprocess that has been awaited for but not yet returned to the caller.
+typedef std::pair< int, process::status > completion_pair;
+
+
+#if defined(HAVE_SYS_EPOLL_H) && \
+    defined(HAVE_DECL_SYS_PIDFD_OPEN) && HAVE_DECL_SYS_PIDFD_OPEN
+/// Whether the executor can wait for subprocesses using an event loop.
+///
+/// The event loop waits for the termination of subprocesses via their pidfds
+/// and implements the deadlines of the subprocesses as the timeout of the
+/// wait.  This avoids delivering the deadlines via SIGALRM and harvests all the
+/// subprocesses that terminate at once with a single wakeup.
+#   define EVENT_LOOP_SUPPORTED 1
+#endif
+
+
+/// Maximum number of events to harvest with a single wakeup.
+static const int max_events_per_wakeup = 64;
+
+
+/// Size of the blocks in which to read the output of the subprocesses.
+static const std::size_t read_block_size = 16 * 1024;
+
+
+/// Sources of the events monitored by the event loop.
+///
+/// The source is stored in the upper half of the event data, next to the PID
+/// of the subprocess the event belongs to.
+enum event_source {
+    /// The pidfd of the subprocess, which signals its termination.
+    source_pidfd = 0,
+
+    /// The pipe connected to the stdout of the subprocess.
+    source_stdout,
+
+    /// The pipe connected to the stderr of the subprocess.
+    source_stderr
+};
+
+
+/// Output of a subprocess captured through a pipe.
+///
+/// The output is kept in memory until it grows past a threshold, at which
+/// point it is spilled to its file on disk and any further output is appended
+/// to the file.
+class captured_output : utils::noncopyable {
+    /// Read end of the pipe, or -1 once the pipe has been closed.
+    int _fd;
+
+    /// Path to the file into which to spill the output.
+    const fs::path _file;
+
+    /// Maximum amount of output to keep in memory.
+    const std::size_t _threshold;
+
+    /// The output captured so far, or none if it has been spilled to _file.
+    optional< std::string > _contents;
+
+    /// Stream to append output to once it has been spilled.  May be NULL.
+    std::auto_ptr< std::ofstream > _spilled;
+
+public:
+    /// Constructor.
+    ///
+    /// \param fd_ Non-blocking read end of the pipe.  This object takes
+    ///     ownership of the file descriptor.
+    /// \param file_ Path to the file into which to spill the output.
+    /// \param threshold_ Maximum amount of output to keep in memory.
+    captured_output(const int fd_, const fs::path& file_,
+                    const std::size_t threshold_) :
+        _fd(fd_), _file(file_), _threshold(threshold_),
+        _contents(std::string())
+    {
+    }
+
+    /// Destructor.
+    ~captured_output(void)
+    {
+        close();
+    }
+
+    /// Returns the read end of the pipe.
+    ///
+    /// \return A file descriptor, or -1 if the pipe has been closed.
+    int
+    fd(void) const
+    {
+        return _fd;
+    }
+
+    /// Returns the output captured in memory.
+    ///
+    /// \return The output, or none if it has been spilled to disk.
+    const optional< std::string >&
+    contents(void) const
+    {
+        return _contents;
+    }
+
+    /// Reads all the output available in the pipe without blocking.
+    ///
+    /// \return True if the pipe reached EOF or failed and thus has nothing
+    /// else to offer; false if the writers may still produce more output.
+    ///
+    /// \throw fs::error If the output cannot be spilled to disk.
+    bool
+    drain(void)
+    {
+        PRE(_fd != -1);
+        char buffer[read_block_size];
+        for (;;) {
+            const ssize_t length = ::read(_fd, buffer, sizeof(buffer));
+            if (length > 0) {
+                append(buffer, static_cast< std::size_t >(length));
+            } else if (length == 0) {
+                return true;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return false;
+            } else if (errno != EINTR) {
+                LW(F("Failed to read output for %s: %s") % _file %
+                   std::strerror(errno));
+                return true;
+            }
+        }
+    }
+
+    /// Closes the pipe, if still open, and flushes the spilled output.
+    void
+    close(void)
+    {
+        if (_fd != -1) {
+            ::close(_fd);
+            _fd = -1;
+        }
+        _spilled.reset(NULL);
+    }
+
+    /// Moves the output captured in memory to disk.
+    ///
+    /// Any output read afterwards is appended to the file.  This is a no-op
+    /// if the output has already been spilled.
+    ///
+    /// \throw fs::error If the file cannot be written.
+    void
+    spill(void)
+    {
+        if (!_contents)
+            return;
+
+        std::auto_ptr< std::ofstream > output(new std::ofstream(
+            _file.c_str(), std::ios::app | std::ios::binary));
+        if (!*output)
+            throw fs::error(F("Failed to create %s") % _file);
+        write(*output, _contents.get().data(), _contents.get().length());
+        _contents = none;
+        if (_fd != -1)
+            _spilled = output;
+    }
+
+private:
+    /// Appends a block of output to the capture.
+    ///
+    /// \param data The block of output.
+    /// \param length The length of the block.
+    ///
+    /// \throw fs::error If the output cannot be spilled to disk.
+    void
+    append(const char* data, const std::size_t length)
+    {
+        if (_contents) {
+            _contents.get().append(data, length);
+            if (_contents.get().length() > _threshold) {
+                LD(F("Spilling output for %s to disk") % _file);
+                spill();
+            }
+        } else {
+            INV(_spilled.get() != NULL);
+            write(*_spilled, data, length);
+        }
+    }
+
+    /// Writes a block of output to the spill file.
+    ///
+    /// \param output The stream of the spill file.
+    /// \param data The block of output.
+    /// \param length The length of the block.
+    ///
+    /// \throw fs::error If the write fails.
+    void
+    write(std::ofstream& output, const char* data, const std::size_t length)
+    {
+        output.write(data, static_cast< std::streamsize >(length));
+        if (!output)
+            throw fs::error(F("Failed to write to %s") % _file);
+    }
+};
+
+
+/// Shared pointer to a captured_output.
+typedef std::shared_ptr< captured_output > captured_output_ptr;
+
+
+/// Contents returned for the outputs that were not captured in memory.
+static const optional< std::string > no_contents;
+
+
+/// Opens a pidfd for a process.
+///
+/// \param pid The process to open the pidfd for.
+///
+/// \return The file descriptor, or -1 if the system call failed.  errno is set
+/// in this case.
+static int
+pidfd_open(const int pid)
+{
+#if defined(EVENT_LOOP_SUPPORTED)
+    return static_cast< int >(::syscall(SYS_pidfd_open, pid, 0));
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+
 }  // anonymous namespace
 
 
@@ -144,7 +387,28 @@ struct utils::process::executor::exec_handle::impl : utils::noncopyable {
     const optional< passwd::user > unprivileged_user;
 
     /// Timer to kill the subprocess on activation.
-    process::deadline_killer timer;
+    ///
+    /// Only used if the subprocess is not monitored by the event loop;
+    /// otherwise, the event loop enforces the deadline.
+    std::auto_ptr< process::deadline_killer > timer;
+
+    /// Time at which the subprocess has to be killed if it is still running.
+    const datetime::timestamp deadline;
+
+    /// Whether the event loop killed the subprocess due to its deadline.
+    bool deadline_expired;
+
+    /// File descriptor to monitor the termination of the subprocess.
+    ///
+    /// This is -1 if the subprocess is not monitored by the event loop or if
+    /// the subprocess has already been awaited for.
+    int pidfd;
+
+    /// Captured stdout of the subprocess, or NULL if it goes to stdout_file.
+    captured_output_ptr stdout_capture;
+
+    /// Captured stderr of the subprocess, or NULL if it goes to stderr_file.
+    captured_output_ptr stderr_capture;
 
     /// Number of owners of the on-disk state.
     executor::detail::refcnt_t state_owners;
@@ -164,6 +428,11 @@ struct utils::process::executor::exec_handle::impl : utils::noncopyable {
     ///     For first-time processes, this should be a new counter set to 0;
     ///     for followup processes, this should point to the same counter used
     ///     by the preceding process.
+    /// \param pidfd_ File descriptor to monitor the termination of the
+    ///     subprocess from the event loop, or -1 to use a timer instead.  This
+    ///     object takes ownership of the file descriptor.
+    /// \param stdout_capture_ Captured stdout of the subprocess, if any.
+    /// \param stderr_capture_ Captured stderr of the subprocess, if any.
     impl(const int pid_,
          const fs::path& control_directory_,
          const fs::path& stdout_file_,
@@ -171,19 +440,115 @@ struct utils::process::executor::exec_handle::impl : utils::noncopyable {
          const datetime::timestamp& start_time_,
          const datetime::delta& timeout,
          const optional< passwd::user > unprivileged_user_,
-         executor::detail::refcnt_t state_owners_) :
+         executor::detail::refcnt_t state_owners_,
+         const int pidfd_,
+         captured_output_ptr stdout_capture_ = captured_output_ptr(),
+         captured_output_ptr stderr_capture_ = captured_output_ptr()) :
         pid(pid_),
         control_directory(control_directory_),
         stdout_file(stdout_file_),
         stderr_file(stderr_file_),
         start_time(start_time_),
         unprivileged_user(unprivileged_user_),
-        timer(timeout, pid_),
+        timer(pidfd_ == -1 ? new process::deadline_killer(timeout, pid_) :
+              NULL),
+        deadline(start_time_ + timeout),
+        deadline_expired(false),
+        pidfd(pidfd_),
+        stdout_capture(stdout_capture_),
+        stderr_capture(stderr_capture_),
         state_owners(state_owners_)
     {
         (*state_owners)++;
         POST(*state_owners > 0);
     }
+
+    /// Destructor.
+    ~impl(void)
+    {
+        close_pidfd();
+    }
+
+    /// Closes the pidfd, if any, which also removes it from the event loop.
+    void
+    close_pidfd(void)
+    {
+        if (pidfd != -1) {
+            ::close(pidfd);
+            pidfd = -1;
+        }
+    }
+
+    /// Reads the output that a pipe event announced.
+    ///
+    /// \param epoll_fd The event loop in which the pipe is registered.
+    /// \param source The pipe that has output available.
+    ///
+    /// \throw fs::error If the output cannot be spilled to disk.
+    void
+    drain_output(const int epoll_fd, const event_source source)
+    {
+        captured_output& output = source == source_stdout ?
+            *stdout_capture : *stderr_capture;
+        if (output.fd() != -1 && output.drain())
+            close_output(epoll_fd, output);
+    }
+
+    /// Reads the remaining output of a terminated subprocess.
+    ///
+    /// Any descendants of the subprocess that escaped its process group may
+    /// still hold the pipes open, so this does not wait for EOF: only the
+    /// output that is already available is collected.
+    ///
+    /// \param epoll_fd The event loop in which the pipes are registered.
+    ///
+    /// \throw fs::error If the output cannot be spilled to disk.
+    void
+    finish_outputs(const int epoll_fd)
+    {
+        if (stdout_capture.get() != NULL && stdout_capture->fd() != -1) {
+            (void)stdout_capture->drain();
+            close_output(epoll_fd, *stdout_capture);
+        }
+        if (stderr_capture.get() != NULL && stderr_capture->fd() != -1) {
+            (void)stderr_capture->drain();
+            close_output(epoll_fd, *stderr_capture);
+        }
+    }
+
+    /// Stops monitoring a pipe and closes it.
+    ///
+    /// \param epoll_fd The event loop in which the pipe is registered.
+    /// \param output The captured output whose pipe to close.
+    static void
+    close_output(const int epoll_fd, captured_output& output)
+    {
+#if defined(EVENT_LOOP_SUPPORTED)
+        // Subprocesses spawned later may hold copies of the pipe until they
+        // exec, which would keep it registered; remove it explicitly.
+        (void)::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, output.fd(), NULL);
+#else
+        (void)epoll_fd;
+#endif
+        output.close();
+    }
+
+    /// Stops the deadline of the subprocess.
+    void
+    unprogram(void)
+    {
+        if (timer.get() != NULL)
+            timer->unprogram();
+    }
+
+    /// Checks whether the subprocess was killed due to its deadline.
+    ///
+    /// \return True if the deadline was reached; false otherwise.
+    bool
+    timed_out(void) const
+    {
+        return timer.get() != NULL ? timer->fired() : deadline_expired;
+    }
 };
 
 
@@ -285,6 +650,12 @@ struct utils::process::executor::exit_handle::impl : utils::noncopyable {
     /// Path to the subprocess's stderr file.
     const fs::path stderr_file;
 
+    /// Captured stdout of the subprocess, or NULL if it went to stdout_file.
+    const captured_output_ptr stdout_capture;
+
+    /// Captured stderr of the subprocess, or NULL if it went to stderr_file.
+    const captured_output_ptr stderr_capture;
+
     /// Number of owners of the on-disk state.
     ///
     /// This will be 1 if this exit_handle is the last holder of the on-disk
@@ -299,6 +670,12 @@ struct utils::process::executor::exit_handle::impl : utils::noncopyable {
     /// ourselves when the handle is destroyed.
     exec_handles_map& all_exec_handles;
 
+    /// Mutable pointer to the trash of the corresponding executor.
+    ///
+    /// Like all_exec_handles, this references a member of the executor_handle
+    /// that yielded this exit_handle instance.
+    fs::trash& trash;
+
     /// Whether the subprocess state has been cleaned yet or not.
     ///
     /// Used to keep track of explicit calls to the public cleanup().
@@ -318,10 +695,15 @@ struct utils::process::executor::exit_handle::impl : utils::noncopyable {
     ///     directory.
     /// \param stdout_file_ Path to the subprocess's stdout file.
     /// \param stderr_file_ Path to the subprocess's stderr file.
+    /// \param stdout_capture_ Captured stdout of the subprocess, if any.
+    /// \param stderr_capture_ Captured stderr of the subprocess, if any.
     /// \param [in,out] state_owners_ Number of owners of the on-disk state.
     /// \param [in,out] all_exec_handles_ Global object keeping track of all
     ///     active executions for an executor.  This is a pointer to a member of
     ///     the executor_handle object.
+    /// \param [in,out] trash_ Trash into which to move the control directory
+    ///     on cleanup.  This is a pointer to a member of the executor_handle
+    ///     object.
     impl(const int original_pid_,
          const optional< process::status > status_,
          const optional< passwd::user > unprivileged_user_,
@@ -330,15 +712,19 @@ struct utils::process::executor::exit_handle::impl : utils::noncopyable {
          const fs::path& control_directory_,
          const fs::path& stdout_file_,
          const fs::path& stderr_file_,
+         captured_output_ptr stdout_capture_,
+         captured_output_ptr stderr_capture_,
          detail::refcnt_t state_owners_,
-         exec_handles_map& all_exec_handles_) :
+         exec_handles_map& all_exec_handles_,
+         fs::trash& trash_) :
         original_pid(original_pid_), status(status_),
         unprivileged_user(unprivileged_user_),
         start_time(start_time_), end_time(end_time_),
         control_directory(control_directory_),
         stdout_file(stdout_file_), stderr_file(stderr_file_),
+        stdout_capture(stdout_capture_), stderr_capture(stderr_capture_),
         state_owners(state_owners_),
-        all_exec_handles(all_exec_handles_), cleaned(false)
+        all_exec_handles(all_exec_handles_), trash(trash_), cleaned(false)
     {
     }
 
@@ -356,6 +742,18 @@ struct utils::process::executor::exit_handle::impl : utils::noncopyable {
         }
     }
 
+    /// Moves the output captured in memory, if any, to the output files.
+    ///
+    /// \throw fs::error If the files cannot be written.
+    void
+    write_output(void)
+    {
+        if (stdout_capture.get() != NULL)
+            stdout_capture->spill();
+        if (stderr_capture.get() != NULL)
+            stderr_capture->spill();
+    }
+
     /// Cleans up the subprocess on-disk state.
     ///
     /// \throw engine::error If the cleanup fails, especially due to the
@@ -366,13 +764,16 @@ struct utils::process::executor::exit_handle::impl : utils::noncopyable {
         PRE(*state_owners > 0);
         if (*state_owners == 1) {
             LI(F("Cleaning up exit_handle for exec_handle %s") % original_pid);
-            fs::rm_r(control_directory);
+            // Deleting the directory can be expensive if the subprocess left
+            // many files behind, so do it in the background.  Any errors will
+            // be reported when the executor is cleaned up.
+            trash.dispose(control_directory);
         } else {
             LI(F("Not cleaning up exit_handle for exec_handle %s; "
                  "%s owners left") % original_pid % (*state_owners - 1));
         }
         // We must decrease our reference only after we have successfully
-        // cleaned up the control directory.  Otherwise, the rm_r call would
+        // cleaned up the control directory.  Otherwise, the dispose call would
         // throw an exception, which would in turn invoke the implicit cleanup
         // from the destructor, which would make us crash due to an invalid
         // reference count.
@@ -509,7 +910,9 @@ executor::exit_handle::work_directory(void) const
 
 /// Returns the path to the subprocess's stdout file.
 ///
-/// \return The path to a file that exists until cleanup() is called.
+/// \return The path to a file that exists until cleanup() is called.  If the
+/// output was captured in memory, the file only exists after a call to
+/// write_output().
 const fs::path&
 executor::exit_handle::stdout_file(void) const
 {
@@ -519,7 +922,9 @@ executor::exit_handle::stdout_file(void) const
 
 /// Returns the path to the subprocess's stderr file.
 ///
-/// \return The path to a file that exists until cleanup() is called.
+/// \return The path to a file that exists until cleanup() is called.  If the
+/// output was captured in memory, the file only exists after a call to
+/// write_output().
 const fs::path&
 executor::exit_handle::stderr_file(void) const
 {
@@ -527,6 +932,47 @@ executor::exit_handle::stderr_file(void) const
 }
 
 
+/// Returns the stdout of the subprocess if it was captured in memory.
+///
+/// \return The output of the subprocess, or none if it lives in stdout_file().
+const optional< std::string >&
+executor::exit_handle::stdout_contents(void) const
+{
+    return _pimpl->stdout_capture.get() != NULL ?
+        _pimpl->stdout_capture->contents() : no_contents;
+}
+
+
+/// Returns the stderr of the subprocess if it was captured in memory.
+///
+/// \return The output of the subprocess, or none if it lives in stderr_file().
+const optional< std::string >&
+executor::exit_handle::stderr_contents(void) const
+{
+    return _pimpl->stderr_capture.get() != NULL ?
+        _pimpl->stderr_capture->contents() : no_contents;
+}
+
+
+/// Writes the output captured in memory to the output files.
+///
+/// Afterwards, stdout_file() and stderr_file() exist and hold the whole output
+/// of the subprocess, and stdout_contents() and stderr_contents() return none.
+/// Callers that need to read or append to the files, or that spawn followup
+/// subprocesses, must call this first.  This is a no-op if the output was not
+/// captured in memory.
+///
+/// Even though this method is marked as const, it modifies the state shared by
+/// all the copies of this handle.
+///
+/// \throw fs::error If the files cannot be written.
+void
+executor::exit_handle::write_output(void) const
+{
+    _pimpl->write_output();
+}
+
+
 /// Internal implementation for the executor_handle.
 ///
 /// Because the executor is a singleton, these essentially is a container for
@@ -547,6 +993,24 @@ struct utils::process::executor::executor_handle::impl : utils::noncopyable {
     /// Mapping of PIDs to the data required at run time.
     exec_handles_map all_exec_handles;
 
+    /// Trash for the control directories of the subprocesses.
+    ///
+    /// This lives within the root work directory so that the control
+    /// directories can be moved into it.
+    std::auto_ptr< fs::trash > trash;
+
+    /// File descriptor of the event loop, or -1 if not supported.
+    int epoll_fd;
+
+    /// Subprocesses awaited for by the event loop but not yet returned.
+    std::deque< completion_pair > completions;
+
+    /// Maximum amount of output of each subprocess to keep in memory.
+    ///
+    /// If 0, the output of the subprocesses is not captured and goes straight
+    /// to their output files instead.
+    std::size_t capture_threshold;
+
     /// Whether the executor state has been cleaned yet or not.
     ///
     /// Used to keep track of explicit calls to the public cleanup().
@@ -558,10 +1022,259 @@ struct utils::process::executor::executor_handle::impl : utils::noncopyable {
         interrupts_handler(new signals::interrupts_handler()),
         root_work_directory(new fs::auto_directory(
             fs::auto_directory::mkdtemp_public(work_directory_template))),
+        trash(new fs::trash(root_work_directory->directory() / "trash",
+                            max_trash_workers)),
+        epoll_fd(setup_event_loop()),
+        capture_threshold(0),
         cleaned(false)
     {
     }
 
+    /// Creates the event loop if the system supports it.
+    ///
+    /// \return The file descriptor of the event loop, or -1 if the executor
+    /// has to fall back to timers and blocking waits.
+    static int
+    setup_event_loop(void)
+    {
+#if defined(EVENT_LOOP_SUPPORTED)
+        // The kernel may be older than the headers we were built against, so
+        // check that pidfds actually work before relying on them.
+        const int self_pidfd = pidfd_open(::getpid());
+        if (self_pidfd == -1) {
+            LI(F("pidfd_open(2) not supported (%s); using timers to enforce "
+                 "deadlines") % std::strerror(errno));
+            return -1;
+        }
+        ::close(self_pidfd);
+
+        const int fd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (fd == -1)
+            LW(F("epoll_create1(2) failed (%s); using timers to enforce "
+                 "deadlines") % std::strerror(errno));
+        return fd;
+#else
+        return -1;
+#endif
+    }
+
+    /// Starts monitoring a subprocess from the event loop.
+    ///
+    /// \param pid The PID of the subprocess.
+    ///
+    /// \return The pidfd of the subprocess, or -1 if the event loop is not in
+    /// use.
+    ///
+    /// \throw process::system_error If the subprocess cannot be monitored.
+    int
+    monitor(const int pid)
+    {
+        if (epoll_fd == -1)
+            return -1;
+
+#if defined(EVENT_LOOP_SUPPORTED)
+        const int pidfd = pidfd_open(pid);
+        if (pidfd == -1) {
+            const int original_errno = errno;
+            throw process::system_error(
+                F("Failed to open pidfd for PID %s") % pid, original_errno);
+        }
+
+        try {
+            add_event(pidfd, pid, source_pidfd);
+        } catch (const process::system_error& unused_error) {
+            ::close(pidfd);
+            throw;
+        }
+        return pidfd;
+#else
+        (void)pid;
+        UNREACHABLE;
+#endif
+    }
+
+    /// Starts monitoring the captured output of a subprocess.
+    ///
+    /// \param pid The PID of the subprocess.
+    /// \param source The output to monitor.
+    /// \param output The captured output whose pipe to monitor.
+    ///
+    /// \throw process::system_error If the pipe cannot be monitored.
+    void
+    monitor_output(const int pid, const event_source source,
+                   const captured_output& output)
+    {
+        PRE(epoll_fd != -1);
+        add_event(output.fd(), pid, source);
+    }
+
+    /// Registers a file descriptor in the event loop.
+    ///
+    /// \param fd The file descriptor to register.
+    /// \param pid The PID of the subprocess the file descriptor belongs to.
+    /// \param source What the file descriptor represents.
+    ///
+    /// \throw process::system_error If the registration fails.
+    void
+    add_event(const int fd, const int pid, const event_source source)
+    {
+#if defined(EVENT_LOOP_SUPPORTED)
+        struct ::epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u64 = (static_cast< uint64_t >(source) << 32) |
+            static_cast< uint32_t >(pid);
+        if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            const int original_errno = errno;
+            throw process::system_error(
+                F("Failed to monitor PID %s") % pid, original_errno);
+        }
+#else
+        (void)fd;
+        (void)pid;
+        (void)source;
+        UNREACHABLE;
+#endif
+    }
+
+    /// Computes how long the event loop can sleep for.
+    ///
+    /// \param now The current time.
+    /// \param [out] running Number of subprocesses still being monitored.
+    ///
+    /// \return The time until the closest deadline in milliseconds, or -1 if
+    /// there are no deadlines to wait for.
+    int
+    next_timeout_ms(const datetime::timestamp& now, std::size_t& running) const
+    {
+        running = 0;
+        optional< int64_t > closest;
+        for (exec_handles_map::const_iterator iter = all_exec_handles.begin();
+             iter != all_exec_handles.end(); ++iter) {
+            const exec_handle::impl& data = *(*iter).second._pimpl;
+            if (data.pidfd == -1)
+                continue;
+            ++running;
+            if (data.deadline_expired)
+                continue;
+            const int64_t remaining = data.deadline.to_microseconds() -
+                now.to_microseconds();
+            if (!closest || remaining < closest.get())
+                closest = remaining;
+        }
+        if (!closest)
+            return -1;
+        else if (closest.get() <= 0)
+            return 0;
+        else
+            return static_cast< int >(
+                std::min(closest.get() / 1000 + 1,
+                         static_cast< int64_t >(INT_MAX)));
+    }
+
+    /// Kills the subprocesses whose deadline has been reached.
+    ///
+    /// \param now The current time.
+    void
+    kill_expired(const datetime::timestamp& now)
+    {
+        for (exec_handles_map::iterator iter = all_exec_handles.begin();
+             iter != all_exec_handles.end(); ++iter) {
+            exec_handle::impl& data = *(*iter).second._pimpl;
+            if (data.pidfd == -1 || data.deadline_expired ||
+                now < data.deadline)
+                continue;
+            LI(F("Subprocess with exec_handle %s reached its deadline") %
+               data.pid);
+            process::terminate_group(data.pid);
+            data.deadline_expired = true;
+        }
+    }
+
+    /// Waits for subprocesses to terminate and for deadlines to expire.
+    ///
+    /// All the subprocesses that terminated during the wait are awaited for
+    /// and queued in the completions list, and any output available from the
+    /// captured subprocesses is collected.  The wait may also return without
+    /// new completions if it was interrupted by a signal, if a deadline
+    /// expired or if it only collected output, so the caller must loop.
+    ///
+    /// \throw process::system_error If there are no subprocesses to wait for
+    ///     or if the event loop fails.
+    /// \throw fs::error If the captured output cannot be spilled to disk.
+    void
+    poll_events(void)
+    {
+#if defined(EVENT_LOOP_SUPPORTED)
+        std::size_t running;
+        const int timeout_ms = next_timeout_ms(datetime::timestamp::now(),
+                                               running);
+        if (running == 0)
+            throw process::system_error("No subprocesses to wait for", ECHILD);
+
+        struct ::epoll_event events[max_events_per_wakeup];
+        const int nevents = ::epoll_wait(epoll_fd, events,
+                                         max_events_per_wakeup, timeout_ms);
+        if (nevents == -1) {
+            const int original_errno = errno;
+            if (original_errno == EINTR)
+                return;  // Let the caller check for interrupts.
+            throw process::system_error("epoll_wait(2) failed",
+                                        original_errno);
+        }
+
+        for (int i = 0; i < nevents; ++i) {
+            const int pid = static_cast< int >(
+                static_cast< uint32_t >(events[i].data.u64));
+            const event_source source = static_cast< event_source >(
+                events[i].data.u64 >> 32);
+            const exec_handles_map::iterator iter = all_exec_handles.find(pid);
+            INV_MSG(iter != all_exec_handles.end(),
+                    F("Event for unknown PID %s") % pid);
+            exec_handle::impl& data = *(*iter).second._pimpl;
+            if (source != source_pidfd) {
+                data.drain_output(epoll_fd, source);
+                continue;
+            }
+            // Subprocesses spawned later may hold copies of the pidfd until
+            // they exec, which would keep it registered; remove it explicitly.
+            (void)::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, data.pidfd, NULL);
+            data.close_pidfd();
+            completions.push_back(completion_pair(pid, process::wait(pid)));
+        }
+
+        kill_expired(datetime::timestamp::now());
+#else
+        UNREACHABLE;
+#endif
+    }
+
+    /// Waits for a subprocess to terminate.
+    ///
+    /// \param pid The PID of the subprocess to wait for, or none to wait for
+    ///     any subprocess.
+    ///
+    /// \return The PID and status of the terminated subprocess.
+    ///
+    /// \throw signals::interrupted_error If an interrupt fires while waiting.
+    completion_pair
+    wait_event_loop(const optional< int > pid)
+    {
+        PRE(epoll_fd != -1);
+        for (;;) {
+            signals::check_interrupt();
+            for (std::deque< completion_pair >::iterator
+                     iter = completions.begin(); iter != completions.end();
+                 ++iter) {
+                if (!pid || (*iter).first == pid.get()) {
+                    const completion_pair completion = *iter;
+                    completions.erase(iter);
+                    return completion;
+                }
+            }
+            poll_events();
+        }
+    }
+
     /// Destructor.
     ~impl(void)
     {
@@ -582,16 +1295,25 @@ struct utils::process::executor::executor_handle::impl : utils::noncopyable {
     {
         PRE(!cleaned);
 
+        // The subprocesses in the completions queue have already been reaped,
+        // so their PIDs may belong to unrelated processes by now.
+        std::set< int > reaped;
+        for (std::deque< completion_pair >::const_iterator
+                 iter = completions.begin(); iter != completions.end(); ++iter)
+            reaped.insert((*iter).first);
+
         for (exec_handles_map::const_iterator iter = all_exec_handles.begin();
              iter != all_exec_handles.end(); ++iter) {
             const int& pid = (*iter).first;
             const exec_handle& data = (*iter).second;
 
-            process::terminate_group(pid);
-            int status;
-            if (::waitpid(pid, &status, 0) == -1) {
-                // Should not happen.
-                LW(F("Failed to wait for PID %s") % pid);
+            if (reaped.find(pid) == reaped.end()) {
+                process::terminate_group(pid);
+                int status;
+                if (::waitpid(pid, &status, 0) == -1) {
+                    // Should not happen.
+                    LW(F("Failed to wait for PID %s") % pid);
+                }
             }
 
             try {
@@ -602,6 +1324,19 @@ struct utils::process::executor::executor_handle::impl : utils::noncopyable {
             }
         }
         all_exec_handles.clear();
+        completions.clear();
+
+        try {
+            trash->drain();
+        } catch (const fs::error& e) {
+            LE(F("Failed to clean up subprocess work directories: %s") %
+               e.what());
+        }
+
+        if (epoll_fd != -1) {
+            ::close(epoll_fd);
+            epoll_fd = -1;
+        }
 
         try {
             // The following only causes the work directory to be deleted, not
@@ -638,7 +1373,11 @@ struct utils::process::executor::executor_handle::impl : utils::noncopyable {
         const exec_handles_map::iterator iter = all_exec_handles.find(
             original_pid);
         exec_handle& data = (*iter).second;
-        data._pimpl->timer.unprogram();
+        data._pimpl->unprogram();
+
+        // The process group is gone, so the pipes hold all the output that
+        // the subprocess could produce.
+        data._pimpl->finish_outputs(epoll_fd);
 
         // It is tempting to assert here (and old code did) that, if the timer
         // has fired, the process has been forcibly killed by us.  This is not
@@ -651,25 +1390,30 @@ struct utils::process::executor::executor_handle::impl : utils::noncopyable {
         // this correctly but we don't care because this should not really
         // happen.
 
-        if (!fs::exists(data.stdout_file())) {
+        if (data._pimpl->stdout_capture.get() == NULL &&
+            !fs::exists(data.stdout_file())) {
             std::ofstream new_stdout(data.stdout_file().c_str());
         }
-        if (!fs::exists(data.stderr_file())) {
+        if (data._pimpl->stderr_capture.get() == NULL &&
+            !fs::exists(data.stderr_file())) {
             std::ofstream new_stderr(data.stderr_file().c_str());
         }
 
         return exit_handle(std::shared_ptr< exit_handle::impl >(
             new exit_handle::impl(
                 data.pid(),
-                data._pimpl->timer.fired() ?
+                data._pimpl->timed_out() ?
                     none : utils::make_optional(status),
                 data._pimpl->unprivileged_user,
                 data._pimpl->start_time, datetime::timestamp::now(),
                 data.control_directory(),
                 data.stdout_file(),
                 data.stderr_file(),
+                data._pimpl->stdout_capture,
+                data._pimpl->stderr_capture,
                 data._pimpl->state_owners,
-                all_exec_handles)));
+                all_exec_handles,
+                *trash)));
     }
 };
 
@@ -712,6 +1456,45 @@ executor::executor_handle::cleanup(void)
 }
 
 
+/// Captures the output of the subprocesses in memory.
+///
+/// Once enabled, the stdout and stderr of the subprocesses spawned by spawn()
+/// without explicit output targets are connected to pipes that the executor
+/// drains while it waits for the subprocesses.  The output is kept in memory
+/// and is only written to the output files once it exceeds the threshold or
+/// when the caller asks for it with exit_handle::write_output().  This saves
+/// creating, writing and reading back two files per subprocess when the caller
+/// can consume the output straight from exit_handle::stdout_contents() and
+/// exit_handle::stderr_contents().
+///
+/// Capturing requires the event loop to drain the pipes, so this is a no-op
+/// on systems that do not support it.
+///
+/// \param threshold Maximum amount of output of each stream to keep in
+///     memory.  Must be positive.
+void
+executor::executor_handle::enable_output_capture(const std::size_t threshold)
+{
+    PRE(threshold > 0);
+    if (_pimpl->epoll_fd == -1) {
+        LI("Event loop not available; not capturing output in memory");
+        return;
+    }
+    _pimpl->capture_threshold = threshold;
+}
+
+
+/// Checks whether the output of new subprocesses is captured in memory.
+///
+/// \return True if enable_output_capture() was called and the system supports
+/// capturing output; false otherwise.
+bool
+executor::executor_handle::capturing_output(void) const
+{
+    return _pimpl->capture_threshold > 0;
+}
+
+
 /// Initializes the executor.
 ///
 /// \pre This function can only be called if there is no other executor_handle
@@ -752,6 +1535,8 @@ executor::executor_handle::spawn_pre(void)
 /// \param timeout Maximum amount of time the subprocess can run for.
 /// \param unprivileged_user If not none, user to switch to before execution.
 /// \param child The process created by spawn().
+/// \param captured Whether the child was spawned with its output connected to
+///     pipes to be captured in memory.
 ///
 /// \return The execution handle of the started subprocess.
 executor::exec_handle
@@ -761,8 +1546,19 @@ executor::executor_handle::spawn_post(
     const fs::path& stderr_file,
     const datetime::delta& timeout,
     const optional< passwd::user > unprivileged_user,
-    std::auto_ptr< process::child > child)
+    std::auto_ptr< process::child > child,
+    const bool captured)
 {
+    captured_output_ptr stdout_capture, stderr_capture;
+    if (captured) {
+        stdout_capture.reset(new captured_output(
+            child->release_stdout_fd(), stdout_file,
+            _pimpl->capture_threshold));
+        stderr_capture.reset(new captured_output(
+            child->release_stderr_fd(), stderr_file,
+            _pimpl->capture_threshold));
+    }
+
     const exec_handle handle(std::shared_ptr< exec_handle::impl >(
         new exec_handle::impl(
             child->pid(),
@@ -772,23 +1568,38 @@ executor::executor_handle::spawn_post(
             datetime::timestamp::now(),
             timeout,
             unprivileged_user,
-            detail::refcnt_t(new detail::refcnt_t::element_type(0)))));
+            detail::refcnt_t(new detail::refcnt_t::element_type(0)),
+            _pimpl->monitor(child->pid()),
+            stdout_capture,
+            stderr_capture)));
     INV_MSG(_pimpl->all_exec_handles.find(handle.pid()) ==
             _pimpl->all_exec_handles.end(),
             F("PID %s already in all_exec_handles; not properly cleaned "
               "up or reused too fast") % handle.pid());;
     _pimpl->all_exec_handles.insert(exec_handles_map::value_type(
         handle.pid(), handle));
+    if (captured) {
+        _pimpl->monitor_output(handle.pid(), source_stdout, *stdout_capture);
+        _pimpl->monitor_output(handle.pid(), source_stderr, *stderr_capture);
+    }
     LI(F("Spawned subprocess with exec_handle %s") % handle.pid());
     return handle;
 }
 
 
 /// Pre-helper for the spawn_followup() method.
+///
+/// \param base Exit handle of the subprocess to use as context.
+///
+/// \throw fs::error If the output of base cannot be written to its files.
 void
-executor::executor_handle::spawn_followup_pre(void)
+executor::executor_handle::spawn_followup_pre(const exit_handle& base)
 {
     signals::check_interrupt();
+
+    // The followup appends its output to the files of base, so these have to
+    // hold the output of base first.
+    base.write_output();
 }
 
 
@@ -815,7 +1626,8 @@ executor::executor_handle::spawn_followup_post(
             datetime::timestamp::now(),
             timeout,
             base.unprivileged_user(),
-            base.state_owners())));
+            base.state_owners(),
+            _pimpl->monitor(child->pid()))));
     INV_MSG(_pimpl->all_exec_handles.find(handle.pid()) ==
             _pimpl->all_exec_handles.end(),
             F("PID %s already in all_exec_handles; not properly cleaned "
@@ -836,6 +1648,11 @@ executor::exit_handle
 executor::executor_handle::wait(const exec_handle exec_handle)
 {
     signals::check_interrupt();
+    if (_pimpl->epoll_fd != -1) {
+        const completion_pair completion = _pimpl->wait_event_loop(
+            utils::make_optional(exec_handle.pid()));
+        return _pimpl->post_wait(completion.first, completion.second);
+    }
     const process::status status = process::wait(exec_handle.pid());
     return _pimpl->post_wait(exec_handle.pid(), status);
 }
@@ -848,6 +1665,10 @@ executor::exit_handle
 executor::executor_handle::wait_any(void)
 {
     signals::check_interrupt();
+    if (_pimpl->epoll_fd != -1) {
+        const completion_pair completion = _pimpl->wait_event_loop(none);
+        return _pimpl->post_wait(completion.first, completion.second);
+    }
     const process::status status = process::wait_any();
     return _pimpl->post_wait(status.dead_pid(), status);
 }
@@ -66,6 +66,7 @@
 
 #include <cstddef>
 #include <memory>
+#include <string>
 
 #include "utils/datetime_fwd.hpp"
 #include "utils/fs/path_fwd.hpp"
@@ -165,6 +166,9 @@ public:
     utils::fs::path work_directory(void) const;
     const utils::fs::path& stdout_file(void) const;
     const utils::fs::path& stderr_file(void) const;
+    const utils::optional< std::string >& stdout_contents(void) const;
+    const utils::optional< std::string >& stderr_contents(void) const;
+    void write_output(void) const;
 };
 
 
@@ -187,9 +191,10 @@ class executor_handle {
                            const utils::fs::path&,
                            const utils::datetime::delta&,
                            const utils::optional< utils::passwd::user >,
-                           std::auto_ptr< utils::process::child >);
+                           std::auto_ptr< utils::process::child >,
+                           const bool);
 
-    void spawn_followup_pre(void);
+    void spawn_followup_pre(const exit_handle&);
     exec_handle spawn_followup_post(const exit_handle&,
                                     const utils::datetime::delta&,
                                     std::auto_ptr< utils::process::child >);
@@ -201,6 +206,9 @@ public:
 
     void cleanup(void);
 
+    void enable_output_capture(const std::size_t);
+    bool capturing_output(void) const;
+
     template< class Hook >
     exec_handle spawn(Hook,
                       const datetime::delta&,
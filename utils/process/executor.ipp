@@ -111,6 +111,10 @@ public:
 /// \param stderr_target If not none, file to which to write the stderr of the
 ///     test case.
 ///
+/// If output capture is enabled and no targets are given, the stdout and
+/// stderr of the subprocess are captured in memory instead of being written
+/// to the default files; see enable_output_capture().
+///
 /// \return A handle for the background operation.  Used to match the result of
 /// the execution returned by wait_any() with this invocation.
 template< class Hook >
@@ -129,15 +133,19 @@ executor::executor_handle::spawn(
     const fs::path stderr_path = stderr_target ?
         stderr_target.get() : (unique_work_directory / detail::stderr_name);
 
-    std::auto_ptr< process::child > child = process::child::fork_files(
-        detail::run_child< Hook >(hook,
-                                  unique_work_directory,
-                                  unique_work_directory / detail::work_subdir,
-                                  unprivileged_user),
-        stdout_path, stderr_path);
+    const fs::path work_directory = unique_work_directory / detail::work_subdir;
+    const detail::run_child< Hook > run_child(hook, unique_work_directory,
+                                              work_directory,
+                                              unprivileged_user);
+
+    const bool capture = !stdout_target && !stderr_target &&
+        capturing_output();
+    std::auto_ptr< process::child > child = capture ?
+        process::child::fork_pipes(run_child) :
+        process::child::fork_files(run_child, stdout_path, stderr_path);
 
     return spawn_post(unique_work_directory, stdout_path, stderr_path,
-                      timeout, unprivileged_user, child);
+                      timeout, unprivileged_user, child, capture);
 }
 
 
@@ -163,7 +171,7 @@ executor::executor_handle::spawn_followup(Hook hook,
                                           const exit_handle& base,
                                           const datetime::delta& timeout)
 {
-    spawn_followup_pre();
+    spawn_followup_pre(base);
 
     std::auto_ptr< process::child > child = process::child::fork_files(
         detail::run_child< Hook >(hook,
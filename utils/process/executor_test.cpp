@@ -221,6 +221,31 @@ child_print(const fs::path& /* control_directory */)
 }
 
 
+/// Subprocess that writes a large amount of data to stdout.
+class child_print_lots {
+    /// Number of bytes to write.
+    std::size_t _length;
+
+public:
+    /// Constructor.
+    ///
+    /// \param length Number of bytes to write.
+    child_print_lots(const std::size_t length) : _length(length)
+    {
+    }
+
+    /// Runs the subprocess.
+    void
+    operator()(const fs::path& /* control_directory */)
+        UTILS_NORETURN
+    {
+        for (std::size_t i = 0; i < _length; ++i)
+            std::cout << static_cast< char >('a' + i % 26);
+        do_exit(EXIT_SUCCESS);
+    }
+};
+
+
 /// Subprocess that sleeps for a period of time before exiting.
 class child_sleep {
     /// Seconds to sleep for before termination.
@@ -446,6 +471,70 @@ ATF_TEST_CASE_BODY(integration__run_many)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(integration__wait_after_many_exits);
+ATF_TEST_CASE_BODY(integration__wait_after_many_exits)
+{
+    executor::executor_handle handle = executor::setup();
+
+    const executor::exec_handle exec_handle1 = do_spawn(handle, child_exit(1));
+    const executor::exec_handle exec_handle2 = do_spawn(handle, child_exit(2));
+    const executor::exec_handle exec_handle3 = do_spawn(handle, child_exit(3));
+
+    // Give all subprocesses a chance to terminate so that they are collected
+    // together, and then check that waiting for a specific one does not lose
+    // track of the others.
+    ::sleep(1);
+
+    {
+        executor::exit_handle exit_handle = handle.wait(exec_handle2);
+        ATF_REQUIRE_EQ(exec_handle2.pid(), exit_handle.original_pid());
+        require_exit(2, exit_handle.status());
+        exit_handle.cleanup();
+    }
+
+    std::map< int, int > exp_exit_statuses;
+    exp_exit_statuses[exec_handle1.pid()] = 1;
+    exp_exit_statuses[exec_handle3.pid()] = 3;
+    for (std::size_t i = 0; i < 2; ++i) {
+        executor::exit_handle exit_handle = handle.wait_any();
+        const std::map< int, int >::iterator iter = exp_exit_statuses.find(
+            exit_handle.original_pid());
+        ATF_REQUIRE(iter != exp_exit_statuses.end());
+        require_exit((*iter).second, exit_handle.status());
+        exp_exit_statuses.erase(iter);
+        exit_handle.cleanup();
+    }
+
+    handle.cleanup();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(integration__cleanup_after_many_exits);
+ATF_TEST_CASE_BODY(integration__cleanup_after_many_exits)
+{
+    executor::executor_handle handle = executor::setup();
+
+    const executor::exec_handle exec_handle1 = do_spawn(handle, child_exit(1));
+    const executor::exec_handle exec_handle2 = do_spawn(handle, child_exit(2));
+    const executor::exec_handle exec_handle3 = do_spawn(handle, child_exit(3));
+
+    // Let the subprocesses be collected together so that the ones we never
+    // wait for are left behind as pending completions.
+    ::sleep(1);
+
+    {
+        executor::exit_handle exit_handle = handle.wait(exec_handle2);
+        require_exit(2, exit_handle.status());
+        exit_handle.cleanup();
+    }
+
+    handle.cleanup();
+
+    ATF_REQUIRE(!fs::exists(exec_handle1.control_directory()));
+    ATF_REQUIRE(!fs::exists(exec_handle3.control_directory()));
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(integration__parameters_and_output);
 ATF_TEST_CASE_BODY(integration__parameters_and_output)
 {
@@ -640,6 +729,120 @@ ATF_TEST_CASE_BODY(integration__output_files_always_exist)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(integration__capture_output);
+ATF_TEST_CASE_BODY(integration__capture_output)
+{
+    executor::executor_handle handle = executor::setup();
+    handle.enable_output_capture(1024);
+    if (!handle.capturing_output())
+        skip("Output capture not supported in this system");
+
+    (void)handle.spawn(child_print, infinite_timeout, none);
+    executor::exit_handle exit_handle = handle.wait_any();
+
+    ATF_REQUIRE(exit_handle.stdout_contents());
+    ATF_REQUIRE_EQ("stdout: some text\n", exit_handle.stdout_contents().get());
+    ATF_REQUIRE(exit_handle.stderr_contents());
+    ATF_REQUIRE_EQ("stderr: some other text\n",
+                   exit_handle.stderr_contents().get());
+    ATF_REQUIRE(!fs::exists(exit_handle.stdout_file()));
+    ATF_REQUIRE(!fs::exists(exit_handle.stderr_file()));
+
+    exit_handle.write_output();
+    ATF_REQUIRE(!exit_handle.stdout_contents());
+    ATF_REQUIRE(!exit_handle.stderr_contents());
+    ATF_REQUIRE(atf::utils::compare_file(exit_handle.stdout_file().str(),
+                                         "stdout: some text\n"));
+    ATF_REQUIRE(atf::utils::compare_file(exit_handle.stderr_file().str(),
+                                         "stderr: some other text\n"));
+
+    exit_handle.cleanup();
+    handle.cleanup();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(integration__capture_output__spill);
+ATF_TEST_CASE_BODY(integration__capture_output__spill)
+{
+    executor::executor_handle handle = executor::setup();
+    handle.enable_output_capture(20);
+    if (!handle.capturing_output())
+        skip("Output capture not supported in this system");
+
+    (void)handle.spawn(child_print, infinite_timeout, none);
+    executor::exit_handle exit_handle = handle.wait_any();
+
+    ATF_REQUIRE(exit_handle.stdout_contents());
+    ATF_REQUIRE_EQ("stdout: some text\n", exit_handle.stdout_contents().get());
+    ATF_REQUIRE(!exit_handle.stderr_contents());
+    ATF_REQUIRE(!fs::exists(exit_handle.stdout_file()));
+    ATF_REQUIRE(atf::utils::compare_file(exit_handle.stderr_file().str(),
+                                         "stderr: some other text\n"));
+
+    exit_handle.cleanup();
+    handle.cleanup();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(integration__capture_output__large);
+ATF_TEST_CASE_BODY(integration__capture_output__large)
+{
+    executor::executor_handle handle = executor::setup();
+    handle.enable_output_capture(4 * 1024 * 1024);
+    if (!handle.capturing_output())
+        skip("Output capture not supported in this system");
+
+    // Much larger than the capacity of a pipe so that the subprocess blocks
+    // unless the executor drains the pipe while it waits.
+    const std::size_t length = 1024 * 1024 + 17;
+    (void)handle.spawn(child_print_lots(length), infinite_timeout, none);
+    executor::exit_handle exit_handle = handle.wait_any();
+
+    require_exit(EXIT_SUCCESS, exit_handle.status());
+    ATF_REQUIRE(exit_handle.stdout_contents());
+    const std::string& contents = exit_handle.stdout_contents().get();
+    ATF_REQUIRE_EQ(length, contents.length());
+    ATF_REQUIRE_EQ("abcdefghijklmnopq", contents.substr(0, 17));
+    ATF_REQUIRE_EQ("wxyzabcdefghijklm", contents.substr(length - 17));
+
+    exit_handle.cleanup();
+    handle.cleanup();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(integration__capture_output__followup);
+ATF_TEST_CASE_BODY(integration__capture_output__followup)
+{
+    executor::executor_handle handle = executor::setup();
+    handle.enable_output_capture(1024);
+    if (!handle.capturing_output())
+        skip("Output capture not supported in this system");
+
+    (void)handle.spawn(child_create_cookie("cookie.1"), infinite_timeout, none);
+    executor::exit_handle exit_1_handle = handle.wait_any();
+    ATF_REQUIRE(exit_1_handle.stdout_contents());
+
+    (void)handle.spawn_followup(child_create_cookie("cookie.2"), exit_1_handle,
+                                infinite_timeout);
+    executor::exit_handle exit_2_handle = handle.wait_any();
+
+    ATF_REQUIRE(!exit_1_handle.stdout_contents());
+    ATF_REQUIRE(!exit_2_handle.stdout_contents());
+    ATF_REQUIRE(atf::utils::compare_file(
+                    exit_1_handle.stdout_file().str(),
+                    "Creating cookie: cookie.1 (stdout)\n"
+                    "Creating cookie: cookie.2 (stdout)\n"));
+    ATF_REQUIRE(atf::utils::compare_file(
+                    exit_1_handle.stderr_file().str(),
+                    "Creating cookie: cookie.1 (stderr)\n"
+                    "Creating cookie: cookie.2 (stderr)\n"));
+
+    exit_2_handle.cleanup();
+    exit_1_handle.cleanup();
+    handle.cleanup();
+}
+
+
 ATF_TEST_CASE(integration__timeouts);
 ATF_TEST_CASE_HEAD(integration__timeouts)
 {
@@ -921,6 +1124,8 @@ ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, integration__run_one);
     ATF_ADD_TEST_CASE(tcs, integration__run_many);
+    ATF_ADD_TEST_CASE(tcs, integration__wait_after_many_exits);
+    ATF_ADD_TEST_CASE(tcs, integration__cleanup_after_many_exits);
 
     ATF_ADD_TEST_CASE(tcs, integration__parameters_and_output);
     ATF_ADD_TEST_CASE(tcs, integration__custom_output_files);
@@ -930,6 +1135,10 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, integration__followup);
 
     ATF_ADD_TEST_CASE(tcs, integration__output_files_always_exist);
+    ATF_ADD_TEST_CASE(tcs, integration__capture_output);
+    ATF_ADD_TEST_CASE(tcs, integration__capture_output__spill);
+    ATF_ADD_TEST_CASE(tcs, integration__capture_output__large);
+    ATF_ADD_TEST_CASE(tcs, integration__capture_output__followup);
     ATF_ADD_TEST_CASE(tcs, integration__timeouts);
     ATF_ADD_TEST_CASE(tcs, integration__unprivileged_user);
     ATF_ADD_TEST_CASE(tcs, integration__auto_cleanup);
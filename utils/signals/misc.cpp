@@ -33,6 +33,7 @@
 #endif
 
 extern "C" {
+#include <pthread.h>
 #include <signal.h>
 }
 
@@ -104,3 +105,32 @@ signals::reset_all(void)
 
     return ok;
 }
+
+
+/// Starts a new thread with all signals blocked.
+///
+/// Signals are delivered to any thread that does not block them, so background
+/// threads must be started this way to ensure that signals are always delivered
+/// to, and handled by, the main thread.  The signal mask of the caller is left
+/// untouched.
+///
+/// \param body The code to run in the new thread.
+///
+/// \return The handle of the new thread.
+///
+/// \throw std::system_error If the thread cannot be started.
+std::thread
+signals::start_masked_thread(const std::function< void (void) >& body)
+{
+    ::sigset_t all_signals, old_sigmask;
+    sigfillset(&all_signals);
+    ::pthread_sigmask(SIG_SETMASK, &all_signals, &old_sigmask);
+    try {
+        std::thread thread(body);
+        ::pthread_sigmask(SIG_SETMASK, &old_sigmask, NULL);
+        return thread;
+    } catch (...) {
+        ::pthread_sigmask(SIG_SETMASK, &old_sigmask, NULL);
+        throw;
+    }
+}
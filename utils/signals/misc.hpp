@@ -32,6 +32,9 @@
 #if !defined(UTILS_SIGNALS_MISC_HPP)
 #define UTILS_SIGNALS_MISC_HPP
 
+#include <functional>
+#include <thread>
+
 namespace utils {
 namespace signals {
 
@@ -43,6 +46,9 @@ void reset(const int);
 bool reset_all(void);
 
 
+std::thread start_masked_thread(const std::function< void (void) >&);
+
+
 }  // namespace signals
 }  // namespace utils
 
@@ -29,11 +29,13 @@
 #include "utils/signals/misc.hpp"
 
 extern "C" {
+#include <pthread.h>
 #include <signal.h>
 #include <unistd.h>
 }
 
 #include <cstdlib>
+#include <thread>
 
 #include <atf-c++.hpp>
 
@@ -93,6 +95,18 @@ run_reset_all(void)
 }
 
 
+/// Body of a thread that records whether SIGINT is blocked in it.
+///
+/// \param [out] blocked Set to true if SIGINT is blocked; false otherwise.
+static void
+check_sigint_blocked(bool* blocked)
+{
+    ::sigset_t mask;
+    ::pthread_sigmask(SIG_BLOCK, NULL, &mask);
+    *blocked = sigismember(&mask, SIGINT);
+}
+
+
 }  // anonymous namespace
 
 
@@ -125,9 +139,26 @@ ATF_TEST_CASE_BODY(reset_all)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(start_masked_thread);
+ATF_TEST_CASE_BODY(start_masked_thread)
+{
+    bool blocked = false;
+    std::thread thread = signals::start_masked_thread(
+        std::bind(check_sigint_blocked, &blocked));
+    thread.join();
+    ATF_REQUIRE(blocked);
+
+    bool caller_blocked = true;
+    check_sigint_blocked(&caller_blocked);
+    ATF_REQUIRE(!caller_blocked);
+}
+
+
 ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, reset__ok);
     ATF_ADD_TEST_CASE(tcs, reset__invalid);
     ATF_ADD_TEST_CASE(tcs, reset_all);
+
+    ATF_ADD_TEST_CASE(tcs, start_masked_thread);
 }
@@ -32,11 +32,12 @@ extern "C" {
 #include <sys/time.h>
 
 #include <signal.h>
+#include <stdint.h>
 }
 
+#include <algorithm>
 #include <cerrno>
 #include <map>
-#include <set>
 #include <vector>
 
 #include "utils/datetime.hpp"
@@ -87,21 +88,62 @@ safe_setitimer(const datetime::delta& delta, itimerval* old_timeval)
 
 
 /// Deadline scheduler for all user timers on top of the unique system timer.
+///
+/// Timers are kept in a binary min-heap ordered by activation time.  Removing
+/// a timer does not touch the heap: the timer is only dropped from the set of
+/// live timers and its heap entry is discarded when it reaches the top.  This
+/// means that unprogramming a timer, which is what happens to the vast
+/// majority of timers, never reprograms the system timer.  If the system
+/// timer fires for a timer that is gone, we just rearm it for the next live
+/// one.  All timers that are due on a wakeup are run together and the system
+/// timer is rearmed at most once per wakeup.
 class global_state : utils::noncopyable {
-    /// Collection of active timers.
-    ///
-    /// Because this is a collection of pointers, all timers are guaranteed to
-    /// be unique, and we want all of these pointers to be valid.
-    typedef std::set< signals::timer* > timers_set;
-
     /// Sequence of ordered timers.
     typedef std::vector< signals::timer* > timers_vector;
 
-    /// Collection of active timestamps by their activation timestamp.
-    ///
-    /// This collection is ordered intentionally so that it can be scanned
-    /// sequentially to find either expired or expiring-now timers.
-    typedef std::map< datetime::timestamp, timers_set > timers_by_timestamp_map;
+    /// Entry in the heap of pending activations.
+    struct heap_entry {
+        /// Activation time of the timer.
+        datetime::timestamp when;
+
+        /// Identifier of the programming of the timer.
+        ///
+        /// Timer objects may be destroyed and their addresses reused while
+        /// their stale entries remain in the heap, so we cannot identify the
+        /// entries by the timer pointer alone.
+        uint64_t id;
+
+        /// The timer to run; only valid if id is still live.
+        signals::timer* timer;
+
+        /// Constructor.
+        ///
+        /// \param when_ Activation time of the timer.
+        /// \param id_ Identifier of the programming of the timer.
+        /// \param timer_ The timer to run.
+        heap_entry(const datetime::timestamp& when_, const uint64_t id_,
+                   signals::timer* timer_) :
+            when(when_), id(id_), timer(timer_)
+        {
+        }
+
+        /// Ordering for std::push_heap and friends to yield a min-heap.
+        ///
+        /// \param other The entry to compare to.
+        ///
+        /// \return True if this entry fires after the other one.
+        bool
+        operator<(const heap_entry& other) const
+        {
+            return when > other.when;
+        }
+    };
+
+    /// Collection of pending activations, some of which may be stale.
+    typedef std::vector< heap_entry > heap_vector;
+
+    /// Mapping of live timers to the identifier of their programming.
+    typedef std::map< signals::timer*, uint64_t > live_timers_map;
 
     /// The original timer before any timer was programmed.
     ::itimerval _old_timeval;
@@ -109,43 +151,75 @@ class global_state : utils::noncopyable {
     /// Programmer for the SIGALRM handler.
     std::auto_ptr< signals::programmer > _sigalrm_programmer;
 
-    /// Time of the current activation of the timer.
+    /// Time of the current activation of the system timer.
     datetime::timestamp _timer_activation;
 
-    /// Mapping of all active timers using their timestamp as the key.
-    timers_by_timestamp_map _all_timers;
+    /// Heap of pending activations.
+    heap_vector _heap;
+
+    /// Timers that are programmed and have not fired yet.
+    live_timers_map _live_timers;
 
-    /// Adds a timer to the _all_timers map.
+    /// Identifier to assign to the next programmed timer.
+    uint64_t _next_id;
+
+    /// Checks if a heap entry corresponds to a live timer.
+    ///
+    /// \param entry The entry to check.
+    ///
+    /// \return True if the timer of the entry is still programmed.
+    bool
+    is_live(const heap_entry& entry) const
+    {
+        const live_timers_map::const_iterator iter = _live_timers.find(
+            entry.timer);
+        return iter != _live_timers.end() && (*iter).second == entry.id;
+    }
+
+    /// Adds a timer to the set of pending activations.
     ///
     /// \param timer The timer to add.
     void
-    add_to_all_timers(signals::timer* timer)
+    add_timer(signals::timer* timer)
     {
-        timers_set& timers = _all_timers[timer->when()];
-        INV(timers.find(timer) == timers.end());
-        timers.insert(timer);
+        INV(_live_timers.find(timer) == _live_timers.end());
+        const uint64_t id = _next_id++;
+        _live_timers[timer] = id;
+        _heap.push_back(heap_entry(timer->when(), id, timer));
+        std::push_heap(_heap.begin(), _heap.end());
     }
 
-    /// Removes a timer from the _all_timers map.
+    /// Drops stale entries from the heap once they dominate it.
     ///
-    /// This ensures that empty vectors are removed from _all_timers if the
-    /// removal of the timer causes its bucket to be emptied.
+    /// This keeps the memory used by the heap proportional to the number of
+    /// live timers even if they are unprogrammed in an order that never
+    /// brings their stale entries to the top.
+    void
+    compact_heap(const signals::interrupts_inhibiter& /* inhibiter */)
+    {
+        if (_heap.size() < 64 || _heap.size() < _live_timers.size() * 2)
+            return;
+
+        heap_vector live;
+        live.reserve(_live_timers.size());
+        for (heap_vector::const_iterator iter = _heap.begin();
+             iter != _heap.end(); ++iter) {
+            if (is_live(*iter))
+                live.push_back(*iter);
+        }
+        std::make_heap(live.begin(), live.end());
+        _heap.swap(live);
+    }
+
+    /// Removes stale entries from the top of the heap.
     ///
-    /// \param timer The timer to remove.
+    /// \post The top of the heap, if any, corresponds to a live timer.
     void
-    remove_from_all_timers(signals::timer* timer)
+    prune_top(void)
     {
-        // We may not find the timer in _all_timers if the timer has fired,
-        // because fire() took it out from the map.
-        timers_by_timestamp_map::iterator iter = _all_timers.find(
-            timer->when());
-        if (iter != _all_timers.end()) {
-            timers_set& timers = (*iter).second;
-            INV(timers.find(timer) != timers.end());
-            timers.erase(timer);
-            if (timers.empty()) {
-                _all_timers.erase(iter);
-            }
+        while (!_heap.empty() && !is_live(_heap.front())) {
+            std::pop_heap(_heap.begin(), _heap.end());
+            _heap.pop_back();
         }
     }
 
@@ -153,8 +227,7 @@ class global_state : utils::noncopyable {
     ///
     /// \param now The current timestamp.
     ///
-    /// \post _all_timers is updated to contain only the timers that are
-    /// strictly in the future.
+    /// \post The heap only contains timers that are strictly in the future.
     ///
     /// \return A sequence of valid timers that need to be invoked in the order
     /// of activation.  These are all previously registered timers with
@@ -166,23 +239,25 @@ class global_state : utils::noncopyable {
     {
         timers_vector to_run;
 
-        timers_by_timestamp_map::iterator iter = _all_timers.begin();
-        while (iter != _all_timers.end() && (*iter).first <= now) {
-            const timers_set& timers = (*iter).second;
-            to_run.insert(to_run.end(), timers.begin(), timers.end());
-
-            // Remove expired entries here so that we can always assume that
-            // the first entry in all_timers corresponds to the next
-            // activation.
-            const timers_by_timestamp_map::iterator previous_iter = iter;
-            ++iter;
-            _all_timers.erase(previous_iter);
+        prune_top();
+        while (!_heap.empty() && _heap.front().when <= now) {
+            signals::timer* timer = _heap.front().timer;
+            _live_timers.erase(timer);
+            to_run.push_back(timer);
+
+            std::pop_heap(_heap.begin(), _heap.end());
+            _heap.pop_back();
+            prune_top();
         }
 
         return to_run;
     }
 
-    /// Adjusts the global system timer to point to the next activation.
+    /// Programs the system timer for the next activation if necessary.
+    ///
+    /// The system timer is only reprogrammed if the next activation is earlier
+    /// than the one it is armed for, or if it has already fired.  Timers that
+    /// are already due are scheduled to fire immediately.
     ///
     /// \param now The current timestamp.
     ///
@@ -192,39 +267,23 @@ class global_state : utils::noncopyable {
         const datetime::timestamp& now,
         const signals::interrupts_inhibiter& /* inhibiter */)
     {
-        if (_all_timers.empty()) {
+        prune_top();
+        if (_heap.empty()) {
             // Nothing to do.  We can reach this case if all the existing timers
-            // are in the past and they all fired.  Just ignore the request and
-            // leave the global timer as is.
+            // fired or were unprogrammed.  Just leave the global timer as is;
+            // if it fires, the handler finds nothing to run.
             return;
         }
 
-        // While fire() prunes old entries from the list of timers, it is
-        // possible for this routine to run with "expired" timers (i.e. timers
-        // whose deadline lies in the past but that have not yet fired for
-        // whatever reason that is out of our control) in the list.  We have to
-        // iterate until we find the next activation instead of assuming that
-        // the first entry represents the desired value.
-        timers_by_timestamp_map::const_iterator iter = _all_timers.begin();
-        PRE(!(*iter).second.empty());
-        datetime::timestamp next = (*iter).first;
-        while (next < now) {
-            ++iter;
-            if (iter == _all_timers.end()) {
-                // Nothing to do.  We can reach this case if all the existing
-                // timers are in the past but they have not yet fired.
-                return;
-            }
-            PRE(!(*iter).second.empty());
-            next = (*iter).first;
-        }
-
-        if (next < _timer_activation || now > _timer_activation) {
-            INV(next >= now);
-            const datetime::delta delta = next - now;
+        const datetime::timestamp& next = _heap.front().when;
+        if (next < _timer_activation || now >= _timer_activation) {
+            // A zero delta would disarm the timer, so use the smallest possible
+            // delay for timers that are due already.
+            const datetime::delta delta = next > now ?
+                next - now : datetime::delta(0, 1);
             LD(F("Reprogramming timer; firing on %s; now is %s") % next % now);
             safe_setitimer(delta, NULL);
-            _timer_activation = next;
+            _timer_activation = now + delta;
         }
     }
 
@@ -240,7 +299,8 @@ public:
     ///
     /// \throw system_error If the programming fails.
     global_state(signals::timer* timer, const datetime::timestamp& now) :
-        _timer_activation(timer->when())
+        _timer_activation(timer->when()),
+        _next_id(0)
     {
         PRE(now < timer->when());
 
@@ -255,7 +315,7 @@ public:
         try {
             safe_setitimer(delta, &_old_timeval);
             _timer_activation = timer->when();
-            add_to_all_timers(timer);
+            add_timer(timer);
         } catch (...) {
             _sigalrm_programmer.reset(NULL);
             throw;
@@ -294,19 +354,20 @@ public:
     {
         signals::interrupts_inhibiter inhibiter;
 
-        add_to_all_timers(timer);
+        compact_heap(inhibiter);
+        add_timer(timer);
         reprogram_system_timer(now, inhibiter);
     }
 
     /// Unprograms a timer.
     ///
-    /// This removes the timer from the global state and reprograms the global
-    /// system timer if necessary.
+    /// This removes the timer from the global state but does not reprogram the
+    /// global system timer: if the timer was the next one to fire, the system
+    /// timer fires for nothing and is then rearmed for the next live timer.
     ///
     /// \param timer The timer to unprogram.
     ///
-    /// \return True if the system interval timer has been reprogrammed to
-    /// another future timer; false if there are no more active timers.
+    /// \return True if there are other active timers; false otherwise.
     bool
     unprogram(signals::timer* timer)
     {
@@ -314,13 +375,10 @@ public:
 
         LD(F("Unprogramming timer; previously firing on %s") % timer->when());
 
-        remove_from_all_timers(timer);
-        if (_all_timers.empty()) {
-            return false;
-        } else {
-            reprogram_system_timer(datetime::timestamp::now(), inhibiter);
-            return true;
-        }
+        // We may not find the timer if it has fired, because fire() took it
+        // out from the live timers.
+        _live_timers.erase(timer);
+        return !_live_timers.empty();
     }
 
     /// Executes active timers.
@@ -529,7 +587,9 @@ signals::timer::unprogram(void)
         return;
     }
 
-    if (!globals->unprogram(this)) {
+    // The global state is gone if this timer fired and all other timers were
+    // unprogrammed since.
+    if (globals.get() != NULL && !globals->unprogram(this)) {
         globals.reset(NULL);
     }
     _pimpl->programmed = false;
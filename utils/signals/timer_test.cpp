@@ -35,6 +35,7 @@ extern "C" {
 
 #include <cstddef>
 #include <iostream>
+#include <set>
 #include <vector>
 
 #include <atf-c++.hpp>
@@ -411,6 +412,60 @@ ATF_TEST_CASE_BODY(infinitesimal)
 }
 
 
+ATF_TEST_CASE(many_concurrent);
+ATF_TEST_CASE_HEAD(many_concurrent)
+{
+    set_md_var("descr", "Programs lots of concurrent timers and cancels most "
+               "of them before they fire, as happens with the deadlines of "
+               "tests run in parallel, and reports how long this takes");
+    set_md_var("timeout", "60");
+}
+ATF_TEST_CASE_BODY(many_concurrent)
+{
+    const int num_timers = 10000;
+
+    std::vector< int > fired;
+    std::vector< signals::timer* > timers;
+    timers.reserve(num_timers);
+
+    const datetime::timestamp start_program = datetime::timestamp::now();
+    for (int i = 0; i < num_timers; ++i) {
+        // Spread the activations over one second, starting in the future
+        // enough for the cancellations below to happen before any firing.
+        timers.push_back(new delayed_inserter(
+            datetime::delta(1, (i % 1000) * 1000), fired, i));
+    }
+    const datetime::timestamp end_program = datetime::timestamp::now();
+
+    std::vector< signals::timer* > kept;
+    std::set< int > exp_fired;
+    for (int i = 0; i < num_timers; ++i) {
+        if (i % 10 == 0) {
+            kept.push_back(timers[i]);
+            exp_fired.insert(i);
+        } else {
+            timers[i]->unprogram();
+            delete timers[i];
+        }
+    }
+    const datetime::timestamp end_unprogram = datetime::timestamp::now();
+
+    wait_timers(kept);
+    for (std::vector< signals::timer* >::iterator iter = kept.begin();
+         iter != kept.end(); ++iter) {
+        (*iter)->unprogram();
+        delete *iter;
+    }
+
+    std::cout << F("Programmed %s timers in %s; unprogrammed %s of them in "
+                   "%s\n") % num_timers % (end_program - start_program) %
+        (num_timers - kept.size()) % (end_unprogram - end_program);
+
+    ATF_REQUIRE(exp_fired == std::set< int >(fired.begin(), fired.end()));
+    ATF_REQUIRE_EQ(kept.size(), fired.size());
+}
+
+
 ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, program_seconds);
@@ -423,4 +478,5 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, reprogram_from_scratch);
     ATF_ADD_TEST_CASE(tcs, unprogram);
     ATF_ADD_TEST_CASE(tcs, infinitesimal);
+    ATF_ADD_TEST_CASE(tcs, many_concurrent);
 }
@@ -0,0 +1,135 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "utils/sqlite/blob_io.hpp"
+
+extern "C" {
+#include <sqlite3.h>
+}
+
+#include "utils/format/macros.hpp"
+#include "utils/logging/macros.hpp"
+#include "utils/noncopyable.hpp"
+#include "utils/sanity.hpp"
+#include "utils/sqlite/database.hpp"
+#include "utils/sqlite/exceptions.hpp"
+
+namespace sqlite = utils::sqlite;
+
+
+/// Internal implementation for the BLOB handle.
+struct utils::sqlite::blob_io::impl : utils::noncopyable {
+    /// The database this BLOB belongs to.
+    database& db;
+
+    /// The SQLite 3 internal BLOB handle.
+    ::sqlite3_blob* blob;
+
+    /// Constructor.
+    ///
+    /// \param db_ The database this BLOB belongs to.
+    /// \param blob_ The SQLite internal BLOB handle.
+    impl(database& db_, ::sqlite3_blob* blob_) :
+        db(db_),
+        blob(blob_)
+    {
+    }
+
+    /// Destructor.
+    ~impl(void)
+    {
+        const int error = ::sqlite3_blob_close(blob);
+        if (error != SQLITE_OK)
+            LW(F("Error %s while closing a BLOB handle") % error);
+    }
+};
+
+
+/// Initializes a BLOB handle.
+///
+/// This is an internal function.  Use database::open_blob() to instantiate one
+/// of these objects.
+///
+/// \param db The database this BLOB belongs to.
+/// \param raw_blob A pointer to the SQLite internal BLOB handle.
+sqlite::blob_io::blob_io(database& db, void* raw_blob) :
+    _pimpl(new impl(db, static_cast< ::sqlite3_blob* >(raw_blob)))
+{
+}
+
+
+/// Destructor for the BLOB handle.
+sqlite::blob_io::~blob_io(void)
+{
+}
+
+
+/// Returns the size of the BLOB.
+///
+/// \return The size of the BLOB in bytes.
+int
+sqlite::blob_io::size(void)
+{
+    return ::sqlite3_blob_bytes(_pimpl->blob);
+}
+
+
+/// Reads a piece of the BLOB.
+///
+/// \param buffer The memory into which to read.
+/// \param length The number of bytes to read.
+/// \param offset The position within the BLOB from which to start reading.
+///
+/// \throw api_error If the read fails; for example, if the requested piece
+///     goes past the end of the BLOB.
+void
+sqlite::blob_io::read(void* buffer, const int length, const int offset)
+{
+    if (::sqlite3_blob_read(_pimpl->blob, buffer, length, offset) != SQLITE_OK)
+        throw api_error::from_database(_pimpl->db, "sqlite3_blob_read");
+}
+
+
+/// Writes a piece of the BLOB.
+///
+/// The size of a BLOB cannot be changed through this interface, so the BLOB
+/// must have been created with enough space for all the writes.
+///
+/// \param buffer The data to write.
+/// \param length The number of bytes to write.
+/// \param offset The position within the BLOB at which to start writing.
+///
+/// \throw api_error If the write fails; for example, if the handle was opened
+///     in read-only mode or if the piece goes past the end of the BLOB.
+void
+sqlite::blob_io::write(const void* buffer, const int length, const int offset)
+{
+    if (::sqlite3_blob_write(_pimpl->blob, buffer, length, offset) !=
+        SQLITE_OK)
+        throw api_error::from_database(_pimpl->db, "sqlite3_blob_write");
+}
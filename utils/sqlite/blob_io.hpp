@@ -0,0 +1,76 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/// \file utils/sqlite/blob_io.hpp
+/// A RAII model for incremental I/O on SQLite BLOBs.
+///
+/// Incremental I/O allows reading and writing a BLOB stored in the database in
+/// pieces, which avoids having to hold the whole BLOB in memory.  BLOBs to be
+/// written incrementally must be created first with their final size, which is
+/// done by binding a sqlite::zeroblob to the statement that inserts them.
+
+#if !defined(UTILS_SQLITE_BLOB_IO_HPP)
+#define UTILS_SQLITE_BLOB_IO_HPP
+
+#include "utils/sqlite/blob_io_fwd.hpp"
+
+#include <memory>
+
+#include "utils/sqlite/database_fwd.hpp"
+
+namespace utils {
+namespace sqlite {
+
+
+/// A RAII model for an open SQLite 3 BLOB handle.
+///
+/// The handle is automatically closed when it goes out of scope.  Because it
+/// holds a reference to its database, the handle must be destroyed before the
+/// database is closed.
+class blob_io {
+    struct impl;
+
+    /// Pointer to the shared internal implementation.
+    std::shared_ptr< impl > _pimpl;
+
+    blob_io(database&, void*);
+    friend class database;
+
+public:
+    ~blob_io(void);
+
+    int size(void);
+    void read(void*, const int, const int);
+    void write(const void*, const int, const int);
+};
+
+
+}  // namespace sqlite
+}  // namespace utils
+
+#endif  // !defined(UTILS_SQLITE_BLOB_IO_HPP)
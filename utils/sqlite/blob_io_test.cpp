@@ -0,0 +1,117 @@
+// Copyright 2026 The Kyua Authors.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+// * Neither the name of Google Inc. nor the names of its contributors
+//   may be used to endorse or promote products derived from this software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "utils/sqlite/blob_io.hpp"
+
+#include <cstring>
+
+#include <atf-c++.hpp>
+
+#include "utils/sqlite/database.hpp"
+#include "utils/sqlite/exceptions.hpp"
+#include "utils/sqlite/statement.ipp"
+
+namespace sqlite = utils::sqlite;
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(read);
+ATF_TEST_CASE_BODY(read)
+{
+    sqlite::database db = sqlite::database::in_memory();
+    db.exec("CREATE TABLE t (id INTEGER PRIMARY KEY, data BLOB);"
+            "INSERT INTO t VALUES (5, x'0102030405060708')");
+
+    sqlite::blob_io blob = db.open_blob("t", "data", 5, false);
+    ATF_REQUIRE_EQ(8, blob.size());
+
+    char buffer[3];
+    blob.read(buffer, 3, 0);
+    ATF_REQUIRE(std::memcmp("\x01\x02\x03", buffer, 3) == 0);
+    blob.read(buffer, 3, 5);
+    ATF_REQUIRE(std::memcmp("\x06\x07\x08", buffer, 3) == 0);
+    ATF_REQUIRE_THROW(sqlite::api_error, blob.read(buffer, 3, 6));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(write);
+ATF_TEST_CASE_BODY(write)
+{
+    sqlite::database db = sqlite::database::in_memory();
+    db.exec("CREATE TABLE t (id INTEGER PRIMARY KEY, data BLOB)");
+
+    sqlite::statement stmt = db.create_statement(
+        "INSERT INTO t (data) VALUES (:data)");
+    stmt.bind(":data", sqlite::zeroblob(6));
+    stmt.step_without_results();
+
+    {
+        sqlite::blob_io blob = db.open_blob("t", "data",
+                                            db.last_insert_rowid(), true);
+        blob.write("abc", 3, 0);
+        blob.write("def", 3, 3);
+        ATF_REQUIRE_THROW(sqlite::api_error, blob.write("g", 1, 6));
+    }
+
+    sqlite::statement query = db.create_statement("SELECT data FROM t");
+    ATF_REQUIRE(query.step());
+    const sqlite::blob contents = query.column_blob(0);
+    ATF_REQUIRE_EQ(6, contents.size);
+    ATF_REQUIRE(std::memcmp("abcdef", contents.memory, 6) == 0);
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(write__read_only);
+ATF_TEST_CASE_BODY(write__read_only)
+{
+    sqlite::database db = sqlite::database::in_memory();
+    db.exec("CREATE TABLE t (id INTEGER PRIMARY KEY, data BLOB);"
+            "INSERT INTO t VALUES (1, x'00')");
+
+    sqlite::blob_io blob = db.open_blob("t", "data", 1, false);
+    ATF_REQUIRE_THROW(sqlite::api_error, blob.write("a", 1, 0));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(open_blob__missing_row);
+ATF_TEST_CASE_BODY(open_blob__missing_row)
+{
+    sqlite::database db = sqlite::database::in_memory();
+    db.exec("CREATE TABLE t (id INTEGER PRIMARY KEY, data BLOB)");
+
+    ATF_REQUIRE_THROW_RE(sqlite::api_error, "sqlite3_blob_open",
+                         db.open_blob("t", "data", 1, false));
+}
+
+
+ATF_INIT_TEST_CASES(tcs)
+{
+    ATF_ADD_TEST_CASE(tcs, read);
+    ATF_ADD_TEST_CASE(tcs, write);
+    ATF_ADD_TEST_CASE(tcs, write__read_only);
+    ATF_ADD_TEST_CASE(tcs, open_blob__missing_row);
+}
@@ -33,7 +33,9 @@ extern "C" {
 }
 
 #include <cstring>
+#include <map>
 #include <stdexcept>
+#include <utility>
 
 #include "utils/format/macros.hpp"
 #include "utils/fs/path.hpp"
@@ -41,6 +43,7 @@ extern "C" {
 #include "utils/noncopyable.hpp"
 #include "utils/optional.ipp"
 #include "utils/sanity.hpp"
+#include "utils/sqlite/blob_io.hpp"
 #include "utils/sqlite/exceptions.hpp"
 #include "utils/sqlite/statement.ipp"
 #include "utils/sqlite/transaction.hpp"
@@ -63,6 +66,18 @@ struct utils::sqlite::database::impl : utils::noncopyable {
     /// Whether we own the database or not (to decide if we close it).
     bool owned;
 
+    /// Non-owning database object for the statements in statement_cache.
+    ///
+    /// Statements keep a reference to the database object they were created
+    /// from, so the cached statements cannot reference the short-lived objects
+    /// that our callers use to access the cache.  We cannot reference a
+    /// database object that shares this impl either, as that would create a
+    /// reference cycle.
+    std::auto_ptr< database > cache_db;
+
+    /// Prepared statements handed out by cached_statement(), keyed by SQL.
+    std::map< std::string, statement > statement_cache;
+
     /// Constructor.
     ///
     /// \param db_filename_ The path to the database as seen at construction
@@ -126,6 +141,9 @@ struct utils::sqlite::database::impl : utils::noncopyable {
     close(void)
     {
         PRE(db != NULL);
+        // Cached statements must be finalized before closing the database.
+        statement_cache.clear();
+        cache_db.reset(NULL);
         int error = ::sqlite3_close(db);
         // For now, let's consider a return of SQLITE_BUSY an error.  We should
         // not be trying to close a busy database in our code.  Maybe revisit
@@ -300,6 +318,30 @@ sqlite::database::begin_transaction(void)
 }
 
 
+/// Opens a BLOB for incremental I/O.
+///
+/// \param table The name of the table that contains the BLOB.
+/// \param column The name of the column that contains the BLOB.
+/// \param rowid The identifier of the row that contains the BLOB.
+/// \param writable Whether to open the BLOB for writing as well as reading.
+///
+/// \return A handle to the BLOB.
+///
+/// \throw api_error If the BLOB cannot be opened; for example, if the row does
+///     not exist or if the value in the given column is not a BLOB.
+sqlite::blob_io
+sqlite::database::open_blob(const char* table, const char* column,
+                            const int64_t rowid, const bool writable)
+{
+    sqlite3_blob* blob;
+    const int error = ::sqlite3_blob_open(_pimpl->db, "main", table, column,
+                                          rowid, writable ? 1 : 0, &blob);
+    if (error != SQLITE_OK)
+        throw api_error::from_database(*this, "sqlite3_blob_open");
+    return blob_io(*this, static_cast< void* >(blob));
+}
+
+
 /// Prepares a new statement.
 ///
 /// \param sql The SQL statement to prepare.
@@ -318,6 +360,39 @@ sqlite::database::create_statement(const std::string& sql)
 }
 
 
+/// Gets a prepared statement from the cache, preparing it if necessary.
+///
+/// Use this instead of create_statement() for statements that are executed
+/// many times over the lifetime of the database to avoid parsing and planning
+/// them on every execution.
+///
+/// \pre Any previous user of the same statement must be done with it, as the
+/// statement is shared.
+///
+/// \param sql The SQL statement to prepare.
+///
+/// \return The prepared statement, reset and with no values bound.
+///
+/// \throw api_error If there is any problem preparing the statement.
+sqlite::statement
+sqlite::database::cached_statement(const std::string& sql)
+{
+    std::map< std::string, statement >::iterator iter =
+        _pimpl->statement_cache.find(sql);
+    if (iter == _pimpl->statement_cache.end()) {
+        if (_pimpl->cache_db.get() == NULL)
+            _pimpl->cache_db.reset(new database(_pimpl->db_filename,
+                                                _pimpl->db, false));
+        iter = _pimpl->statement_cache.insert(
+            std::make_pair(sql, _pimpl->cache_db->create_statement(sql))).first;
+    } else {
+        (*iter).second.reset();
+        (*iter).second.clear_bindings();
+    }
+    return (*iter).second;
+}
+
+
 /// Returns the row identifier of the last insert.
 ///
 /// \return A row identifier.
@@ -46,6 +46,7 @@ extern "C" {
 
 #include "utils/fs/path_fwd.hpp"
 #include "utils/optional_fwd.hpp"
+#include "utils/sqlite/blob_io_fwd.hpp"
 #include "utils/sqlite/c_gate_fwd.hpp"
 #include "utils/sqlite/statement_fwd.hpp"
 #include "utils/sqlite/transaction_fwd.hpp"
@@ -99,7 +100,9 @@ public:
     void exec(const std::string&);
 
     transaction begin_transaction(void);
+    blob_io open_blob(const char*, const char*, const int64_t, const bool);
     statement create_statement(const std::string&);
+    statement cached_statement(const std::string&);
 
     int64_t last_insert_rowid(void);
 };
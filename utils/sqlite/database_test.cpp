@@ -243,6 +243,79 @@ ATF_TEST_CASE_BODY(create_statement__fail)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(cached_statement__reuse);
+ATF_TEST_CASE_BODY(cached_statement__reuse)
+{
+    sqlite::database db = sqlite::database::in_memory();
+    db.exec("CREATE TABLE test (a INTEGER)");
+
+    for (int i = 0; i < 3; ++i) {
+        sqlite::statement stmt = db.cached_statement(
+            "INSERT INTO test VALUES (:a)");
+        stmt.bind(":a", i);
+        stmt.step_without_results();
+    }
+
+    sqlite::statement stmt = db.cached_statement(
+        "SELECT COUNT(*), SUM(a) FROM test");
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE_EQ(3, stmt.column_int(0));
+    ATF_REQUIRE_EQ(3, stmt.column_int(1));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(cached_statement__reset);
+ATF_TEST_CASE_BODY(cached_statement__reset)
+{
+    sqlite::database db = sqlite::database::in_memory();
+    db.exec("CREATE TABLE test (a INTEGER)");
+    db.exec("INSERT INTO test VALUES (1)");
+    db.exec("INSERT INTO test VALUES (2)");
+
+    const char* sql = "SELECT a FROM test WHERE a >= :min ORDER BY a";
+    {
+        sqlite::statement stmt = db.cached_statement(sql);
+        stmt.bind(":min", 1);
+        ATF_REQUIRE(stmt.step());
+        ATF_REQUIRE_EQ(1, stmt.column_int(0));
+    }
+    {
+        // The previous binding must be gone, so :min is NULL.
+        sqlite::statement stmt = db.cached_statement(sql);
+        ATF_REQUIRE(!stmt.step());
+    }
+    {
+        // The statement must start from the first row again.
+        sqlite::statement stmt = db.cached_statement(sql);
+        stmt.bind(":min", 1);
+        ATF_REQUIRE(stmt.step());
+        ATF_REQUIRE_EQ(1, stmt.column_int(0));
+    }
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(cached_statement__close);
+ATF_TEST_CASE_BODY(cached_statement__close)
+{
+    sqlite::database db = sqlite::database::in_memory();
+    {
+        sqlite::statement stmt = db.cached_statement("SELECT 3");
+        ATF_REQUIRE(stmt.step());
+    }
+    // Would crash if the cached statement was not finalized.
+    db.close();
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(cached_statement__fail);
+ATF_TEST_CASE_BODY(cached_statement__fail)
+{
+    sqlite::database db = sqlite::database::in_memory();
+    REQUIRE_API_ERROR("sqlite3_prepare_v2",
+                      db.cached_statement("SELECT * FROM missing"));
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(last_insert_rowid);
 ATF_TEST_CASE_BODY(last_insert_rowid)
 {
@@ -283,5 +356,10 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, create_statement__ok);
     ATF_ADD_TEST_CASE(tcs, create_statement__fail);
 
+    ATF_ADD_TEST_CASE(tcs, cached_statement__reuse);
+    ATF_ADD_TEST_CASE(tcs, cached_statement__reset);
+    ATF_ADD_TEST_CASE(tcs, cached_statement__close);
+    ATF_ADD_TEST_CASE(tcs, cached_statement__fail);
+
     ATF_ADD_TEST_CASE(tcs, last_insert_rowid);
 }
@@ -103,11 +103,14 @@ sqlite::error::db_filename(void) const
 ///     for error reporting purposes.
 /// \param api_function_ The name of the API function that caused the error.
 /// \param message_ The plain-text error message provided by SQLite.
+/// \param code_ The extended result code provided by SQLite.
 sqlite::api_error::api_error(const optional< fs::path >& db_filename_,
                              const std::string& api_function_,
-                             const std::string& message_) :
+                             const std::string& message_,
+                             const int code_) :
     error(db_filename_, F("%s (sqlite op: %s)") % message_ % api_function_),
-    _api_function(api_function_)
+    _api_function(api_function_),
+    _code(code_)
 {
 }
 
@@ -124,14 +127,14 @@ sqlite::api_error::~api_error(void) throw()
 /// \param api_function_ The name of the SQLite C API function that caused the
 ///     error.
 ///
-/// \return A new api_error with the retrieved message.
+/// \return A new api_error with the retrieved message and result code.
 sqlite::api_error
 sqlite::api_error::from_database(database& database_,
                                  const std::string& api_function_)
 {
     ::sqlite3* c_db = database_c_gate(database_).c_database();
     return api_error(database_.db_filename(), api_function_,
-                     ::sqlite3_errmsg(c_db));
+                     ::sqlite3_errmsg(c_db), ::sqlite3_extended_errcode(c_db));
 }
 
 
@@ -145,6 +148,35 @@ sqlite::api_error::api_function(void) const
 }
 
 
+/// Gets the extended result code that SQLite reported for this error.
+///
+/// \return One of the SQLITE_* extended result codes.
+int
+sqlite::api_error::code(void) const
+{
+    return _code;
+}
+
+
+/// Checks if the error was caused by a hot journal in a read-only database.
+///
+/// SQLite cannot roll back the changes of an interrupted writer through a
+/// read-only connection, so it refuses to read the database until a read-write
+/// connection does so.
+///
+/// \return True if the database must be opened in read-write mode to recover
+/// it; false otherwise.
+bool
+sqlite::api_error::is_readonly_rollback(void) const
+{
+#if defined(SQLITE_READONLY_ROLLBACK)
+    return _code == SQLITE_READONLY_ROLLBACK;
+#else
+    return _code == SQLITE_READONLY;
+#endif
+}
+
+
 /// Constructs a new error.
 ///
 /// \param db_filename_ Database filename as returned by database::db_filename()
@@ -62,14 +62,19 @@ class api_error : public error {
     /// The name of the SQLite 3 C API function that caused this error.
     std::string _api_function;
 
+    /// The extended result code reported by SQLite for this error.
+    int _code;
+
 public:
     explicit api_error(const utils::optional< utils::fs::path >&,
-                       const std::string&, const std::string&);
+                       const std::string&, const std::string&, const int);
     virtual ~api_error(void) throw();
 
     static api_error from_database(database&, const std::string&);
 
     const std::string& api_function(void) const;
+    int code(void) const;
+    bool is_readonly_rollback(void) const;
 };
 
 
@@ -73,12 +73,14 @@ ATF_TEST_CASE_BODY(error__with_filename)
 ATF_TEST_CASE_WITHOUT_HEAD(api_error__explicit);
 ATF_TEST_CASE_BODY(api_error__explicit)
 {
-    const sqlite::api_error e(none, "some_function", "Some text");
+    const sqlite::api_error e(none, "some_function", "Some text", 1234);
     ATF_REQUIRE_EQ(
         "Some text (sqlite op: some_function) "
         "(sqlite db: in-memory or temporary)",
         std::string(e.what()));
     ATF_REQUIRE_EQ("some_function", e.api_function());
+    ATF_REQUIRE_EQ(1234, e.code());
+    ATF_REQUIRE(!e.is_readonly_rollback());
 }
 
 
@@ -103,6 +105,8 @@ ATF_TEST_CASE_BODY(api_error__from_database)
         ".*ABCDE.*\\(sqlite op: real_function\\) \\(sqlite db: test.db\\)",
         std::string(e.what()));
     ATF_REQUIRE_EQ("real_function", e.api_function());
+    ATF_REQUIRE_EQ(SQLITE_ERROR, e.code());
+    ATF_REQUIRE(!e.is_readonly_rollback());
 }
 
 
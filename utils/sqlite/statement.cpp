@@ -33,6 +33,7 @@ extern "C" {
 }
 
 #include <map>
+#include <vector>
 
 #include "utils/defs.hpp"
 #include "utils/format/macros.hpp"
@@ -111,6 +112,25 @@ struct utils::sqlite::statement::impl : utils::noncopyable {
     /// Cache for the column names in a statement; lazily initialized.
     std::map< std::string, int > column_cache;
 
+    /// Cached resolution of a parameter name to its index.
+    struct parameter_entry {
+        /// Address of the name as last passed to bind_parameter_index().
+        const char* address;
+
+        /// Copy of the name, to detect if the memory at address changed.
+        std::string name;
+
+        /// Index of the parameter.
+        int index;
+    };
+
+    /// Cache for the parameter names in a statement; lazily initialized.
+    ///
+    /// The names passed to bind() are string literals, so we can find them by
+    /// their address, which is much cheaper than looking them up by value.
+    /// Statements have few parameters, so a linear search is fine.
+    std::vector< parameter_entry > parameter_cache;
+
     /// Constructor.
     ///
     /// \param db_ The database this statement belongs to.  Be aware that we
@@ -572,6 +592,20 @@ sqlite::statement::bind(const int index, const std::string& text)
 }
 
 
+/// Binds a zero-filled blob to a prepared statement.
+///
+/// \param index The index of the binding.
+/// \param b Description of the blob.
+///
+/// \throw api_error If the binding fails.
+void
+sqlite::statement::bind(const int index, const zeroblob& b)
+{
+    const int error = ::sqlite3_bind_zeroblob(_pimpl->stmt, index, b.size);
+    handle_bind_error(_pimpl->db, "sqlite3_bind_zeroblob", error);
+}
+
+
 /// Returns the index of the highest parameter.
 ///
 /// \return A parameter index.
@@ -597,6 +631,34 @@ sqlite::statement::bind_parameter_index(const std::string& name)
 }
 
 
+/// Returns the index of a named parameter, caching the result.
+///
+/// This is the version used by the bind() template, which is called on every
+/// execution of a statement, so it avoids querying SQLite and constructing a
+/// string once the parameter has been resolved.
+///
+/// \param name The name of the parameter to be queried; must exist.
+///
+/// \return A parameter index.
+int
+sqlite::statement::bind_parameter_index(const char* name)
+{
+    std::vector< impl::parameter_entry >& cache = _pimpl->parameter_cache;
+    for (std::vector< impl::parameter_entry >::const_iterator iter =
+             cache.begin(); iter != cache.end(); ++iter) {
+        if ((*iter).address == name && (*iter).name == name)
+            return (*iter).index;
+    }
+
+    impl::parameter_entry entry;
+    entry.address = name;
+    entry.name = name;
+    entry.index = bind_parameter_index(entry.name);
+    cache.push_back(entry);
+    return entry.index;
+}
+
+
 /// Returns the name of a parameter by index.
 ///
 /// \param index The index to query; must be valid.
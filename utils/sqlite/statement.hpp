@@ -78,6 +78,25 @@ class null {
 };
 
 
+/// Representation of a BLOB filled with zeros.
+///
+/// This reserves space for a BLOB whose contents are later written with
+/// sqlite::blob_io.
+class zeroblob {
+public:
+    /// Number of bytes in the BLOB.
+    int size;
+
+    /// Constructs a new zero-filled blob.
+    ///
+    /// \param size_ The number of bytes in the BLOB.
+    explicit zeroblob(const int size_) :
+        size(size_)
+    {
+    }
+};
+
+
 /// A RAII model for an SQLite 3 statement.
 class statement {
     struct impl;
@@ -121,10 +140,12 @@ public:
     void bind(const int, const int64_t);
     void bind(const int, const null&);
     void bind(const int, const std::string&);
+    void bind(const int, const zeroblob&);
     template< class T > void bind(const char*, const T&);
 
     int bind_parameter_count(void);
     int bind_parameter_index(const std::string&);
+    int bind_parameter_index(const char*);
     std::string bind_parameter_name(const int);
 
     void clear_bindings(void);
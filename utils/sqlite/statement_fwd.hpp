@@ -49,6 +49,7 @@ enum type {
 class blob;
 class null;
 class statement;
+class zeroblob;
 
 
 }  // namespace sqlite
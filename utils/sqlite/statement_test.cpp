@@ -650,6 +650,23 @@ ATF_TEST_CASE_BODY(bind__text__transient)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(bind__zeroblob);
+ATF_TEST_CASE_BODY(bind__zeroblob)
+{
+    sqlite::database db = sqlite::database::in_memory();
+    sqlite::statement stmt = db.create_statement("SELECT 3, ?");
+
+    stmt.bind(1, sqlite::zeroblob(4));
+    ATF_REQUIRE(stmt.step());
+    ATF_REQUIRE(sqlite::type_blob == stmt.column_type(1));
+    const sqlite::blob blob = stmt.column_blob(1);
+    ATF_REQUIRE_EQ(4, blob.size);
+    const unsigned char zeros[4] = {0, 0, 0, 0};
+    ATF_REQUIRE(std::memcmp(zeros, blob.memory, 4) == 0);
+    ATF_REQUIRE(!stmt.step());
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(bind__by_name);
 ATF_TEST_CASE_BODY(bind__by_name)
 {
@@ -686,6 +703,20 @@ ATF_TEST_CASE_BODY(bind_parameter_index)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(bind_parameter_index__reused_buffer);
+ATF_TEST_CASE_BODY(bind_parameter_index__reused_buffer)
+{
+    sqlite::database db = sqlite::database::in_memory();
+    sqlite::statement stmt = db.create_statement("SELECT 3, :foo, ?, :bar");
+    char name[5];
+    std::strcpy(name, ":foo");
+    ATF_REQUIRE_EQ(1, stmt.bind_parameter_index(name));
+    ATF_REQUIRE_EQ(1, stmt.bind_parameter_index(name));
+    std::strcpy(name, ":bar");
+    ATF_REQUIRE_EQ(3, stmt.bind_parameter_index(name));
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(bind_parameter_name);
 ATF_TEST_CASE_BODY(bind_parameter_name)
 {
@@ -774,10 +805,12 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, bind__null);
     ATF_ADD_TEST_CASE(tcs, bind__text);
     ATF_ADD_TEST_CASE(tcs, bind__text__transient);
+    ATF_ADD_TEST_CASE(tcs, bind__zeroblob);
     ATF_ADD_TEST_CASE(tcs, bind__by_name);
 
     ATF_ADD_TEST_CASE(tcs, bind_parameter_count);
     ATF_ADD_TEST_CASE(tcs, bind_parameter_index);
+    ATF_ADD_TEST_CASE(tcs, bind_parameter_index__reused_buffer);
     ATF_ADD_TEST_CASE(tcs, bind_parameter_name);
 
     ATF_ADD_TEST_CASE(tcs, clear_bindings);
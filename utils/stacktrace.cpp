@@ -47,6 +47,7 @@ extern "C" {
 #include "utils/datetime.hpp"
 #include "utils/env.hpp"
 #include "utils/format/macros.hpp"
+#include "utils/fs/exceptions.hpp"
 #include "utils/fs/operations.hpp"
 #include "utils/fs/path.hpp"
 #include "utils/logging/macros.hpp"
@@ -292,6 +293,14 @@ utils::dump_stacktrace(const fs::path& program,
     const process::status& status = exit_handle.status().get();
     PRE(status.signaled() && status.coredump());
 
+    try {
+        exit_handle.write_output();
+    } catch (const fs::error& e) {
+        LW(F("Failed to write the output of the crashed program: %s") %
+           e.what());
+        return;
+    }
+
     std::ofstream gdb_err(exit_handle.stderr_file().c_str(), std::ios::app);
     if (!gdb_err) {
         LW(F("Failed to open %s to append GDB's output") %
@@ -147,3 +147,30 @@ utils::read_stream(std::istream& input)
 
     return buffer.str();
 }
+
+
+/// Copies the remaining contents of a stream into another one.
+///
+/// The contents are copied in pieces so that large streams do not need to be
+/// loaded into memory.
+///
+/// \param input The input stream from which to read.
+/// \param output The output stream in which to write.
+///
+/// \return The number of bytes copied.
+std::size_t
+utils::copy_stream(std::istream& input, std::ostream& output)
+{
+    std::size_t copied = 0;
+
+    char tmp[4096];
+    while (input.good()) {
+        input.read(tmp, sizeof(tmp));
+        if (input.good() || input.eof()) {
+            output.write(tmp, input.gcount());
+            copied += input.gcount();
+        }
+    }
+
+    return copied;
+}
@@ -50,6 +50,7 @@ std::auto_ptr< std::ostream > open_ostream(const utils::fs::path&);
 std::size_t stream_length(std::istream&);
 std::string read_file(const utils::fs::path&);
 std::string read_stream(std::istream&);
+std::size_t copy_stream(std::istream&, std::ostream&);
 
 
 }  // namespace utils
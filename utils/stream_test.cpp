@@ -140,6 +140,31 @@ ATF_TEST_CASE_BODY(read_stream__some)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(copy_stream__empty);
+ATF_TEST_CASE_BODY(copy_stream__empty)
+{
+    std::istringstream input("");
+    std::ostringstream output;
+    ATF_REQUIRE_EQ(0, utils::copy_stream(input, output));
+    ATF_REQUIRE_EQ("", output.str());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(copy_stream__some);
+ATF_TEST_CASE_BODY(copy_stream__some)
+{
+    std::string contents;
+    for (int i = 0; i < 10000; i++)
+        contents += "abcdef";
+    std::istringstream input("skip" + contents);
+    input.ignore(4);
+    std::ostringstream output("prefix");
+    output.seekp(0, std::ios::end);
+    ATF_REQUIRE_EQ(contents.length(), utils::copy_stream(input, output));
+    ATF_REQUIRE_EQ("prefix" + contents, output.str());
+}
+
+
 ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, open_ostream__stdout);
@@ -154,4 +179,7 @@ ATF_INIT_TEST_CASES(tcs)
 
     ATF_ADD_TEST_CASE(tcs, read_stream__empty);
     ATF_ADD_TEST_CASE(tcs, read_stream__some);
+
+    ATF_ADD_TEST_CASE(tcs, copy_stream__empty);
+    ATF_ADD_TEST_CASE(tcs, copy_stream__some);
 }
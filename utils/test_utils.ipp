@@ -96,6 +96,22 @@ require_run_coredump_tests(const atf::tests::tc* tc)
 }
 
 
+/// Skips the test unless benchmarks have been enabled by the user.
+///
+/// Benchmarks measure the performance of an operation on large inputs and
+/// can take minutes to complete, so they are opt-in.
+///
+/// \param tc The calling test.
+inline void
+require_run_benchmarks(const atf::tests::tc* tc)
+{
+    if (!tc->has_config_var("run_benchmarks") ||
+        !text::to_type< bool >(tc->get_config_var("run_benchmarks"))) {
+        tc->skip("run_benchmarks=false; not running benchmark");
+    }
+}
+
+
 /// Prepares the test so that it can dump core, or skips it otherwise.
 ///
 /// \param tc The calling test.
@@ -28,19 +28,240 @@
 
 #include "utils/text/operations.ipp"
 
+extern "C" {
+#include <stdint.h>
+}
+
+#include <cstring>
+#include <ostream>
 #include <sstream>
 
 #include "utils/format/macros.hpp"
+#include "utils/noncopyable.hpp"
 #include "utils/sanity.hpp"
 
 namespace text = utils::text;
 
 
-/// Replaces XML special characters from an input string.
+namespace {
+
+
+/// Word with all of its bytes set to 0x01.
+static const uint64_t ones = UINT64_C(0x0101010101010101);
+
+
+/// Word with the high bit of all of its bytes set.
+static const uint64_t highs = UINT64_C(0x8080808080808080);
+
+
+/// Checks if any byte of a word has a given value.
+///
+/// \param word The bytes to check.
+/// \param byte The value to look for.
+///
+/// \return True if any of the bytes of word is byte.
+static bool
+has_byte(const uint64_t word, const unsigned char byte)
+{
+    const uint64_t diff = word ^ (ones * byte);
+    return ((diff - ones) & ~diff & highs) != 0;
+}
+
+
+/// Checks if any byte of a word may need to be escaped by escape_xml().
+///
+/// This has false positives, such as for newlines or for bytes above 0x9F, but
+/// no false negatives: the bytes of the words for which this returns false can
+/// be copied as they are.
+///
+/// \param word The bytes to check.
+///
+/// \return True if any of the bytes of word may need escaping.
+static bool
+may_need_escaping(const uint64_t word)
+{
+    // Any byte with its high bit set, which covers 0x80 and above.
+    if ((word & highs) != 0)
+        return true;
+    // Any byte below 0x20, now that we know that no high bits are set.
+    if (((word - ones * 0x20) & ~word & highs) != 0)
+        return true;
+    return has_byte(word, '"') || has_byte(word, '&') || has_byte(word, '<') ||
+        has_byte(word, '>') || has_byte(word, '\'') || has_byte(word, 0x7F);
+}
+
+
+/// Checks if a character has to be escaped by escape_xml().
 ///
 /// The list of XML special characters is specified here:
 ///     http://www.w3.org/TR/xml11/#charsets
 ///
+/// \param ch The character to check.
+///
+/// \return True if the character is an XML special character.
+static bool
+needs_escaping(const char ch)
+{
+    const unsigned char c = (unsigned char)ch;
+    return c == '"' || c == '&' || c == '<' || c == '>' || c == '\'' ||
+        (c >= 0x01 && c <= 0x08) ||
+        (c >= 0x0B && c <= 0x0C) ||
+        (c >= 0x0E && c <= 0x1F) ||
+        (c >= 0x7F && c <= 0x84) ||
+        (c >= 0x86 && c <= 0x9F);
+}
+
+
+/// Buffer to accumulate the escaped output of escape_xml().
+///
+/// Writing to a stream has a noticeable cost per call, so the short runs of
+/// characters between special characters are gathered here and written to
+/// the stream in large blocks.
+class escape_buffer : utils::noncopyable {
+    /// Stream to which to write the buffered contents.
+    std::ostream& _output;
+
+    /// Buffered contents not yet written to the output.
+    char _data[8192];
+
+    /// Number of bytes used in _data.
+    std::size_t _length;
+
+public:
+    /// Constructor.
+    ///
+    /// \param output_ Stream to which to write the buffered contents.
+    explicit escape_buffer(std::ostream& output_) :
+        _output(output_), _length(0)
+    {
+    }
+
+    /// Writes the buffered contents to the output.
+    void
+    flush(void)
+    {
+        _output.write(_data, _length);
+        _length = 0;
+    }
+
+    /// Appends bytes to the buffer.
+    ///
+    /// \param data The bytes to append.
+    /// \param length The number of bytes to append.
+    void
+    append(const char* data, const std::size_t length)
+    {
+        if (_length + length > sizeof(_data)) {
+            flush();
+            if (length > sizeof(_data)) {
+                _output.write(data, length);
+                return;
+            }
+        }
+        std::memcpy(_data + _length, data, length);
+        _length += length;
+    }
+
+    /// Appends the escaped representation of a RestrictedChar character.
+    ///
+    /// These are escaped as '&amp;#[decimal ASCII value];' so that in the XML
+    /// file we will see the escaped character.
+    ///
+    /// \param ch The character to escape.
+    void
+    append_restricted(const char ch)
+    {
+        std::string::size_type value = static_cast< std::string::size_type >(
+            ch);
+        char digits[32];
+        char* first = digits + sizeof(digits);
+        do {
+            *--first = static_cast< char >('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+
+        append("&amp;#", 6);
+        append(first, digits + sizeof(digits) - first);
+        append(";", 1);
+    }
+
+    /// Appends the escaped representation of an XML special character.
+    ///
+    /// \param ch The character to escape.  Must need escaping.
+    void
+    append_escaped(const char ch)
+    {
+        PRE(needs_escaping(ch));
+        switch (ch) {
+        case '"': append("&quot;", 6); break;
+        case '&': append("&amp;", 5); break;
+        case '<': append("&lt;", 4); break;
+        case '>': append("&gt;", 4); break;
+        case '\'': append("&apos;", 6); break;
+        default: append_restricted(ch);
+        }
+    }
+};
+
+
+}  // anonymous namespace
+
+
+/// Writes a piece of text replacing its XML special characters.
+///
+/// The input is scanned a word at a time so that the runs of characters that
+/// do not need escaping are found quickly and copied to the output in bulk.
+/// Escaping works on individual bytes, so the input can be split at any point
+/// and escaped piece by piece with the same result.
+///
+/// \param in The input to quote.
+/// \param length The number of bytes in the input.
+/// \param output The stream into which to write the quoted input.
+void
+text::escape_xml(const char* in, const std::size_t length,
+                 std::ostream& output)
+{
+    escape_buffer buffer(output);
+    const char* const end = in + length;
+    const char* run = in;
+    const char* iter = in;
+    while (iter != end) {
+        if (end - iter >= 8) {
+            uint64_t word;
+            std::memcpy(&word, iter, sizeof(word));
+            if (!may_need_escaping(word)) {
+                iter += 8;
+                continue;
+            }
+        }
+
+        const char* const block_end = end - iter >= 8 ? iter + 8 : end;
+        for (; iter != block_end; ++iter) {
+            if (needs_escaping(*iter)) {
+                buffer.append(run, iter - run);
+                buffer.append_escaped(*iter);
+                run = iter + 1;
+            }
+        }
+    }
+    buffer.append(run, end - run);
+    buffer.flush();
+}
+
+
+/// Writes a string replacing its XML special characters.
+///
+/// \param in The input to quote.
+/// \param output The stream into which to write the quoted input.
+void
+text::escape_xml(const std::string& in, std::ostream& output)
+{
+    escape_xml(in.data(), in.length(), output);
+}
+
+
+/// Replaces XML special characters from an input string.
+///
 /// \param in The input to quote.
 ///
 /// \return A quoted string without any XML special characters.
@@ -48,35 +269,7 @@ std::string
 text::escape_xml(const std::string& in)
 {
     std::ostringstream quoted;
-
-    for (std::string::const_iterator it = in.begin();
-         it != in.end(); ++it) {
-        unsigned char c = (unsigned char)*it;
-        if (c == '"') {
-            quoted << "&quot;";
-        } else if (c == '&') {
-            quoted << "&amp;";
-        } else if (c == '<') {
-            quoted << "&lt;";
-        } else if (c == '>') {
-            quoted << "&gt;";
-        } else if (c == '\'') {
-            quoted << "&apos;";
-        } else if ((c >= 0x01 && c <= 0x08) ||
-                   (c >= 0x0B && c <= 0x0C) ||
-                   (c >= 0x0E && c <= 0x1F) ||
-                   (c >= 0x7F && c <= 0x84) ||
-                   (c >= 0x86 && c <= 0x9F)) {
-            // for RestrictedChar characters, escape them
-            // as '&amp;#[decimal ASCII value];'
-            // so that in the XML file we will see the escaped
-            // character.
-            quoted << "&amp;#" << static_cast< std::string::size_type >(*it)
-                   << ";";
-        } else {
-            quoted << *it;
-        }
-    }
+    escape_xml(in, quoted);
     return quoted.str();
 }
 
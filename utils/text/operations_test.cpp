@@ -28,21 +28,87 @@
 
 #include "utils/text/operations.ipp"
 
+#include <algorithm>
 #include <iostream>
 #include <set>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include <atf-c++.hpp>
 
+#include "utils/datetime.hpp"
+#include "utils/format/macros.hpp"
+#include "utils/test_utils.ipp"
 #include "utils/text/exceptions.hpp"
 
+namespace datetime = utils::datetime;
 namespace text = utils::text;
 
 
 namespace {
 
 
+/// Escapes a string for XML one character at a time.
+///
+/// This is a straightforward implementation of text::escape_xml() used to
+/// validate the results of the optimized one and to compare their speed.
+///
+/// \param in The input to quote.
+///
+/// \return A quoted string without any XML special characters.
+static std::string
+simple_escape_xml(const std::string& in)
+{
+    std::ostringstream quoted;
+    for (std::string::const_iterator it = in.begin(); it != in.end(); ++it) {
+        const unsigned char c = (unsigned char)*it;
+        if (c == '"') {
+            quoted << "&quot;";
+        } else if (c == '&') {
+            quoted << "&amp;";
+        } else if (c == '<') {
+            quoted << "&lt;";
+        } else if (c == '>') {
+            quoted << "&gt;";
+        } else if (c == '\'') {
+            quoted << "&apos;";
+        } else if ((c >= 0x01 && c <= 0x08) ||
+                   (c >= 0x0B && c <= 0x0C) ||
+                   (c >= 0x0E && c <= 0x1F) ||
+                   (c >= 0x7F && c <= 0x84) ||
+                   (c >= 0x86 && c <= 0x9F)) {
+            quoted << "&amp;#" << static_cast< std::string::size_type >(*it)
+                   << ";";
+        } else {
+            quoted << *it;
+        }
+    }
+    return quoted.str();
+}
+
+
+/// Generates text that resembles the output of a test program.
+///
+/// \param length The number of bytes to generate.
+///
+/// \return Lines of text with an occasional XML special character.
+static std::string
+make_output(const std::size_t length)
+{
+    const std::string line =
+        "test_case.cpp:123: Checking that the <value> is \"right\" & valid\n"
+        "Some longer line of plain output without special characters at all\n"
+        "\tindented line with a control character \x1b[0m in it\n";
+    std::string output;
+    output.reserve(length + line.length());
+    while (output.length() < length)
+        output += line;
+    output.resize(length);
+    return output;
+}
+
+
 /// Tests text::refill() on an input string with a range of widths.
 ///
 /// \param expected The expected refilled paragraph.
@@ -96,6 +162,76 @@ ATF_TEST_CASE_BODY(escape_xml__some_escaping)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(escape_xml__stream);
+ATF_TEST_CASE_BODY(escape_xml__stream)
+{
+    std::ostringstream output;
+    text::escape_xml("Some <text>", output);
+    text::escape_xml(std::string(" and more & more"), output);
+    text::escape_xml("\"'>ignored", 3, output);
+    ATF_REQUIRE_EQ("Some &lt;text&gt; and more &amp; more&quot;&apos;&gt;",
+                   output.str());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(escape_xml__stream__all_bytes);
+ATF_TEST_CASE_BODY(escape_xml__stream__all_bytes)
+{
+    std::string input;
+    for (int i = 0; i < 256; ++i) {
+        input += "abcdefgh";
+        input += static_cast< char >(i);
+    }
+
+    // Escape the input at all alignments and in pieces of all sizes up to a
+    // few words so that all bytes are seen at every position of a word.
+    for (std::size_t offset = 0; offset < 8; ++offset) {
+        const std::string shifted = input.substr(offset);
+        const std::string expected = simple_escape_xml(shifted);
+        ATF_REQUIRE_EQ(expected, text::escape_xml(shifted));
+
+        for (std::size_t piece = 1; piece <= 24; ++piece) {
+            std::ostringstream output;
+            for (std::size_t i = 0; i < shifted.length(); i += piece)
+                text::escape_xml(shifted.data() + i,
+                                 std::min(piece, shifted.length() - i),
+                                 output);
+            ATF_REQUIRE_EQ(expected, output.str());
+        }
+    }
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(escape_xml__stream__benchmark);
+ATF_TEST_CASE_BODY(escape_xml__stream__benchmark)
+{
+    utils::require_run_benchmarks(this);
+
+    const std::size_t length = 32 * 1024 * 1024;
+    const std::size_t piece = 4096;
+    const std::string input = make_output(length);
+
+    datetime::timestamp start = datetime::timestamp::now();
+    std::ostringstream simple_output;
+    for (std::size_t i = 0; i < length; i += piece)
+        simple_output << simple_escape_xml(input.substr(i, piece));
+    const datetime::delta simple_elapsed = datetime::timestamp::now() - start;
+
+    start = datetime::timestamp::now();
+    std::ostringstream output;
+    for (std::size_t i = 0; i < length; i += piece)
+        text::escape_xml(input.data() + i, std::min(piece, length - i),
+                         output);
+    const datetime::delta elapsed = datetime::timestamp::now() - start;
+
+    ATF_REQUIRE(simple_output.str() == output.str());
+
+    std::cout << F("Escaped %s bytes in %s microseconds one character at a "
+                   "time and in %s microseconds by words\n") %
+        length % simple_elapsed.to_microseconds() % elapsed.to_microseconds();
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(quote__empty);
 ATF_TEST_CASE_BODY(quote__empty)
 {
@@ -398,6 +534,9 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, escape_xml__empty);
     ATF_ADD_TEST_CASE(tcs, escape_xml__no_escaping);
     ATF_ADD_TEST_CASE(tcs, escape_xml__some_escaping);
+    ATF_ADD_TEST_CASE(tcs, escape_xml__stream);
+    ATF_ADD_TEST_CASE(tcs, escape_xml__stream__all_bytes);
+    ATF_ADD_TEST_CASE(tcs, escape_xml__stream__benchmark);
 
     ATF_ADD_TEST_CASE(tcs, quote__empty);
     ATF_ADD_TEST_CASE(tcs, quote__no_escaping);
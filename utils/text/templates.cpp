@@ -203,323 +203,401 @@ public:
 statement_def::types_map statement_def::_types;
 
 
-/// Definition of a loop.
-///
-/// This simple structure is used to keep track of the parameters of a loop.
-struct loop_def {
-    /// The name of the vector over which this loop is iterating.
-    std::string vector;
-
-    /// The name of the iterator defined by this loop.
-    std::string iterator;
+/// Prefix that marks a line as a statement.
+static const char* const statement_prefix = "%";
 
-    /// Position in the input to which to rewind to on looping.
-    ///
-    /// This position points to the line after the loop statement, not the loop
-    /// itself.  This is one of the reasons why we have this structure, so that
-    /// we can maintain the data about the loop without having to re-process it.
-    std::istream::pos_type position;
 
-    /// Constructs a new loop definition.
-    ///
-    /// \param vector_ The name of the vector (first argument).
-    /// \param iterator_ The name of the iterator (second argumnet).
-    /// \param position_ Position of the next line after the loop statement.
-    loop_def(const std::string& vector_, const std::string& iterator_,
-             const std::istream::pos_type position_) :
-        vector(vector_), iterator(iterator_), position(position_)
-    {
-    }
-};
+/// Delimiter to surround an expression instantiation.
+static const char* const expression_delimiter = "%%";
 
 
-/// Stateful class to instantiate the templates in an input stream.
+/// Piece of a text line: either literal text or an expression to evaluate.
 ///
-/// The goal of this parser is to scan the input once and not buffer anything in
-/// memory.  The only exception are loops: loops are reinterpreted on every
-/// iteration from the same input file by rewidining the stream to the
-/// appropriate position.
-class templates_parser : utils::noncopyable {
-    /// The templates to apply.
-    ///
-    /// Note that this is not const because the parser has to have write access
-    /// to the templates.  In particular, it needs to be able to define the
-    /// iterators as regular variables.
-    text::templates_def _templates;
+/// Expressions are pre-classified when the template is compiled so that the
+/// most common ones, plain variables and vectors indexed by a loop iterator,
+/// can be evaluated without parsing them again on every render.
+struct segment {
+    /// Types of segments.
+    enum segment_type {
+        /// Literal text to print as is.
+        type_literal,
+
+        /// Reference to a variable; name holds its name.
+        type_variable,
+
+        /// Indexing of a vector; name holds the vector and index the variable.
+        type_indexed,
+
+        /// Any other expression, evaluated by templates_def::evaluate().
+        type_other,
+    };
+
+    /// The type of this segment.
+    segment_type type;
+
+    /// The literal text or the expression without its delimiters.
+    std::string contents;
+
+    /// Name of the variable or vector referenced by the expression.
+    std::string name;
 
-    /// Prefix that marks a line as a statement.
-    const std::string _prefix;
+    /// Name of the variable used to index the vector, if any.
+    std::string index;
 
-    /// Delimiter to surround an expression instantiation.
-    const std::string _delimiter;
+    /// Constructs a new literal segment.
+    ///
+    /// \param text The literal text.
+    explicit segment(const std::string& text) :
+        type(type_literal), contents(text)
+    {
+    }
 
-    /// Whether to skip incoming lines or not.
+    /// Constructs a new expression segment.
     ///
-    /// The top of the stack is true whenever we encounter a conditional that
-    /// evaluates to false or a loop that does not have any iterations left.
-    /// Under these circumstances, we need to continue scanning the input stream
-    /// until we find the matching closing endif or endloop construct.
+    /// \param expression The expression without its delimiters.
     ///
-    /// This is a stack rather than a plain boolean to allow us deal with
-    /// if-else clauses.
-    std::stack< bool > _skip;
+    /// \return The new segment.
+    static segment
+    parse_expression(const std::string& expression)
+    {
+        segment new_segment(expression);
+        new_segment.type = type_other;
+
+        const std::string::size_type paren_open = expression.find('(');
+        if (paren_open == std::string::npos) {
+            new_segment.type = type_variable;
+            new_segment.name = expression;
+        } else if (expression[expression.length() - 1] == ')' &&
+                   expression.find(')', paren_open) ==
+                   expression.length() - 1) {
+            const std::string arg0 = expression.substr(0, paren_open);
+            if (arg0 != "defined" && arg0 != "length") {
+                new_segment.type = type_indexed;
+                new_segment.name = arg0;
+                new_segment.index = expression.substr(
+                    paren_open + 1, expression.length() - paren_open - 2);
+            }
+        }
+        return new_segment;
+    }
+};
 
-    /// Current count of nested conditionals.
-    unsigned int _if_level;
 
-    /// Level of the top-most conditional that evaluated to false.
-    unsigned int _exit_if_level;
+/// Single step of a compiled template.
+///
+/// An instruction is either a chunk of text to print, made of literal and
+/// expression segments, or a statement.  Statements carry the index of the
+/// instruction with which they pair up so that conditionals and loops can jump
+/// around the program without having to rescan it.
+struct instruction {
+    /// Whether this instruction prints text or is a statement.
+    bool is_text;
 
-    /// Current count of nested loops.
-    unsigned int _loop_level;
+    /// The segments of the text to print; only valid if is_text.
+    std::vector< segment > segments;
 
-    /// Level of the top-most loop that does not have any iterations left.
-    unsigned int _exit_loop_level;
+    /// The type of the statement; only valid if !is_text.
+    statement_def::statement_type type;
 
-    /// Information about all the nested loops up to the current point.
-    std::stack< loop_def > _loops;
+    /// The arguments to the statement; only valid if !is_text.
+    std::vector< std::string > arguments;
 
-    /// Checks if a line is a statement or not.
-    ///
-    /// \param line The line to validate.
+    /// Index of the paired instruction; only valid if !is_text.
     ///
-    /// \return True if the line looks like a statement, which is determined by
-    /// checking if the line starts by the predefined prefix.
-    bool
-    is_statement(const std::string& line)
+    /// For an if, this is its else or, if there is none, its endif.  For an
+    /// else, this is its endif.  For a loop, this is its endloop, and for an
+    /// endloop, this is its loop.
+    std::size_t target;
+
+    /// Constructs a new text instruction.
+    instruction(void) :
+        is_text(true), type(statement_def::type_else), target(0)
     {
-        return ((line.length() >= _prefix.length() &&
-                 line.substr(0, _prefix.length()) == _prefix) &&
-                (line.length() < _delimiter.length() ||
-                 line.substr(0, _delimiter.length()) != _delimiter));
     }
 
-    /// Parses a given statement line into a statement definition.
+    /// Constructs a new statement instruction.
     ///
-    /// \param line The line to validate; it must be a valid statement.
-    ///
-    /// \return The parsed statement.
-    ///
-    /// \throw text::syntax_error If the input is not a valid statement.
-    statement_def
-    parse_statement(const std::string& line)
+    /// \param statement The parsed statement.
+    explicit instruction(const statement_def& statement) :
+        is_text(false), type(statement.type), arguments(statement.arguments),
+        target(0)
     {
-        PRE(is_statement(line));
-        return statement_def::parse(line.substr(_prefix.length()));
     }
 
-    /// Processes a line from the input when not in skip mode.
+    /// Appends literal text to this text instruction.
     ///
-    /// \param line The line to be processed.
-    /// \param input The input stream from which the line was read.  The current
-    ///     position in the stream must be after the line being processed.
-    /// \param output The output stream into which to write the results.
+    /// Consecutive literals are merged so that runs of plain lines are
+    /// printed in a single write.
     ///
-    /// \throw text::syntax_error If the input is not valid.
+    /// \param text The text to append.
     void
-    handle_normal(const std::string& line, std::istream& input,
-                  std::ostream& output)
+    add_literal(const std::string& text)
     {
-        if (!is_statement(line)) {
-            // Fast path.  Mostly to avoid an indentation level for the big
-            // chunk of code below.
-            output << line << '\n';
+        PRE(is_text);
+        if (text.empty())
             return;
-        }
+        if (!segments.empty() &&
+            segments.back().type == segment::type_literal)
+            segments.back().contents += text;
+        else
+            segments.push_back(segment(text));
+    }
 
-        const statement_def statement = parse_statement(line);
+    /// Appends an expression to this text instruction.
+    ///
+    /// \param expression The expression without its delimiters.
+    void
+    add_expression(const std::string& expression)
+    {
+        PRE(is_text);
+        segments.push_back(segment::parse_expression(expression));
+    }
+};
 
-        switch (statement.type) {
-        case statement_def::type_else:
-            _skip.top() = !_skip.top();
-            break;
 
-        case statement_def::type_endif:
-            _if_level--;
-            break;
+/// Gets the textual name of a statement type.
+///
+/// \param type The statement type.
+///
+/// \return The name of the statement as written in the templates.
+static const char*
+statement_name(const statement_def::statement_type type)
+{
+    switch (type) {
+    case statement_def::type_else: return "else";
+    case statement_def::type_endif: return "endif";
+    case statement_def::type_endloop: return "endloop";
+    case statement_def::type_if: return "if";
+    case statement_def::type_loop: return "loop";
+    }
+    UNREACHABLE;
+}
 
-        case statement_def::type_endloop: {
-            PRE(_loops.size() == _loop_level);
-            loop_def& loop = _loops.top();
 
-            const std::size_t next_index = 1 + text::to_type< std::size_t >(
-                _templates.get_variable(loop.iterator));
+/// Run-time state of a loop being executed.
+struct loop_state {
+    /// The name of the iterator defined by the loop.
+    const std::string* iterator;
 
-            if (next_index < _templates.get_vector(loop.vector).size()) {
-                _templates.add_variable(loop.iterator, F("%s") % next_index);
-                input.seekg(loop.position);
-            } else {
-                _loop_level--;
-                _loops.pop();
-                _templates.remove_variable(loop.iterator);
-            }
-        } break;
+    /// The index of the current iteration.
+    std::size_t index;
 
-        case statement_def::type_if: {
-            _if_level++;
-            const std::string value = _templates.evaluate(
-                statement.arguments[0]);
-            if (value.empty() || value == "0" || value == "false") {
-                _exit_if_level = _if_level;
-                _skip.push(true);
-            } else {
-                _skip.push(false);
+    /// Constructs the state of a loop at its first iteration.
+    ///
+    /// \param iterator_ The name of the iterator defined by the loop.  Must
+    ///     outlive this object.
+    explicit loop_state(const std::string& iterator_) :
+        iterator(&iterator_), index(0)
+    {
+    }
+};
+
+
+/// Formats the index of a loop iteration as a string.
+///
+/// This is equivalent to F("%s") % index but much cheaper, which matters
+/// because it is called once per iteration of every loop.
+///
+/// \param index The index to format.
+///
+/// \return The textual representation of the index.
+static std::string
+index_to_string(std::size_t index)
+{
+    char buffer[32];
+    char* pos = buffer + sizeof(buffer);
+    do {
+        *--pos = static_cast< char >('0' + index % 10);
+        index /= 10;
+    } while (index > 0);
+    return std::string(pos, buffer + sizeof(buffer) - pos);
+}
+
+
+/// Prints a segment of a text instruction.
+///
+/// \param segment_ The segment to print.
+/// \param templates The templates to use.
+/// \param loops The state of the loops being executed, from the outermost to
+///     the innermost.
+/// \param output The stream to which to write the processed text.
+///
+/// \throw text::syntax_error If the segment is an expression that cannot be
+///     evaluated.
+static void
+print_segment(const segment& segment_, const text::templates_def& templates,
+              const std::vector< loop_state >& loops, std::ostream& output)
+{
+    switch (segment_.type) {
+    case segment::type_literal:
+        output.write(segment_.contents.data(), segment_.contents.length());
+        return;
+
+    case segment::type_variable:
+        templates.print_variable(segment_.name, output);
+        return;
+
+    case segment::type_indexed:
+        // Vectors are almost always indexed by the iterator of an enclosing
+        // loop, whose numeric value we already know.  Anything else goes
+        // through the generic evaluation below.
+        for (std::vector< loop_state >::const_reverse_iterator
+                 iter = loops.rbegin(); iter != loops.rend(); ++iter) {
+            if (*(*iter).iterator == segment_.index) {
+                const std::vector< std::string >& vector =
+                    templates.get_vector(segment_.name);
+                if ((*iter).index >= vector.size())
+                    throw text::syntax_error(
+                        F("Index '%s' out of range at position '%s'") %
+                        segment_.index % (*iter).index);
+                output << vector[(*iter).index];
+                return;
             }
-        } break;
+        }
+        break;
+
+    case segment::type_other:
+        break;
+    }
+    output << templates.evaluate(segment_.contents);
+}
+
+
+/// Checks if a line is a statement or not.
+///
+/// \param line The line to validate.
+///
+/// \return True if the line looks like a statement, which is determined by
+/// checking if the line starts by the predefined prefix.
+static bool
+is_statement(const std::string& line)
+{
+    const std::string prefix(statement_prefix);
+    const std::string delimiter(expression_delimiter);
+    return ((line.length() >= prefix.length() &&
+             line.substr(0, prefix.length()) == prefix) &&
+            (line.length() < delimiter.length() ||
+             line.substr(0, delimiter.length()) != delimiter));
+}
 
-        case statement_def::type_loop: {
-            _loop_level++;
 
-            const loop_def loop(statement.arguments[0], statement.arguments[1],
-                                input.tellg());
-            if (_templates.get_vector(loop.vector).empty()) {
-                _exit_loop_level = _loop_level;
-                _skip.push(true);
+/// Splits a text line into literal and expression segments.
+///
+/// An expression is surrounded by the delimiter on both sides.  We scan the
+/// string from left to right finding any expressions that may appear and
+/// record them as separate segments.
+///
+/// Lonely or unbalanced appearances of the delimiter on the input line are
+/// not considered an error, given that the user may actually want to supply
+/// that character sequence without being interpreted as a template.
+///
+/// \param line The input line to split, without its trailing newline.
+/// \param [in,out] text The text instruction to which to append the segments.
+static void
+add_text_line(const std::string& line, instruction& text)
+{
+    const std::string delimiter(expression_delimiter);
+
+    std::string::size_type last_pos = 0;
+    while (last_pos != std::string::npos) {
+        const std::string::size_type open_pos = line.find(delimiter, last_pos);
+        if (open_pos == std::string::npos) {
+            text.add_literal(line.substr(last_pos));
+            last_pos = std::string::npos;
+        } else {
+            const std::string::size_type close_pos = line.find(
+                delimiter, open_pos + delimiter.length());
+            if (close_pos == std::string::npos) {
+                text.add_literal(line.substr(last_pos));
+                last_pos = std::string::npos;
             } else {
-                _templates.add_variable(loop.iterator, "0");
-                _loops.push(loop);
-                _skip.push(false);
+                text.add_literal(line.substr(last_pos, open_pos - last_pos));
+                text.add_expression(line.substr(
+                    open_pos + delimiter.length(),
+                    close_pos - open_pos - delimiter.length()));
+                last_pos = close_pos + delimiter.length();
             }
-        } break;
         }
     }
+    text.add_literal("\n");
+}
 
-    /// Processes a line from the input when in skip mode.
-    ///
-    /// \param line The line to be processed.
-    ///
-    /// \throw text::syntax_error If the input is not valid.
-    void
-    handle_skip(const std::string& line)
-    {
-        PRE(_skip.top());
 
-        if (!is_statement(line))
-            return;
+/// Converts an input template into a list of instructions.
+///
+/// \param input The stream from which to read the template.
+///
+/// \return The instructions of the template, with all the statements paired
+/// up with their matching closing statements.
+///
+/// \throw text::syntax_error If the input is not valid.
+static std::vector< instruction >
+compile_instructions(std::istream& input)
+{
+    std::vector< instruction > instructions;
+
+    // Indexes of the if, else and loop statements that are still open.
+    std::stack< std::size_t > open;
+
+    std::size_t lineno = 0;
+    std::string line;
+    while (std::getline(input, line).good()) {
+        ++lineno;
+
+        if (!is_statement(line)) {
+            if (instructions.empty() || !instructions.back().is_text)
+                instructions.push_back(instruction());
+            add_text_line(line, instructions.back());
+            continue;
+        }
+
+        const statement_def statement = statement_def::parse(
+            line.substr(std::string(statement_prefix).length()));
+        const std::size_t index = instructions.size();
+        instructions.push_back(instruction(statement));
 
-        const statement_def statement = parse_statement(line);
         switch (statement.type) {
         case statement_def::type_else:
-            if (_exit_if_level == _if_level)
-                _skip.top() = !_skip.top();
+            if (open.empty() ||
+                instructions[open.top()].type != statement_def::type_if)
+                throw text::syntax_error(F("Unmatched 'else' at line %s") %
+                                         lineno);
+            instructions[open.top()].target = index;
+            open.top() = index;
             break;
 
         case statement_def::type_endif:
-            INV(_if_level >= _exit_if_level);
-            if (_if_level == _exit_if_level)
-                _skip.top() = false;
-            _if_level--;
-            _skip.pop();
+            if (open.empty() ||
+                instructions[open.top()].type == statement_def::type_loop)
+                throw text::syntax_error(F("Unmatched 'endif' at line %s") %
+                                         lineno);
+            instructions[open.top()].target = index;
+            open.pop();
             break;
 
         case statement_def::type_endloop:
-            INV(_loop_level >= _exit_loop_level);
-            if (_loop_level == _exit_loop_level)
-                _skip.top() = false;
-            _loop_level--;
-            _skip.pop();
+            if (open.empty() ||
+                instructions[open.top()].type != statement_def::type_loop)
+                throw text::syntax_error(F("Unmatched 'endloop' at line %s") %
+                                         lineno);
+            instructions[open.top()].target = index;
+            instructions[index].target = open.top();
+            open.pop();
             break;
 
         case statement_def::type_if:
-            _if_level++;
-            _skip.push(true);
-            break;
-
         case statement_def::type_loop:
-            _loop_level++;
-            _skip.push(true);
-            break;
-
-        default:
+            open.push(index);
             break;
         }
     }
 
-    /// Evaluates expressions on a given input line.
-    ///
-    /// An expression is surrounded by _delimiter on both sides.  We scan the
-    /// string from left to right finding any expressions that may appear, yank
-    /// them out and call templates_def::evaluate() to get their value.
-    ///
-    /// Lonely or unbalanced appearances of _delimiter on the input line are
-    /// not considered an error, given that the user may actually want to supply
-    /// that character sequence without being interpreted as a template.
-    ///
-    /// \param in_line The input line from which to evaluate expressions.
-    ///
-    /// \return The evaluated line.
-    ///
-    /// \throw text::syntax_error If the expressions in the line are malformed.
-    std::string
-    evaluate(const std::string& in_line)
-    {
-        std::string out_line;
-
-        std::string::size_type last_pos = 0;
-        while (last_pos != std::string::npos) {
-            const std::string::size_type open_pos = in_line.find(
-                _delimiter, last_pos);
-            if (open_pos == std::string::npos) {
-                out_line += in_line.substr(last_pos);
-                last_pos = std::string::npos;
-            } else {
-                const std::string::size_type close_pos = in_line.find(
-                    _delimiter, open_pos + _delimiter.length());
-                if (close_pos == std::string::npos) {
-                    out_line += in_line.substr(last_pos);
-                    last_pos = std::string::npos;
-                } else {
-                    out_line += in_line.substr(last_pos, open_pos - last_pos);
-                    out_line += _templates.evaluate(in_line.substr(
-                        open_pos + _delimiter.length(),
-                        close_pos - open_pos - _delimiter.length()));
-                    last_pos = close_pos + _delimiter.length();
-                }
-            }
-        }
-
-        return out_line;
-    }
-
-public:
-    /// Constructs a new template parser.
-    ///
-    /// \param templates_ The templates to apply to the processed file.
-    /// \param prefix_ The prefix that identifies lines as statements.
-    /// \param delimiter_ Delimiter to surround a variable instantiation.
-    templates_parser(const text::templates_def& templates_,
-                     const std::string& prefix_,
-                     const std::string& delimiter_) :
-        _templates(templates_),
-        _prefix(prefix_),
-        _delimiter(delimiter_),
-        _if_level(0),
-        _exit_if_level(0),
-        _loop_level(0),
-        _exit_loop_level(0)
-    {
-    }
+    if (!open.empty())
+        throw text::syntax_error(F("Unterminated '%s' statement") %
+                                 statement_name(instructions[open.top()].type));
 
-    /// Applies the templates to a given input.
-    ///
-    /// \param input The stream to which to apply the templates.
-    /// \param output The stream into which to write the results.
-    ///
-    /// \throw text::syntax_error If the input is not valid.  Note that the
-    ///     is not guaranteed to be unmodified on exit if an error is
-    ///     encountered.
-    void
-    instantiate(std::istream& input, std::ostream& output)
-    {
-        std::string line;
-        while (std::getline(input, line).good()) {
-            if (!_skip.empty() && _skip.top())
-                handle_skip(line);
-            else
-                handle_normal(evaluate(line), input, output);
-        }
-    }
-};
+    return instructions;
+}
 
 
 }  // anonymous namespace
@@ -546,6 +624,7 @@ text::templates_def::add_variable(const std::string& name,
                                   const std::string& value)
 {
     PRE(_vectors.find(name) == _vectors.end());
+    PRE(_callbacks.find(name) == _callbacks.end());
     _variables[name] = value;
 }
 
@@ -578,6 +657,7 @@ void
 text::templates_def::add_vector(const std::string& name)
 {
     PRE(_variables.find(name) == _variables.end());
+    PRE(_callbacks.find(name) == _callbacks.end());
     _vectors[name] = strings_vector();
 }
 
@@ -598,19 +678,41 @@ text::templates_def::add_to_vector(const std::string& name,
 }
 
 
+/// Sets a callback variable in the templates.
+///
+/// Printing the variable invokes the callback to write its value directly to
+/// the output of the templates.  The variable cannot be used in any other
+/// expression.
+///
+/// \pre The variable must not already exist as a string variable or a vector.
+///
+/// \param name The name of the variable to set.
+/// \param callback The function to write the value of the variable.  Any
+///     state referenced by it must remain valid while the templates are used.
+void
+text::templates_def::add_callback(const std::string& name,
+                                  const callback_type& callback)
+{
+    PRE(_variables.find(name) == _variables.end());
+    PRE(_vectors.find(name) == _vectors.end());
+    _callbacks[name] = callback;
+}
+
+
 /// Checks whether a given identifier exists as a variable or a vector.
 ///
 /// This is used to implement the evaluation of conditions in if clauses.
 ///
 /// \param name The name of the variable or vector.
 ///
-/// \return True if the given name exists as a variable or a vector; false
-/// otherwise.
+/// \return True if the given name exists as a variable, a callback variable
+/// or a vector; false otherwise.
 bool
 text::templates_def::exists(const std::string& name) const
 {
     return (_variables.find(name) != _variables.end() ||
-            _vectors.find(name) != _vectors.end());
+            _vectors.find(name) != _vectors.end() ||
+            _callbacks.find(name) != _callbacks.end());
 }
 
 
@@ -620,13 +722,18 @@ text::templates_def::exists(const std::string& name) const
 ///
 /// \return The value of the requested variable.
 ///
-/// \throw text::syntax_error If the variable does not exist.
+/// \throw text::syntax_error If the variable does not exist or if it is a
+///     callback variable.
 const std::string&
 text::templates_def::get_variable(const std::string& name) const
 {
     const variables_map::const_iterator iter = _variables.find(name);
-    if (iter == _variables.end())
+    if (iter == _variables.end()) {
+        if (_callbacks.find(name) != _callbacks.end())
+            throw text::syntax_error(F("Variable '%s' can only be printed") %
+                                     name);
         throw text::syntax_error(F("Unknown variable '%s'") % name);
+    }
     return (*iter).second;
 }
 
@@ -648,6 +755,24 @@ text::templates_def::get_vector(const std::string& name) const
 }
 
 
+/// Prints the value of a variable.
+///
+/// \param name The name of the string or callback variable.
+/// \param output The stream to which to write the value.
+///
+/// \throw text::syntax_error If the variable does not exist.
+void
+text::templates_def::print_variable(const std::string& name,
+                                    std::ostream& output) const
+{
+    const callbacks_map::const_iterator iter = _callbacks.find(name);
+    if (iter != _callbacks.end())
+        (*iter).second(output);
+    else
+        output << get_variable(name);
+}
+
+
 /// Indexes a vector and gets the value.
 ///
 /// \param name The name of the vector to index.
@@ -724,6 +849,159 @@ text::templates_def::evaluate(const std::string& expression) const
 }
 
 
+/// Internal implementation for compiled_template.
+struct utils::text::compiled_template::impl : utils::noncopyable {
+    /// The instructions of the template.
+    const std::vector< instruction > instructions;
+
+    /// Constructor.
+    ///
+    /// \param input The stream from which to read the template.
+    ///
+    /// \throw text::syntax_error If the input is not valid.
+    impl(std::istream& input) :
+        instructions(compile_instructions(input))
+    {
+    }
+};
+
+
+/// Constructs a new compiled template from its implementation.
+///
+/// \param pimpl Constructed implementation of the object.
+text::compiled_template::compiled_template(std::shared_ptr< impl > pimpl) :
+    _pimpl(pimpl)
+{
+}
+
+
+/// Destructor.
+text::compiled_template::~compiled_template(void)
+{
+}
+
+
+/// Compiles a template read from a stream.
+///
+/// \param input The stream from which to read the template.
+///
+/// \return The compiled template.
+///
+/// \throw text::syntax_error If the input is not valid.
+text::compiled_template
+text::compiled_template::compile(std::istream& input)
+{
+    return compiled_template(std::shared_ptr< impl >(new impl(input)));
+}
+
+
+/// Compiles a template read from a file.
+///
+/// \param input_file The path to the template to compile.
+///
+/// \return The compiled template.
+///
+/// \throw text::error If the input file cannot be opened.
+/// \throw text::syntax_error If the input is not valid.
+text::compiled_template
+text::compiled_template::compile(const fs::path& input_file)
+{
+    std::ifstream input(input_file.c_str());
+    if (!input)
+        throw text::error(F("Failed to open %s for read") % input_file);
+    return compile(input);
+}
+
+
+/// Applies a set of templates to this compiled template.
+///
+/// The same compiled template can be rendered any number of times.
+///
+/// \param templates_ The templates to use.
+/// \param output The stream to which to write the processed text.
+///
+/// \throw text::syntax_error If any expression cannot be evaluated.  Note
+///     that the output is not guaranteed to be unmodified on exit if an error
+///     is encountered.
+void
+text::compiled_template::render(const templates_def& templates_,
+                                std::ostream& output) const
+{
+    // Loops define their iterators as regular variables, so we need a copy
+    // of the templates that we can modify.
+    text::templates_def templates = templates_;
+
+    // State of each of the nested loops being executed.
+    std::vector< loop_state > loops;
+
+    const std::vector< instruction >& instructions = _pimpl->instructions;
+    std::size_t pc = 0;
+    while (pc < instructions.size()) {
+        const instruction& current = instructions[pc];
+
+        if (current.is_text) {
+            for (std::vector< segment >::const_iterator
+                     iter = current.segments.begin();
+                 iter != current.segments.end(); ++iter)
+                print_segment(*iter, templates, loops, output);
+            ++pc;
+            continue;
+        }
+
+        switch (current.type) {
+        case statement_def::type_else:
+            // Reached at the end of the taken branch of a conditional.
+            pc = current.target + 1;
+            break;
+
+        case statement_def::type_endif:
+            ++pc;
+            break;
+
+        case statement_def::type_endloop: {
+            const instruction& loop = instructions[current.target];
+            const std::string& vector = loop.arguments[0];
+            const std::string& iterator = loop.arguments[1];
+
+            INV(!loops.empty());
+            const std::size_t next_index = loops.back().index + 1;
+            if (next_index < templates.get_vector(vector).size()) {
+                loops.back().index = next_index;
+                templates.add_variable(iterator, index_to_string(next_index));
+                pc = current.target + 1;
+            } else {
+                loops.pop_back();
+                templates.remove_variable(iterator);
+                ++pc;
+            }
+        } break;
+
+        case statement_def::type_if: {
+            const std::string value = templates.evaluate(
+                current.arguments[0]);
+            if (value.empty() || value == "0" || value == "false")
+                pc = current.target + 1;
+            else
+                ++pc;
+        } break;
+
+        case statement_def::type_loop: {
+            const std::string& vector = current.arguments[0];
+            const std::string& iterator = current.arguments[1];
+
+            if (templates.get_vector(vector).empty()) {
+                pc = current.target + 1;
+            } else {
+                loops.push_back(loop_state(iterator));
+                templates.add_variable(iterator, "0");
+                ++pc;
+            }
+        } break;
+        }
+    }
+}
+
+
 /// Applies a set of templates to an input stream.
 ///
 /// \param templates The templates to use.
@@ -735,8 +1013,7 @@ void
 text::instantiate(const templates_def& templates,
                   std::istream& input, std::ostream& output)
 {
-    templates_parser parser(templates, "%", "%%");
-    parser.instantiate(input, output);
+    compiled_template::compile(input).render(templates, output);
 }
 
 
@@ -49,15 +49,17 @@
 ///   %loop names iter
 ///     * %%last_names(iter)%%, %%names(iter)%%
 ///   %endloop
-///   %endif names
+///   %endif
 
 #if !defined(UTILS_TEXT_TEMPLATES_HPP)
 #define UTILS_TEXT_TEMPLATES_HPP
 
 #include "utils/text/templates_fwd.hpp"
 
+#include <functional>
 #include <istream>
 #include <map>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -75,6 +77,11 @@ namespace text {
 /// definition is static in the sense that this is what the caller program
 /// specifies.
 class templates_def {
+public:
+    /// Function that writes the value of a callback variable to a stream.
+    typedef std::function< void (std::ostream&) > callback_type;
+
+private:
     /// Mapping of variable names to their values.
     typedef std::map< std::string, std::string > variables_map;
 
@@ -94,6 +101,16 @@ class templates_def {
     /// Collection of vectors available to the templates.
     vectors_map _vectors;
 
+    /// Mapping of callback variable names to their functions.
+    typedef std::map< std::string, callback_type > callbacks_map;
+
+    /// Collection of callback variables available to the templates.
+    ///
+    /// These variables can only be printed.  Their values are written by the
+    /// callbacks straight into the output of the templates, which avoids
+    /// having to hold large values in memory.
+    callbacks_map _callbacks;
+
     const std::string& get_vector(const std::string&, const std::string&) const;
 
 public:
@@ -103,15 +120,40 @@ public:
     void remove_variable(const std::string&);
     void add_vector(const std::string&);
     void add_to_vector(const std::string&, const std::string&);
+    void add_callback(const std::string&, const callback_type&);
 
     bool exists(const std::string&) const;
     const std::string& get_variable(const std::string&) const;
     const strings_vector& get_vector(const std::string&) const;
+    void print_variable(const std::string&, std::ostream&) const;
 
     std::string evaluate(const std::string&) const;
 };
 
 
+/// Template parsed into an in-memory program.
+///
+/// Parsing a template is more expensive than applying a set of templates to
+/// it, so callers that instantiate the same template many times should compile
+/// it once and render the compiled version for every output.
+class compiled_template {
+    struct impl;
+
+    /// Pointer to shared implementation.
+    std::shared_ptr< impl > _pimpl;
+
+    compiled_template(std::shared_ptr< impl >);
+
+public:
+    ~compiled_template(void);
+
+    static compiled_template compile(std::istream&);
+    static compiled_template compile(const fs::path&);
+
+    void render(const templates_def&, std::ostream&) const;
+};
+
+
 void instantiate(const templates_def&, std::istream&, std::ostream&);
 void instantiate(const templates_def&, const fs::path&, const fs::path&);
 
@@ -29,14 +29,19 @@
 #include "utils/text/templates.hpp"
 
 #include <fstream>
+#include <iostream>
 #include <sstream>
 
 #include <atf-c++.hpp>
 
+#include "utils/datetime.hpp"
+#include "utils/format/macros.hpp"
 #include "utils/fs/operations.hpp"
 #include "utils/fs/path.hpp"
+#include "utils/test_utils.ipp"
 #include "utils/text/exceptions.hpp"
 
+namespace datetime = utils::datetime;
 namespace fs = utils::fs;
 namespace text = utils::text;
 
@@ -84,6 +89,16 @@ do_test_fail(const text::templates_def& templates, const std::string& input_str,
 }
 
 
+/// Callback for a template variable that prints a constant value.
+///
+/// \param output The stream to which to write the value.
+static void
+print_foo(std::ostream& output)
+{
+    output << "foo";
+}
+
+
 }  // anonymous namespace
 
 
@@ -159,6 +174,23 @@ ATF_TEST_CASE_BODY(templates_def__add_to_vector)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(templates_def__add_callback);
+ATF_TEST_CASE_BODY(templates_def__add_callback)
+{
+    text::templates_def templates;
+    ATF_REQUIRE(!templates.exists("some-name"));
+    templates.add_callback("some-name", print_foo);
+    ATF_REQUIRE(templates.exists("some-name"));
+    ATF_REQUIRE_THROW_RE(text::syntax_error,
+                         "Variable 'some-name' can only be printed",
+                         templates.get_variable("some-name"));
+
+    std::ostringstream output;
+    templates.print_variable("some-name", output);
+    ATF_REQUIRE_EQ("foo", output.str());
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(templates_def__exists__variable);
 ATF_TEST_CASE_BODY(templates_def__exists__variable)
 {
@@ -899,6 +931,50 @@ ATF_TEST_CASE_BODY(instantiate__invalid_narguments)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(instantiate__unmatched_else);
+ATF_TEST_CASE_BODY(instantiate__unmatched_else)
+{
+    do_test_fail(text::templates_def(), "a\n%else\n",
+                 "Unmatched 'else' at line 2");
+    do_test_fail(text::templates_def(), "%if a\n%else\n%else\n%endif\n",
+                 "Unmatched 'else' at line 3");
+    do_test_fail(text::templates_def(), "%loop a i\n%else\n%endloop\n",
+                 "Unmatched 'else' at line 2");
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(instantiate__unmatched_endif);
+ATF_TEST_CASE_BODY(instantiate__unmatched_endif)
+{
+    do_test_fail(text::templates_def(), "%endif\n",
+                 "Unmatched 'endif' at line 1");
+    do_test_fail(text::templates_def(), "%loop a i\n%endif\n%endloop\n",
+                 "Unmatched 'endif' at line 2");
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(instantiate__unmatched_endloop);
+ATF_TEST_CASE_BODY(instantiate__unmatched_endloop)
+{
+    do_test_fail(text::templates_def(), "%endloop\n",
+                 "Unmatched 'endloop' at line 1");
+    do_test_fail(text::templates_def(), "%if a\n%endloop\n%endif\n",
+                 "Unmatched 'endloop' at line 2");
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(instantiate__unterminated);
+ATF_TEST_CASE_BODY(instantiate__unterminated)
+{
+    do_test_fail(text::templates_def(), "%if a\n",
+                 "Unterminated 'if' statement");
+    do_test_fail(text::templates_def(), "%if a\n%else\n",
+                 "Unterminated 'else' statement");
+    do_test_fail(text::templates_def(), "%loop a i\n%if b\n%endif\n",
+                 "Unterminated 'loop' statement");
+}
+
+
 ATF_TEST_CASE_WITHOUT_HEAD(instantiate__files__ok);
 ATF_TEST_CASE_BODY(instantiate__files__ok)
 {
@@ -946,6 +1022,179 @@ ATF_TEST_CASE_BODY(instantiate__files__output_error)
 }
 
 
+ATF_TEST_CASE_WITHOUT_HEAD(compiled_template__render__many);
+ATF_TEST_CASE_BODY(compiled_template__render__many)
+{
+    std::istringstream input(
+        "Name: %%name%%\n"
+        "%loop items iter\n"
+        "%if defined(last)\n"
+        "* %%items(iter)%%, last %%last%%\n"
+        "%else\n"
+        "* %%items(iter)%%\n"
+        "%endif\n"
+        "%endloop\n"
+        "Done\n");
+    const text::compiled_template compiled =
+        text::compiled_template::compile(input);
+
+    text::templates_def templates1;
+    templates1.add_variable("name", "first");
+    templates1.add_vector("items");
+    templates1.add_to_vector("items", "a");
+    templates1.add_to_vector("items", "b");
+
+    text::templates_def templates2;
+    templates2.add_variable("name", "second");
+    templates2.add_variable("last", "z");
+    templates2.add_vector("items");
+    templates2.add_to_vector("items", "c");
+
+    text::templates_def templates3;
+    templates3.add_variable("name", "third");
+    templates3.add_vector("items");
+
+    for (int i = 0; i < 2; ++i) {
+        std::ostringstream output1;
+        compiled.render(templates1, output1);
+        ATF_REQUIRE_EQ("Name: first\n* a\n* b\nDone\n", output1.str());
+
+        std::ostringstream output2;
+        compiled.render(templates2, output2);
+        ATF_REQUIRE_EQ("Name: second\n* c, last z\nDone\n", output2.str());
+
+        std::ostringstream output3;
+        compiled.render(templates3, output3);
+        ATF_REQUIRE_EQ("Name: third\nDone\n", output3.str());
+    }
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(compiled_template__render__callback);
+ATF_TEST_CASE_BODY(compiled_template__render__callback)
+{
+    std::istringstream input(
+        "%if defined(contents)\n"
+        "<pre>%%contents%%</pre>\n"
+        "%endif\n");
+    const text::compiled_template compiled =
+        text::compiled_template::compile(input);
+
+    text::templates_def templates;
+    std::ostringstream output1;
+    compiled.render(templates, output1);
+    ATF_REQUIRE_EQ("", output1.str());
+
+    templates.add_callback("contents", print_foo);
+    std::ostringstream output2;
+    compiled.render(templates, output2);
+    ATF_REQUIRE_EQ("<pre>foo</pre>\n", output2.str());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(compiled_template__render__error);
+ATF_TEST_CASE_BODY(compiled_template__render__error)
+{
+    std::istringstream input("%%first%%\n%%second%%\n");
+    const text::compiled_template compiled =
+        text::compiled_template::compile(input);
+
+    text::templates_def templates;
+    templates.add_variable("first", "1");
+    std::ostringstream output;
+    ATF_REQUIRE_THROW_RE(text::syntax_error, "Unknown variable 'second'",
+                         compiled.render(templates, output));
+
+    templates.add_variable("second", "2");
+    std::ostringstream output2;
+    compiled.render(templates, output2);
+    ATF_REQUIRE_EQ("1\n2\n", output2.str());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(compiled_template__compile__files__ok);
+ATF_TEST_CASE_BODY(compiled_template__compile__files__ok)
+{
+    atf::utils::create_file("input.txt", "The string is: %%string%%\n");
+    const text::compiled_template compiled =
+        text::compiled_template::compile(fs::path("input.txt"));
+
+    text::templates_def templates;
+    templates.add_variable("string", "Hello, world!");
+    std::ostringstream output;
+    compiled.render(templates, output);
+    ATF_REQUIRE_EQ("The string is: Hello, world!\n", output.str());
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(compiled_template__compile__files__input_error);
+ATF_TEST_CASE_BODY(compiled_template__compile__files__input_error)
+{
+    ATF_REQUIRE_THROW_RE(text::error, "Failed to open input.txt for read",
+                         text::compiled_template::compile(
+                             fs::path("input.txt")));
+}
+
+
+ATF_TEST_CASE_WITHOUT_HEAD(compiled_template__render__benchmark);
+ATF_TEST_CASE_BODY(compiled_template__render__benchmark)
+{
+    utils::require_run_benchmarks(this);
+
+    const std::size_t pages = 100000;
+
+    std::istringstream input(
+        "<html>\n"
+        "<head><title>%%test_case%%</title></head>\n"
+        "<body>\n"
+        "<h1>%%test_case%%</h1>\n"
+        "<p>Result: %%result%%</p>\n"
+        "<table>\n"
+        "%loop metadata_var iter\n"
+        "<tr><td>%%metadata_var(iter)%%</td>"
+        "<td>%%metadata_value(iter)%%</td></tr>\n"
+        "%endloop\n"
+        "</table>\n"
+        "%if defined(stdout)\n"
+        "<pre>%%stdout%%</pre>\n"
+        "%else\n"
+        "<p>No output.</p>\n"
+        "%endif\n"
+        "</body>\n"
+        "</html>\n");
+    const text::compiled_template compiled =
+        text::compiled_template::compile(input);
+
+    text::templates_def templates;
+    templates.add_variable("result", "passed");
+    templates.add_vector("metadata_var");
+    templates.add_vector("metadata_value");
+    for (int i = 0; i < 10; ++i) {
+        templates.add_to_vector("metadata_var", F("var%s") % i);
+        templates.add_to_vector("metadata_value", F("value%s") % i);
+    }
+
+    const datetime::timestamp start = datetime::timestamp::now();
+    std::size_t total_size = 0;
+    for (std::size_t i = 0; i < pages; ++i) {
+        templates.add_variable("test_case", F("program:case%s") % i);
+        std::ostringstream output;
+        compiled.render(templates, output);
+        total_size += output.str().length();
+    }
+    const datetime::delta elapsed = datetime::timestamp::now() - start;
+
+    std::ostringstream last;
+    compiled.render(templates, last);
+    ATF_REQUIRE(last.str().find("<h1>program:case99999</h1>") !=
+                std::string::npos);
+    ATF_REQUIRE(total_size >= pages * last.str().length() / 2);
+
+    std::cout << F("Rendered %s pages (%s bytes) in %s microseconds\n") %
+        pages % total_size % elapsed.to_microseconds();
+}
+
+
 ATF_INIT_TEST_CASES(tcs)
 {
     ATF_ADD_TEST_CASE(tcs, templates_def__add_variable__first);
@@ -954,6 +1203,7 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, templates_def__add_vector__first);
     ATF_ADD_TEST_CASE(tcs, templates_def__add_vector__replace);
     ATF_ADD_TEST_CASE(tcs, templates_def__add_to_vector);
+    ATF_ADD_TEST_CASE(tcs, templates_def__add_callback);
     ATF_ADD_TEST_CASE(tcs, templates_def__exists__variable);
     ATF_ADD_TEST_CASE(tcs, templates_def__exists__vector);
     ATF_ADD_TEST_CASE(tcs, templates_def__get_variable__ok);
@@ -995,7 +1245,18 @@ ATF_INIT_TEST_CASES(tcs)
     ATF_ADD_TEST_CASE(tcs, instantiate__unknown_statement);
     ATF_ADD_TEST_CASE(tcs, instantiate__invalid_narguments);
 
+    ATF_ADD_TEST_CASE(tcs, instantiate__unmatched_else);
+    ATF_ADD_TEST_CASE(tcs, instantiate__unmatched_endif);
+    ATF_ADD_TEST_CASE(tcs, instantiate__unmatched_endloop);
+    ATF_ADD_TEST_CASE(tcs, instantiate__unterminated);
     ATF_ADD_TEST_CASE(tcs, instantiate__files__ok);
     ATF_ADD_TEST_CASE(tcs, instantiate__files__input_error);
     ATF_ADD_TEST_CASE(tcs, instantiate__files__output_error);
+
+    ATF_ADD_TEST_CASE(tcs, compiled_template__render__many);
+    ATF_ADD_TEST_CASE(tcs, compiled_template__render__callback);
+    ATF_ADD_TEST_CASE(tcs, compiled_template__render__error);
+    ATF_ADD_TEST_CASE(tcs, compiled_template__compile__files__ok);
+    ATF_ADD_TEST_CASE(tcs, compiled_template__compile__files__input_error);
+    ATF_ADD_TEST_CASE(tcs, compiled_template__render__benchmark);
 }